@@ -39,6 +39,11 @@ path: c/include/array/array.h
  #include <stddef.h>
  #include <stdbool.h>
  #include <stdlib.h>
+ #include <stdatomic.h>
+ #include <stdint.h>
+ 
+ // Maximum number of dimensions an Array can have
+ #define ARRAY_MAX_DIMS 32
  
  /**
   * @brief Enum representing the supported data types for array elements
@@ -50,21 +55,60 @@ path: c/include/array/array.h
      CHAR,
      STRING,
      BOOL,
-     ARRAY
+     ARRAY,
+     INT8,                   // int8_t
+     INT16,                  // int16_t
+     INT64,                  // int64_t
+     UINT8,                  // uint8_t
+     UINT16,                 // uint16_t
+     UINT32,                 // uint32_t
+     UINT64,                 // uint64_t
+     FLOAT16,                // IEEE 754 half precision, stored as uint16_t bits
+     BFLOAT16,               // upper 16 bits of a float, stored as uint16_t bits
+     TYPE_COUNT              // number of types (not a valid element type)
  } Type;
  
+ /**
+  * @brief Reference-counted storage shared by arrays and their copies
+  * 
+  * array_copy() of a whole contiguous array shares the buffer instead of
+  * duplicating it. The first write through any sharer (after
+  * array_make_writable) gives that array, and its views, a private copy.
+  */
+ typedef struct ArrayBuffer {
+     atomic_size_t refcount; // arrays (not views) holding this buffer
+     void *data;             // element data (parray of every holder)
+     size_t bytes;           // size of data as allocated
+     char *strings;          // STRING only: string blob
+     size_t strings_size;    // STRING only: size of the blob as allocated
+     void (*release)(struct ArrayBuffer *buffer); // frees data when the last holder goes (NULL: leave it)
+     void *context;          // owner-defined state for release (e.g. a file mapping)
+ } ArrayBuffer;
+ 
  /**
   * @brief Struct representing an array with type information
+  * 
+  * STRING arrays use an Arrow-style layout: parray holds capacity + 1 int64
+  * offsets and element k is the NUL-terminated string at strings + offsets[k],
+  * ending before offsets[k + 1]. Equal offsets mean an empty string. See
+  * array_string.h for access.
   */
  typedef struct Array {
      void *parray;           // pointer to array of data
      Type type;              // type of data
      size_t sizeof_type;     // size of each element in bytes
      size_t *shape;          // int[] for size of each dimension
+     ptrdiff_t *strides;     // elements to step for each dimension (may be negative)
+     size_t offset;          // index of the first element within parray
      size_t num_dimensions;  // number of dimensions
      size_t count;           // total number of elements
      size_t capacity;        // total number of elements that can be stored
      bool is_dynamic;        // whether the array is dynamically resizable
+     bool owns_buffer;       // whether the array holds a reference on buffer (false for views)
+     struct Array *base;     // array a view borrows its buffer from (NULL if owner)
+     char *strings;          // STRING only: byte blob the offsets in parray point into
+     size_t strings_size;    // STRING only: allocated size of the blob in bytes
+     ArrayBuffer *buffer;    // storage behind parray and strings
  } Array;
  
  /**
@@ -111,6 +155,9 @@ path: c/include/array/array.h
  /**
   * @brief Create an array with evenly spaced values
   * 
+  * Values are computed in double; integer types truncate them toward zero and
+  * clamp to the type's range, as array_astype does.
+  * 
   * @param start Start value
   * @param stop Stop value (exclusive)
   * @param step Step size
@@ -123,6 +170,8 @@ path: c/include/array/array.h
  /**
   * @brief Create an array with evenly spaced values over a specified interval
   * 
+  * Integer types truncate and clamp each point like array_arange.
+  * 
   * @param start Start value
   * @param stop Stop value (inclusive)
   * @param num_points Number of points
@@ -132,22 +181,91 @@ path: c/include/array/array.h
   */
  Array* array_linspace(double start, double stop, size_t num_points, Type type, bool is_dynamic);
  
+ /**
+  * @brief Wrap existing memory as a contiguous array without copying
+  * 
+  * @param data First element
+  * @param bytes Bytes available at data (at least count * element size)
+  * @param type Data type of elements (not STRING)
+  * @param shape Size of each dimension
+  * @param num_dimensions Number of dimensions (1 to ARRAY_MAX_DIMS)
+  * @param release Called once the last holder is freed (NULL: memory is never freed)
+  * @param context Stored in ArrayBuffer.context for release
+  * @return Array* Array over data, NULL on error (release is not called)
+  */
+ Array* array_from_buffer(void* data, size_t bytes, Type type, const size_t* shape,
+                          size_t num_dimensions, void (*release)(ArrayBuffer* buffer), void* context);
+ 
  /**
   * @brief Create a copy of an array
   * 
+  * The copy keeps the source shape and is always contiguous, so copying a
+  * strided view materializes it. A non-dynamic copy of a whole contiguous
+  * array is O(1): it shares the buffer copy-on-write, so call
+  * array_make_writable() before writing to parray directly.
+  * 
   * @param array Array to copy
   * @param is_dynamic Whether the new array can be resized
   * @return Array* Pointer to the newly created array
   */
  Array* array_copy(Array* array, bool is_dynamic);
  
+ /**
+  * @brief Give an array (and the views of its base) a buffer nobody else shares
+  * 
+  * Call before writing elements of an array that may share its buffer with
+  * a copy. Views keep aliasing their base: writing through a view is visible
+  * to the base and its other views, never to copies.
+  * 
+  * @param array Array or view about to be written
+  * @return true on success, false if a private buffer could not be allocated
+  */
+ bool array_make_writable(Array* array);
+ 
+ /**
+  * @brief Array that holds the buffer of an array or view
+  * 
+  * @param array Array or view
+  * @return Array* The view's base, or array itself
+  */
+ Array* array_root(const Array* array);
+ 
  /**
   * @brief Free memory allocated for an array
   * 
+  * Views only release their own metadata; free views before their base.
+  * Buffers shared by copies are released with the last holder.
+  * 
   * @param array Array to free
   */
  void array_free(Array* array);
  
+ /**
+  * @brief Give a contiguous array a new shape in place (same element count)
+  * 
+  * @param array Contiguous array to reshape
+  * @param shape Size of each dimension
+  * @param num_dimensions Number of dimensions (at most ARRAY_MAX_DIMS)
+  * @return true on success
+  */
+ bool array_set_shape(Array* array, const size_t* shape, size_t num_dimensions);
+ 
+ /**
+  * @brief Pointer to the first element (parray advanced by offset)
+  * 
+  * @param array Array or view
+  * @return void* Address of element (0, 0, ..., 0)
+  */
+ void* array_data(const Array* array);
+ 
+ /**
+  * @brief Whether elements are laid out densely in row-major order
+  * 
+  * @param array Array or view
+  * @return true if element i of the flattened array is at array_data() + i
+  */
+ bool array_is_contiguous(const Array* array);
+ 
  /**
   * @brief Helper function to get the size of a specified type
   * 
@@ -156,6 +274,18 @@ path: c/include/array/array.h
   */
  size_t array_sizeof_type(Type type);
  
+ /**
+  * @brief Convert between float and the 16-bit float storage types
+  * 
+  * Narrowing rounds to nearest even; values beyond the FLOAT16 range become
+  * infinity and NaNs stay (quiet) NaNs. Bulk conversions use the
+  * KERNEL_TO_FLOAT and KERNEL_FROM_FLOAT kernels instead.
+  */
+ float array_float16_to_float(uint16_t half);
+ uint16_t array_float_to_float16(float value);
+ float array_bfloat16_to_float(uint16_t half);
+ uint16_t array_float_to_bfloat16(float value);
+ 
  /**
   * @brief Helper function to create a new array structure
   * 
@@ -166,11 +296,22 @@ path: c/include/array/array.h
   */
  Array* array_create(size_t size, Type type, bool is_dynamic);
  
+ /**
+  * @brief Size of an array's data buffer in bytes
+  * 
+  * @param array Array structure
+  * @return size_t capacity * sizeof_type, plus one closing offset for STRING
+  */
+ size_t array_buffer_bytes(const Array* array);
+ 
  /**
   * @brief Helper function to allocate memory for array data
   * 
+  * Buffers are aligned to the cache line (at least 64 bytes); multi-MB buffers
+  * are huge-page aligned and advised for transparent huge pages.
+  * 
   * @param array Array structure to allocate memory for
-  * @return void* Pointer to allocated memory
+  * @return void* Pointer to allocated memory (release with memory_buffer_free)
   */
  void* array_allocate(Array* array);
  
@@ -0,0 +1,102 @@
+/*
+Lightweight compression of INT arrays
+
+array_compress() cuts an INT array (flattened in row-major order) into blocks
+of BITPACK_BLOCK values and stores every block at the narrowest fixed bit
+width that holds it, in one of two encodings picked per block:
+
+- Frame of reference (FOR): each value minus the block minimum. Narrow-range
+  data packs to the width of its range (a constant block takes no bits).
+- Delta: each difference from the previous value minus the smallest
+  difference. Sorted and slowly changing data packs to the width of its
+  steps, whatever the magnitude of the values.
+
+Blocks decode independently with the dispatched SIMD KERNEL_BITUNPACK kernel
+(and the INT KERNEL_CUMSUM kernel for delta blocks) into an L1-sized buffer,
+so decompression runs on the thread pool and random access decodes one block.
+Every block header also keeps the block's minimum and maximum: MIN and MAX
+read only the headers, and comparisons against a value decide whole blocks
+from them, decoding only the blocks that straddle the value.
+
+path: c/include/array/array_compress.h
+*/
+
+#ifndef ARRAY_COMPRESS_H
+#define ARRAY_COMPRESS_H
+
+#include "array.h"
+#include "array_mask.h"
+#include "array_reduce.h"
+#include "runtime/runtime_dispatch.h"
+
+typedef enum {
+    COMPRESS_FOR,
+    COMPRESS_DELTA
+} CompressEncoding;
+
+// One block of BITPACK_BLOCK values (the last one may be partial)
+typedef struct {
+    size_t offset;          // first packed word of the block
+    int min;                // smallest value
+    int max;                // largest value
+    int base;               // added to every packed value: min (FOR) or the smallest difference (DELTA)
+    int first;              // DELTA: the first value
+    uint8_t bits;           // packed width, 0 to 32
+    uint8_t encoding;       // CompressEncoding
+} CompressedBlock;
+
+typedef struct {
+    CompressedBlock* blocks;
+    uint32_t* packed;       // 4 * bits words per block
+    size_t count;           // number of values
+    size_t num_blocks;
+    size_t packed_words;
+} CompressedArray;
+
+/**
+ * @brief Compress an INT array
+ *
+ * @param array INT array of any shape (may be a view)
+ * @return CompressedArray* New compressed copy of array->count values (free
+ *         with array_compressed_free), NULL on error
+ */
+CompressedArray* array_compress(const Array* array);
+
+/**
+ * @brief Decompress into a new array
+ *
+ * @param compressed Compressed array
+ * @return Array* New 1-D INT array, NULL on error
+ */
+Array* array_decompress(const CompressedArray* compressed);
+
+// Free a compressed array (NULL is ignored)
+void array_compressed_free(CompressedArray* compressed);
+
+// Bytes used by the headers and the packed data
+size_t array_compressed_bytes(const CompressedArray* compressed);
+
+// Value i (< count), decoding at most one block
+int array_compressed_get(const CompressedArray* compressed, size_t i);
+
+/**
+ * @brief Reduce the compressed values without decompressing the array
+ *
+ * @param op REDUCE_SUM, REDUCE_MEAN, REDUCE_MIN or REDUCE_MAX
+ * @param compressed Compressed array
+ * @param result Output: the reduced value
+ * @return true on success; MIN, MAX and MEAN fail on empty arrays
+ */
+bool array_compressed_reduce(ReduceOp op, const CompressedArray* compressed, double* result);
+
+/**
+ * @brief Compare every value against a scalar
+ *
+ * @param cmp Predicate (value cmp scalar)
+ * @param compressed Compressed array
+ * @param value Scalar to compare against
+ * @return BitMask* New packed mask of count elements, NULL on error
+ */
+BitMask* array_compressed_compare(CompareOp cmp, const CompressedArray* compressed, int value);
+
+#endif // ARRAY_COMPRESS_H
@@ -0,0 +1,35 @@
+/*
+Element type conversion: array_astype
+
+array_astype() converts every element of an array to another element type,
+the way NumPy's astype() does for numeric arrays, except that narrowing
+saturates instead of wrapping: integers are clamped to the destination range,
+FLOAT and DOUBLE values are truncated toward zero and clamped (NaN becomes
+0), and every type converts to BOOL as value != 0. Conversions to FLOAT16 and
+BFLOAT16 round to nearest even through FLOAT (so DOUBLE is rounded twice).
+
+Each (source, destination) pair has its own dispatched SIMD kernel
+(KERNEL_ASTYPE), so there is no per-element switch over Type. The input is
+read once and the output written once, in chunks spread over the thread
+pool; the 16-bit float types pass through an L1-sized FLOAT buffer per
+chunk.
+
+path: c/include/array/array_convert.h
+*/
+
+#ifndef ARRAY_CONVERT_H
+#define ARRAY_CONVERT_H
+
+#include "array.h"
+
+/**
+ * @brief Convert an array to another element type
+ *
+ * @param array Array of any type but STRING and ARRAY (may be a view)
+ * @param type Destination type (any type but STRING and ARRAY)
+ * @return Array* New contiguous array of the same shape, NULL on error. When
+ *         the type does not change this is array_copy(array, false).
+ */
+Array* array_astype(const Array* array, Type type);
+
+#endif // ARRAY_CONVERT_H
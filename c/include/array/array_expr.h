@@ -0,0 +1,106 @@
+/*
+Deferred elementwise expressions with fused evaluation
+
+An ArrayExpr records a chain such as (a * b + c) / d as a DAG instead of
+computing each step into its own temporary. array_expr_eval() then makes a
+single pass over the data: inputs are read a cache-sized chunk at a time, every
+node runs its dispatched kernel on that chunk in L1-resident scratch, and only
+the final result is written to memory.
+
+    ArrayExpr* e = array_expr_new();
+    int ab = array_expr_mul(e, array_expr_input(e, a), array_expr_input(e, b));
+    int r = array_expr_div(e, array_expr_add(e, ab, array_expr_input(e, c)),
+                           array_expr_input(e, d));
+    Array* result = array_expr_eval(e, r);
+    array_expr_free(e);
+
+Nodes are int handles; a failed call returns -1 and any node built from -1 is
+-1 as well, so a chain only needs checking once at the end. Inputs broadcast
+together like array_math operands and must all have the same Type. Inputs
+are borrowed: they must stay alive, and unchanged, until evaluation.
+
+path: c/include/array/array_expr.h
+*/
+
+#ifndef ARRAY_EXPR_H
+#define ARRAY_EXPR_H
+
+#include "array.h"
+#include "runtime/runtime_dispatch.h"
+
+// Arrays a single evaluation may read (scalars do not count)
+#define ARRAY_EXPR_MAX_INPUTS 16
+
+typedef struct ArrayExpr ArrayExpr;
+
+/**
+ * @brief Create an empty expression graph
+ *
+ * @return ArrayExpr* New graph, NULL on allocation failure
+ */
+ArrayExpr* array_expr_new(void);
+
+/**
+ * @brief Free a graph (its input arrays are not touched)
+ */
+void array_expr_free(ArrayExpr* expr);
+
+/**
+ * @brief Add an array operand
+ *
+ * @param expr Graph
+ * @param array Array or view of INT, FLOAT, DOUBLE, CHAR or BOOL (borrowed)
+ * @return int Node handle, -1 on error
+ */
+int array_expr_input(ArrayExpr* expr, const Array* array);
+
+/**
+ * @brief Add a constant, converted to the graph's element type on evaluation
+ *
+ * @return int Node handle, -1 on error
+ */
+int array_expr_scalar(ArrayExpr* expr, double value);
+
+/**
+ * @brief Add an elementwise binary node
+ *
+ * @param op KERNEL_ADD, KERNEL_SUB, KERNEL_MUL, KERNEL_DIV, KERNEL_MIN or KERNEL_MAX
+ * @return int Node handle, -1 on error (or if a or b is -1)
+ */
+int array_expr_binary(ArrayExpr* expr, KernelOp op, int a, int b);
+
+/**
+ * @brief Add a fused multiply-add node: a * b + c
+ *
+ * @return int Node handle, -1 on error
+ */
+int array_expr_fma(ArrayExpr* expr, int a, int b, int c);
+
+// Convenience wrappers around array_expr_binary
+int array_expr_add(ArrayExpr* expr, int a, int b);
+int array_expr_sub(ArrayExpr* expr, int a, int b);
+int array_expr_mul(ArrayExpr* expr, int a, int b);
+int array_expr_div(ArrayExpr* expr, int a, int b);
+int array_expr_minimum(ArrayExpr* expr, int a, int b);
+int array_expr_maximum(ArrayExpr* expr, int a, int b);
+
+/**
+ * @brief Evaluate a node into an existing array in one fused pass
+ *
+ * @param expr Graph
+ * @param node Node to evaluate (nodes it does not depend on are skipped)
+ * @param out Array with the broadcast shape of the node's inputs (may be a
+ *            view, and may overlap the inputs: they are read as they were
+ *            before the call)
+ * @return true on success
+ */
+bool array_expr_eval_into(const ArrayExpr* expr, int node, Array* out);
+
+/**
+ * @brief Evaluate a node into a new array in one fused pass
+ *
+ * @return Array* New contiguous array with the broadcast shape, NULL on error
+ */
+Array* array_expr_eval(const ArrayExpr* expr, int node);
+
+#endif // ARRAY_EXPR_H
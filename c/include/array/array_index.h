@@ -0,0 +1,66 @@
+/*
+Integer-array indexing: take and put
+
+array_take() is NumPy's np.take: elements picked by an INT index array, either
+from the flattened array or along one axis. array_put() is the reverse, writing
+values to the picked positions. Indices may be negative (counted from the end)
+and are bounds-checked before anything is read or written.
+
+Gathers run on the dispatched TAKE kernel, which uses the hardware gather
+instructions for 4- and 8-byte elements, and on the thread pool for large
+index arrays. When the indexed array is larger than L2, the kernels prefetch
+get_gather_prefetch_distance() elements ahead, which hides most of the memory
+latency of random lookups (set_gather_prefetch_distance() tunes it).
+
+path: c/include/array/array_index.h
+*/
+
+#ifndef ARRAY_INDEX_H
+#define ARRAY_INDEX_H
+
+#include "array.h"
+
+/**
+ * @brief Elements of the flattened array at the given indices
+ *
+ * @param array Array of any element type except ARRAY (may be a view)
+ * @param indices INT array of flat indices in [-count, count) (may be a view)
+ * @return Array* New array with the shape of indices, NULL on error
+ */
+Array* array_take(const Array* array, const Array* indices);
+
+/**
+ * @brief Slices along one axis at the given indices
+ *
+ * @param array Array of any element type except ARRAY and STRING (may be a view)
+ * @param indices INT array of indices along axis, read in flat order (may be a view)
+ * @param axis Axis to index
+ * @return Array* New array with shape[axis] replaced by the number of indices, NULL on error
+ */
+Array* array_take_axis(const Array* array, const Array* indices, size_t axis);
+
+/**
+ * @brief Write values to the flattened array at the given indices
+ *
+ * Values are written in index order, so the last of repeated indices wins.
+ *
+ * @param array Array or view to write (not STRING or ARRAY)
+ * @param indices INT array of flat indices in [-count, count) (may be a view)
+ * @param values Array of the same type with one element per index, or a single element
+ * @return true on success
+ */
+bool array_put(Array* array, const Array* indices, const Array* values);
+
+/**
+ * @brief Write slices along one axis at the given indices
+ *
+ * @param array Array or view to write (not STRING or ARRAY)
+ * @param indices INT array of indices along axis, read in flat order (may be a view)
+ * @param values Array of the same type shaped like array with shape[axis] replaced
+ *               by the number of indices
+ * @param axis Axis to index
+ * @return true on success
+ */
+bool array_put_axis(Array* array, const Array* indices, const Array* values, size_t axis);
+
+#endif // ARRAY_INDEX_H
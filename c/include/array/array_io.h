@@ -0,0 +1,47 @@
+/*
+Persistence in the NumPy .npy format
+
+A .npy file is a short text header (dtype, memory order, shape) padded to a
+64-byte boundary, followed by the raw element buffer. Files written here load
+with numpy.load() and vice versa for the supported dtypes:
+
+    INT '<i4'     FLOAT '<f4'    DOUBLE '<f8'   CHAR '|i1'     BOOL '|b1'
+    INT8 '|i1'    INT16 '<i2'    INT64 '<i8'    UINT8 '|u1'    UINT16 '<u2'
+    UINT32 '<u4'  UINT64 '<u8'   FLOAT16 '<f2'
+
+(shown for a little-endian host). '|i1' files load as CHAR. BFLOAT16 has no
+NumPy dtype and cannot be saved; STRING and ARRAY are rejected too.
+
+Loading maps the file instead of reading it: the Array's buffer is the
+mapping, so opening is O(header) and pages are read on first touch. The
+mapping is private, so writes to a loaded array never reach the file.
+
+path: c/include/array/array_io.h
+*/
+
+#ifndef ARRAY_IO_H
+#define ARRAY_IO_H
+
+#include "array.h"
+
+/**
+ * @brief Write an array to a .npy file
+ *
+ * @param array Array or view (views are written in row-major order)
+ * @param path File to create or overwrite
+ * @return true on success
+ */
+bool array_save_npy(const Array* array, const char* path);
+
+/**
+ * @brief Map a .npy file as an Array
+ *
+ * Fortran-ordered files load as column-major strided arrays. The mapping is
+ * released when the array (and every copy sharing it) is freed.
+ *
+ * @param path File to open
+ * @return Array* Array over the mapped data, NULL on error
+ */
+Array* array_load_npy(const char* path);
+
+#endif // ARRAY_IO_H
@@ -0,0 +1,43 @@
+/*
+Linear algebra: matrix multiply
+
+array_matmul() multiplies 2-D FLOAT or DOUBLE arrays with a packed,
+cache-blocked GEMM in the GotoBLAS/BLIS style. Blocks of B sized for L3 and
+of A sized for L2 are copied into contiguous panels laid out in the order the
+micro-kernel reads them, so the innermost loop streams both from L1 while the
+C tile stays in registers. The micro-kernel (AVX-512, AVX2/FMA or scalar) is
+picked by the runtime dispatch registry, and blocks of C are computed on the
+thread pool.
+
+Inputs may be views: transposed operands are handled while packing, without a
+separate copy.
+
+path: c/include/array/array_linalg.h
+*/
+
+#ifndef ARRAY_LINALG_H
+#define ARRAY_LINALG_H
+
+#include "array.h"
+
+/**
+ * @brief Matrix product of two 2-D arrays
+ *
+ * @param a FLOAT or DOUBLE array of shape (m, k) (may be a view)
+ * @param b Array of the same type and shape (k, n) (may be a view)
+ * @return Array* New contiguous (m, n) array, NULL on error
+ */
+Array* array_matmul(const Array* a, const Array* b);
+
+/**
+ * @brief Matrix product written into an existing array
+ *
+ * @param a FLOAT or DOUBLE array of shape (m, k) (may be a view)
+ * @param b Array of the same type and shape (k, n) (may be a view)
+ * @param out Contiguous (m, n) array of the same type (may be a or b, or share their
+ *            buffer: the product then goes through a temporary)
+ * @return true on success
+ */
+bool array_matmul_into(const Array* a, const Array* b, Array* out);
+
+#endif // ARRAY_LINALG_H
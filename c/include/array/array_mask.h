@@ -0,0 +1,131 @@
+/*
+Boolean masks: counting and masked selection
+
+Masks are BOOL arrays, usually built with array_compare() and combined with
+array_mul (AND) and array_add (OR). array_select() is NumPy's a[mask]: the
+elements where the mask is true, in row-major order, as a new 1-D array.
+
+Selection counts the mask first, so the result is allocated once at its exact
+size, then left-packs the selected elements with the dispatched compaction
+kernel. Large arrays are counted and packed in independent blocks on the
+thread pool.
+
+BitMask is the packed form: one bit per element in 64-bit words, an eighth of
+the memory of a BOOL array. Masks combine with AND/OR/XOR/ANDNOT/NOT a word
+(64 elements) at a time, count with popcount, and convert to and from BOOL
+arrays and INT index lists. All of these run the dispatched KERNEL_BITWISE,
+KERNEL_POPCOUNT, KERNEL_PACK_BITS, KERNEL_UNPACK_BITS and KERNEL_BIT_INDICES
+kernels over ranges of words on the thread pool.
+
+path: c/include/array/array_mask.h
+*/
+
+#ifndef ARRAY_MASK_H
+#define ARRAY_MASK_H
+
+#include "array.h"
+#include "runtime/runtime_dispatch.h"
+
+/**
+ * @brief Bit-packed boolean mask
+ * 
+ * Element i is bit i % 64 of words[i / 64]. Bits past count are always 0.
+ */
+typedef struct {
+    uint64_t* words;        // (count + 63) / 64 words
+    size_t count;           // number of elements
+    size_t num_words;       // number of words
+} BitMask;
+
+/**
+ * @brief Number of true elements in a mask
+ *
+ * @param mask BOOL array (may be a view)
+ * @return size_t Count of true elements (0 on error)
+ */
+size_t array_count_true(const Array* mask);
+
+/**
+ * @brief Elements of an array where a mask is true
+ *
+ * @param array Array of any element type except ARRAY (may be a view)
+ * @param mask BOOL array with the same shape (may be a view)
+ * @return Array* New 1-D array of the selected elements, NULL on error
+ */
+Array* array_select(const Array* array, const Array* mask);
+
+/**
+ * @brief Create a packed mask with every element set to value
+ *
+ * @param count Number of elements
+ * @param value Initial value of every element
+ * @return BitMask* New mask (free with array_bitmask_free), NULL on error
+ */
+BitMask* array_bitmask_new(size_t count, bool value);
+
+// Free a packed mask (NULL is ignored)
+void array_bitmask_free(BitMask* mask);
+
+// Read and write one element (i < count)
+bool array_bitmask_get(const BitMask* mask, size_t i);
+void array_bitmask_set(BitMask* mask, size_t i, bool value);
+
+/**
+ * @brief Pack a BOOL array, in row-major order
+ *
+ * @param mask BOOL array of any shape (may be a view)
+ * @return BitMask* New mask of mask->count elements, NULL on error
+ */
+BitMask* array_bitmask_pack(const Array* mask);
+
+/**
+ * @brief Unpack a mask into a BOOL array
+ *
+ * @param mask Packed mask
+ * @return Array* New 1-D BOOL array of mask->count elements, NULL on error
+ */
+Array* array_bitmask_unpack(const BitMask* mask);
+
+/**
+ * @brief Combine two masks word by word
+ *
+ * @param op BIT_AND, BIT_OR, BIT_XOR, BIT_ANDNOT (a and not b) or BIT_NOT (b is ignored)
+ * @param a First operand
+ * @param b Second operand with a's count (may be NULL for BIT_NOT)
+ * @param out Result with a's count (may be a or b)
+ * @return true on success, false on error
+ */
+bool array_bitmask_op(BitwiseOp op, const BitMask* a, const BitMask* b, BitMask* out);
+
+// Mask algebra into new masks (NULL on error)
+BitMask* array_bitmask_and(const BitMask* a, const BitMask* b);
+BitMask* array_bitmask_or(const BitMask* a, const BitMask* b);
+BitMask* array_bitmask_xor(const BitMask* a, const BitMask* b);
+BitMask* array_bitmask_andnot(const BitMask* a, const BitMask* b);
+BitMask* array_bitmask_not(const BitMask* a);
+
+// Number of set elements (0 on error)
+size_t array_bitmask_count(const BitMask* mask);
+
+// Whether any / every element is set (false on error; all() of an empty mask is true)
+bool array_bitmask_any(const BitMask* mask);
+bool array_bitmask_all(const BitMask* mask);
+
+/**
+ * @brief Positions of the set elements
+ *
+ * @param mask Packed mask of at most INT_MAX elements
+ * @return Array* New 1-D INT array of ascending positions, NULL on error
+ */
+Array* array_bitmask_to_indices(const BitMask* mask);
+
+/**
+ * @brief Mask with the elements at the given positions set
+ *
+ * @param indices INT array of positions in [-count, count) (negatives count from the end)
+ * @param count Number of elements of the mask
+ * @return BitMask* New mask, NULL on error
+ */
+BitMask* array_bitmask_from_indices(const Array* indices, size_t count);
+
+#endif // ARRAY_MASK_H
@@ -0,0 +1,84 @@
+/*
+Elementwise math between Arrays with NumPy broadcasting
+
+Shapes are aligned from the right; each pair of dimensions must be equal or
+one of them must be 1. Both operands must have the same Type, which is also
+the result type (comparisons produce BOOL masks).
+
+path: c/include/array/array_math.h
+*/
+
+#ifndef ARRAY_MATH_H
+#define ARRAY_MATH_H
+
+#include "array.h"
+#include "runtime/runtime_dispatch.h"
+
+/**
+ * @brief Shape two arrays broadcast to
+ * 
+ * @param a First operand
+ * @param b Second operand
+ * @param shape Output: broadcast shape (ARRAY_MAX_DIMS entries)
+ * @param num_dimensions Output: number of broadcast dimensions
+ * @return true if the shapes are compatible
+ */
+bool array_broadcast_shape(const Array* a, const Array* b, size_t* shape, size_t* num_dimensions);
+
+/**
+ * @brief Apply a binary kernel elementwise with broadcasting into an existing array
+ * 
+ * @param op KERNEL_ADD, KERNEL_SUB, KERNEL_MUL, KERNEL_DIV, KERNEL_MIN or KERNEL_MAX
+ * @param a First operand
+ * @param b Second operand
+ * @param out Result with the broadcast shape (may be a view, and may overlap a or b:
+ *            overlapping operands are read as they were before the call)
+ * @return true on success
+ */
+bool array_binary_op_into(KernelOp op, const Array* a, const Array* b, Array* out);
+
+/**
+ * @brief Apply a binary kernel elementwise with broadcasting
+ * 
+ * @param op KERNEL_ADD, KERNEL_SUB, KERNEL_MUL, KERNEL_DIV, KERNEL_MIN or KERNEL_MAX
+ * @param a First operand
+ * @param b Second operand
+ * @return Array* New contiguous array with the broadcast shape, NULL on error
+ */
+Array* array_binary_op(KernelOp op, const Array* a, const Array* b);
+
+/**
+ * @brief Compare two arrays elementwise with broadcasting into an existing mask
+ * 
+ * @param cmp Predicate (CMP_EQ, CMP_NE, CMP_LT, CMP_LE, CMP_GT or CMP_GE)
+ * @param a First operand
+ * @param b Second operand (same Type as a)
+ * @param out BOOL array with the broadcast shape (may be a view, and may overlap a or b)
+ * @return true on success
+ */
+bool array_compare_into(CompareOp cmp, const Array* a, const Array* b, Array* out);
+
+/**
+ * @brief Compare two arrays elementwise with broadcasting
+ * 
+ * @return Array* New BOOL mask with the broadcast shape, NULL on error
+ */
+Array* array_compare(CompareOp cmp, const Array* a, const Array* b);
+
+/**
+ * @brief Compare every element with a single value
+ * 
+ * @param value Pointer to a value of a's Type (e.g. int* for INT)
+ * @return Array* New BOOL mask with a's shape, NULL on error
+ */
+Array* array_compare_value(CompareOp cmp, const Array* a, const void* value);
+
+// Convenience wrappers around array_binary_op
+Array* array_add(const Array* a, const Array* b);
+Array* array_sub(const Array* a, const Array* b);
+Array* array_mul(const Array* a, const Array* b);
+Array* array_div(const Array* a, const Array* b);
+Array* array_minimum(const Array* a, const Array* b);     // NaN if either element is NaN
+Array* array_maximum(const Array* a, const Array* b);     // NaN if either element is NaN
+
+#endif // ARRAY_MATH_H
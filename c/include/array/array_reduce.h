@@ -0,0 +1,82 @@
+/*
+Reductions over all elements of an Array or along one axis
+
+Contiguous runs are summed pairwise in double (FLOAT/DOUBLE) or 64-bit
+integers (the integer types and BOOL), so float results do not drift with
+length. Large reductions (strided views included) are split into fixed-size
+blocks that run on several threads; the block partials are combined in a
+fixed order, so results do not depend on the thread count. Sums along a
+non-innermost axis add whole rows and fold each block of rows into the
+result with Neumaier compensation, which keeps long axes from drifting too.
+
+Result types: SUM, PROD and MEAN give DOUBLE, MIN and MAX keep the element
+type, ARGMIN and ARGMAX give INT indices (first occurrence). INT64 and UINT64
+sums stay 64-bit integers throughout (wrapping on overflow, as in NumPy), so
+axis SUMs of those types keep the element type and are exact; a whole-array
+SUM or MEAN is that exact total rounded once to the returned double, which is
+exact up to 2^53.
+
+NaN propagates as in NumPy: MIN and MAX of FLOAT/DOUBLE data holding a NaN
+are NaN, and ARGMIN and ARGMAX give the index of the first NaN.
+
+path: c/include/array/array_reduce.h
+*/
+
+#ifndef ARRAY_REDUCE_H
+#define ARRAY_REDUCE_H
+
+#include "array.h"
+
+typedef enum {
+    REDUCE_SUM,
+    REDUCE_PROD,
+    REDUCE_MIN,
+    REDUCE_MAX,
+    REDUCE_MEAN,
+    REDUCE_ARGMIN,
+    REDUCE_ARGMAX
+} ReduceOp;
+
+/**
+ * @brief Reduce every element of an array
+ *
+ * @param op Reduction to apply
+ * @param array Array of INT, INT8, INT16, INT64, UINT8, UINT16, UINT32, UINT64, FLOAT,
+ *              DOUBLE, CHAR or BOOL (may be a view); FLOAT16, BFLOAT16, STRING and
+ *              ARRAY are rejected
+ * @param result Output: the reduced value, or the flat row-major index for ARGMIN/ARGMAX
+ * @return true on success; MIN, MAX, MEAN and the arg reductions fail on empty arrays
+ */
+bool array_reduce(ReduceOp op, const Array* array, double* result);
+
+/**
+ * @brief Reduce along one axis
+ *
+ * @param op Reduction to apply
+ * @param array Array of INT, INT8, INT16, INT64, UINT8, UINT16, UINT32, UINT64, FLOAT,
+ *              DOUBLE, CHAR or BOOL (may be a view); FLOAT16, BFLOAT16, STRING and
+ *              ARRAY are rejected
+ * @param axis Axis to reduce
+ * @return Array* New contiguous array without that axis (shape (1,) for 1-D input), NULL on error
+ */
+Array* array_reduce_axis(ReduceOp op, const Array* array, size_t axis);
+
+// Whole-array convenience wrappers (NAN, or SIZE_MAX for indices, on error)
+double array_sum(const Array* array);
+double array_prod(const Array* array);
+double array_mean(const Array* array);
+double array_min(const Array* array);
+double array_max(const Array* array);
+size_t array_argmin(const Array* array);
+size_t array_argmax(const Array* array);
+
+// Per-axis convenience wrappers around array_reduce_axis
+Array* array_sum_axis(const Array* array, size_t axis);
+Array* array_prod_axis(const Array* array, size_t axis);
+Array* array_mean_axis(const Array* array, size_t axis);
+Array* array_min_axis(const Array* array, size_t axis);
+Array* array_max_axis(const Array* array, size_t axis);
+Array* array_argmin_axis(const Array* array, size_t axis);
+Array* array_argmax_axis(const Array* array, size_t axis);
+
+#endif // ARRAY_REDUCE_H
@@ -0,0 +1,53 @@
+/*
+Prefix scans: running sums, products, minima and maxima along an axis
+
+array_scan() computes inclusive scans (element i combines elements 0..i of
+its row along the axis) or exclusive ones (elements 0..i-1, with the
+operation's identity first: 0, 1, +max or -max), so an exclusive SUM over
+row lengths gives the row offsets of ragged data. Results keep the element
+type; INT sums and products wrap on overflow. MIN and MAX propagate NaN:
+from the first NaN on, the rest of the row is NaN.
+
+Along the innermost axis the dispatched SIMD scan kernels run over each row,
+and long rows are cut into fixed blocks that are scanned on the thread pool
+in two passes: block totals, then every block again from its offset. Along
+other axes each output row is the previous one combined elementwise with the
+next input row. Fixed blocks keep results independent of the thread count,
+but float SUM and PROD are reassociated (within a SIMD register and across
+blocks); SCAN_SUM_COMPENSATED instead adds sequentially with a Neumaier
+compensation term carried in double for accurate long float sums.
+
+path: c/include/array/array_scan.h
+*/
+
+#ifndef ARRAY_SCAN_H
+#define ARRAY_SCAN_H
+
+#include "array.h"
+
+typedef enum {
+    SCAN_SUM,
+    SCAN_PROD,
+    SCAN_MIN,
+    SCAN_MAX,
+    SCAN_SUM_COMPENSATED    // SUM with Neumaier compensation (same as SUM for INT)
+} ScanOp;
+
+/**
+ * @brief Scan along one axis
+ *
+ * @param op Scan to apply
+ * @param array INT, FLOAT or DOUBLE array (may be a view)
+ * @param axis Axis to scan along
+ * @param exclusive Exclude each element from its own result
+ * @return Array* New contiguous array of the same shape and type, NULL on error
+ */
+Array* array_scan(ScanOp op, const Array* array, size_t axis, bool exclusive);
+
+// Inclusive convenience wrappers around array_scan
+Array* array_cumsum(const Array* array, size_t axis);
+Array* array_cumprod(const Array* array, size_t axis);
+Array* array_cummin(const Array* array, size_t axis);
+Array* array_cummax(const Array* array, size_t axis);
+
+#endif // ARRAY_SCAN_H
@@ -0,0 +1,82 @@
+/*
+Sorting and selection
+
+array_sort() sorts INT, FLOAT, DOUBLE and CHAR arrays in place along the last
+axis (every row of a 2-D array independently, like NumPy's default axis=-1).
+array_argsort() gives the INT indices that would sort each row instead, and
+array_partition() only puts one position of each row in its sorted place
+(NumPy's partition, C++'s nth_element). array_topk() finds the k largest or
+smallest elements of a whole array without sorting it: when only the top 100
+of millions of scores are wanted, almost every element is rejected by a
+vectorized compare against the current k-th best and never touched again.
+
+Elements are first mapped onto unsigned integer keys that order the same way
+(the sign bit flipped for integers; for floats also all other bits of
+negatives), so one set of routines handles every type and floats compare as
+plain integers. Rows of at least SORT_RADIX_MIN keys are LSD radix sorted a
+byte per pass on the thread pool, skipping bytes that are equal in every key.
+Shorter rows are merge sorted from blocks of 16 keys ordered by the dispatched
+in-register sorting network.
+
+Floating-point order is -inf < negatives < -0.0 < +0.0 < positives < +inf,
+with every NaN last. Ties in argsort and top-k go to the lower index.
+
+path: c/include/array/array_sort.h
+*/
+
+#ifndef ARRAY_SORT_H
+#define ARRAY_SORT_H
+
+#include "array.h"
+
+// Rows with at least this many elements are radix sorted
+#define SORT_RADIX_MIN 2048
+
+/**
+ * @brief Sort an array in place along its last axis
+ *
+ * @param array INT, FLOAT, DOUBLE or CHAR array or view to sort
+ * @return true on success
+ */
+bool array_sort(Array* array);
+
+/**
+ * @brief Indices that sort an array along its last axis
+ *
+ * With stable, rows are radix or merge sorted as (key, index) pairs; without
+ * it they are introsorted in place, which needs no scratch row and is
+ * O(n log n) in the worst case. Both keep equal elements in index order.
+ *
+ * @param array INT, FLOAT, DOUBLE or CHAR array or view
+ * @param stable Use the stable (radix/merge) passes
+ * @return Array* New INT array of the same shape: row positions of the
+ *         elements in sorted order, NULL on error
+ */
+Array* array_argsort(const Array* array, bool stable);
+
+/**
+ * @brief Partially sort an array in place along its last axis
+ *
+ * Afterwards element kth of every row is the one a full sort would put there,
+ * no element before it is larger and none after it is smaller. Introselect
+ * keeps this O(n) on average and O(n log n) in the worst case.
+ *
+ * @param array INT, FLOAT, DOUBLE or CHAR array or view to partition
+ * @param kth Position within each row
+ * @return true on success
+ */
+bool array_partition(Array* array, size_t kth);
+
+/**
+ * @brief Flat indices of the k largest or smallest elements
+ *
+ * NaN counts as larger than every number, as in array_sort().
+ *
+ * @param array INT, FLOAT, DOUBLE or CHAR array or view (read as flattened)
+ * @param k Number of elements to find, at most array->count
+ * @param largest Find the largest elements rather than the smallest
+ * @return Array* New 1-D INT array of k indices, best first, NULL on error
+ */
+Array* array_topk(const Array* array, size_t k, bool largest);
+
+#endif // ARRAY_SORT_H
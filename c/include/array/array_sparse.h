@@ -0,0 +1,105 @@
+/*
+Sparse matrices: COO, CSR and CSC storage with sparse-dense products
+
+A SparseArray keeps only the stored entries of a 2-D FLOAT or DOUBLE matrix.
+COO lists (row, column, value) triplets in any order and may repeat a
+position (repeats add up). CSR groups the entries by row and CSC by column,
+each sorted by the other index with repeats merged, and an offsets array
+marks where every row (column) starts.
+
+array_sparse_matvec() and array_sparse_matmul() run on CSR rows on the thread
+pool (other formats are converted first). SpMV computes row dot products
+with the dispatched kernels: the x values of a run of entries are gathered
+with KERNEL_TAKE, multiplied by the entry values with KERNEL_MUL, and each
+row's products are summed pairwise with KERNEL_SUM, a run spanning many
+short rows at a time. SpMM adds value * (row of B) into a cache-sized tile of
+the output row for every entry with KERNEL_FMA.
+
+path: c/include/array/array_sparse.h
+*/
+
+#ifndef ARRAY_SPARSE_H
+#define ARRAY_SPARSE_H
+
+#include "array.h"
+
+typedef enum {
+    SPARSE_COO,
+    SPARSE_CSR,
+    SPARSE_CSC
+} SparseFormat;
+
+typedef struct {
+    SparseFormat format;
+    Type type;              // FLOAT or DOUBLE
+    size_t rows;
+    size_t cols;
+    size_t nnz;             // stored entries
+    void* values;           // nnz values of the type
+    int* row_indices;       // COO, CSC: row of every entry (NULL for CSR)
+    int* col_indices;       // COO, CSR: column of every entry (NULL for CSC)
+    size_t* offsets;        // CSR: rows + 1 row starts, CSC: cols + 1 column starts (NULL for COO)
+} SparseArray;
+
+/**
+ * @brief Sparse copy of the nonzero elements of a matrix
+ *
+ * @param dense 2-D FLOAT or DOUBLE array (may be a view)
+ * @param format Storage format of the result
+ * @return SparseArray* New sparse matrix (free with array_sparse_free), NULL on error
+ */
+SparseArray* array_sparse_from_dense(const Array* dense, SparseFormat format);
+
+/**
+ * @brief Sparse matrix from (row, column, value) triplets
+ *
+ * @param rows Number of rows (at most INT_MAX)
+ * @param cols Number of columns (at most INT_MAX)
+ * @param row_indices 1-D INT array of rows in [0, rows)
+ * @param col_indices 1-D INT array of columns in [0, cols), as long as row_indices
+ * @param values 1-D FLOAT or DOUBLE array, as long as row_indices
+ * @param format Storage format of the result (CSR and CSC add repeated positions)
+ * @return SparseArray* New sparse matrix, NULL on error
+ */
+SparseArray* array_sparse_from_triplets(size_t rows, size_t cols, const Array* row_indices,
+                                        const Array* col_indices, const Array* values, SparseFormat format);
+
+/**
+ * @brief Copy a sparse matrix into another format
+ *
+ * @param sparse Sparse matrix
+ * @param format Storage format of the result
+ * @return SparseArray* New sparse matrix, NULL on error
+ */
+SparseArray* array_sparse_convert(const SparseArray* sparse, SparseFormat format);
+
+/**
+ * @brief Dense copy of a sparse matrix
+ *
+ * @param sparse Sparse matrix
+ * @return Array* New contiguous (rows, cols) array, NULL on error
+ */
+Array* array_sparse_to_dense(const SparseArray* sparse);
+
+// Free a sparse matrix (NULL is ignored)
+void array_sparse_free(SparseArray* sparse);
+
+/**
+ * @brief Sparse matrix times dense vector (SpMV)
+ *
+ * @param a Sparse (m, n) matrix
+ * @param x 1-D array of n elements of a's type (may be a view)
+ * @return Array* New 1-D array of m elements, NULL on error
+ */
+Array* array_sparse_matvec(const SparseArray* a, const Array* x);
+
+/**
+ * @brief Sparse matrix times dense matrix (SpMM)
+ *
+ * @param a Sparse (m, k) matrix
+ * @param b 2-D (k, n) array of a's type (may be a view)
+ * @return Array* New contiguous (m, n) array, NULL on error
+ */
+Array* array_sparse_matmul(const SparseArray* a, const Array* b);
+
+#endif // ARRAY_SPARSE_H
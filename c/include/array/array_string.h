@@ -0,0 +1,81 @@
+/*
+STRING arrays in one contiguous blob (Arrow-style layout)
+
+parray holds int64 offsets and every string is stored NUL-terminated in the
+blob at Array.strings, back to back in element order. Building, copying and
+freeing touch two buffers no matter how many strings there are, and the
+search functions scan the blob linearly instead of chasing one pointer per
+element. STRING arrays are immutable once built.
+
+path: c/include/array/array_string.h
+*/
+
+#ifndef ARRAY_STRING_H
+#define ARRAY_STRING_H
+
+#include "array.h"
+
+/**
+ * @brief Create a STRING array from C strings
+ * 
+ * @param strings Strings to copy (NULL entries become "")
+ * @param count Number of strings
+ * @param is_dynamic Whether the array can be resized
+ * @return Array* New STRING array, NULL on error
+ */
+Array* array_from_strings(const char* const* strings, size_t count, bool is_dynamic);
+
+/**
+ * @brief Create a STRING array with every element equal to value
+ * 
+ * @param size Number of elements
+ * @param value String to repeat
+ * @param is_dynamic Whether the array can be resized
+ * @return Array* New STRING array, NULL on error
+ */
+Array* array_string_full(size_t size, const char* value, bool is_dynamic);
+
+/**
+ * @brief Copy a STRING array (or view) into a new compact blob
+ * 
+ * Contiguous sources copy with two memcpys: offsets and blob.
+ * 
+ * @param source STRING array to copy
+ * @param is_dynamic Whether the new array can be resized
+ * @return Array* New contiguous STRING array with the source shape, NULL on error
+ */
+Array* array_string_copy(const Array* source, bool is_dynamic);
+
+/**
+ * @brief String at a flat (row-major) index
+ * 
+ * @param array STRING array or view
+ * @param index Flat index below array->count
+ * @return const char* NUL-terminated string inside the blob ("" for unset elements)
+ */
+const char* array_string_get(const Array* array, size_t index);
+
+/**
+ * @brief Length of the string at a flat index, without the NUL
+ */
+size_t array_string_length(const Array* array, size_t index);
+
+/**
+ * @brief Elementwise string equality
+ * 
+ * @param array STRING array or view
+ * @param value String to compare against
+ * @return Array* BOOL array with the shape of array, NULL on error
+ */
+Array* array_string_equal(const Array* array, const char* value);
+
+/**
+ * @brief Elementwise substring search
+ * 
+ * @param array STRING array or view
+ * @param needle Substring to look for ("" matches everything)
+ * @return Array* BOOL array with the shape of array, NULL on error
+ */
+Array* array_string_contains(const Array* array, const char* needle);
+
+#endif // ARRAY_STRING_H
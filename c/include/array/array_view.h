@@ -0,0 +1,181 @@
+/*
+Views over Array buffers (slice, reshape, ravel, transpose, permute)
+
+A view shares parray with its base array and only owns its shape/strides.
+Strides and offset are counted in elements, so the element at index
+(i0, i1, ...) lives at parray + (offset + i0*strides[0] + i1*strides[1] + ...).
+
+path: c/include/array/array_view.h
+*/
+
+#ifndef ARRAY_VIEW_H
+#define ARRAY_VIEW_H
+
+#include "array.h"
+#include <stdint.h>
+
+// Slice bound meaning "use the Python default" (start/stop of the axis, step 1)
+#define SLICE_DEFAULT PTRDIFF_MIN
+
+/**
+ * @brief Python-style slice start:stop:step for one axis (negative values count from the end)
+ */
+typedef struct {
+    ptrdiff_t start;
+    ptrdiff_t stop;
+    ptrdiff_t step;
+} ArraySlice;
+
+/**
+ * @brief Create a view of the whole array
+ * 
+ * @param array Array to view
+ * @return Array* View sharing the array's buffer
+ */
+Array* array_view(Array* array);
+
+/**
+ * @brief Slice one axis without copying (a[start:stop:step] along axis)
+ * 
+ * @param array Array to slice
+ * @param axis Axis to slice
+ * @param start First index (SLICE_DEFAULT for the start of the axis)
+ * @param stop One past the last index (SLICE_DEFAULT for the end of the axis)
+ * @param step Step between indices, may be negative (SLICE_DEFAULT for 1)
+ * @return Array* View into the array's buffer, NULL on invalid arguments
+ */
+Array* array_slice(Array* array, size_t axis, ptrdiff_t start, ptrdiff_t stop, ptrdiff_t step);
+
+/**
+ * @brief Slice the leading axes at once (a[s0, s1, ...]); remaining axes are kept whole
+ * 
+ * @param array Array to slice
+ * @param slices One slice per leading axis
+ * @param num_slices Number of slices (at most num_dimensions)
+ * @return Array* View into the array's buffer, NULL on invalid arguments
+ */
+Array* array_slices(Array* array, const ArraySlice* slices, size_t num_slices);
+
+/**
+ * @brief Give the array a new shape with the same number of elements
+ * 
+ * @param array Array to reshape
+ * @param shape New size of each dimension
+ * @param num_dimensions Number of dimensions
+ * @return Array* View if the array is contiguous, otherwise a reshaped copy
+ */
+Array* array_reshape(Array* array, const size_t* shape, size_t num_dimensions);
+
+/**
+ * @brief Flatten to one dimension
+ * 
+ * @param array Array to flatten
+ * @return Array* View if the array is contiguous, otherwise a flat copy
+ */
+Array* array_ravel(Array* array);
+
+/**
+ * @brief Reverse the axes (rows become columns for 2-D arrays) without copying
+ * 
+ * @param array Array to transpose
+ * @return Array* View with reversed shape and strides
+ */
+Array* array_transpose(Array* array);
+
+/**
+ * @brief Reorder the axes without copying (NumPy's transpose with axes)
+ * 
+ * @param array Array to permute
+ * @param axes Permutation of 0..num_dimensions-1: axis d of the view is axis axes[d]
+ * @return Array* View with permuted shape and strides, NULL on an invalid permutation
+ */
+Array* array_permute(Array* array, const size_t* axes);
+
+/**
+ * @brief Contiguous copy with the axes reversed
+ * 
+ * Moves data in cache-blocked tiles (see array_gather), on several threads
+ * for large arrays.
+ * 
+ * @param array Array or view to transpose
+ * @return Array* New contiguous array, NULL on error
+ */
+Array* array_transpose_copy(Array* array);
+
+/**
+ * @brief Contiguous copy with the axes reordered
+ * 
+ * @param array Array or view to permute
+ * @param axes Permutation of 0..num_dimensions-1
+ * @return Array* New contiguous array, NULL on error
+ */
+Array* array_permute_copy(Array* array, const size_t* axes);
+
+/**
+ * @brief Address of the element at an N-D index
+ * 
+ * @param array Array or view
+ * @param index One index per dimension (not bounds checked)
+ * @return void* Pointer to the element
+ */
+void* array_get_ptr(const Array* array, const size_t* index);
+
+/**
+ * @brief Contiguous version of an array
+ * 
+ * @param array Array or view
+ * @param owned Output: the copy to free afterwards, or NULL when array is
+ *              already contiguous
+ * @return const Array* array itself, or a new contiguous copy of it (NULL if
+ *         the copy could not be allocated)
+ */
+const Array* array_contiguous(const Array* array, Array** owned);
+
+/**
+ * @brief Input to read while writing out elementwise
+ * 
+ * An input whose elements overlap out's without having exactly out's layout
+ * would be overwritten before it is read (out = c[1:], in = c[:-1]). Such an
+ * input is copied to a new contiguous array first. Exact aliases and
+ * disjoint inputs are returned as they are.
+ * 
+ * @param in Input array or view
+ * @param out Array or view about to be written
+ * @param owned Output: the copy to free after the write, or NULL
+ * @return const Array* in or its copy, NULL if the copy could not be allocated
+ */
+const Array* array_unaliased(const Array* in, const Array* out, Array** owned);
+
+/**
+ * @brief Copy the elements, in row-major order, into a dense buffer
+ * 
+ * Views whose innermost axis is strided while another axis is not (transposed
+ * layouts) are copied in L1-sized tiles rather than row by row.
+ * 
+ * @param array Array or view to read
+ * @param dst Buffer of at least count * sizeof_type bytes
+ */
+void array_gather(const Array* array, void* dst);
+
+/**
+ * @brief Copy a dense row-major buffer into the array's (possibly strided) elements
+ * 
+ * @param array Array or view to write
+ * @param src Buffer of count * sizeof_type bytes
+ */
+void array_scatter(Array* array, const void* src);
+
+/**
+ * @brief Copy n elements between strided locations
+ * 
+ * @param dst Destination of the first element
+ * @param dst_stride Elements between consecutive destination elements
+ * @param src Source of the first element
+ * @param src_stride Elements between consecutive source elements (0 repeats one element)
+ * @param n Number of elements
+ * @param size Size of one element in bytes
+ */
+void array_copy_elements(void* dst, ptrdiff_t dst_stride, const void* src, ptrdiff_t src_stride,
+                         size_t n, size_t size);
+
+#endif // ARRAY_VIEW_H
@@ -26,6 +26,7 @@ typedef struct {
     bool avx2;
     bool avx512f;
     bool fma;
+    bool f16c;  // half precision conversions (VCVTPH2PS/VCVTPS2PH)
     bool neon;  // For ARM
     bool sve;   // For ARM
 } CPUFeatures;
@@ -69,6 +70,10 @@ typedef struct {
 // Detect and fill all fields of the hardware profile
 HardwareProfile detect_hardware_profile(void);
 
+// Detect the CPU, cache and memory fields only, leaving gpu_info empty. Unlike
+// detect_hardware_profile() it runs no external commands (nvidia-smi, lspci).
+HardwareProfile detect_cpu_profile(void);
+
 // Print a summary of detected hardware
 void print_hardware_profile(const HardwareProfile* hw);
 
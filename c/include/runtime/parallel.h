@@ -0,0 +1,34 @@
+// parallel.h - Data-parallel loops over index ranges
+//
+// parallel_for() runs on a pool of worker threads that is started on first
+// use and kept for the life of the process. [0, n) is split into one range per
+// participating thread; each thread works through its own range a grain at a
+// time and, when it runs dry, steals the back half of another thread's range,
+// so uneven work still balances. The call returns once every item is done.
+//
+// Loops that fit in one grain run directly on the calling thread. Calls made
+// from inside a loop body, or while another thread is using the pool, also
+// run serially, so nested loops are safe.
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+
+// Body of a parallel loop: handle items [begin, end)
+typedef void (*ParallelRangeFn)(size_t begin, size_t end, void* ctx);
+
+// Threads parallel_for() may use (physical cores unless overridden)
+size_t parallel_thread_count(void);
+
+// Override the thread count (0 restores the hardware default, 1 runs serially)
+void parallel_set_thread_count(size_t threads);
+
+// Items per grain for loops touching `item_bytes` of memory per item: enough
+// to cover the L2 cache, so each grain amortizes a steal or a thread wake-up
+size_t parallel_grain(size_t item_bytes);
+
+// Run fn over [0, n) in ranges of at least `grain` items
+void parallel_for(size_t n, size_t grain, ParallelRangeFn fn, void* ctx);
+
+#endif // PARALLEL_H
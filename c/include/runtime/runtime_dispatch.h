@@ -2,14 +2,234 @@
 #define RUNTIME_DISPATCH_H
 
 #include "hardware/hardware_detection.h"
+#include "array/array.h"
 
-// Function pointer types
-typedef void (*ArrayAddFn)(const float* a, const float* b, float* c, int n);
+// Function pointer types (inputs and output may have any alignment)
+typedef void (*ArrayAddFn)(const float* a, const float* b, float* c, size_t n);
+
+// Instruction set levels a kernel variant can be compiled for (ordered)
+typedef enum {
+    ISA_SCALAR,
+    ISA_SSE2,
+    ISA_AVX,
+    ISA_AVX2,
+    ISA_AVX512,
+    ISA_COUNT
+} IsaLevel;
 
 // Initialize runtime dispatch based on hardware profile
 void init_runtime_dispatch(const HardwareProfile* hw);
 
+// Highest ISA level the hardware profile supports
+IsaLevel select_isa_level(const HardwareProfile* hw);
+
+// ISA level picked by the last init_runtime_dispatch() call
+IsaLevel get_runtime_isa_level(void);
+
+// Human readable name of an ISA level ("AVX2", ...)
+const char* isa_level_name(IsaLevel isa);
+
 // Get best function for array addition
 ArrayAddFn get_array_add_function(void);
 
+// Get the array addition variant compiled for a specific ISA level
+ArrayAddFn get_array_add_variant(IsaLevel isa);
+
+//====================
+// Kernel registry
+//====================
+
+// Operations with a kernel for every element type
+typedef enum {
+    KERNEL_ADD,
+    KERNEL_SUB,
+    KERNEL_MUL,
+    KERNEL_DIV,
+    KERNEL_FMA,        // out = a * b + c, rounded once for FLOAT/DOUBLE
+    KERNEL_MIN,
+    KERNEL_MAX,
+    KERNEL_COMPARE,
+    KERNEL_FILL,
+    KERNEL_COPY,
+    KERNEL_IOTA,       // out[i] = start + i * step (arange, linspace)
+    KERNEL_SUM,        // *result (double; INT64/UINT64: element type, wrapping) = pairwise sum of src
+    KERNEL_PROD,       // *result (double) = product of src
+    KERNEL_REDUCE_MIN, // *result (element type) = smallest element (a NaN if any), n >= 1
+    KERNEL_REDUCE_MAX, // *result (element type) = largest element (a NaN if any), n >= 1
+    KERNEL_SUM_ROWS,   // acc[i] += src[i], acc is double
+    KERNEL_PROD_ROWS,  // acc[i] *= src[i], acc is double
+    KERNEL_COMPRESS,   // dst = src[i] where mask[i], returns the count
+    KERNEL_TAKE,       // dst[i] = src[indices[i]]
+    KERNEL_PUT,        // dst[indices[i]] = values[i] (in order: the last duplicate wins)
+    KERNEL_TRANSPOSE,  // dst[c][r] = src[r][c] for one block
+    KERNEL_GEMM,       // C tile (+)= packed A sliver x packed B sliver
+    KERNEL_SORT_BLOCK, // sort up to SORT_BLOCK_KEYS unsigned keys of the type's width
+    KERNEL_KEY_FILTER, // positions of the elements whose sort key is below/above a threshold
+    KERNEL_CUMSUM,     // dst[i] = carry + src[0] + ... + src[i]
+    KERNEL_CUMPROD,    // dst[i] = carry * src[0] * ... * src[i]
+    KERNEL_CUMMIN,     // dst[i] = min(carry, src[0], ..., src[i])
+    KERNEL_CUMMAX,     // dst[i] = max(carry, src[0], ..., src[i])
+    KERNEL_CUMSUM_COMPENSATED, // CUMSUM of FLOAT/DOUBLE with Neumaier compensation
+    KERNEL_TO_FLOAT,   // dst (float) = src widened (FLOAT16, BFLOAT16)
+    KERNEL_FROM_FLOAT, // dst = src (float) rounded to nearest even (FLOAT16, BFLOAT16)
+    KERNEL_ASTYPE,     // conversions from the type to each fixed-width type, saturating
+    KERNEL_BITWISE,    // out[i] = a[i] op b[i] over the 64-bit words of packed masks (BOOL)
+    KERNEL_POPCOUNT,   // set bits in n words (BOOL)
+    KERNEL_PACK_BITS,  // bit i of words = bytes[i] != 0 (BOOL)
+    KERNEL_UNPACK_BITS, // bytes[i] = bit i of words (BOOL)
+    KERNEL_BIT_INDICES, // base + the position of every set bit, ascending (BOOL)
+    KERNEL_BITPACK,    // pack a block of values - base at a fixed bit width (INT)
+    KERNEL_BITUNPACK,  // unpack a block of values and add base (INT)
+    KERNEL_OP_COUNT
+} KernelOp;
+
+// Predicate for KERNEL_COMPARE
+typedef enum {
+    CMP_EQ,
+    CMP_NE,
+    CMP_LT,
+    CMP_LE,
+    CMP_GT,
+    CMP_GE
+} CompareOp;
+
+// Operation for KERNEL_BITWISE (NOT ignores b)
+typedef enum {
+    BIT_AND,
+    BIT_OR,
+    BIT_XOR,
+    BIT_ANDNOT,        // a & ~b
+    BIT_NOT
+} BitwiseOp;
+
+// Kernel signatures (all buffers contiguous, n elements of the registered Type)
+typedef void (*BinaryKernelFn)(const void* a, const void* b, void* out, size_t n);
+typedef void (*FmaKernelFn)(const void* a, const void* b, const void* c, void* out, size_t n);
+typedef void (*CompareKernelFn)(const void* a, const void* b, bool* out, size_t n, CompareOp cmp);
+typedef void (*FillKernelFn)(void* dst, const void* value, size_t n);
+typedef void (*CopyKernelFn)(void* dst, const void* src, size_t n);
+typedef void (*IotaKernelFn)(void* dst, double start, double step, size_t n);
+typedef void (*ReduceKernelFn)(const void* src, size_t n, void* result);
+typedef void (*AccumulateKernelFn)(const void* src, double* acc, size_t n);
+typedef size_t (*CompressKernelFn)(const void* src, const bool* mask, void* dst, size_t n);
+// Indices are valid and non-negative; prefetch > 0 prefetches that many elements ahead
+typedef void (*TakeKernelFn)(const void* src, const int* indices, void* dst, size_t n, size_t prefetch);
+typedef void (*PutKernelFn)(void* dst, const int* indices, const void* values, size_t n, size_t prefetch);
+// Strides are in elements between consecutive rows of src and of dst
+typedef void (*TransposeKernelFn)(const void* src, ptrdiff_t src_stride, void* dst,
+                                  ptrdiff_t dst_stride, size_t rows, size_t cols);
+// c[i*ldc + j] = (accumulate ? c[i*ldc + j] : 0) + sum_p a[p*mr + i] * b[p*nr + j]
+typedef void (*GemmKernelFn)(size_t k, const void* a, const void* b, void* c, ptrdiff_t ldc,
+                             bool accumulate);
+
+// Sort n <= SORT_BLOCK_KEYS unsigned integer keys in place, ascending
+#define SORT_BLOCK_KEYS 16
+typedef void (*SortKernelFn)(void* keys, size_t n);
+// Writes, in order, the positions i where the sort key of src[i] (the unsigned
+// key array_sort orders by) is < threshold, or > threshold with above; returns how many
+typedef size_t (*KeyFilterKernelFn)(const void* src, size_t n, uint64_t threshold, bool above,
+                                    uint32_t* positions);
+// Running scan of src into dst (which may be src) continuing from *carry, an
+// element of the type (double[2] sum and compensation for CUMSUM_COMPENSATED),
+// left at the last running value; exclusive writes the value before src[i]
+typedef void (*ScanKernelFn)(const void* src, void* dst, size_t n, void* carry, bool exclusive);
+// Element type conversion of n elements between buffers that do not overlap
+typedef void (*ConvertKernelFn)(const void* src, void* dst, size_t n);
+// Packed masks: bit i of an n-element mask is bit i % 64 of word i / 64. PACK
+// writes (n + 63) / 64 words, zeroing the bits past n; BIT_INDICES reads n
+// words and returns how many positions it wrote.
+typedef void (*BitwiseKernelFn)(const uint64_t* a, const uint64_t* b, uint64_t* out, size_t words,
+                                BitwiseOp op);
+typedef size_t (*PopcountKernelFn)(const uint64_t* words, size_t n);
+typedef void (*PackBitsKernelFn)(const bool* bytes, uint64_t* words, size_t n);
+typedef void (*UnpackBitsKernelFn)(const uint64_t* words, bool* bytes, size_t n);
+typedef size_t (*BitIndicesKernelFn)(const uint64_t* words, size_t n, int base, int* positions);
+// Bit-packed blocks of BITPACK_BLOCK values (array_compress). Value i of a
+// block is value i / 4 of lane i % 4; each lane fills every fourth word, low
+// bits first, so a block of width bits is 4 * bits words (none for 0).
+// Values are stored as (uint32) (value - base) and must fit in bits.
+#define BITPACK_BLOCK 128
+typedef void (*BitPackKernelFn)(const int* values, int base, unsigned bits, uint32_t* packed);
+typedef void (*BitUnpackKernelFn)(const uint32_t* packed, unsigned bits, int base, int* values);
+
+// Matrix multiply micro-kernel with the register tile it computes
+typedef struct {
+    GemmKernelFn fn;
+    size_t mr;                     // rows of C per call
+    size_t nr;                     // columns of C per call
+} GemmKernel;
+
+// One registry slot; the member to use follows from the KernelOp
+typedef union {
+    BinaryKernelFn binary;   // ADD, SUB, MUL, DIV, MIN, MAX
+    FmaKernelFn fma;         // FMA
+    CompareKernelFn compare; // COMPARE
+    FillKernelFn fill;       // FILL
+    CopyKernelFn copy;       // COPY
+    IotaKernelFn iota;       // IOTA
+    ReduceKernelFn reduce;   // SUM, PROD, REDUCE_MIN, REDUCE_MAX
+    AccumulateKernelFn accumulate; // SUM_ROWS, PROD_ROWS
+    CompressKernelFn compress;     // COMPRESS
+    TakeKernelFn take;             // TAKE
+    PutKernelFn put;               // PUT
+    TransposeKernelFn transpose;   // TRANSPOSE
+    const GemmKernel* gemm;        // GEMM
+    SortKernelFn sort;             // SORT_BLOCK
+    KeyFilterKernelFn key_filter;  // KEY_FILTER
+    ScanKernelFn scan;             // CUMSUM, CUMPROD, CUMMIN, CUMMAX, CUMSUM_COMPENSATED
+    ConvertKernelFn convert;       // TO_FLOAT, FROM_FLOAT
+    const ConvertKernelFn* astype; // ASTYPE: TYPE_COUNT kernels indexed by destination (NULL: none)
+    BitwiseKernelFn bitwise;       // BITWISE
+    PopcountKernelFn popcount;     // POPCOUNT
+    PackBitsKernelFn pack_bits;    // PACK_BITS
+    UnpackBitsKernelFn unpack_bits; // UNPACK_BITS
+    BitIndicesKernelFn bit_indices; // BIT_INDICES
+    BitPackKernelFn bitpack;       // BITPACK
+    BitUnpackKernelFn bitunpack;   // BITUNPACK
+} Kernel;
+
+// Register a kernel variant (call before or after init; selection is refreshed)
+void register_kernel(KernelOp op, Type type, IsaLevel isa, Kernel kernel);
+
+// Register the kernels shipped with the library (called by init_runtime_dispatch)
+void register_builtin_kernels(void);
+
+// Register the KERNEL_ASTYPE tables (called by register_builtin_kernels)
+void register_convert_kernels(void);
+
+// Register the KERNEL_BITPACK and KERNEL_BITUNPACK kernels (called by register_builtin_kernels)
+void register_bitpack_kernels(void);
+
+// Best kernel for op x type on this machine, O(1). A NULL member means the
+// type does not support the operation. Initializes dispatch on first use;
+// call init_runtime_dispatch() up front in multithreaded programs.
+Kernel get_kernel(KernelOp op, Type type);
+
+// Kernel registered for an exact ISA level (NULL member if none)
+Kernel get_kernel_variant(KernelOp op, Type type, IsaLevel isa);
+
+// ISA level of the kernel get_kernel() returns for op x type
+IsaLevel get_kernel_isa(KernelOp op, Type type);
+
+// Hardware profile dispatch was initialized with (without GPU information when
+// dispatch initialized itself on first use)
+const HardwareProfile* get_runtime_hardware_profile(void);
+
+// Output size in bytes from which FILL, COPY and IOTA kernels switch to
+// non-temporal stores. Defaults to the L3 size once dispatch is initialized.
+size_t get_streaming_store_threshold(void);
+void set_streaming_store_threshold(size_t bytes);
+
+// Threads filling one slice of a larger output declare the whole output's size
+// here, so the streaming decision matches a single-threaded call (0 clears).
+void set_streaming_store_extent(size_t bytes);
+
+// Whether a kernel writing `bytes` should use non-temporal stores
+bool use_streaming_stores(size_t bytes);
+
+// Elements ahead that TAKE and PUT kernels prefetch when the indexed array does
+// not fit in L2 (0 disables prefetching)
+size_t get_gather_prefetch_distance(void);
+void set_gather_prefetch_distance(size_t elements);
+
 #endif // RUNTIME_DISPATCH_H
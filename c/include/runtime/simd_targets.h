@@ -0,0 +1,35 @@
+// simd_targets.h - Per-function ISA targeting for runtime-dispatched kernels
+//
+// Kernels are compiled into a portable binary (no -march flag) and each
+// variant is tagged with the instruction set it needs. The dispatcher only
+// calls a variant after detect_hardware_profile() reported that ISA.
+
+#ifndef SIMD_TARGETS_H
+#define SIMD_TARGETS_H
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386) || defined(_M_IX86)
+    #define SIMD_X86 1
+    #include <immintrin.h>
+#else
+    #define SIMD_X86 0
+#endif
+
+// GCC and Clang need a target attribute to emit instructions the TU was not
+// compiled for. MSVC accepts any intrinsic in any function.
+#if SIMD_X86 && (defined(__GNUC__) || defined(__clang__))
+    #define TARGET_SSE2    __attribute__((target("sse2")))
+    #define TARGET_AVX     __attribute__((target("avx")))
+    #define TARGET_AVX2    __attribute__((target("avx2")))
+    #define TARGET_AVX2_FMA __attribute__((target("avx2,fma")))
+    #define TARGET_AVX2_F16C __attribute__((target("avx2,f16c")))
+    #define TARGET_AVX512  __attribute__((target("avx512f")))
+#else
+    #define TARGET_SSE2
+    #define TARGET_AVX
+    #define TARGET_AVX2
+    #define TARGET_AVX2_FMA
+    #define TARGET_AVX2_F16C
+    #define TARGET_AVX512
+#endif
+
+#endif // SIMD_TARGETS_H
@@ -0,0 +1,40 @@
+// type_limits.h - Integer element ranges and the saturating real -> integer rule
+//
+// Traits are keyed by the type name used in kernel names (int, char, int8, ...)
+// so kernel templates can paste them. Kernels that turn a FLOAT or DOUBLE
+// value into an integer element (astype, arange, linspace, expression
+// constants) go through SATURATE_REAL: NaN becomes 0 and out-of-range values
+// clamp to the destination range instead of hitting an undefined C cast.
+
+#ifndef TYPE_LIMITS_H
+#define TYPE_LIMITS_H
+
+#include <stdint.h>
+#include <limits.h>
+
+#define MIN_int    INT_MIN
+#define MAX_int    INT_MAX
+#define MIN_char   CHAR_MIN
+#define MAX_char   CHAR_MAX
+#define MIN_int8   INT8_MIN
+#define MAX_int8   INT8_MAX
+#define MIN_int16  INT16_MIN
+#define MAX_int16  INT16_MAX
+#define MIN_int64  INT64_MIN
+#define MAX_int64  INT64_MAX
+#define MIN_uint8  0
+#define MAX_uint8  UINT8_MAX
+#define MIN_uint16 0
+#define MAX_uint16 UINT16_MAX
+#define MIN_uint32 0
+#define MAX_uint32 UINT32_MAX
+#define MIN_uint64 0
+#define MAX_uint64 UINT64_MAX
+
+// x of real type S as integer type D named DN, truncated toward zero. The
+// bounds round up to a power of two in S, so values at them clamp too.
+#define SATURATE_REAL(x, S, D, DN)                                                   \
+    ((x) != (x) ? (D)0 : (x) <= (S)MIN_##DN ? (D)MIN_##DN                            \
+                       : (x) >= (S)MAX_##DN ? (D)MAX_##DN : (D)(x))
+
+#endif // TYPE_LIMITS_H
@@ -0,0 +1,39 @@
+// memory.h - Aligned and huge-page-aware allocation for array buffers
+
+#ifndef MEMORY_UTILS_H
+#define MEMORY_UTILS_H
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Buffers at least this large are mapped directly from the OS: they start on a
+// huge-page boundary, are advised for transparent huge pages, and come back
+// zeroed without the pages being touched.
+#define MEMORY_LARGE_ALLOC_BYTES (4u * 1024u * 1024u)
+
+// Huge page size the large path aligns to
+#define MEMORY_HUGE_PAGE_BYTES (2u * 1024u * 1024u)
+
+void* aligned_malloc(size_t size, size_t alignment);
+void aligned_free(void* ptr);
+
+// Alignment used for array buffers (detected cache line size, at least 64)
+size_t memory_buffer_alignment(void);
+
+// Allocate an array buffer of `bytes` bytes aligned to memory_buffer_alignment().
+// With zeroed set, the memory reads as zero (free for large buffers).
+void* memory_buffer_alloc(size_t bytes, bool zeroed);
+
+// Release a buffer from memory_buffer_alloc(); `bytes` must match the request
+void memory_buffer_free(void* ptr, size_t bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MEMORY_UTILS_H
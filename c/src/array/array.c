@@ -1,10 +1,65 @@
 
 
  #include "../include/array/array.h"
+ #include "../../include/array/array_view.h"
+ #include "../../include/array/array_string.h"
+ #include "../../include/runtime/runtime_dispatch.h"
+ #include "../../include/runtime/parallel.h"
+ #include "../../include/utils/memory.h"
  #include <stdlib.h>
  #include <string.h>
  #include <stdio.h>
  #include <math.h>
+ #include <stdint.h>
+ 
+ // Elements per scheduling unit of a parallel fill or copy, so slices start on
+ // cache line boundaries of an aligned buffer
+ #define SLICE_ELEMENTS 64
+ 
+ /**
+  * A fill or copy split into slices for the thread pool
+  */
+ typedef struct {
+     Kernel kernel;
+     bool is_fill;
+     char* dst;
+     const char* src;         // FILL: the value; COPY: the source
+     size_t count;
+     size_t size;
+ } SliceTask;
+ 
+ static void run_slices(size_t begin, size_t end, void* ctx) {
+     SliceTask* task = (SliceTask*)ctx;
+     size_t first = begin * SLICE_ELEMENTS;
+     size_t last = end * SLICE_ELEMENTS < task->count ? end * SLICE_ELEMENTS : task->count;
+     
+     // Stream if the whole output would have, not just this slice
+     set_streaming_store_extent(task->count * task->size);
+     if (task->is_fill) {
+         task->kernel.fill(task->dst + first * task->size, task->src, last - first);
+     } else {
+         task->kernel.copy(task->dst + first * task->size, task->src + first * task->size, last - first);
+     }
+     set_streaming_store_extent(0);
+ }
+ 
+ /**
+  * Run a FILL kernel over n elements on the thread pool
+  */
+ static void parallel_fill(Kernel fill, void* dst, const void* value, size_t n, size_t size) {
+     SliceTask task = { fill, true, (char*)dst, (const char*)value, n, size };
+     size_t units = (n + SLICE_ELEMENTS - 1) / SLICE_ELEMENTS;
+     parallel_for(units, parallel_grain(SLICE_ELEMENTS * size), run_slices, &task);
+ }
+ 
+ /**
+  * Run a COPY kernel over n elements on the thread pool
+  */
+ static void parallel_copy(Kernel copy, void* dst, const void* src, size_t n, size_t size) {
+     SliceTask task = { copy, false, (char*)dst, (const char*)src, n, size };
+     size_t units = (n + SLICE_ELEMENTS - 1) / SLICE_ELEMENTS;
+     parallel_for(units, parallel_grain(2 * SLICE_ELEMENTS * size), run_slices, &task);
+ }
  
  /**
   * Helper function to determine the size of a type
@@ -20,11 +75,24 @@
          case CHAR:
              return sizeof(char);
          case STRING:
-             return sizeof(char*);
+             return sizeof(int64_t);  // one offset into the string blob
          case BOOL:
              return sizeof(bool);
          case ARRAY:
              return sizeof(Array*);
+         case INT8:
+         case UINT8:
+             return sizeof(uint8_t);
+         case INT16:
+         case UINT16:
+         case FLOAT16:
+         case BFLOAT16:
+             return sizeof(uint16_t);
+         case UINT32:
+             return sizeof(uint32_t);
+         case INT64:
+         case UINT64:
+             return sizeof(uint64_t);
          default:
              fprintf(stderr, "Error: Unknown type\n");
              return 0;
@@ -32,9 +100,78 @@
  }
  
  /**
-  * Helper function to create a new array structure
+  * Scalar 16-bit float conversions through the dispatched kernels
   */
- Array* array_create(size_t size, Type type, bool is_dynamic) {
+ float array_float16_to_float(uint16_t half) {
+     float value;
+     get_kernel(KERNEL_TO_FLOAT, FLOAT16).convert(&half, &value, 1);
+     return value;
+ }
+ 
+ uint16_t array_float_to_float16(float value) {
+     uint16_t half;
+     get_kernel(KERNEL_FROM_FLOAT, FLOAT16).convert(&value, &half, 1);
+     return half;
+ }
+ 
+ float array_bfloat16_to_float(uint16_t half) {
+     float value;
+     get_kernel(KERNEL_TO_FLOAT, BFLOAT16).convert(&half, &value, 1);
+     return value;
+ }
+ 
+ uint16_t array_float_to_bfloat16(float value) {
+     uint16_t half;
+     get_kernel(KERNEL_FROM_FLOAT, BFLOAT16).convert(&value, &half, 1);
+     return half;
+ }
+ 
+ static void* array_allocate_buffer(Array* array, bool zeroed);
+ 
+ /**
+  * Release hook for buffers from memory_buffer_alloc
+  */
+ static void array_buffer_free_memory(ArrayBuffer* buffer) {
+     memory_buffer_free(buffer->data, buffer->bytes);
+ }
+ 
+ /**
+  * Wrap freshly allocated data in a buffer with one reference
+  */
+ static ArrayBuffer* array_buffer_new(void* data, size_t bytes) {
+     ArrayBuffer* buffer = (ArrayBuffer*)malloc(sizeof(ArrayBuffer));
+     if (!buffer) {
+         fprintf(stderr, "Error: Failed to allocate memory for array buffer\n");
+         return NULL;
+     }
+     atomic_init(&buffer->refcount, 1);
+     buffer->data = data;
+     buffer->bytes = bytes;
+     buffer->strings = NULL;
+     buffer->strings_size = 0;
+     buffer->release = array_buffer_free_memory;
+     buffer->context = NULL;
+     return buffer;
+ }
+ 
+ /**
+  * Drop one reference; the last holder frees data, strings and the buffer
+  */
+ static void array_buffer_release(ArrayBuffer* buffer) {
+     if (!buffer || atomic_fetch_sub(&buffer->refcount, 1) != 1) return;
+     if (buffer->strings) {
+         memory_buffer_free(buffer->strings, buffer->strings_size);
+     }
+     if (buffer->release) {
+         buffer->release(buffer);
+     }
+     free(buffer);
+ }
+ 
+ /**
+  * Create the array structure and its buffer, optionally zero-filled
+  */
+ static Array* array_create_buffer(size_t size, Type type, bool is_dynamic, bool zeroed) {
      Array* array = (Array*)malloc(sizeof(Array));
      if (!array) {
          fprintf(stderr, "Error: Failed to allocate memory for Array\n");
@@ -65,9 +202,27 @@
      }
      array->shape[0] = size;
      
-     // Allocate memory for array data
-     array->parray = array_allocate(array);
-     if (!array->parray) {
+     // Freshly created arrays are dense and own their buffer
+     array->strides = (ptrdiff_t*)malloc(sizeof(ptrdiff_t) * array->num_dimensions);
+     if (!array->strides) {
+         fprintf(stderr, "Error: Failed to allocate memory for strides\n");
+         free(array->shape);
+         free(array);
+         return NULL;
+     }
+     array->strides[0] = 1;
+     array->offset = 0;
+     array->owns_buffer = true;
+     array->base = NULL;
+     array->strings = NULL;
+     array->strings_size = 0;
+     
+     // Allocate memory for array data (STRING offsets start out all empty)
+     array->parray = array_allocate_buffer(array, zeroed || type == STRING);
+     array->buffer = array->parray ? array_buffer_new(array->parray, array_buffer_bytes(array)) : NULL;
+     if (!array->buffer) {
+         if (array->parray) memory_buffer_free(array->parray, array_buffer_bytes(array));
+         free(array->strides);
          free(array->shape);
          free(array);
          return NULL;
@@ -77,12 +232,25 @@
  }
  
  /**
-  * Helper function to allocate memory for array data
+  * Helper function to create a new array structure
   */
- void* array_allocate(Array* array) {
+ Array* array_create(size_t size, Type type, bool is_dynamic) {
+     return array_create_buffer(size, type, is_dynamic, false);
+ }
+ 
+ /**
+  * Allocate cache-line aligned array data; large buffers get huge pages and
+  * are zero-filled by the OS without touching them
+  */
+ static void* array_allocate_buffer(Array* array, bool zeroed) {
      if (!array) return NULL;
      
-     void* data = malloc(array->capacity * array->sizeof_type);
+     if (array->sizeof_type != 0 && array->capacity >= SIZE_MAX / array->sizeof_type) {
+         fprintf(stderr, "Error: Array size overflows size_t\n");
+         return NULL;
+     }
+     
+     void* data = memory_buffer_alloc(array_buffer_bytes(array), zeroed);
      if (!data) {
          fprintf(stderr, "Error: Failed to allocate memory for array data\n");
          return NULL;
@@ -91,6 +259,175 @@
      return data;
  }
  
+ /**
+  * Bytes in parray: capacity elements, plus the closing offset for STRING
+  */
+ size_t array_buffer_bytes(const Array* array) {
+     size_t slots = array->type == STRING ? array->capacity + 1 : array->capacity;
+     return slots * array->sizeof_type;
+ }
+ 
+ /**
+  * Helper function to allocate memory for array data
+  */
+ void* array_allocate(Array* array) {
+     return array_allocate_buffer(array, false);
+ }
+ 
+ /**
+  * Give a contiguous array a new shape with the same element count
+  */
+ bool array_set_shape(Array* array, const size_t* shape, size_t num_dimensions) {
+     if (!array || !shape || num_dimensions == 0 || num_dimensions > ARRAY_MAX_DIMS) {
+         fprintf(stderr, "Error: Invalid shape\n");
+         return false;
+     }
+     if (!array_is_contiguous(array)) {
+         fprintf(stderr, "Error: Cannot set the shape of a non-contiguous array\n");
+         return false;
+     }
+     
+     size_t count = 1;
+     for (size_t d = 0; d < num_dimensions; d++) {
+         count *= shape[d];
+     }
+     if (count != array->count) {
+         fprintf(stderr, "Error: Shape does not match element count\n");
+         return false;
+     }
+     
+     size_t* new_shape = (size_t*)malloc(sizeof(size_t) * num_dimensions);
+     ptrdiff_t* new_strides = (ptrdiff_t*)malloc(sizeof(ptrdiff_t) * num_dimensions);
+     if (!new_shape || !new_strides) {
+         fprintf(stderr, "Error: Failed to allocate memory for shape\n");
+         free(new_shape);
+         free(new_strides);
+         return false;
+     }
+     
+     // Row-major strides: the last axis is dense
+     ptrdiff_t stride = 1;
+     for (size_t d = num_dimensions; d-- > 0;) {
+         new_shape[d] = shape[d];
+         new_strides[d] = stride;
+         stride *= (ptrdiff_t)shape[d];
+     }
+     
+     free(array->shape);
+     free(array->strides);
+     array->shape = new_shape;
+     array->strides = new_strides;
+     array->num_dimensions = num_dimensions;
+     return true;
+ }
+ 
+ /**
+  * Pointer to the first element
+  */
+ void* array_data(const Array* array) {
+     // Views read through their base, which may have moved to a private buffer
+     return (char*)array_root(array)->parray + array->offset * array->sizeof_type;
+ }
+ 
+ /**
+  * Array holding the buffer of an array or view
+  */
+ Array* array_root(const Array* array) {
+     return array->base ? array->base : (Array*)array;
+ }
+ 
+ /**
+  * Detach the array's base from buffers shared with copies
+  */
+ bool array_make_writable(Array* array) {
+     if (!array) {
+         fprintf(stderr, "Error: Array cannot be NULL\n");
+         return false;
+     }
+     
+     Array* root = array_root(array);
+     ArrayBuffer* shared = root->buffer;
+     if (atomic_load(&shared->refcount) == 1) return true;
+     
+     // Whole-buffer copy, so the offsets of root and its views stay valid
+     void* data = memory_buffer_alloc(shared->bytes, false);
+     ArrayBuffer* private_buffer = data ? array_buffer_new(data, shared->bytes) : NULL;
+     char* strings = shared->strings ? (char*)memory_buffer_alloc(shared->strings_size, false) : NULL;
+     if (!private_buffer || (shared->strings && !strings)) {
+         fprintf(stderr, "Error: Failed to allocate memory for a private copy\n");
+         if (private_buffer) free(private_buffer);
+         if (data) memory_buffer_free(data, shared->bytes);
+         if (strings) memory_buffer_free(strings, shared->strings_size);
+         return false;
+     }
+     
+     memcpy(data, shared->data, shared->bytes);
+     if (strings) {
+         memcpy(strings, shared->strings, shared->strings_size);
+         private_buffer->strings = strings;
+         private_buffer->strings_size = shared->strings_size;
+     }
+     
+     root->buffer = private_buffer;
+     root->parray = data;
+     root->strings = strings;
+     array->parray = data;
+     array->strings = strings;
+     array_buffer_release(shared);
+     return true;
+ }
+ 
+ /**
+  * O(1) copy: a new array holding another reference on the buffer
+  */
+ static Array* array_share(const Array* source) {
+     Array* root = array_root(source);
+     Array* copy = (Array*)malloc(sizeof(Array));
+     if (!copy) {
+         fprintf(stderr, "Error: Failed to allocate memory for Array\n");
+         return NULL;
+     }
+     
+     *copy = *root;
+     copy->num_dimensions = 1;
+     copy->shape = (size_t*)malloc(sizeof(size_t));
+     copy->strides = (ptrdiff_t*)malloc(sizeof(ptrdiff_t));
+     if (!copy->shape || !copy->strides) {
+         fprintf(stderr, "Error: Failed to allocate memory for shape\n");
+         free(copy->shape);
+         free(copy->strides);
+         free(copy);
+         return NULL;
+     }
+     copy->shape[0] = root->count;
+     copy->strides[0] = 1;
+     copy->offset = 0;
+     copy->is_dynamic = false;
+     copy->owns_buffer = true;
+     copy->base = NULL;
+     atomic_fetch_add(&copy->buffer->refcount, 1);
+     
+     if (source->num_dimensions != 1 &&
+         !array_set_shape(copy, source->shape, source->num_dimensions)) {
+         array_free(copy);
+         return NULL;
+     }
+     return copy;
+ }
+ 
+ /**
+  * Whether the elements are dense and row-major
+  */
+ bool array_is_contiguous(const Array* array) {
+     ptrdiff_t expected = 1;
+     for (size_t d = array->num_dimensions; d-- > 0;) {
+         // Axes of length 1 are never stepped along, so their stride is irrelevant
+         if (array->shape[d] != 1 && array->strides[d] != expected) return false;
+         expected *= (ptrdiff_t)array->shape[d];
+     }
+     return true;
+ }
+ 
  /**
   * Create an empty array with uninitialized values
   */
@@ -102,86 +439,42 @@
   * Create an array filled with zeros
   */
  Array* array_zeros(size_t size, Type type, bool is_dynamic) {
-     Array* array = array_create(size, type, is_dynamic);
-     if (!array) return NULL;
-     
-     // Initialize all bytes to zero
-     memset(array->parray, 0, array->count * array->sizeof_type);
-     
-     return array;
+     // The allocator hands back zeroed memory (untouched pages for large arrays)
+     return array_create_buffer(size, type, is_dynamic, true);
  }
  
  /**
   * Create an array filled with ones
   */
  Array* array_ones(size_t size, Type type, bool is_dynamic) {
+     // Strings: one "1" per element in a single blob
+     if (type == STRING) {
+         return array_string_full(size, "1", is_dynamic);
+     }
+     
      Array* array = array_create(size, type, is_dynamic);
      if (!array) return NULL;
  
      // Initialize all elements to 1 based on type
+     union { int i; float f; double d; char c; bool b; int64_t i64; } one;
      switch (type) {
-         case INT: {
-             int one = 1;
-             for (size_t i = 0; i < size; i++) {
-                 memcpy((char*)array->parray + i * array->sizeof_type, &one, array->sizeof_type);
-             }
+         case INT:    one.i = 1;    break;
+         case FLOAT:  one.f = 1.0f; break;
+         case DOUBLE: one.d = 1.0;  break;
+         case CHAR:   one.c = '1';  break;
+         case BOOL:   one.b = true; break;
+         case INT8:
+         case INT16:
+         case INT64:
+         case UINT8:
+         case UINT16:
+         case UINT32:
+         case UINT64:
+         case FLOAT16:
+         case BFLOAT16:
+             // The IOTA kernel writes 1 in the type's own encoding
+             get_kernel(KERNEL_IOTA, type).iota(&one, 1.0, 0.0, 1);
              break;
-         }
-         case FLOAT: {
-             float one = 1.0f;
-             for (size_t i = 0; i < size; i++) {
-                 memcpy((char*)array->parray + i * array->sizeof_type, &one, array->sizeof_type);
-             }
-             break;
-         }
-         case DOUBLE: {
-             double one = 1.0;
-             for (size_t i = 0; i < size; i++) {
-                 memcpy((char*)array->parray + i * array->sizeof_type, &one, array->sizeof_type);
-             }
-             break;
-         }
-         case CHAR: {
-             char one = '1';
-             for (size_t i = 0; i < size; i++) {
-                 memcpy((char*)array->parray + i * array->sizeof_type, &one, array->sizeof_type);
-             }
-             break;
-         }
-         case BOOL: {
-             bool one = true;
-             for (size_t i = 0; i < size; i++) {
-                 memcpy((char*)array->parray + i * array->sizeof_type, &one, array->sizeof_type);
-             }
-             break;
-         }
-         case STRING: {
-             // For strings, we need to allocate memory for each string
-             char* one_str = strdup("1");
-             if (!one_str) {
-                 fprintf(stderr, "Error: Failed to allocate memory for string\n");
-                 array_free(array);
-                 return NULL;
-             }
-             
-             for (size_t i = 0; i < size; i++) {
-                 char* str_copy = strdup(one_str);
-                 if (!str_copy) {
-                     fprintf(stderr, "Error: Failed to allocate memory for string copy\n");
-                     // Clean up previously allocated strings
-                     for (size_t j = 0; j < i; j++) {
-                         char** str_ptr = (char**)array->parray + j;
-                         free(*str_ptr);
-                     }
-                     free(one_str);
-                     array_free(array);
-                     return NULL;
-                 }
-                 memcpy((char*)array->parray + i * array->sizeof_type, &str_copy, array->sizeof_type);
-             }
-             free(one_str);
-             break;
-         }
          case ARRAY:
              // Arrays of arrays not supported for this function
              fprintf(stderr, "Error: Arrays of arrays not supported for ones()\n");
@@ -193,6 +486,7 @@
              return NULL;
      }
      
+     parallel_fill(get_kernel(KERNEL_FILL, type), array->parray, &one, size, array->sizeof_type);
      return array;
  }
  
@@ -205,30 +499,19 @@
          return NULL;
      }
  
+     // Strings are laid out back to back in one blob
+     if (type == STRING) {
+         return array_string_full(size, *(const char**)value, is_dynamic);
+     }
+ 
      Array* array = array_create(size, type, is_dynamic);
      if (!array) return NULL;
  
-     // Fill array with the provided value
-     if (type == STRING) {
-         // For strings, we need special handling to duplicate each string
-         char* str_value = *(char**)value;
-         
-         for (size_t i = 0; i < size; i++) {
-             char* str_copy = strdup(str_value);
-             if (!str_copy) {
-                 fprintf(stderr, "Error: Failed to allocate memory for string copy\n");
-                 // Clean up previously allocated strings
-                 for (size_t j = 0; j < i; j++) {
-                     char** str_ptr = (char**)array->parray + j;
-                     free(*str_ptr);
-                 }
-                 array_free(array);
-                 return NULL;
-             }
-             memcpy((char*)array->parray + i * array->sizeof_type, &str_copy, array->sizeof_type);
-         }
+     // Broadcast the value with the dispatched fill kernel
+     Kernel fill = get_kernel(KERNEL_FILL, type);
+     if (fill.fill) {
+         parallel_fill(fill, array->parray, value, size, array->sizeof_type);
      } else {
-         // For other types, simply copy the value to each element
          for (size_t i = 0; i < size; i++) {
              memcpy((char*)array->parray + i * array->sizeof_type, value, array->sizeof_type);
          }
@@ -260,34 +543,21 @@
      
      // Fill array with the sequence
      switch (type) {
-         case INT: {
-             for (size_t i = 0; i < size; i++) {
-                 int value = (int)(start + i * step);
-                 memcpy((char*)array->parray + i * array->sizeof_type, &value, array->sizeof_type);
-             }
-             break;
-         }
-         case FLOAT: {
-             for (size_t i = 0; i < size; i++) {
-                 float value = (float)(start + i * step);
-                 memcpy((char*)array->parray + i * array->sizeof_type, &value, array->sizeof_type);
-             }
-             break;
-         }
-         case DOUBLE: {
-             for (size_t i = 0; i < size; i++) {
-                 double value = start + i * step;
-                 memcpy((char*)array->parray + i * array->sizeof_type, &value, array->sizeof_type);
-             }
-             break;
-         }
-         case CHAR: {
-             for (size_t i = 0; i < size; i++) {
-                 char value = (char)(start + i * step);
-                 memcpy((char*)array->parray + i * array->sizeof_type, &value, array->sizeof_type);
-             }
+         case INT:
+         case FLOAT:
+         case DOUBLE:
+         case CHAR:
+         case INT8:
+         case INT16:
+         case INT64:
+         case UINT8:
+         case UINT16:
+         case UINT32:
+         case UINT64:
+         case FLOAT16:
+         case BFLOAT16:
+             get_kernel(KERNEL_IOTA, type).iota(array->parray, start, step, size);
              break;
-         }
          case BOOL:
          case STRING:
          case ARRAY:
@@ -321,34 +591,21 @@
      
      // Fill array with the sequence
      switch (type) {
-         case INT: {
-             for (size_t i = 0; i < num_points; i++) {
-                 int value = (int)(start + i * step);
-                 memcpy((char*)array->parray + i * array->sizeof_type, &value, array->sizeof_type);
-             }
-             break;
-         }
-         case FLOAT: {
-             for (size_t i = 0; i < num_points; i++) {
-                 float value = (float)(start + i * step);
-                 memcpy((char*)array->parray + i * array->sizeof_type, &value, array->sizeof_type);
-             }
-             break;
-         }
-         case DOUBLE: {
-             for (size_t i = 0; i < num_points; i++) {
-                 double value = start + i * step;
-                 memcpy((char*)array->parray + i * array->sizeof_type, &value, array->sizeof_type);
-             }
-             break;
-         }
-         case CHAR: {
-             for (size_t i = 0; i < num_points; i++) {
-                 char value = (char)(start + i * step);
-                 memcpy((char*)array->parray + i * array->sizeof_type, &value, array->sizeof_type);
-             }
+         case INT:
+         case FLOAT:
+         case DOUBLE:
+         case CHAR:
+         case INT8:
+         case INT16:
+         case INT64:
+         case UINT8:
+         case UINT16:
+         case UINT32:
+         case UINT64:
+         case FLOAT16:
+         case BFLOAT16:
+             get_kernel(KERNEL_IOTA, type).iota(array->parray, start, step, num_points);
              break;
-         }
          case BOOL:
          case STRING:
          case ARRAY:
@@ -362,31 +619,83 @@
              return NULL;
      }
      
-     // Ensure the last element is exactly the stop value
-     switch (type) {
-         case INT: {
-             int value = (int)stop;
-             memcpy((char*)array->parray + (num_points - 1) * array->sizeof_type, &value, array->sizeof_type);
-             break;
-         }
-         case FLOAT: {
-             float value = (float)stop;
-             memcpy((char*)array->parray + (num_points - 1) * array->sizeof_type, &value, array->sizeof_type);
-             break;
-         }
-         case DOUBLE: {
-             memcpy((char*)array->parray + (num_points - 1) * array->sizeof_type, &stop, array->sizeof_type);
-             break;
-         }
-         case CHAR: {
-             char value = (char)stop;
-             memcpy((char*)array->parray + (num_points - 1) * array->sizeof_type, &value, array->sizeof_type);
-             break;
-         }
-         default:
-             break;
+     // Ensure the last element is exactly the stop value, converted (and for
+     // integer types clamped) by the IOTA kernel like the other points
+     get_kernel(KERNEL_IOTA, type).iota((char*)array->parray + (num_points - 1) * array->sizeof_type,
+                                        stop, 0.0, 1);
+     
+     return array;
+ }
+ 
+ /**
+  * Wrap caller-owned memory as a contiguous array
+  */
+ Array* array_from_buffer(void* data, size_t bytes, Type type, const size_t* shape,
+                          size_t num_dimensions, void (*release)(ArrayBuffer* buffer), void* context) {
+     if (!data || !shape || num_dimensions == 0 || num_dimensions > ARRAY_MAX_DIMS) {
+         fprintf(stderr, "Error: Invalid buffer or shape\n");
+         return NULL;
      }
+     if (type == STRING || type == ARRAY) {
+         fprintf(stderr, "Error: Type cannot wrap a raw buffer\n");
+         return NULL;
+     }
+     
+     size_t size = array_sizeof_type(type);
+     size_t count = 1;
+     for (size_t d = 0; d < num_dimensions; d++) {
+         if (shape[d] != 0 && count > SIZE_MAX / shape[d]) count = SIZE_MAX;
+         else count *= shape[d];
+     }
+     if (size == 0 || count > bytes / size) {
+         fprintf(stderr, "Error: Buffer is smaller than the shape requires\n");
+         return NULL;
+     }
+     
+     Array* array = (Array*)malloc(sizeof(Array));
+     ArrayBuffer* buffer = (ArrayBuffer*)malloc(sizeof(ArrayBuffer));
+     size_t* one = (size_t*)malloc(sizeof(size_t));
+     ptrdiff_t* unit = (ptrdiff_t*)malloc(sizeof(ptrdiff_t));
+     if (!array || !buffer || !one || !unit) {
+         fprintf(stderr, "Error: Failed to allocate memory for Array\n");
+         free(array);
+         free(buffer);
+         free(one);
+         free(unit);
+         return NULL;
+     }
+     
+     atomic_init(&buffer->refcount, 1);
+     buffer->data = data;
+     buffer->bytes = bytes;
+     buffer->strings = NULL;
+     buffer->strings_size = 0;
+     buffer->release = release;
+     buffer->context = context;
      
+     one[0] = count;
+     unit[0] = 1;
+     array->parray = data;
+     array->type = type;
+     array->sizeof_type = size;
+     array->shape = one;
+     array->strides = unit;
+     array->offset = 0;
+     array->num_dimensions = 1;
+     array->count = count;
+     array->capacity = count;
+     array->is_dynamic = false;
+     array->owns_buffer = true;
+     array->base = NULL;
+     array->strings = NULL;
+     array->strings_size = 0;
+     array->buffer = buffer;
+     
+     if (num_dimensions != 1 && !array_set_shape(array, shape, num_dimensions)) {
+         buffer->release = NULL;  // caller keeps ownership on failure
+         array_free(array);
+         return NULL;
+     }
      return array;
  }
  
@@ -399,31 +708,39 @@
          return NULL;
      }
      
-     // Create a new array with the same properties
+     // A whole, dense, fixed-size array is shared until one side writes
+     Array* root = array_root(source);
+     if (!is_dynamic && !root->is_dynamic && source->offset == 0 &&
+         source->count == root->capacity && array_is_contiguous(source)) {
+         return array_share(source);
+     }
+     
+     // Strings copy their offsets and blob together
+     if (source->type == STRING) {
+         return array_string_copy(source, is_dynamic);
+     }
+     
+     // Create a new array with the same properties and shape
      Array* array = array_create(source->count, source->type, is_dynamic);
      if (!array) return NULL;
+     if (source->num_dimensions != 1 &&
+         !array_set_shape(array, source->shape, source->num_dimensions)) {
+         array_free(array);
+         return NULL;
+     }
      
      // Copy data from source array
-     if (source->type == STRING) {
-         // For string arrays, we need to duplicate each string
-         for (size_t i = 0; i < source->count; i++) {
-             char** src_str_ptr = (char**)source->parray + i;
-             char* str_copy = strdup(*src_str_ptr);
-             if (!str_copy) {
-                 fprintf(stderr, "Error: Failed to allocate memory for string copy\n");
-                 // Clean up previously allocated strings
-                 for (size_t j = 0; j < i; j++) {
-                     char** str_ptr = (char**)array->parray + j;
-                     free(*str_ptr);
-                 }
-                 array_free(array);
-                 return NULL;
-             }
-             memcpy((char*)array->parray + i * array->sizeof_type, &str_copy, array->sizeof_type);
+     if (array_is_contiguous(source)) {
+         // For other types, copy with the dispatched copy kernel
+         Kernel copy = get_kernel(KERNEL_COPY, source->type);
+         if (copy.copy) {
+             parallel_copy(copy, array->parray, array_data(source), source->count, source->sizeof_type);
+         } else {
+             memcpy(array->parray, array_data(source), source->count * source->sizeof_type);
          }
      } else {
-         // For other types, just copy the memory
-         memcpy(array->parray, source->parray, source->count * source->sizeof_type);
+         // Strided views are materialized row by row
+         array_gather(source, array->parray);
      }
      
      return array;
@@ -435,19 +752,15 @@
  void array_free(Array* array) {
      if (!array) return;
      
-     // Free string data if this is a string array
-     if (array->type == STRING && array->parray) {
-         for (size_t i = 0; i < array->count; i++) {
-             char** str_ptr = (char**)array->parray + i;
-             free(*str_ptr);
-         }
+     // Views borrow the buffer (and its strings) from their base; copies
+     // sharing it keep it alive until the last one is freed
+     if (array->owns_buffer) {
+         array_buffer_release(array->buffer);
      }
      
-     // Free array data
-     free(array->parray);
-     
-     // Free shape array
+     // Free shape and strides arrays
      free(array->shape);
+     free(array->strides);
      
      // Free array struct itself
      free(array);
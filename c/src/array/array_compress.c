@@ -0,0 +1,408 @@
+/**
+ * array_compress.c - Frame-of-reference and delta bit packing of INT arrays
+ *
+ * Compression makes two passes over the blocks, like selection: plan every
+ * block (range, encoding and width), turn the widths into packed offsets,
+ * then pack each block straight to its offset. Everything else decodes
+ * blocks one at a time into a stack buffer. Blocks are independent, so all
+ * of it runs on the thread pool.
+ */
+
+#include "../../include/array/array_compress.h"
+#include "../../include/array/array_view.h"
+#include "../../include/runtime/parallel.h"
+#include "../../include/utils/memory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdatomic.h>
+
+typedef struct {
+    const int* src;
+    int* dst;
+    CompressedArray* compressed;
+    BitPackKernelFn pack;
+    BitUnpackKernelFn unpack;
+    ScanKernelFn scan;                  // INT CUMSUM rebuilds delta blocks
+    CompareKernelFn compare;
+    PackBitsKernelFn pack_bits;
+    uint64_t* words;                    // comparison result, 2 words per block
+    CompareOp cmp;
+    int value;
+    atomic_llong sum;
+} CompressTask;
+
+/**
+ * Number of values in block b
+ */
+static size_t block_count(const CompressedArray* compressed, size_t b) {
+    size_t start = b * BITPACK_BLOCK;
+    return compressed->count - start < BITPACK_BLOCK ? compressed->count - start : BITPACK_BLOCK;
+}
+
+/**
+ * Bits needed to hold every value in [0, range]
+ */
+static unsigned width_of(unsigned long long range) {
+    unsigned bits = 0;
+    while (bits < 64 && (range >> bits) != 0) bits++;
+    return bits;
+}
+
+/**
+ * Values of block b, a partial block padded with its last value
+ */
+static size_t load_block(const CompressTask* task, size_t b, int* values) {
+    size_t n = block_count(task->compressed, b);
+    memcpy(values, task->src + b * BITPACK_BLOCK, n * sizeof(int));
+    for (size_t i = n; i < BITPACK_BLOCK; i++) values[i] = values[n - 1];
+    return n;
+}
+
+/**
+ * Decode block b into BITPACK_BLOCK values
+ */
+static void decode_block(const CompressTask* task, size_t b, int* values) {
+    const CompressedBlock* block = &task->compressed->blocks[b];
+    task->unpack(task->compressed->packed + block->offset, block->bits, block->base, values);
+    if (block->encoding == COMPRESS_DELTA) {
+        // values[0] unpacks to base, so the running sum starts at first - base
+        int carry = (int)((unsigned)block->first - (unsigned)block->base);
+        task->scan(values, values, BITPACK_BLOCK, &carry, false);
+    }
+}
+
+/**
+ * Difference packed past the end of a partial DELTA block: the one closest
+ * to 0 that [base, base + 2^bits - 1] holds
+ */
+static long long delta_pad_step(int base, unsigned bits) {
+    long long top = (long long)base + (long long)((1ull << bits) - 1);
+    return base > 0 ? base : top < 0 ? top : 0;
+}
+
+//====================
+// Compression
+//====================
+
+static void plan_blocks(size_t begin, size_t end, void* ctx) {
+    CompressTask* task = (CompressTask*)ctx;
+    int values[BITPACK_BLOCK];
+    for (size_t b = begin; b < end; b++) {
+        size_t n = load_block(task, b, values);
+        int min = values[0], max = values[0];
+        for (size_t i = 1; i < n; i++) {
+            if (values[i] < min) min = values[i];
+            if (values[i] > max) max = values[i];
+        }
+        // Steps between real values only (none for a single value)
+        long long min_step = n > 1 ? LLONG_MAX : 0, max_step = n > 1 ? LLONG_MIN : 0;
+        for (size_t i = 1; i < n; i++) {
+            long long step = (long long)values[i] - values[i - 1];
+            if (step < min_step) min_step = step;
+            if (step > max_step) max_step = step;
+        }
+
+        CompressedBlock* block = &task->compressed->blocks[b];
+        block->min = min;
+        block->max = max;
+        block->first = values[0];
+        block->encoding = COMPRESS_FOR;
+        block->base = min;
+        block->bits = (uint8_t)width_of((unsigned long long)((long long)max - min));
+        // Differences must be INT values for the CUMSUM kernel to rebuild them
+        if (min_step >= INT_MIN && max_step <= INT_MAX) {
+            unsigned delta_bits = width_of((unsigned long long)(max_step - min_step));
+            // Padding past a partial block must decode to INT values as well,
+            // else it repeats the last value (a step of 0)
+            long long reach = values[n - 1] + (long long)(BITPACK_BLOCK - n) *
+                                                  delta_pad_step((int)min_step, delta_bits);
+            if (reach < INT_MIN || reach > INT_MAX) {
+                if (min_step > 0) min_step = 0;
+                if (max_step < 0) max_step = 0;
+                delta_bits = width_of((unsigned long long)(max_step - min_step));
+            }
+            if (delta_bits < block->bits) {
+                block->encoding = COMPRESS_DELTA;
+                block->base = (int)min_step;
+                block->bits = (uint8_t)delta_bits;
+            }
+        }
+    }
+}
+
+static void pack_blocks(size_t begin, size_t end, void* ctx) {
+    CompressTask* task = (CompressTask*)ctx;
+    int values[BITPACK_BLOCK];
+    for (size_t b = begin; b < end; b++) {
+        const CompressedBlock* block = &task->compressed->blocks[b];
+        size_t n = load_block(task, b, values);
+        if (block->encoding == COMPRESS_DELTA) {
+            int pad = (int)delta_pad_step(block->base, block->bits);
+            for (size_t i = BITPACK_BLOCK - 1; i > 0; i--) {
+                values[i] = i < n ? (int)((long long)values[i] - values[i - 1]) : pad;
+            }
+            values[0] = block->base;
+        }
+        task->pack(values, block->base, block->bits, task->compressed->packed + block->offset);
+    }
+}
+
+/**
+ * Compress an INT array
+ */
+CompressedArray* array_compress(const Array* array) {
+    if (!array || array->type != INT) {
+        fprintf(stderr, "Error: Compression requires an INT array\n");
+        return NULL;
+    }
+    Array* owned;
+    const Array* src = array_contiguous(array, &owned);
+    if (!src) return NULL;
+
+    CompressedArray* compressed = (CompressedArray*)calloc(1, sizeof(CompressedArray));
+    size_t num_blocks = (array->count + BITPACK_BLOCK - 1) / BITPACK_BLOCK;
+    CompressedBlock* blocks = (CompressedBlock*)malloc((num_blocks > 0 ? num_blocks : 1) * sizeof(CompressedBlock));
+    if (!compressed || !blocks) {
+        fprintf(stderr, "Error: Failed to allocate memory for compression\n");
+        free(compressed);
+        free(blocks);
+        array_free(owned);
+        return NULL;
+    }
+    compressed->blocks = blocks;
+    compressed->count = array->count;
+    compressed->num_blocks = num_blocks;
+
+    CompressTask task = { 0 };
+    task.src = (const int*)array_data(src);
+    task.compressed = compressed;
+    task.pack = get_kernel(KERNEL_BITPACK, INT).bitpack;
+    size_t grain = parallel_grain(2 * BITPACK_BLOCK * sizeof(int));
+    parallel_for(num_blocks, grain, plan_blocks, &task);
+
+    // Widths become packed offsets
+    for (size_t b = 0; b < num_blocks; b++) {
+        blocks[b].offset = compressed->packed_words;
+        compressed->packed_words += 4 * (size_t)blocks[b].bits;
+    }
+    size_t bytes = (compressed->packed_words > 0 ? compressed->packed_words : 1) * sizeof(uint32_t);
+    compressed->packed = (uint32_t*)memory_buffer_alloc(bytes, false);
+    if (!compressed->packed) {
+        fprintf(stderr, "Error: Failed to allocate memory for compression\n");
+        free(blocks);
+        free(compressed);
+        array_free(owned);
+        return NULL;
+    }
+    parallel_for(num_blocks, grain, pack_blocks, &task);
+    array_free(owned);
+    return compressed;
+}
+
+/**
+ * Free a compressed array
+ */
+void array_compressed_free(CompressedArray* compressed) {
+    if (!compressed) return;
+    size_t bytes = (compressed->packed_words > 0 ? compressed->packed_words : 1) * sizeof(uint32_t);
+    memory_buffer_free(compressed->packed, bytes);
+    free(compressed->blocks);
+    free(compressed);
+}
+
+/**
+ * Bytes used by the headers and the packed data
+ */
+size_t array_compressed_bytes(const CompressedArray* compressed) {
+    if (!compressed) return 0;
+    return sizeof(CompressedArray) + compressed->num_blocks * sizeof(CompressedBlock) +
+           compressed->packed_words * sizeof(uint32_t);
+}
+
+//====================
+// Decompression
+//====================
+
+static void decode_blocks(size_t begin, size_t end, void* ctx) {
+    CompressTask* task = (CompressTask*)ctx;
+    for (size_t b = begin; b < end; b++) {
+        size_t n = block_count(task->compressed, b);
+        int* dst = task->dst + b * BITPACK_BLOCK;
+        if (n == BITPACK_BLOCK) {
+            decode_block(task, b, dst);
+        } else {
+            int values[BITPACK_BLOCK];
+            decode_block(task, b, values);
+            memcpy(dst, values, n * sizeof(int));
+        }
+    }
+}
+
+/**
+ * Kernels every decoding pass needs
+ */
+static void init_decoder(CompressTask* task, const CompressedArray* compressed) {
+    task->compressed = (CompressedArray*)compressed;
+    task->unpack = get_kernel(KERNEL_BITUNPACK, INT).bitunpack;
+    task->scan = get_kernel(KERNEL_CUMSUM, INT).scan;
+}
+
+/**
+ * Decompress into a new array
+ */
+Array* array_decompress(const CompressedArray* compressed) {
+    if (!compressed) {
+        fprintf(stderr, "Error: Compressed array cannot be NULL\n");
+        return NULL;
+    }
+    Array* out = array_empty(compressed->count, INT, false);
+    if (!out || compressed->count == 0) return out;
+
+    CompressTask task = { 0 };
+    init_decoder(&task, compressed);
+    task.dst = (int*)out->parray;
+    parallel_for(compressed->num_blocks, parallel_grain(2 * BITPACK_BLOCK * sizeof(int)), decode_blocks, &task);
+    return out;
+}
+
+/**
+ * Value i: extracted in place from a FOR block, a DELTA block is decoded
+ */
+int array_compressed_get(const CompressedArray* compressed, size_t i) {
+    const CompressedBlock* block = &compressed->blocks[i / BITPACK_BLOCK];
+    size_t j = i % BITPACK_BLOCK;
+    if (block->encoding == COMPRESS_DELTA) {
+        CompressTask task = { 0 };
+        init_decoder(&task, compressed);
+        int values[BITPACK_BLOCK];
+        decode_block(&task, i / BITPACK_BLOCK, values);
+        return values[j];
+    }
+    if (block->bits == 0) return block->base;
+
+    unsigned bits = block->bits;
+    unsigned bit = (unsigned)(j / 4) * bits;
+    unsigned shift = bit % 32;
+    const uint32_t* row = compressed->packed + block->offset + 4 * (bit / 32);
+    uint32_t x = row[j % 4] >> shift;
+    if (shift + bits > 32) x |= row[j % 4 + 4] << (32 - shift);
+    uint32_t mask = bits == 32 ? UINT32_MAX : ((uint32_t)1 << bits) - 1;
+    return (int)((x & mask) + (uint32_t)block->base);
+}
+
+//====================
+// Reductions and comparisons
+//====================
+
+static void sum_blocks(size_t begin, size_t end, void* ctx) {
+    CompressTask* task = (CompressTask*)ctx;
+    int values[BITPACK_BLOCK];
+    long long sum = 0;
+    for (size_t b = begin; b < end; b++) {
+        size_t n = block_count(task->compressed, b);
+        decode_block(task, b, values);
+        for (size_t i = 0; i < n; i++) sum += values[i];
+    }
+    atomic_fetch_add(&task->sum, sum);
+}
+
+/**
+ * Reduce the compressed values
+ */
+bool array_compressed_reduce(ReduceOp op, const CompressedArray* compressed, double* result) {
+    if (!compressed || !result) {
+        fprintf(stderr, "Error: Compressed array and result cannot be NULL\n");
+        return false;
+    }
+    if (op != REDUCE_SUM && op != REDUCE_MEAN && op != REDUCE_MIN && op != REDUCE_MAX) {
+        fprintf(stderr, "Error: Compressed arrays support SUM, MEAN, MIN and MAX\n");
+        return false;
+    }
+    if (op != REDUCE_SUM && compressed->count == 0) {
+        fprintf(stderr, "Error: Cannot reduce an empty array\n");
+        return false;
+    }
+
+    // Block headers hold the extremes
+    if (op == REDUCE_MIN || op == REDUCE_MAX) {
+        int best = op == REDUCE_MIN ? compressed->blocks[0].min : compressed->blocks[0].max;
+        for (size_t b = 1; b < compressed->num_blocks; b++) {
+            const CompressedBlock* block = &compressed->blocks[b];
+            if (op == REDUCE_MIN && block->min < best) best = block->min;
+            if (op == REDUCE_MAX && block->max > best) best = block->max;
+        }
+        *result = best;
+        return true;
+    }
+
+    CompressTask task = { 0 };
+    init_decoder(&task, compressed);
+    atomic_init(&task.sum, 0);
+    parallel_for(compressed->num_blocks, parallel_grain(BITPACK_BLOCK * sizeof(int)), sum_blocks, &task);
+    long long sum = atomic_load(&task.sum);
+    *result = op == REDUCE_MEAN ? (double)sum / (double)compressed->count : (double)sum;
+    return true;
+}
+
+/**
+ * Whole-block answer of (value cmp scalar) from the block range: 1 if every
+ * value passes, 0 if none does, -1 if the block must be decoded
+ */
+static int block_verdict(CompareOp cmp, const CompressedBlock* block, int value) {
+    switch (cmp) {
+        case CMP_EQ:
+        case CMP_NE: {
+            int verdict = value < block->min || value > block->max ? 0 : block->min == block->max ? 1 : -1;
+            return verdict < 0 || cmp == CMP_EQ ? verdict : !verdict;
+        }
+        case CMP_LT: return block->max < value ? 1 : block->min >= value ? 0 : -1;
+        case CMP_LE: return block->max <= value ? 1 : block->min > value ? 0 : -1;
+        case CMP_GT: return block->min > value ? 1 : block->max <= value ? 0 : -1;
+        case CMP_GE: return block->min >= value ? 1 : block->max < value ? 0 : -1;
+    }
+    return -1;
+}
+
+static void compare_blocks(size_t begin, size_t end, void* ctx) {
+    CompressTask* task = (CompressTask*)ctx;
+    int values[BITPACK_BLOCK], scalar[BITPACK_BLOCK];
+    bool passed[BITPACK_BLOCK];
+    for (size_t i = 0; i < BITPACK_BLOCK; i++) scalar[i] = task->value;
+    for (size_t b = begin; b < end; b++) {
+        size_t n = block_count(task->compressed, b);
+        uint64_t* words = task->words + 2 * b;
+        int verdict = block_verdict(task->cmp, &task->compressed->blocks[b], task->value);
+        // A partial block goes through the kernels, which keep the bits past count clear
+        if (verdict >= 0 && n == BITPACK_BLOCK) {
+            words[0] = words[1] = verdict ? UINT64_MAX : 0;
+            continue;
+        }
+        decode_block(task, b, values);
+        task->compare(values, scalar, passed, n, task->cmp);
+        task->pack_bits(passed, words, n);
+    }
+}
+
+/**
+ * Compare every value against a scalar
+ */
+BitMask* array_compressed_compare(CompareOp cmp, const CompressedArray* compressed, int value) {
+    if (!compressed) {
+        fprintf(stderr, "Error: Compressed array cannot be NULL\n");
+        return NULL;
+    }
+    BitMask* out = array_bitmask_new(compressed->count, false);
+    if (!out || compressed->count == 0) return out;
+
+    CompressTask task = { 0 };
+    init_decoder(&task, compressed);
+    task.compare = get_kernel(KERNEL_COMPARE, INT).compare;
+    task.pack_bits = get_kernel(KERNEL_PACK_BITS, BOOL).pack_bits;
+    task.words = out->words;
+    task.cmp = cmp;
+    task.value = value;
+    parallel_for(compressed->num_blocks, parallel_grain(BITPACK_BLOCK * sizeof(int)), compare_blocks, &task);
+    return out;
+}
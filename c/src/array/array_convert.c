@@ -0,0 +1,131 @@
+/**
+ * array_convert.c - Element type conversion
+ *
+ * The (dense) input is cut into ASTYPE_CHUNK-element chunks that run on the
+ * thread pool, each converted straight into the output by the dispatched
+ * KERNEL_ASTYPE kernel for the type pair. FLOAT16 and BFLOAT16 have no pair
+ * kernels: their chunks are widened to (or narrowed from) FLOAT with the
+ * KERNEL_TO_FLOAT / KERNEL_FROM_FLOAT kernels through a FLOAT buffer that
+ * stays in L1, and converted on from there.
+ */
+
+#include "../../include/array/array_convert.h"
+#include "../../include/array/array_view.h"
+#include "../../include/runtime/runtime_dispatch.h"
+#include "../../include/runtime/parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Elements per conversion step (the FLOAT buffer is 4 KB)
+#define ASTYPE_CHUNK ((size_t)1 << 10)
+
+typedef struct {
+    const char* src;
+    char* dst;
+    size_t count;                // elements
+    size_t src_size;             // element sizes
+    size_t dst_size;
+    ConvertKernelFn direct;      // source to destination (NULL: through FLOAT)
+    ConvertKernelFn to_float;    // source to FLOAT
+    ConvertKernelFn from_float;  // FLOAT to destination
+} AstypeTask;
+
+static void convert_chunks(size_t begin, size_t end, void* ctx) {
+    AstypeTask* task = (AstypeTask*)ctx;
+    float buffer[ASTYPE_CHUNK];
+    for (size_t c = begin; c < end; c++) {
+        size_t start = c * ASTYPE_CHUNK;
+        size_t n = task->count - start < ASTYPE_CHUNK ? task->count - start : ASTYPE_CHUNK;
+        const char* src = task->src + start * task->src_size;
+        char* dst = task->dst + start * task->dst_size;
+        if (task->direct) {
+            task->direct(src, dst, n);
+        } else {
+            task->to_float(src, buffer, n);
+            task->from_float(buffer, dst, n);
+        }
+    }
+}
+
+static bool is_half(Type type) {
+    return type == FLOAT16 || type == BFLOAT16;
+}
+
+// Pair kernel, NULL if either side has none
+static ConvertKernelFn astype_kernel(Type from, Type to) {
+    const ConvertKernelFn* table = get_kernel(KERNEL_ASTYPE, from).astype;
+    return table ? table[to] : NULL;
+}
+
+/**
+ * Pick the kernels for a conversion; false if the pair is not supported
+ */
+static bool astype_plan(Type from, Type to, AstypeTask* task) {
+    if (from == FLOAT && is_half(to)) {
+        task->direct = get_kernel(KERNEL_FROM_FLOAT, to).convert;
+    } else if (is_half(from) && to == FLOAT) {
+        task->direct = get_kernel(KERNEL_TO_FLOAT, from).convert;
+    } else if (is_half(from) || is_half(to)) {
+        task->to_float = is_half(from) ? get_kernel(KERNEL_TO_FLOAT, from).convert : astype_kernel(from, FLOAT);
+        task->from_float = is_half(to) ? get_kernel(KERNEL_FROM_FLOAT, to).convert : astype_kernel(FLOAT, to);
+        return task->to_float && task->from_float;
+    } else {
+        task->direct = astype_kernel(from, to);
+    }
+    return task->direct != NULL;
+}
+
+//====================
+// Public API
+//====================
+
+/**
+ * Convert an array to another element type
+ */
+Array* array_astype(const Array* array, Type type) {
+    if (!array) {
+        fprintf(stderr, "Error: Array cannot be NULL\n");
+        return NULL;
+    }
+    if (array->type == STRING || array->type == ARRAY || type == STRING || type == ARRAY ||
+        type >= TYPE_COUNT) {
+        fprintf(stderr, "Error: Type not supported for astype\n");
+        return NULL;
+    }
+    if (array->type == type) return array_copy((Array*)array, false);
+
+    AstypeTask task = { 0 };
+    if (!astype_plan(array->type, type, &task)) {
+        fprintf(stderr, "Error: Conversion not supported for these types\n");
+        return NULL;
+    }
+
+    Array* out = array_empty(array->count, type, false);
+    if (!out) return NULL;
+    if (!array_set_shape(out, array->shape, array->num_dimensions)) {
+        array_free(out);
+        return NULL;
+    }
+    if (array->count == 0) return out;
+
+    Array* owned;
+    const Array* src = array_contiguous(array, &owned);
+    if (!src) {
+        array_free(out);
+        return NULL;
+    }
+
+    task.src = (const char*)array_data(src);
+    task.dst = (char*)array_data(out);
+    task.count = array->count;
+    task.src_size = array->sizeof_type;
+    task.dst_size = out->sizeof_type;
+
+    // Small arrays fit in one grain and convert on the calling thread
+    size_t chunks = (task.count + ASTYPE_CHUNK - 1) / ASTYPE_CHUNK;
+    parallel_for(chunks, parallel_grain(ASTYPE_CHUNK * (task.src_size + task.dst_size)), convert_chunks, &task);
+
+    array_free(owned);
+    return out;
+}
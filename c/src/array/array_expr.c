@@ -0,0 +1,598 @@
+/**
+ * array_expr.c - Deferred elementwise expressions evaluated in one fused pass
+ *
+ * Nodes are stored in creation order, which is already a topological order.
+ * Evaluation builds one broadcast plan over the output and every input the
+ * node depends on, collapses it the way array_math.c does, and walks it a
+ * chunk at a time: each chunk runs the node kernels back to back in scratch
+ * buffers, which are recycled as soon as their last consumer has run.
+ */
+
+#include "../../include/array/array_expr.h"
+#include "../../include/array/array_view.h"
+#include "../../include/runtime/parallel.h"
+#include "../../include/utils/memory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+// Bytes per scratch buffer; a typical chain keeps all of its buffers in L1
+#define EXPR_CHUNK_BYTES 4096
+
+#define EXPR_OPERANDS (ARRAY_EXPR_MAX_INPUTS + 1)  // inputs, then out
+
+typedef enum {
+    EXPR_INPUT,
+    EXPR_SCALAR,
+    EXPR_BINARY,
+    EXPR_FMA
+} ExprKind;
+
+typedef struct {
+    ExprKind kind;
+    KernelOp op;          // EXPR_BINARY
+    int args[3];          // operand nodes (2 for binary, 3 for FMA)
+    const Array* array;   // EXPR_INPUT
+    double value;         // EXPR_SCALAR
+} ExprNode;
+
+struct ArrayExpr {
+    ExprNode* nodes;
+    size_t num_nodes;
+    size_t capacity;
+    Type type;            // element type of every input (TYPE_COUNT before the first)
+};
+
+//====================
+// Building
+//====================
+
+/**
+ * Create an empty expression graph
+ */
+ArrayExpr* array_expr_new(void) {
+    ArrayExpr* expr = (ArrayExpr*)calloc(1, sizeof(ArrayExpr));
+    if (!expr) {
+        fprintf(stderr, "Error: Failed to allocate memory for ArrayExpr\n");
+        return NULL;
+    }
+    expr->type = TYPE_COUNT;
+    return expr;
+}
+
+/**
+ * Free a graph
+ */
+void array_expr_free(ArrayExpr* expr) {
+    if (!expr) return;
+    free(expr->nodes);
+    free(expr);
+}
+
+static int expr_push(ArrayExpr* expr, const ExprNode* node) {
+    if (expr->num_nodes == expr->capacity) {
+        size_t capacity = expr->capacity ? expr->capacity * 2 : 16;
+        ExprNode* nodes = capacity <= INT_MAX ? (ExprNode*)realloc(expr->nodes, capacity * sizeof(ExprNode)) : NULL;
+        if (!nodes) {
+            fprintf(stderr, "Error: Failed to grow ArrayExpr\n");
+            return -1;
+        }
+        expr->nodes = nodes;
+        expr->capacity = capacity;
+    }
+    expr->nodes[expr->num_nodes] = *node;
+    return (int)expr->num_nodes++;
+}
+
+/**
+ * Check operand handles; -1 operands fail quietly (the error was already reported)
+ */
+static bool expr_check_args(const ArrayExpr* expr, const int* args, size_t n) {
+    if (!expr) {
+        fprintf(stderr, "Error: ArrayExpr cannot be NULL\n");
+        return false;
+    }
+    for (size_t k = 0; k < n; k++) {
+        if (args[k] == -1) return false;
+        if (args[k] < 0 || (size_t)args[k] >= expr->num_nodes) {
+            fprintf(stderr, "Error: Invalid expression node\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Add an array operand
+ */
+int array_expr_input(ArrayExpr* expr, const Array* array) {
+    if (!expr || !array) {
+        fprintf(stderr, "Error: ArrayExpr and Array cannot be NULL\n");
+        return -1;
+    }
+    if (array->type == STRING || array->type == ARRAY) {
+        fprintf(stderr, "Error: Expressions support numeric and BOOL arrays only\n");
+        return -1;
+    }
+    if (expr->type != TYPE_COUNT && expr->type != array->type) {
+        fprintf(stderr, "Error: Operand types must match\n");
+        return -1;
+    }
+
+    ExprNode node = { .kind = EXPR_INPUT, .args = { -1, -1, -1 }, .array = array };
+    int id = expr_push(expr, &node);
+    if (id >= 0) expr->type = array->type;
+    return id;
+}
+
+/**
+ * Add a constant
+ */
+int array_expr_scalar(ArrayExpr* expr, double value) {
+    if (!expr) {
+        fprintf(stderr, "Error: ArrayExpr cannot be NULL\n");
+        return -1;
+    }
+    ExprNode node = { .kind = EXPR_SCALAR, .args = { -1, -1, -1 }, .value = value };
+    return expr_push(expr, &node);
+}
+
+/**
+ * Add an elementwise binary node
+ */
+int array_expr_binary(ArrayExpr* expr, KernelOp op, int a, int b) {
+    int args[2] = { a, b };
+    if (!expr_check_args(expr, args, 2)) return -1;
+    if (op != KERNEL_ADD && op != KERNEL_SUB && op != KERNEL_MUL && op != KERNEL_DIV &&
+        op != KERNEL_MIN && op != KERNEL_MAX) {
+        fprintf(stderr, "Error: Not a binary elementwise operation\n");
+        return -1;
+    }
+    ExprNode node = { .kind = EXPR_BINARY, .op = op, .args = { a, b, -1 } };
+    return expr_push(expr, &node);
+}
+
+/**
+ * Add a fused multiply-add node
+ */
+int array_expr_fma(ArrayExpr* expr, int a, int b, int c) {
+    int args[3] = { a, b, c };
+    if (!expr_check_args(expr, args, 3)) return -1;
+    ExprNode node = { .kind = EXPR_FMA, .op = KERNEL_FMA, .args = { a, b, c } };
+    return expr_push(expr, &node);
+}
+
+int array_expr_add(ArrayExpr* expr, int a, int b) { return array_expr_binary(expr, KERNEL_ADD, a, b); }
+int array_expr_sub(ArrayExpr* expr, int a, int b) { return array_expr_binary(expr, KERNEL_SUB, a, b); }
+int array_expr_mul(ArrayExpr* expr, int a, int b) { return array_expr_binary(expr, KERNEL_MUL, a, b); }
+int array_expr_div(ArrayExpr* expr, int a, int b) { return array_expr_binary(expr, KERNEL_DIV, a, b); }
+int array_expr_minimum(ArrayExpr* expr, int a, int b) { return array_expr_binary(expr, KERNEL_MIN, a, b); }
+int array_expr_maximum(ArrayExpr* expr, int a, int b) { return array_expr_binary(expr, KERNEL_MAX, a, b); }
+
+//====================
+// Evaluation
+//====================
+
+/**
+ * Per-node evaluation state
+ */
+typedef struct {
+    Kernel kernel;
+    int slot;                 // scratch buffer (-1 if the node is not evaluated)
+    size_t operand;           // EXPR_INPUT: index into the plan
+    unsigned char value[8];   // EXPR_SCALAR: the constant in the element type
+} ExprStep;
+
+/**
+ * Everything a worker needs to evaluate a range of chunks
+ */
+typedef struct {
+    const ArrayExpr* expr;
+    ExprStep* steps;
+    const int* order;         // evaluated nodes, in topological order
+    size_t num_steps;
+    int root;
+    size_t size;              // element size
+    size_t num_slots;
+    size_t num_operands;      // inputs + out
+    size_t num_dimensions;    // collapsed
+    size_t shape[ARRAY_MAX_DIMS];
+    ptrdiff_t strides[EXPR_OPERANDS][ARRAY_MAX_DIMS];
+    char* data[EXPR_OPERANDS];
+    size_t chunk;             // elements per chunk
+    size_t chunks_per_row;
+    atomic_bool failed;
+} ExprTask;
+
+// Integer types go through their IOTA kernel, which truncates and clamps
+// out-of-range constants instead of casting
+static void expr_store_scalar(Type type, double value, void* dst) {
+    switch (type) {
+        case FLOAT:  *(float*)dst = (float)value; break;
+        case DOUBLE: *(double*)dst = value; break;
+        case BOOL:   *(bool*)dst = value != 0; break;
+        default:     get_kernel(KERNEL_IOTA, type).iota(dst, value, 0.0, 1); break;
+    }
+}
+
+/**
+ * Broadcast the inputs to one shape and collapse it, as array_math.c does
+ * for two operands
+ */
+static bool expr_plan(ExprTask* task, const Array* const* operands) {
+    size_t m = task->num_operands - 1;
+    const Array* out = operands[m];
+
+    size_t shape[ARRAY_MAX_DIMS];
+    size_t ndim = 0;
+    for (size_t k = 0; k < m; k++) {
+        if (operands[k]->num_dimensions > ndim) ndim = operands[k]->num_dimensions;
+    }
+    for (size_t d = 0; d < ndim; d++) {
+        shape[d] = 1;
+        for (size_t k = 0; k < m; k++) {
+            size_t lead = ndim - operands[k]->num_dimensions;
+            size_t dim = d < lead ? 1 : operands[k]->shape[d - lead];
+            if (dim != shape[d] && dim != 1 && shape[d] != 1) {
+                fprintf(stderr, "Error: Operands could not be broadcast together\n");
+                return false;
+            }
+            if (dim != 1) shape[d] = dim;
+        }
+    }
+    if (out->num_dimensions != ndim || memcmp(out->shape, shape, ndim * sizeof(size_t)) != 0) {
+        fprintf(stderr, "Error: Output shape does not match the broadcast shape\n");
+        return false;
+    }
+
+    ptrdiff_t strides[EXPR_OPERANDS][ARRAY_MAX_DIMS];
+    for (size_t k = 0; k < task->num_operands; k++) {
+        size_t lead = ndim - operands[k]->num_dimensions;
+        for (size_t d = 0; d < ndim; d++) {
+            bool broadcast = d < lead || operands[k]->shape[d - lead] == 1;
+            strides[k][d] = broadcast ? 0 : operands[k]->strides[d - lead];
+        }
+        task->data[k] = (char*)array_data(operands[k]);
+    }
+
+    // Walk outward from the innermost axis, merging where every layout allows
+    size_t n = 0;
+    for (size_t d = ndim; d-- > 0;) {
+        if (shape[d] == 1) continue;
+
+        bool merge = n > 0;
+        for (size_t k = 0; k < task->num_operands && merge; k++) {
+            size_t inner = ARRAY_MAX_DIMS - n;
+            merge = strides[k][d] == task->strides[k][inner] * (ptrdiff_t)task->shape[inner];
+        }
+
+        if (merge) {
+            task->shape[ARRAY_MAX_DIMS - n] *= shape[d];
+        } else {
+            n++;
+            task->shape[ARRAY_MAX_DIMS - n] = shape[d];
+            for (size_t k = 0; k < task->num_operands; k++) {
+                task->strides[k][ARRAY_MAX_DIMS - n] = strides[k][d];
+            }
+        }
+    }
+
+    if (n == 0) {
+        n = 1;
+        task->shape[ARRAY_MAX_DIMS - 1] = 1;
+        for (size_t k = 0; k < task->num_operands; k++) task->strides[k][ARRAY_MAX_DIMS - 1] = 1;
+    }
+
+    task->num_dimensions = n;
+    memmove(task->shape, task->shape + ARRAY_MAX_DIMS - n, n * sizeof(size_t));
+    for (size_t k = 0; k < task->num_operands; k++) {
+        memmove(task->strides[k], task->strides[k] + ARRAY_MAX_DIMS - n, n * sizeof(ptrdiff_t));
+    }
+    return true;
+}
+
+/**
+ * Evaluate chunks [begin, end); chunk u is piece u % chunks_per_row of row
+ * u / chunks_per_row
+ */
+static void expr_run(size_t begin, size_t end, void* ctx) {
+    ExprTask* task = (ExprTask*)ctx;
+    const ExprNode* nodes = task->expr->nodes;
+    size_t size = task->size;
+    size_t bytes = task->chunk * size;
+    size_t ndim = task->num_dimensions;
+    size_t inner = task->shape[ndim - 1];
+    size_t out_k = task->num_operands - 1;
+    ptrdiff_t out_stride = task->strides[out_k][ndim - 1];
+
+    unsigned char* scratch = (unsigned char*)aligned_malloc(task->num_slots * bytes, 64);
+    const void** value = (const void**)malloc(task->expr->num_nodes * sizeof(void*));
+    if (!scratch || !value) {
+        atomic_store(&task->failed, true);
+        aligned_free(scratch);
+        free(value);
+        return;
+    }
+
+    // Constants fill their buffers once
+    for (size_t s = 0; s < task->num_steps; s++) {
+        int i = task->order[s];
+        if (nodes[i].kind == EXPR_SCALAR) {
+            array_copy_elements(scratch + task->steps[i].slot * bytes, 1, task->steps[i].value, 0,
+                                 task->chunk, size);
+        }
+    }
+    // Inputs broadcast along the row: remember which element their buffer holds
+    const char* staged[EXPR_OPERANDS] = { NULL };
+    size_t staged_count[EXPR_OPERANDS] = { 0 };
+
+    for (size_t u = begin; u < end; u++) {
+        size_t row = u / task->chunks_per_row;
+        size_t start = (u % task->chunks_per_row) * task->chunk;
+        size_t m = inner - start < task->chunk ? inner - start : task->chunk;
+
+        ptrdiff_t base[EXPR_OPERANDS] = { 0 };
+        for (size_t d = ndim - 1, rest = row; d-- > 0;) {
+            size_t index = rest % task->shape[d];
+            rest /= task->shape[d];
+            for (size_t k = 0; k < task->num_operands; k++) base[k] += (ptrdiff_t)index * task->strides[k][d];
+        }
+
+        char* dst = task->data[out_k] + (base[out_k] + (ptrdiff_t)start * out_stride) * (ptrdiff_t)size;
+
+        for (size_t s = 0; s < task->num_steps; s++) {
+            int i = task->order[s];
+            const ExprNode* node = &nodes[i];
+            const ExprStep* step = &task->steps[i];
+            unsigned char* buffer = scratch + step->slot * bytes;
+
+            if (node->kind == EXPR_INPUT) {
+                size_t k = step->operand;
+                ptrdiff_t stride = task->strides[k][ndim - 1];
+                const char* src = task->data[k] + (base[k] + (ptrdiff_t)start * stride) * (ptrdiff_t)size;
+                if (stride == 1) {
+                    value[i] = src;
+                    continue;
+                }
+                if (stride != 0 || staged[k] != src || staged_count[k] < m) {
+                    array_copy_elements(buffer, 1, src, stride, m, size);
+                    staged[k] = stride == 0 ? src : NULL;
+                    staged_count[k] = m;
+                }
+                value[i] = buffer;
+            } else if (node->kind == EXPR_SCALAR) {
+                value[i] = buffer;
+            } else {
+                // The root writes straight to a dense output
+                void* result = i == task->root && out_stride == 1 ? (void*)dst : (void*)buffer;
+                if (node->kind == EXPR_FMA) {
+                    step->kernel.fma(value[node->args[0]], value[node->args[1]], value[node->args[2]], result, m);
+                } else {
+                    step->kernel.binary(value[node->args[0]], value[node->args[1]], result, m);
+                }
+                value[i] = result;
+            }
+        }
+
+        if (value[task->root] != dst) {
+            array_copy_elements(dst, out_stride, value[task->root], 1, m, size);
+        }
+    }
+
+    free(value);
+    aligned_free(scratch);
+}
+
+/**
+ * Last node reading each node up to root (-1: root does not depend on it;
+ * INT_MAX for the root itself)
+ */
+static void expr_liveness(const ArrayExpr* expr, int root, int* last_use) {
+    for (int i = 0; i <= root; i++) last_use[i] = -1;
+    last_use[root] = INT_MAX;
+    for (int i = root + 1; i-- > 0;) {
+        if (last_use[i] == -1) continue;
+        for (int k = 0; k < 3; k++) {
+            int arg = expr->nodes[i].args[k];
+            if (arg >= 0 && last_use[arg] < i) last_use[arg] = i;
+        }
+    }
+}
+
+/**
+ * Pick the nodes the root depends on, resolve their kernels and give each a
+ * scratch slot. Computed nodes hand their slot back after their last consumer.
+ */
+static bool expr_schedule(ExprTask* task, Type type, const Array** operands, int* order, int* last_use) {
+    const ArrayExpr* expr = task->expr;
+    const ExprNode* nodes = expr->nodes;
+    size_t count = (size_t)task->root + 1;
+
+    for (size_t i = 0; i < count; i++) task->steps[i].slot = -1;
+    expr_liveness(expr, task->root, last_use);
+
+    task->num_steps = 0;
+    task->num_operands = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (last_use[i] != -1) order[task->num_steps++] = (int)i;
+    }
+
+    int* free_slots = (int*)malloc(task->num_steps * sizeof(int));
+    if (!free_slots) {
+        fprintf(stderr, "Error: Failed to allocate memory for evaluation\n");
+        return false;
+    }
+    size_t num_free = 0;
+    bool ok = true;
+
+    for (size_t s = 0; s < task->num_steps && ok; s++) {
+        int i = order[s];
+        const ExprNode* node = &nodes[i];
+        ExprStep* step = &task->steps[i];
+
+        switch (node->kind) {
+            case EXPR_INPUT:
+                if (task->num_operands == ARRAY_EXPR_MAX_INPUTS) {
+                    fprintf(stderr, "Error: Expression reads more than %d arrays\n", ARRAY_EXPR_MAX_INPUTS);
+                    ok = false;
+                    break;
+                }
+                step->operand = task->num_operands;
+                operands[task->num_operands++] = node->array;
+                step->slot = (int)task->num_slots++;
+                break;
+            case EXPR_SCALAR:
+                expr_store_scalar(type, node->value, step->value);
+                step->slot = (int)task->num_slots++;
+                break;
+            case EXPR_BINARY:
+            case EXPR_FMA:
+                step->kernel = get_kernel(node->op, type);
+                if (!step->kernel.binary) {
+                    fprintf(stderr, "Error: Operation not supported for this type\n");
+                    ok = false;
+                    break;
+                }
+                step->slot = num_free > 0 ? free_slots[--num_free] : (int)task->num_slots++;
+
+                // Release operands this node was the last reader of (once each)
+                for (int k = 0; k < 3; k++) {
+                    int arg = node->args[k];
+                    if (arg < 0 || last_use[arg] != i) continue;
+                    if (nodes[arg].kind != EXPR_BINARY && nodes[arg].kind != EXPR_FMA) continue;
+                    if ((k > 0 && node->args[0] == arg) || (k > 1 && node->args[1] == arg)) continue;
+                    free_slots[num_free++] = task->steps[arg].slot;
+                }
+                break;
+        }
+    }
+
+    free(free_slots);
+    if (ok && task->num_operands == 0) {
+        fprintf(stderr, "Error: Expression has no array inputs\n");
+        ok = false;
+    }
+    return ok;
+}
+
+/**
+ * Evaluate a node into an existing array
+ */
+bool array_expr_eval_into(const ArrayExpr* expr, int node, Array* out) {
+    if (!out || !expr_check_args(expr, &node, 1)) {
+        if (!out) fprintf(stderr, "Error: Output cannot be NULL\n");
+        return false;
+    }
+    if (out->type != expr->type) {
+        fprintf(stderr, "Error: Output type must match the operands\n");
+        return false;
+    }
+
+    ExprTask* task = (ExprTask*)calloc(1, sizeof(ExprTask));
+    size_t count = (size_t)node + 1;
+    ExprStep* steps = (ExprStep*)calloc(count, sizeof(ExprStep));
+    int* order = (int*)malloc(count * sizeof(int));
+    int* last_use = (int*)malloc(count * sizeof(int));
+    const Array* operands[EXPR_OPERANDS];
+    bool ok = task && steps && order && last_use;
+    if (!ok) fprintf(stderr, "Error: Failed to allocate memory for evaluation\n");
+
+    if (ok) {
+        task->expr = expr;
+        task->steps = steps;
+        task->order = order;
+        task->root = node;
+        task->size = out->sizeof_type;
+        atomic_init(&task->failed, false);
+        ok = expr_schedule(task, expr->type, operands, order, last_use);
+    }
+
+    // out may share its buffer with a copy (which may be one of the inputs)
+    if (ok) ok = array_make_writable(out);
+
+    // Inputs partially overlapping out are read from copies
+    Array* owned[EXPR_OPERANDS] = { NULL };
+    for (size_t k = 0; ok && k < task->num_operands; k++) {
+        operands[k] = array_unaliased(operands[k], out, &owned[k]);
+        ok = operands[k] != NULL;
+    }
+
+    if (ok) {
+        operands[task->num_operands++] = out;
+        ok = expr_plan(task, operands);
+    }
+
+    if (ok && out->count > 0) {
+        size_t ndim = task->num_dimensions;
+        size_t inner = task->shape[ndim - 1];
+        size_t rows = out->count / inner;
+        task->chunk = EXPR_CHUNK_BYTES / task->size;
+        if (task->chunk > inner) task->chunk = inner;
+        task->chunks_per_row = (inner + task->chunk - 1) / task->chunk;
+
+        size_t grain = parallel_grain(task->num_operands * task->size) / task->chunk;
+        parallel_for(rows * task->chunks_per_row, grain, expr_run, task);
+        if (atomic_load(&task->failed)) {
+            fprintf(stderr, "Error: Failed to allocate memory for evaluation\n");
+            ok = false;
+        }
+    }
+
+    for (size_t k = 0; k < EXPR_OPERANDS; k++) array_free(owned[k]);
+    free(last_use);
+    free(order);
+    free(steps);
+    free(task);
+    return ok;
+}
+
+/**
+ * Evaluate a node into a new array
+ */
+Array* array_expr_eval(const ArrayExpr* expr, int node) {
+    if (!expr_check_args(expr, &node, 1)) return NULL;
+
+    int* last_use = (int*)malloc(((size_t)node + 1) * sizeof(int));
+    if (!last_use) {
+        fprintf(stderr, "Error: Failed to allocate memory for evaluation\n");
+        return NULL;
+    }
+    expr_liveness(expr, node, last_use);
+
+    // Output shape: every input the node reads, broadcast together
+    // (compatibility is checked when the plan is built)
+    size_t shape[ARRAY_MAX_DIMS];
+    size_t ndim = 0;
+    for (int i = 0; i <= node; i++) {
+        const Array* array = expr->nodes[i].array;
+        if (last_use[i] != -1 && expr->nodes[i].kind == EXPR_INPUT && array->num_dimensions > ndim) {
+            ndim = array->num_dimensions;
+        }
+    }
+    for (size_t d = 0; d < ndim; d++) shape[d] = 1;
+    for (int i = 0; i <= node; i++) {
+        const Array* array = expr->nodes[i].array;
+        if (last_use[i] == -1 || expr->nodes[i].kind != EXPR_INPUT) continue;
+        size_t lead = ndim - array->num_dimensions;
+        for (size_t d = 0; d < array->num_dimensions; d++) {
+            if (array->shape[d] != 1) shape[lead + d] = array->shape[d];
+        }
+    }
+    free(last_use);
+    if (ndim == 0) {
+        fprintf(stderr, "Error: Expression has no array inputs\n");
+        return NULL;
+    }
+
+    size_t count = 1;
+    for (size_t d = 0; d < ndim; d++) count *= shape[d];
+
+    Array* out = array_empty(count, expr->type, false);
+    if (!out) return NULL;
+    if (!array_set_shape(out, shape, ndim) || !array_expr_eval_into(expr, node, out)) {
+        array_free(out);
+        return NULL;
+    }
+    return out;
+}
@@ -0,0 +1,353 @@
+/**
+ * array_index.c - take and put with INT index arrays
+ *
+ * Both forms see the (dense) array as [outer, len, inner]: len is the indexed
+ * extent and inner the elements moved per index. With inner == 1 every index
+ * moves one element and the dispatched gather/scatter kernels do the work;
+ * otherwise each index moves a whole contiguous row with memcpy. Indices are
+ * checked and made non-negative once up front, so the kernels never branch.
+ */
+
+#include "../../include/array/array_index.h"
+#include "../../include/array/array_string.h"
+#include "../../include/array/array_view.h"
+#include "../../include/runtime/runtime_dispatch.h"
+#include "../../include/runtime/parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Indices per scheduling unit of a gather
+#define TAKE_CHUNK 4096
+
+typedef struct {
+    const char* src;
+    char* dst;
+    const int* indices;
+    size_t len;              // extent of the indexed axis
+    size_t k;                // number of indices
+    size_t inner;            // elements moved per index
+    size_t size;             // element size
+    size_t chunks;           // gather units per outer row
+    size_t prefetch;
+    Kernel take;
+} TakeTask;
+
+static void take_chunks(size_t begin, size_t end, void* ctx) {
+    TakeTask* task = (TakeTask*)ctx;
+    for (size_t u = begin; u < end; u++) {
+        size_t o = u / task->chunks;
+        size_t j = (u % task->chunks) * TAKE_CHUNK;
+        size_t n = task->k - j < TAKE_CHUNK ? task->k - j : TAKE_CHUNK;
+        task->take.take(task->src + o * task->len * task->size, task->indices + j,
+                        task->dst + (o * task->k + j) * task->size, n, task->prefetch);
+    }
+}
+
+static void take_rows(size_t begin, size_t end, void* ctx) {
+    TakeTask* task = (TakeTask*)ctx;
+    size_t row = task->inner * task->size;
+    for (size_t r = begin; r < end; r++) {
+        size_t o = r / task->k;
+        size_t j = r % task->k;
+        memcpy(task->dst + r * row, task->src + (o * task->len + (size_t)task->indices[j]) * row, row);
+    }
+}
+
+/**
+ * Prefetch distance for gathers or scatters into `bytes` of indexed data
+ */
+static size_t prefetch_distance(size_t bytes) {
+    // parallel_grain(1) is the L2 size: below it random accesses mostly hit
+    return bytes > parallel_grain(1) ? get_gather_prefetch_distance() : 0;
+}
+
+/**
+ * Check an INT index array against an extent of len and give its indices as a
+ * dense non-negative buffer (*owned is set when the caller must free it)
+ */
+static bool prepare_indices(const Array* indices, size_t len, const int** out, int** owned) {
+    *owned = NULL;
+    if (!indices || indices->type != INT) {
+        fprintf(stderr, "Error: Indices must be an INT array\n");
+        return false;
+    }
+
+    Array* owned_dense;
+    const Array* d = array_contiguous(indices, &owned_dense);
+    if (!d) return false;
+    const int* idx = (const int*)array_data(d);
+    size_t count = indices->count;
+
+    bool negative = false;
+    for (size_t i = 0; i < count; i++) {
+        long long v = idx[i];
+        if (v < -(long long)len || v >= (long long)len) {
+            fprintf(stderr, "Error: Index %d is out of bounds for size %zu\n", idx[i], len);
+            array_free(owned_dense);
+            return false;
+        }
+        negative |= v < 0;
+    }
+    if (!negative && !owned_dense) {
+        *out = idx;
+        return true;
+    }
+
+    // Wrapped negatives, or a dense copy that must outlive its Array
+    int* fixed = (int*)malloc((count > 0 ? count : 1) * sizeof(int));
+    if (!fixed) {
+        fprintf(stderr, "Error: Failed to allocate memory for indices\n");
+        array_free(owned_dense);
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        fixed[i] = idx[i] < 0 ? (int)(idx[i] + (long long)len) : idx[i];
+    }
+    array_free(owned_dense);
+    *out = fixed;
+    *owned = fixed;
+    return true;
+}
+
+/**
+ * Split an array's shape around axis into [outer, len, inner]
+ */
+static void axis_extents(const Array* array, size_t axis, size_t* outer, size_t* inner) {
+    *outer = 1;
+    *inner = 1;
+    for (size_t d = 0; d < axis; d++) *outer *= array->shape[d];
+    for (size_t d = axis + 1; d < array->num_dimensions; d++) *inner *= array->shape[d];
+}
+
+/**
+ * Gather [outer, k, inner] from the dense [outer, len, inner] array a into out
+ */
+static void take_run(const Array* a, const int* idx, size_t outer, size_t len, size_t k,
+                     size_t inner, Array* out) {
+    if (outer == 0 || k == 0 || inner == 0) return;
+
+    TakeTask task = { 0 };
+    task.src = (const char*)array_data(a);
+    task.dst = (char*)array_data(out);
+    task.indices = idx;
+    task.len = len;
+    task.k = k;
+    task.inner = inner;
+    task.size = a->sizeof_type;
+
+    if (inner == 1) {
+        task.take = get_kernel(KERNEL_TAKE, a->type);
+        task.prefetch = prefetch_distance(len * task.size);
+        task.chunks = (k + TAKE_CHUNK - 1) / TAKE_CHUNK;
+        parallel_for(outer * task.chunks, parallel_grain(TAKE_CHUNK * (2 * task.size + sizeof(int))),
+                     take_chunks, &task);
+    } else {
+        parallel_for(outer * k, parallel_grain(2 * inner * task.size), take_rows, &task);
+    }
+}
+
+/**
+ * STRING take: gather the picked strings and pack them into a new blob
+ */
+static Array* take_strings(const Array* array, const int* idx, size_t k) {
+    const char** strings = (const char**)malloc((k > 0 ? k : 1) * sizeof(char*));
+    if (!strings) {
+        fprintf(stderr, "Error: Failed to allocate memory for take\n");
+        return NULL;
+    }
+    for (size_t i = 0; i < k; i++) strings[i] = array_string_get(array, (size_t)idx[i]);
+    Array* out = array_from_strings(strings, k, false);
+    free(strings);
+    return out;
+}
+
+/**
+ * Elements of the flattened array at the given indices
+ */
+Array* array_take(const Array* array, const Array* indices) {
+    if (!array || !indices) {
+        fprintf(stderr, "Error: Array and indices cannot be NULL\n");
+        return NULL;
+    }
+    if (array->type == ARRAY) {
+        fprintf(stderr, "Error: Arrays of arrays cannot be indexed\n");
+        return NULL;
+    }
+
+    const int* idx;
+    int* owned_idx;
+    if (!prepare_indices(indices, array->count, &idx, &owned_idx)) return NULL;
+
+    Array* out = NULL;
+    if (array->type == STRING) {
+        out = take_strings(array, idx, indices->count);
+    } else {
+        Array* owned;
+        const Array* a = array_contiguous(array, &owned);
+        out = a ? array_empty(indices->count, array->type, false) : NULL;
+        if (out) take_run(a, idx, 1, array->count, indices->count, 1, out);
+        array_free(owned);
+    }
+    if (out && !array_set_shape(out, indices->shape, indices->num_dimensions)) {
+        array_free(out);
+        out = NULL;
+    }
+
+    free(owned_idx);
+    return out;
+}
+
+/**
+ * Slices along one axis at the given indices
+ */
+Array* array_take_axis(const Array* array, const Array* indices, size_t axis) {
+    if (!array || !indices) {
+        fprintf(stderr, "Error: Array and indices cannot be NULL\n");
+        return NULL;
+    }
+    if (array->type == ARRAY || array->type == STRING) {
+        fprintf(stderr, "Error: take along an axis is not supported for this type\n");
+        return NULL;
+    }
+    if (axis >= array->num_dimensions) {
+        fprintf(stderr, "Error: Axis %zu is out of range for %zu dimensions\n", axis, array->num_dimensions);
+        return NULL;
+    }
+
+    size_t len = array->shape[axis];
+    const int* idx;
+    int* owned_idx;
+    if (!prepare_indices(indices, len, &idx, &owned_idx)) return NULL;
+
+    size_t outer, inner;
+    axis_extents(array, axis, &outer, &inner);
+    size_t k = indices->count;
+    size_t shape[ARRAY_MAX_DIMS];
+    memcpy(shape, array->shape, array->num_dimensions * sizeof(size_t));
+    shape[axis] = k;
+
+    Array* owned;
+    const Array* a = array_contiguous(array, &owned);
+    Array* out = a ? array_empty(outer * k * inner, array->type, false) : NULL;
+    if (out && !array_set_shape(out, shape, array->num_dimensions)) {
+        array_free(out);
+        out = NULL;
+    }
+    if (out) take_run(a, idx, outer, len, k, inner, out);
+
+    array_free(owned);
+    free(owned_idx);
+    return out;
+}
+
+/**
+ * Scatter [outer, k, inner] values into the dense [outer, len, inner] buffer
+ * dst, in index order (repeat: every index gets the single value)
+ */
+static void put_run(char* dst, Type type, size_t size, const int* idx, const char* values,
+                    bool repeat, size_t outer, size_t len, size_t k, size_t inner) {
+    if (inner == 1 && !repeat) {
+        Kernel put = get_kernel(KERNEL_PUT, type);
+        size_t prefetch = prefetch_distance(len * size);
+        for (size_t o = 0; o < outer; o++) {
+            put.put(dst + o * len * size, idx, values + o * k * size, k, prefetch);
+        }
+        return;
+    }
+    size_t row = inner * size;
+    for (size_t o = 0; o < outer; o++) {
+        for (size_t j = 0; j < k; j++) {
+            const char* value = repeat ? values : values + (o * k + j) * row;
+            memcpy(dst + (o * len + (size_t)idx[j]) * row, value, row);
+        }
+    }
+}
+
+/**
+ * Shared checks and staging of array_put and array_put_axis
+ */
+static bool put_along(Array* array, const Array* indices, const Array* values, size_t axis,
+                      bool flat) {
+    if (!array || !indices || !values) {
+        fprintf(stderr, "Error: Array, indices and values cannot be NULL\n");
+        return false;
+    }
+    if (array->type == ARRAY || array->type == STRING) {
+        fprintf(stderr, "Error: put is not supported for this type\n");
+        return false;
+    }
+    if (values->type != array->type) {
+        fprintf(stderr, "Error: Values must have the type of the array\n");
+        return false;
+    }
+
+    size_t outer = 1, len = array->count, inner = 1;
+    if (!flat) {
+        if (axis >= array->num_dimensions) {
+            fprintf(stderr, "Error: Axis %zu is out of range for %zu dimensions\n", axis, array->num_dimensions);
+            return false;
+        }
+        len = array->shape[axis];
+        axis_extents(array, axis, &outer, &inner);
+    }
+
+    size_t k = indices->count;
+    bool repeat = false;
+    if (flat) {
+        repeat = values->count == 1 && k != 1;
+        if (values->count != k && !repeat) {
+            fprintf(stderr, "Error: Values must have one element per index or a single element\n");
+            return false;
+        }
+    } else {
+        bool match = values->num_dimensions == array->num_dimensions;
+        for (size_t d = 0; match && d < array->num_dimensions; d++) {
+            match = values->shape[d] == (d == axis ? k : array->shape[d]);
+        }
+        if (!match) {
+            fprintf(stderr, "Error: Values must match the array shape with the indexed axis resized\n");
+            return false;
+        }
+    }
+
+    const int* idx;
+    int* owned_idx;
+    if (!prepare_indices(indices, len, &idx, &owned_idx)) return false;
+    if (!array_make_writable(array)) {
+        free(owned_idx);
+        return false;
+    }
+
+    Array* owned_values;
+    const Array* v = array_contiguous(values, &owned_values);
+
+    // Strided targets are written through a dense staging copy
+    Array* staged = NULL;
+    const Array* target = v ? array_contiguous(array, &staged) : NULL;
+    bool ok = target != NULL;
+    if (ok) {
+        put_run((char*)array_data(target), array->type, array->sizeof_type, idx,
+                (const char*)array_data(v), repeat, outer, len, k, inner);
+        if (staged) array_scatter(array, array_data(staged));
+    }
+
+    array_free(staged);
+    array_free(owned_values);
+    free(owned_idx);
+    return ok;
+}
+
+/**
+ * Write values to the flattened array at the given indices
+ */
+bool array_put(Array* array, const Array* indices, const Array* values) {
+    return put_along(array, indices, values, 0, true);
+}
+
+/**
+ * Write slices along one axis at the given indices
+ */
+bool array_put_axis(Array* array, const Array* indices, const Array* values, size_t axis) {
+    return put_along(array, indices, values, axis, false);
+}
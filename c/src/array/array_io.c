@@ -0,0 +1,366 @@
+/**
+ * array_io.c - .npy save and memory-mapped load
+ *
+ * Header layout (format versions 1.0, 2.0 and 3.0):
+ *   "\x93NUMPY", major, minor, header length (uint16 for 1.x, uint32 after),
+ *   then a Python dict literal padded with spaces and a final '\n' so the
+ *   data starts on a 64-byte boundary.
+ */
+
+#include "../../include/array/array_io.h"
+#include "../../include/array/array_view.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define NPY_MAGIC "\x93NUMPY"
+#define NPY_MAGIC_LEN 6
+#define NPY_ALIGN 64
+#define NPY_MAX_HEADER 65536
+
+static bool host_is_little_endian(void) {
+    const uint16_t probe = 1;
+    return *(const uint8_t*)&probe == 1;
+}
+
+/**
+ * dtype string for a Type ("<i4", ...), NULL if it has no .npy equivalent
+ */
+static const char* npy_descr(Type type) {
+    bool little = host_is_little_endian();
+    switch (type) {
+        case INT:    return sizeof(int) == 4 ? (little ? "<i4" : ">i4") : NULL;
+        case FLOAT:  return little ? "<f4" : ">f4";
+        case DOUBLE: return little ? "<f8" : ">f8";
+        case CHAR:   return "|i1";
+        case BOOL:   return sizeof(bool) == 1 ? "|b1" : NULL;
+        case INT8:   return "|i1";
+        case INT16:  return little ? "<i2" : ">i2";
+        case INT64:  return little ? "<i8" : ">i8";
+        case UINT8:  return "|u1";
+        case UINT16: return little ? "<u2" : ">u2";
+        case UINT32: return little ? "<u4" : ">u4";
+        case UINT64: return little ? "<u8" : ">u8";
+        case FLOAT16: return little ? "<f2" : ">f2";
+        default:     return NULL;  // BFLOAT16 has no NumPy dtype
+    }
+}
+
+/**
+ * Type for a dtype string; only the host byte order is accepted
+ */
+static bool npy_type(const char* descr, Type* type) {
+    // CHAR comes before INT8 so "|i1" files keep loading as CHAR
+    const Type candidates[] = { INT, FLOAT, DOUBLE, CHAR, BOOL, INT16, INT64, UINT8, UINT16, UINT32,
+                                UINT64, FLOAT16 };
+    for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+        const char* name = npy_descr(candidates[i]);
+        if (!name) continue;
+        // '=' is native order; single bytes may be written with any order mark
+        if (strcmp(descr + 1, name + 1) == 0 &&
+            (descr[0] == name[0] || descr[0] == '=' || name[0] == '|')) {
+            *type = candidates[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+//====================
+// Save
+//====================
+
+/**
+ * Build the padded dict header; returns its length (0 on overflow)
+ */
+static size_t npy_header(const Array* array, const char* descr, char* out, size_t capacity,
+                         size_t* preamble) {
+    char shape[ARRAY_MAX_DIMS * 24 + 8];
+    size_t len = 0;
+    shape[len++] = '(';
+    for (size_t d = 0; d < array->num_dimensions; d++) {
+        len += (size_t)snprintf(shape + len, sizeof(shape) - len, d == 0 ? "%zu" : ", %zu",
+                                array->shape[d]);
+    }
+    if (array->num_dimensions == 1) shape[len++] = ',';
+    shape[len++] = ')';
+    shape[len] = '\0';
+
+    int n = snprintf(out, capacity, "{'descr': '%s', 'fortran_order': False, 'shape': %s, }",
+                     descr, shape);
+    if (n < 0 || (size_t)n + NPY_ALIGN >= capacity) return 0;
+
+    // Version 1.0 stores the length in 16 bits; larger headers need 2.0
+    size_t dict = (size_t)n + 1;  // with the closing newline
+    *preamble = NPY_MAGIC_LEN + 2 + 2;
+    if (*preamble + dict > 65535) *preamble = NPY_MAGIC_LEN + 2 + 4;
+
+    size_t total = (*preamble + dict + NPY_ALIGN - 1) / NPY_ALIGN * NPY_ALIGN;
+    size_t padded = total - *preamble;
+    memset(out + n, ' ', padded - (size_t)n - 1);
+    out[padded - 1] = '\n';
+    return padded;
+}
+
+/**
+ * Write an array to a .npy file
+ */
+bool array_save_npy(const Array* array, const char* path) {
+    if (!array || !path) {
+        fprintf(stderr, "Error: Array and path cannot be NULL\n");
+        return false;
+    }
+
+    const char* descr = npy_descr(array->type);
+    if (!descr) {
+        fprintf(stderr, "Error: Type has no .npy representation\n");
+        return false;
+    }
+
+    char header[NPY_MAX_HEADER];
+    size_t preamble;
+    size_t header_len = npy_header(array, descr, header, sizeof(header), &preamble);
+    if (header_len == 0) {
+        fprintf(stderr, "Error: .npy header too large\n");
+        return false;
+    }
+
+    // Non-contiguous views are materialized in row-major order first
+    Array* dense;
+    const Array* src = array_contiguous(array, &dense);
+    if (!src) return false;
+    const void* data = array_data(src);
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot open %s for writing\n", path);
+        array_free(dense);
+        return false;
+    }
+
+    unsigned char pre[NPY_MAGIC_LEN + 2 + 4];
+    memcpy(pre, NPY_MAGIC, NPY_MAGIC_LEN);
+    pre[NPY_MAGIC_LEN] = preamble == NPY_MAGIC_LEN + 4 ? 1 : 2;
+    pre[NPY_MAGIC_LEN + 1] = 0;
+    for (size_t i = 0; i < preamble - NPY_MAGIC_LEN - 2; i++) {
+        pre[NPY_MAGIC_LEN + 2 + i] = (unsigned char)(header_len >> (8 * i));  // little endian
+    }
+
+    size_t bytes = array->count * array->sizeof_type;
+    bool ok = fwrite(pre, 1, preamble, file) == preamble &&
+              fwrite(header, 1, header_len, file) == header_len &&
+              (bytes == 0 || fwrite(data, 1, bytes, file) == bytes);
+    ok = fclose(file) == 0 && ok;
+    if (!ok) fprintf(stderr, "Error: Failed to write %s\n", path);
+
+    array_free(dense);
+    return ok;
+}
+
+//====================
+// Load
+//====================
+
+typedef struct {
+    Type type;
+    bool fortran_order;
+    size_t shape[ARRAY_MAX_DIMS];
+    size_t num_dimensions;
+} NpyHeader;
+
+/**
+ * Value text following 'key': in the header dict
+ */
+static const char* npy_field(const char* dict, const char* key) {
+    char quoted[32];
+    snprintf(quoted, sizeof(quoted), "'%s'", key);
+    const char* p = strstr(dict, quoted);
+    if (!p) return NULL;
+    p = strchr(p + strlen(quoted), ':');
+    if (!p) return NULL;
+    p++;
+    while (*p == ' ') p++;
+    return p;
+}
+
+static bool npy_parse_header(const char* dict, NpyHeader* header) {
+    const char* descr = npy_field(dict, "descr");
+    const char* order = npy_field(dict, "fortran_order");
+    const char* shape = npy_field(dict, "shape");
+    if (!descr || !order || !shape || *descr != '\'' || *shape != '(') {
+        fprintf(stderr, "Error: Malformed .npy header\n");
+        return false;
+    }
+
+    char name[16];
+    const char* end = strchr(descr + 1, '\'');
+    if (!end || (size_t)(end - descr - 1) >= sizeof(name)) {
+        fprintf(stderr, "Error: Malformed .npy dtype\n");
+        return false;
+    }
+    memcpy(name, descr + 1, (size_t)(end - descr - 1));
+    name[end - descr - 1] = '\0';
+    if (!npy_type(name, &header->type)) {
+        fprintf(stderr, "Error: Unsupported .npy dtype %s\n", name);
+        return false;
+    }
+
+    header->fortran_order = strncmp(order, "True", 4) == 0;
+
+    header->num_dimensions = 0;
+    const char* p = shape + 1;
+    while (*p && *p != ')') {
+        while (*p == ' ' || *p == ',') p++;
+        if (*p == ')') break;
+        char* next;
+        unsigned long long dim = strtoull(p, &next, 10);
+        if (next == p || header->num_dimensions == ARRAY_MAX_DIMS) {
+            fprintf(stderr, "Error: Malformed .npy shape\n");
+            return false;
+        }
+        header->shape[header->num_dimensions++] = (size_t)dim;
+        p = next;
+    }
+
+    // 0-d arrays load as a single element
+    if (header->num_dimensions == 0) header->shape[header->num_dimensions++] = 1;
+    return true;
+}
+
+#ifndef _WIN32
+static void npy_unmap(ArrayBuffer* buffer) {
+    // context is the start of the mapping; data begins after the header
+    size_t header = (size_t)((char*)buffer->data - (char*)buffer->context);
+    munmap(buffer->context, header + buffer->bytes);
+}
+#endif
+
+/**
+ * Give a loaded array column-major strides
+ */
+static void npy_fortran_strides(Array* array) {
+    ptrdiff_t stride = 1;
+    for (size_t d = 0; d < array->num_dimensions; d++) {
+        array->strides[d] = stride;
+        stride *= (ptrdiff_t)array->shape[d];
+    }
+}
+
+/**
+ * Map a .npy file as an Array
+ */
+Array* array_load_npy(const char* path) {
+    if (!path) {
+        fprintf(stderr, "Error: Path cannot be NULL\n");
+        return NULL;
+    }
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot open %s\n", path);
+        return NULL;
+    }
+
+    unsigned char pre[NPY_MAGIC_LEN + 2 + 4];
+    size_t got = fread(pre, 1, NPY_MAGIC_LEN + 4, file);
+    if (got < NPY_MAGIC_LEN + 4 || memcmp(pre, NPY_MAGIC, NPY_MAGIC_LEN) != 0 ||
+        pre[NPY_MAGIC_LEN] < 1 || pre[NPY_MAGIC_LEN] > 3) {
+        fprintf(stderr, "Error: %s is not a .npy file\n", path);
+        fclose(file);
+        return NULL;
+    }
+
+    size_t header_len = (size_t)pre[NPY_MAGIC_LEN + 2] | (size_t)pre[NPY_MAGIC_LEN + 3] << 8;
+    size_t preamble = NPY_MAGIC_LEN + 4;
+    if (pre[NPY_MAGIC_LEN] >= 2) {
+        if (fread(pre + NPY_MAGIC_LEN + 4, 1, 2, file) != 2) header_len = SIZE_MAX;
+        else header_len |= (size_t)pre[NPY_MAGIC_LEN + 4] << 16 | (size_t)pre[NPY_MAGIC_LEN + 5] << 24;
+        preamble += 2;
+    }
+    if (header_len >= NPY_MAX_HEADER) {
+        fprintf(stderr, "Error: .npy header too large\n");
+        fclose(file);
+        return NULL;
+    }
+
+    char dict[NPY_MAX_HEADER];
+    NpyHeader header;
+    bool ok = fread(dict, 1, header_len, file) == header_len;
+    dict[ok ? header_len : 0] = '\0';
+    ok = ok && npy_parse_header(dict, &header);
+    fclose(file);
+    if (!ok) return NULL;
+
+    size_t size = array_sizeof_type(header.type);
+    size_t count = 1;
+    for (size_t d = 0; d < header.num_dimensions; d++) {
+        if (header.shape[d] != 0 && count > SIZE_MAX / size / header.shape[d]) {
+            fprintf(stderr, "Error: .npy shape is too large\n");
+            return NULL;
+        }
+        count *= header.shape[d];
+    }
+    size_t bytes = count * size;
+    size_t data_offset = preamble + header_len;
+
+    // Nothing to map for empty arrays
+    if (count == 0) {
+        Array* empty = array_zeros(0, header.type, false);
+        if (empty && !array_set_shape(empty, header.shape, header.num_dimensions)) {
+            array_free(empty);
+            return NULL;
+        }
+        return empty;
+    }
+
+#ifdef _WIN32
+    // No mmap here: read the data into an owned buffer
+    Array* array = array_empty(count, header.type, false);
+    file = array ? fopen(path, "rb") : NULL;
+    ok = file && fseek(file, (long)data_offset, SEEK_SET) == 0 &&
+         fread(array->parray, 1, bytes, file) == bytes;
+    if (file) fclose(file);
+    if (!ok || !array_set_shape(array, header.shape, header.num_dimensions)) {
+        fprintf(stderr, "Error: Failed to read %s\n", path);
+        array_free(array);
+        return NULL;
+    }
+#else
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < data_offset + bytes) {
+        fprintf(stderr, "Error: %s is truncated\n", path);
+        if (fd >= 0) close(fd);
+        return NULL;
+    }
+
+    // Private mapping: pages load on first touch; writes stay in this process
+    size_t map_bytes = data_offset + bytes;
+    void* mapping = mmap(NULL, map_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        fprintf(stderr, "Error: Failed to map %s\n", path);
+        return NULL;
+    }
+
+    Array* array = array_from_buffer((char*)mapping + data_offset, bytes, header.type,
+                                     header.shape, header.num_dimensions, npy_unmap, mapping);
+    if (!array) {
+        munmap(mapping, map_bytes);
+        return NULL;
+    }
+#endif
+
+    if (header.fortran_order) npy_fortran_strides(array);
+    return array;
+}
@@ -0,0 +1,307 @@
+/**
+ * array_linalg.c - Packed, cache-blocked matrix multiply
+ *
+ * The loop nest is the usual five-loop GEMM:
+ *
+ *   for jc in steps of NC         B block (KC x NC) packed once, shared by all threads
+ *     for pc in steps of KC
+ *       for ic in steps of MC     A block (MC x KC) packed per unit, private
+ *         for jr in steps of NR   B sliver stays in L1
+ *           for ir in steps of MR micro-kernel: MR x NR tile of C in registers
+ *
+ * KC is chosen so an A and a B sliver fill half of L1, MC so the A block fills
+ * half of L2 and NC so the B block fills half of L3. Units of work are (ic
+ * block, group of B slivers) pairs, so skinny products still spread across
+ * threads. Tiles that overhang the edges of C are computed into a scratch
+ * tile and merged.
+ */
+
+#include "../../include/array/array_linalg.h"
+#include "../../include/runtime/runtime_dispatch.h"
+#include "../../include/runtime/parallel.h"
+#include "../../include/utils/memory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+// Cache sizes assumed when detection did not report them
+#define GEMM_DEFAULT_L1_BYTES ((size_t)32 * 1024)
+#define GEMM_DEFAULT_L2_BYTES ((size_t)256 * 1024)
+#define GEMM_DEFAULT_L3_BYTES ((size_t)8 * 1024 * 1024)
+
+typedef struct {
+    const char* a;           // element (0, 0) of A
+    ptrdiff_t a_row;         // strides of A in elements
+    ptrdiff_t a_col;
+    const char* b;
+    ptrdiff_t b_row;
+    ptrdiff_t b_col;
+    char* c;                 // dense (m, n) output
+    size_t m, n, k;
+    size_t size;
+    Type type;
+    const GemmKernel* kernel;
+    size_t mc, kc, nc;       // block sizes
+    size_t jc, nc_cur;       // current B block
+    size_t pc, kc_cur;
+    char* b_packed;
+    size_t col_groups;       // units per A block
+    atomic_bool failed;
+} GemmTask;
+
+static inline void copy_element(char* dst, const char* src, size_t size) {
+    if (size == sizeof(float)) memcpy(dst, src, sizeof(float));
+    else memcpy(dst, src, sizeof(double));
+}
+
+/**
+ * Pick MC, KC and NC from the cache sizes
+ */
+static void gemm_blocking(GemmTask* task) {
+    const CacheInfo* cache = &get_runtime_hardware_profile()->cache_info;
+    size_t l1 = cache->l1_data_cache_size_kb > 0 ? (size_t)cache->l1_data_cache_size_kb * 1024 : GEMM_DEFAULT_L1_BYTES;
+    size_t l2 = cache->l2_cache_size_kb > 0 ? (size_t)cache->l2_cache_size_kb * 1024 : GEMM_DEFAULT_L2_BYTES;
+    size_t l3 = cache->l3_cache_size_kb > 0 ? (size_t)cache->l3_cache_size_kb * 1024 : GEMM_DEFAULT_L3_BYTES;
+    size_t mr = task->kernel->mr, nr = task->kernel->nr, size = task->size;
+
+    size_t kc = (l1 / 2) / ((mr + nr) * size);
+    task->kc = kc < 1 ? 1 : kc > task->k ? task->k : kc;
+
+    size_t mc = (l2 / 2) / (task->kc * size) / mr * mr;
+    size_t m_max = (task->m + mr - 1) / mr * mr;
+    task->mc = mc < mr ? mr : mc > m_max ? m_max : mc;
+
+    size_t nc = (l3 / 2) / (task->kc * size) / nr * nr;
+    size_t n_max = (task->n + nr - 1) / nr * nr;
+    task->nc = nc < nr ? nr : nc > n_max ? n_max : nc;
+}
+
+/**
+ * Pack rows [ic, ic + rows) of the current K block of A into MR-row slivers
+ */
+static void pack_a(const GemmTask* task, char* dst, size_t ic, size_t rows) {
+    size_t mr = task->kernel->mr, size = task->size;
+    for (size_t s = 0; s < rows; s += mr) {
+        for (size_t p = 0; p < task->kc_cur; p++) {
+            const char* src = task->a + ((ptrdiff_t)(ic + s) * task->a_row +
+                                         (ptrdiff_t)(task->pc + p) * task->a_col) * (ptrdiff_t)size;
+            for (size_t i = 0; i < mr; i++, dst += size) {
+                if (s + i < rows) copy_element(dst, src + (ptrdiff_t)i * task->a_row * (ptrdiff_t)size, size);
+                else memset(dst, 0, size);
+            }
+        }
+    }
+}
+
+/**
+ * Pack NR-column slivers [begin, end) of the current B block
+ */
+static void pack_b(size_t begin, size_t end, void* ctx) {
+    GemmTask* task = (GemmTask*)ctx;
+    size_t nr = task->kernel->nr, size = task->size;
+    for (size_t j = begin; j < end; j++) {
+        char* dst = task->b_packed + j * task->kc_cur * nr * size;
+        size_t col = task->jc + j * nr;
+        for (size_t p = 0; p < task->kc_cur; p++) {
+            const char* src = task->b + ((ptrdiff_t)(task->pc + p) * task->b_row +
+                                         (ptrdiff_t)col * task->b_col) * (ptrdiff_t)size;
+            for (size_t jj = 0; jj < nr; jj++, dst += size) {
+                if (col + jj < task->n) copy_element(dst, src + (ptrdiff_t)jj * task->b_col * (ptrdiff_t)size, size);
+                else memset(dst, 0, size);
+            }
+        }
+    }
+}
+
+/**
+ * Store the part of a scratch tile that lies inside C
+ */
+static void merge_tile(const GemmTask* task, char* c, const char* tile, size_t rows, size_t cols,
+                       bool accumulate) {
+    size_t nr = task->kernel->nr;
+    for (size_t i = 0; i < rows; i++) {
+        if (task->type == FLOAT) {
+            float* dst = (float*)c + i * task->n;
+            const float* src = (const float*)tile + i * nr;
+            for (size_t j = 0; j < cols; j++) dst[j] = accumulate ? dst[j] + src[j] : src[j];
+        } else {
+            double* dst = (double*)c + i * task->n;
+            const double* src = (const double*)tile + i * nr;
+            for (size_t j = 0; j < cols; j++) dst[j] = accumulate ? dst[j] + src[j] : src[j];
+        }
+    }
+}
+
+/**
+ * Units [begin, end): pack an A block, then sweep it against a group of B slivers
+ */
+static void gemm_blocks(size_t begin, size_t end, void* ctx) {
+    GemmTask* task = (GemmTask*)ctx;
+    const GemmKernel* kernel = task->kernel;
+    size_t mr = kernel->mr, nr = kernel->nr, size = task->size;
+    size_t a_bytes = task->mc * task->kc * size;
+    size_t bytes = a_bytes + mr * nr * size;
+    char* a_packed = (char*)memory_buffer_alloc(bytes, false);
+    if (!a_packed) {
+        atomic_store(&task->failed, true);
+        return;
+    }
+    char* tile = a_packed + a_bytes;
+
+    size_t slivers = (task->nc_cur + nr - 1) / nr;
+    bool accumulate = task->pc > 0;
+    for (size_t u = begin; u < end; u++) {
+        size_t ic = (u / task->col_groups) * task->mc;
+        size_t g = u % task->col_groups;
+        size_t mc_cur = task->m - ic < task->mc ? task->m - ic : task->mc;
+        pack_a(task, a_packed, ic, mc_cur);
+
+        for (size_t j = slivers * g / task->col_groups; j < slivers * (g + 1) / task->col_groups; j++) {
+            size_t col = task->jc + j * nr;
+            size_t cols = task->n - col < nr ? task->n - col : nr;
+            const char* b_sliver = task->b_packed + j * task->kc_cur * nr * size;
+            for (size_t i = 0; i < mc_cur; i += mr) {
+                size_t rows = mc_cur - i < mr ? mc_cur - i : mr;
+                const char* a_sliver = a_packed + i * task->kc_cur * size;
+                char* c = task->c + ((ic + i) * task->n + col) * size;
+                if (rows == mr && cols == nr) {
+                    kernel->fn(task->kc_cur, a_sliver, b_sliver, c, (ptrdiff_t)task->n, accumulate);
+                } else {
+                    kernel->fn(task->kc_cur, a_sliver, b_sliver, tile, (ptrdiff_t)nr, false);
+                    merge_tile(task, c, tile, rows, cols, accumulate);
+                }
+            }
+        }
+    }
+    memory_buffer_free(a_packed, bytes);
+}
+
+/**
+ * Matrix product written into an existing array
+ */
+bool array_matmul_into(const Array* a, const Array* b, Array* out) {
+    if (!a || !b || !out) {
+        fprintf(stderr, "Error: Operands cannot be NULL\n");
+        return false;
+    }
+    if (a->type != b->type || out->type != a->type) {
+        fprintf(stderr, "Error: Operand types must match\n");
+        return false;
+    }
+    if (a->type != FLOAT && a->type != DOUBLE) {
+        fprintf(stderr, "Error: Matrix multiply supports FLOAT and DOUBLE arrays\n");
+        return false;
+    }
+    if (a->num_dimensions != 2 || b->num_dimensions != 2 || out->num_dimensions != 2) {
+        fprintf(stderr, "Error: Matrix multiply needs 2-D arrays\n");
+        return false;
+    }
+    if (a->shape[1] != b->shape[0] || out->shape[0] != a->shape[0] || out->shape[1] != b->shape[1]) {
+        fprintf(stderr, "Error: Matrix shapes do not align\n");
+        return false;
+    }
+    if (!array_is_contiguous(out)) {
+        fprintf(stderr, "Error: Output of a matrix multiply must be contiguous\n");
+        return false;
+    }
+    if (!array_make_writable(out)) return false;
+
+    // The blocked passes re-read a and b after writing parts of out, so an
+    // output sharing their buffer gets the product through a temporary
+    const void* out_buffer = array_root(out)->parray;
+    if (out_buffer == array_root(a)->parray || out_buffer == array_root(b)->parray) {
+        Array* product = array_matmul(a, b);
+        if (!product) return false;
+        memcpy(array_data(out), product->parray, product->count * product->sizeof_type);
+        array_free(product);
+        return true;
+    }
+
+    GemmTask task = { 0 };
+    task.a = (const char*)array_data(a);
+    task.a_row = a->strides[0];
+    task.a_col = a->strides[1];
+    task.b = (const char*)array_data(b);
+    task.b_row = b->strides[0];
+    task.b_col = b->strides[1];
+    task.c = (char*)array_data(out);
+    task.m = a->shape[0];
+    task.k = a->shape[1];
+    task.n = b->shape[1];
+    task.size = a->sizeof_type;
+    task.type = a->type;
+    task.kernel = get_kernel(KERNEL_GEMM, a->type).gemm;
+    atomic_init(&task.failed, false);
+
+    if (task.m == 0 || task.n == 0) return true;
+    if (task.k == 0) {
+        memset(task.c, 0, task.m * task.n * task.size);
+        return true;
+    }
+    if (!task.kernel) {
+        fprintf(stderr, "Error: No matrix multiply kernel for this type\n");
+        return false;
+    }
+
+    gemm_blocking(&task);
+    size_t nr = task.kernel->nr;
+    size_t b_bytes = task.nc * task.kc * task.size;
+    task.b_packed = (char*)memory_buffer_alloc(b_bytes, false);
+    if (!task.b_packed) {
+        fprintf(stderr, "Error: Failed to allocate memory for matrix multiply\n");
+        return false;
+    }
+
+    size_t threads = parallel_thread_count();
+    size_t a_blocks = (task.m + task.mc - 1) / task.mc;
+    for (task.jc = 0; task.jc < task.n; task.jc += task.nc) {
+        task.nc_cur = task.n - task.jc < task.nc ? task.n - task.jc : task.nc;
+        size_t slivers = (task.nc_cur + nr - 1) / nr;
+
+        // Split B slivers into groups when there are too few A blocks to go round
+        size_t groups = a_blocks >= 2 * threads ? 1 : (2 * threads + a_blocks - 1) / a_blocks;
+        task.col_groups = groups < slivers ? groups : slivers;
+        size_t group_cols = task.nc_cur / task.col_groups;
+
+        for (task.pc = 0; task.pc < task.k; task.pc += task.kc) {
+            task.kc_cur = task.k - task.pc < task.kc ? task.k - task.pc : task.kc;
+            parallel_for(slivers, parallel_grain(2 * task.kc_cur * nr * task.size), pack_b, &task);
+
+            size_t unit_bytes = (task.mc * task.kc_cur + task.kc_cur * group_cols + task.mc * group_cols) * task.size;
+            parallel_for(a_blocks * task.col_groups, parallel_grain(unit_bytes), gemm_blocks, &task);
+            if (atomic_load(&task.failed)) break;
+        }
+        if (atomic_load(&task.failed)) break;
+    }
+
+    memory_buffer_free(task.b_packed, b_bytes);
+    if (atomic_load(&task.failed)) {
+        fprintf(stderr, "Error: Failed to allocate memory for matrix multiply\n");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Matrix product of two 2-D arrays
+ */
+Array* array_matmul(const Array* a, const Array* b) {
+    if (!a || !b) {
+        fprintf(stderr, "Error: Operands cannot be NULL\n");
+        return NULL;
+    }
+    if (a->num_dimensions != 2 || b->num_dimensions != 2) {
+        fprintf(stderr, "Error: Matrix multiply needs 2-D arrays\n");
+        return NULL;
+    }
+
+    size_t shape[2] = { a->shape[0], b->shape[1] };
+    Array* out = array_empty(shape[0] * shape[1], a->type, false);
+    if (!out) return NULL;
+    if (!array_set_shape(out, shape, 2) || !array_matmul_into(a, b, out)) {
+        array_free(out);
+        return NULL;
+    }
+    return out;
+}
@@ -0,0 +1,529 @@
+/**
+ * array_mask.c - Mask counting, masked selection and packed bit masks
+ *
+ * Selection makes two passes over fixed-size blocks: count the true bytes of
+ * every block's mask, turn the counts into output offsets, then compact each
+ * block straight to its offset. Blocks are independent in both passes, so
+ * they run on the thread pool, and the output is allocated once in between.
+ * Packed masks list their set positions the same way, with popcounts of
+ * blocks of words as the counts.
+ */
+
+#include "../../include/array/array_mask.h"
+#include "../../include/array/array_string.h"
+#include "../../include/array/array_view.h"
+#include "../../include/runtime/runtime_dispatch.h"
+#include "../../include/runtime/parallel.h"
+#include "../../include/utils/memory.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdatomic.h>
+
+// Elements per independently counted and compacted block
+#define SELECT_BLOCK ((size_t)1 << 16)
+
+// Words of a packed mask per block (SELECT_BLOCK elements)
+#define BITMASK_BLOCK_WORDS (SELECT_BLOCK / 64)
+
+typedef struct {
+    const char* src;
+    const bool* mask;
+    char* dst;
+    size_t count;            // elements
+    size_t size;             // element size
+    size_t* offsets;         // per block: true count, then output offset
+    Kernel sum;              // KERNEL_SUM on BOOL counts true bytes
+    Kernel compress;
+} SelectTask;
+
+static void count_blocks(size_t begin, size_t end, void* ctx) {
+    SelectTask* task = (SelectTask*)ctx;
+    for (size_t b = begin; b < end; b++) {
+        size_t start = b * SELECT_BLOCK;
+        size_t n = task->count - start < SELECT_BLOCK ? task->count - start : SELECT_BLOCK;
+        double selected;
+        task->sum.reduce(task->mask + start, n, &selected);
+        task->offsets[b] = (size_t)selected;
+    }
+}
+
+static void compress_blocks(size_t begin, size_t end, void* ctx) {
+    SelectTask* task = (SelectTask*)ctx;
+    for (size_t b = begin; b < end; b++) {
+        size_t start = b * SELECT_BLOCK;
+        size_t n = task->count - start < SELECT_BLOCK ? task->count - start : SELECT_BLOCK;
+        task->compress.compress(task->src + start * task->size, task->mask + start,
+                                task->dst + task->offsets[b] * task->size, n);
+    }
+}
+
+/**
+ * Count true elements block by block; fills task->offsets with the counts
+ */
+static size_t count_true(SelectTask* task) {
+    size_t blocks = (task->count + SELECT_BLOCK - 1) / SELECT_BLOCK;
+    parallel_for(blocks, parallel_grain(SELECT_BLOCK), count_blocks, task);
+    size_t total = 0;
+    for (size_t b = 0; b < blocks; b++) total += task->offsets[b];
+    return total;
+}
+
+/**
+ * Number of true elements in a mask
+ */
+size_t array_count_true(const Array* mask) {
+    if (!mask || mask->type != BOOL) {
+        fprintf(stderr, "Error: Mask must be a BOOL array\n");
+        return 0;
+    }
+    if (mask->count == 0) return 0;
+
+    Array* owned;
+    const Array* m = array_contiguous(mask, &owned);
+    if (!m) return 0;
+
+    SelectTask task = { 0 };
+    task.mask = (const bool*)array_data(m);
+    task.count = m->count;
+    task.sum = get_kernel(KERNEL_SUM, BOOL);
+    task.offsets = (size_t*)malloc(((task.count + SELECT_BLOCK - 1) / SELECT_BLOCK) * sizeof(size_t));
+    if (!task.offsets) {
+        fprintf(stderr, "Error: Failed to allocate memory for mask counts\n");
+        array_free(owned);
+        return 0;
+    }
+
+    size_t total = count_true(&task);
+    free(task.offsets);
+    array_free(owned);
+    return total;
+}
+
+/**
+ * STRING selection: gather the selected strings and pack them into a new blob
+ */
+static Array* select_strings(const Array* array, const bool* mask, size_t total) {
+    const char** strings = (const char**)malloc((total > 0 ? total : 1) * sizeof(char*));
+    if (!strings) {
+        fprintf(stderr, "Error: Failed to allocate memory for selection\n");
+        return NULL;
+    }
+    size_t k = 0;
+    for (size_t i = 0; i < array->count; i++) {
+        if (mask[i]) strings[k++] = array_string_get(array, i);
+    }
+    Array* out = array_from_strings(strings, total, false);
+    free(strings);
+    return out;
+}
+
+/**
+ * Elements of an array where a mask is true
+ */
+Array* array_select(const Array* array, const Array* mask) {
+    if (!array || !mask) {
+        fprintf(stderr, "Error: Array and mask cannot be NULL\n");
+        return NULL;
+    }
+    if (mask->type != BOOL) {
+        fprintf(stderr, "Error: Mask must be a BOOL array\n");
+        return NULL;
+    }
+    if (array->type == ARRAY) {
+        fprintf(stderr, "Error: Arrays of arrays cannot be selected from\n");
+        return NULL;
+    }
+    if (array->num_dimensions != mask->num_dimensions ||
+        memcmp(array->shape, mask->shape, array->num_dimensions * sizeof(size_t)) != 0) {
+        fprintf(stderr, "Error: Mask shape must match the array shape\n");
+        return NULL;
+    }
+
+    Array* owned_mask;
+    const Array* m = array_contiguous(mask, &owned_mask);
+    if (!m) return NULL;
+
+    SelectTask task = { 0 };
+    task.mask = (const bool*)array_data(m);
+    task.count = array->count;
+    task.size = array->sizeof_type;
+    task.sum = get_kernel(KERNEL_SUM, BOOL);
+    task.compress = get_kernel(KERNEL_COMPRESS, array->type);
+
+    size_t blocks = (task.count + SELECT_BLOCK - 1) / SELECT_BLOCK;
+    task.offsets = (size_t*)malloc((blocks > 0 ? blocks : 1) * sizeof(size_t));
+    if (!task.offsets) {
+        fprintf(stderr, "Error: Failed to allocate memory for selection\n");
+        array_free(owned_mask);
+        return NULL;
+    }
+
+    // Counting first sizes the output exactly
+    size_t total = count_true(&task);
+
+    Array* out = NULL;
+    if (array->type == STRING) {
+        out = select_strings(array, task.mask, total);
+    } else if (!task.compress.compress) {
+        fprintf(stderr, "Error: Selection not supported for this type\n");
+    } else {
+        Array* owned_array;
+        const Array* a = array_contiguous(array, &owned_array);
+        out = a ? array_empty(total, array->type, false) : NULL;
+        if (out && total > 0) {
+            // Block counts become output offsets
+            size_t offset = 0;
+            for (size_t b = 0; b < blocks; b++) {
+                size_t selected = task.offsets[b];
+                task.offsets[b] = offset;
+                offset += selected;
+            }
+            task.src = (const char*)array_data(a);
+            task.dst = (char*)out->parray;
+            parallel_for(blocks, parallel_grain(SELECT_BLOCK * (1 + 2 * task.size)), compress_blocks, &task);
+        }
+        array_free(owned_array);
+    }
+
+    free(task.offsets);
+    array_free(owned_mask);
+    return out;
+}
+
+//====================
+// Packed masks
+//====================
+
+typedef struct {
+    const uint64_t* a;
+    const uint64_t* b;
+    uint64_t* words;
+    bool* bytes;             // unpacked side of PACK_BITS / UNPACK_BITS
+    int* positions;          // output of BIT_INDICES
+    size_t count;            // elements
+    size_t num_words;
+    size_t* offsets;         // per block: set count, then output offset
+    BitwiseOp op;
+    Kernel kernel;
+    atomic_size_t total;
+} BitMaskTask;
+
+/**
+ * Elements [first, first + n) covered by words [begin, end)
+ */
+static void word_elements(const BitMaskTask* task, size_t begin, size_t end, size_t* first, size_t* n) {
+    *first = begin * 64;
+    *n = (end * 64 < task->count ? end * 64 : task->count) - *first;
+}
+
+static void bitwise_words(size_t begin, size_t end, void* ctx) {
+    BitMaskTask* task = (BitMaskTask*)ctx;
+    task->kernel.bitwise(task->a + begin, task->b ? task->b + begin : NULL, task->words + begin,
+                         end - begin, task->op);
+}
+
+static void popcount_words(size_t begin, size_t end, void* ctx) {
+    BitMaskTask* task = (BitMaskTask*)ctx;
+    atomic_fetch_add(&task->total, task->kernel.popcount(task->a + begin, end - begin));
+}
+
+static void pack_words(size_t begin, size_t end, void* ctx) {
+    BitMaskTask* task = (BitMaskTask*)ctx;
+    size_t first, n;
+    word_elements(task, begin, end, &first, &n);
+    task->kernel.pack_bits(task->bytes + first, task->words + begin, n);
+}
+
+static void unpack_words(size_t begin, size_t end, void* ctx) {
+    BitMaskTask* task = (BitMaskTask*)ctx;
+    size_t first, n;
+    word_elements(task, begin, end, &first, &n);
+    task->kernel.unpack_bits(task->a + begin, task->bytes + first, n);
+}
+
+static void count_bit_blocks(size_t begin, size_t end, void* ctx) {
+    BitMaskTask* task = (BitMaskTask*)ctx;
+    for (size_t b = begin; b < end; b++) {
+        size_t w = b * BITMASK_BLOCK_WORDS;
+        size_t n = task->num_words - w < BITMASK_BLOCK_WORDS ? task->num_words - w : BITMASK_BLOCK_WORDS;
+        task->offsets[b] = task->kernel.popcount(task->a + w, n);
+    }
+}
+
+static void index_bit_blocks(size_t begin, size_t end, void* ctx) {
+    BitMaskTask* task = (BitMaskTask*)ctx;
+    for (size_t b = begin; b < end; b++) {
+        size_t w = b * BITMASK_BLOCK_WORDS;
+        size_t n = task->num_words - w < BITMASK_BLOCK_WORDS ? task->num_words - w : BITMASK_BLOCK_WORDS;
+        task->kernel.bit_indices(task->a + w, n, (int)(w * 64), task->positions + task->offsets[b]);
+    }
+}
+
+/**
+ * Clear the bits past count in the last word
+ */
+static void clear_tail(BitMask* mask) {
+    if (mask->count % 64) mask->words[mask->num_words - 1] &= ((uint64_t)1 << (mask->count % 64)) - 1;
+}
+
+static size_t words_bytes(size_t num_words) {
+    return (num_words > 0 ? num_words : 1) * sizeof(uint64_t);
+}
+
+/**
+ * Create a packed mask with every element set to value
+ */
+BitMask* array_bitmask_new(size_t count, bool value) {
+    BitMask* mask = (BitMask*)malloc(sizeof(BitMask));
+    if (!mask) {
+        fprintf(stderr, "Error: Failed to allocate memory for bit mask\n");
+        return NULL;
+    }
+    mask->count = count;
+    mask->num_words = (count + 63) / 64;
+    mask->words = (uint64_t*)memory_buffer_alloc(words_bytes(mask->num_words), !value);
+    if (!mask->words) {
+        fprintf(stderr, "Error: Failed to allocate memory for bit mask\n");
+        free(mask);
+        return NULL;
+    }
+    if (value && mask->num_words > 0) {
+        memset(mask->words, 0xFF, mask->num_words * sizeof(uint64_t));
+        clear_tail(mask);
+    }
+    return mask;
+}
+
+/**
+ * Free a packed mask
+ */
+void array_bitmask_free(BitMask* mask) {
+    if (!mask) return;
+    memory_buffer_free(mask->words, words_bytes(mask->num_words));
+    free(mask);
+}
+
+bool array_bitmask_get(const BitMask* mask, size_t i) {
+    return (mask->words[i / 64] >> (i % 64)) & 1;
+}
+
+void array_bitmask_set(BitMask* mask, size_t i, bool value) {
+    uint64_t bit = (uint64_t)1 << (i % 64);
+    if (value) mask->words[i / 64] |= bit;
+    else mask->words[i / 64] &= ~bit;
+}
+
+/**
+ * Pack a BOOL array
+ */
+BitMask* array_bitmask_pack(const Array* mask) {
+    if (!mask || mask->type != BOOL) {
+        fprintf(stderr, "Error: Mask must be a BOOL array\n");
+        return NULL;
+    }
+    Array* owned;
+    const Array* m = array_contiguous(mask, &owned);
+    if (!m) return NULL;
+
+    BitMask* out = array_bitmask_new(m->count, false);
+    if (out && out->num_words > 0) {
+        BitMaskTask task = { 0 };
+        task.bytes = (bool*)array_data(m);
+        task.words = out->words;
+        task.count = out->count;
+        task.kernel = get_kernel(KERNEL_PACK_BITS, BOOL);
+        parallel_for(out->num_words, parallel_grain(64 + sizeof(uint64_t)), pack_words, &task);
+    }
+    array_free(owned);
+    return out;
+}
+
+/**
+ * Unpack a mask into a BOOL array
+ */
+Array* array_bitmask_unpack(const BitMask* mask) {
+    if (!mask) {
+        fprintf(stderr, "Error: Mask cannot be NULL\n");
+        return NULL;
+    }
+    Array* out = array_empty(mask->count, BOOL, false);
+    if (!out || mask->count == 0) return out;
+
+    BitMaskTask task = { 0 };
+    task.a = mask->words;
+    task.bytes = (bool*)out->parray;
+    task.count = mask->count;
+    task.kernel = get_kernel(KERNEL_UNPACK_BITS, BOOL);
+    parallel_for(mask->num_words, parallel_grain(64 + sizeof(uint64_t)), unpack_words, &task);
+    return out;
+}
+
+/**
+ * Combine two masks word by word
+ */
+bool array_bitmask_op(BitwiseOp op, const BitMask* a, const BitMask* b, BitMask* out) {
+    if (!a || !out || (op != BIT_NOT && !b)) {
+        fprintf(stderr, "Error: Masks cannot be NULL\n");
+        return false;
+    }
+    if ((op != BIT_NOT && b->count != a->count) || out->count != a->count) {
+        fprintf(stderr, "Error: Masks must have the same number of elements\n");
+        return false;
+    }
+    if (a->num_words == 0) return true;
+
+    BitMaskTask task = { 0 };
+    task.a = a->words;
+    task.b = op != BIT_NOT ? b->words : NULL;
+    task.words = out->words;
+    task.op = op;
+    task.kernel = get_kernel(KERNEL_BITWISE, BOOL);
+    parallel_for(a->num_words, parallel_grain(3 * sizeof(uint64_t)), bitwise_words, &task);
+    // Only NOT can set bits past count
+    if (op == BIT_NOT) clear_tail(out);
+    return true;
+}
+
+/**
+ * Apply op into a new mask
+ */
+static BitMask* bitmask_apply(BitwiseOp op, const BitMask* a, const BitMask* b) {
+    if (!a) {
+        fprintf(stderr, "Error: Masks cannot be NULL\n");
+        return NULL;
+    }
+    BitMask* out = array_bitmask_new(a->count, false);
+    if (out && !array_bitmask_op(op, a, b, out)) {
+        array_bitmask_free(out);
+        return NULL;
+    }
+    return out;
+}
+
+BitMask* array_bitmask_and(const BitMask* a, const BitMask* b) { return bitmask_apply(BIT_AND, a, b); }
+BitMask* array_bitmask_or(const BitMask* a, const BitMask* b) { return bitmask_apply(BIT_OR, a, b); }
+BitMask* array_bitmask_xor(const BitMask* a, const BitMask* b) { return bitmask_apply(BIT_XOR, a, b); }
+BitMask* array_bitmask_andnot(const BitMask* a, const BitMask* b) { return bitmask_apply(BIT_ANDNOT, a, b); }
+BitMask* array_bitmask_not(const BitMask* a) { return bitmask_apply(BIT_NOT, a, NULL); }
+
+/**
+ * Number of set elements
+ */
+size_t array_bitmask_count(const BitMask* mask) {
+    if (!mask) {
+        fprintf(stderr, "Error: Mask cannot be NULL\n");
+        return 0;
+    }
+    BitMaskTask task = { 0 };
+    task.a = mask->words;
+    task.kernel = get_kernel(KERNEL_POPCOUNT, BOOL);
+    atomic_init(&task.total, 0);
+    parallel_for(mask->num_words, parallel_grain(sizeof(uint64_t)), popcount_words, &task);
+    return atomic_load(&task.total);
+}
+
+/**
+ * Whether any element is set (stops at the first set word)
+ */
+bool array_bitmask_any(const BitMask* mask) {
+    if (!mask) {
+        fprintf(stderr, "Error: Mask cannot be NULL\n");
+        return false;
+    }
+    for (size_t i = 0; i < mask->num_words; i++) {
+        if (mask->words[i]) return true;
+    }
+    return false;
+}
+
+/**
+ * Whether every element is set (stops at the first block with a clear bit)
+ */
+bool array_bitmask_all(const BitMask* mask) {
+    if (!mask) {
+        fprintf(stderr, "Error: Mask cannot be NULL\n");
+        return false;
+    }
+    PopcountKernelFn popcount = get_kernel(KERNEL_POPCOUNT, BOOL).popcount;
+    for (size_t w = 0; w < mask->num_words; w += BITMASK_BLOCK_WORDS) {
+        size_t n = mask->num_words - w < BITMASK_BLOCK_WORDS ? mask->num_words - w : BITMASK_BLOCK_WORDS;
+        size_t bits = (w + n) * 64 < mask->count ? n * 64 : mask->count - w * 64;
+        if (popcount(mask->words + w, n) != bits) return false;
+    }
+    return true;
+}
+
+/**
+ * Positions of the set elements
+ */
+Array* array_bitmask_to_indices(const BitMask* mask) {
+    if (!mask) {
+        fprintf(stderr, "Error: Mask cannot be NULL\n");
+        return NULL;
+    }
+    if (mask->count > (size_t)INT_MAX) {
+        fprintf(stderr, "Error: Mask is too long for INT indices\n");
+        return NULL;
+    }
+
+    BitMaskTask task = { 0 };
+    task.a = mask->words;
+    task.num_words = mask->num_words;
+    size_t blocks = (mask->num_words + BITMASK_BLOCK_WORDS - 1) / BITMASK_BLOCK_WORDS;
+    task.offsets = (size_t*)malloc((blocks > 0 ? blocks : 1) * sizeof(size_t));
+    if (!task.offsets) {
+        fprintf(stderr, "Error: Failed to allocate memory for mask indices\n");
+        return NULL;
+    }
+
+    // Counting first sizes the output exactly
+    task.kernel = get_kernel(KERNEL_POPCOUNT, BOOL);
+    parallel_for(blocks, parallel_grain(SELECT_BLOCK / 8), count_bit_blocks, &task);
+    size_t total = 0;
+    for (size_t b = 0; b < blocks; b++) {
+        size_t selected = task.offsets[b];
+        task.offsets[b] = total;
+        total += selected;
+    }
+
+    Array* out = array_empty(total, INT, false);
+    if (out && total > 0) {
+        task.positions = (int*)out->parray;
+        task.kernel = get_kernel(KERNEL_BIT_INDICES, BOOL);
+        parallel_for(blocks, parallel_grain(SELECT_BLOCK / 8 + SELECT_BLOCK * sizeof(int)), index_bit_blocks,
+                     &task);
+    }
+    free(task.offsets);
+    return out;
+}
+
+/**
+ * Mask with the elements at the given positions set
+ */
+BitMask* array_bitmask_from_indices(const Array* indices, size_t count) {
+    if (!indices || indices->type != INT) {
+        fprintf(stderr, "Error: Indices must be an INT array\n");
+        return NULL;
+    }
+    Array* owned;
+    const Array* idx = array_contiguous(indices, &owned);
+    if (!idx) return NULL;
+
+    BitMask* out = array_bitmask_new(count, false);
+    const int* values = (const int*)array_data(idx);
+    for (size_t i = 0; out && i < idx->count; i++) {
+        long long k = values[i];
+        if (k < 0) k += (long long)count;
+        if (k < 0 || (size_t)k >= count) {
+            fprintf(stderr, "Error: Index %d is out of bounds for size %zu\n", values[i], count);
+            array_bitmask_free(out);
+            out = NULL;
+            break;
+        }
+        out->words[k / 64] |= (uint64_t)1 << (k % 64);
+    }
+    array_free(owned);
+    return out;
+}
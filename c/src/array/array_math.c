@@ -0,0 +1,424 @@
+/**
+ * array_math.c - Broadcasting elementwise engine for Arrays
+ *
+ * Operands are broadcast to a common shape by giving broadcast dimensions a
+ * stride of 0. Dimensions that are laid out back to back in every operand are
+ * then collapsed, so most operations turn into a few long inner rows that go
+ * straight to the dispatched SIMD kernel. Rows that are strided or broadcast
+ * along the inner axis are staged through small L1-resident chunk buffers.
+ * Large operations are split into row chunks across the thread pool.
+ */
+
+#include "../../include/array/array_math.h"
+#include "../../include/array/array_view.h"
+#include "../../include/runtime/parallel.h"
+#include <stdio.h>
+#include <string.h>
+
+// Bytes per staging buffer; three of them stay well inside L1
+#define BROADCAST_CHUNK_BYTES 8192
+
+#define BROADCAST_OPERANDS 3  // a, b, out
+
+typedef void (*BroadcastRowFn)(const void* a, const void* b, void* out, size_t n, void* ctx);
+
+/**
+ * Broadcast iteration plan: collapsed shape and per-operand strides (elements)
+ */
+typedef struct {
+    size_t num_dimensions;
+    size_t shape[ARRAY_MAX_DIMS];
+    ptrdiff_t strides[BROADCAST_OPERANDS][ARRAY_MAX_DIMS];
+    char* data[BROADCAST_OPERANDS];
+    size_t size[BROADCAST_OPERANDS];
+} BroadcastPlan;
+
+/**
+ * Shape two arrays broadcast to
+ */
+bool array_broadcast_shape(const Array* a, const Array* b, size_t* shape, size_t* num_dimensions) {
+    size_t ndim = a->num_dimensions > b->num_dimensions ? a->num_dimensions : b->num_dimensions;
+    if (ndim > ARRAY_MAX_DIMS) return false;
+
+    // Align from the right; missing leading dimensions count as 1
+    for (size_t d = 0; d < ndim; d++) {
+        size_t da = d < ndim - a->num_dimensions ? 1 : a->shape[d - (ndim - a->num_dimensions)];
+        size_t db = d < ndim - b->num_dimensions ? 1 : b->shape[d - (ndim - b->num_dimensions)];
+        if (da != db && da != 1 && db != 1) return false;
+        shape[d] = da == 1 ? db : da;
+    }
+    *num_dimensions = ndim;
+    return true;
+}
+
+/**
+ * Strides of an operand viewed with the broadcast shape (0 along broadcast axes)
+ */
+static void broadcast_strides(const Array* array, size_t ndim, ptrdiff_t* strides) {
+    size_t lead = ndim - array->num_dimensions;
+    for (size_t d = 0; d < ndim; d++) {
+        if (d < lead || array->shape[d - lead] == 1) {
+            strides[d] = 0;
+        } else {
+            strides[d] = array->strides[d - lead];
+        }
+    }
+}
+
+/**
+ * Build the plan: broadcast, drop length-1 axes, merge axes that are
+ * contiguous with their inner neighbour in every operand
+ */
+static bool broadcast_plan(const Array* a, const Array* b, const Array* out, BroadcastPlan* plan) {
+    size_t shape[ARRAY_MAX_DIMS];
+    size_t ndim;
+    if (!array_broadcast_shape(a, b, shape, &ndim)) {
+        fprintf(stderr, "Error: Operands could not be broadcast together\n");
+        return false;
+    }
+    if (out->num_dimensions != ndim || memcmp(out->shape, shape, ndim * sizeof(size_t)) != 0) {
+        fprintf(stderr, "Error: Output shape does not match the broadcast shape\n");
+        return false;
+    }
+
+    const Array* operands[BROADCAST_OPERANDS] = { a, b, out };
+    ptrdiff_t strides[BROADCAST_OPERANDS][ARRAY_MAX_DIMS];
+    for (int k = 0; k < BROADCAST_OPERANDS; k++) {
+        broadcast_strides(operands[k], ndim, strides[k]);
+        plan->data[k] = (char*)array_data(operands[k]);
+        plan->size[k] = operands[k]->sizeof_type;
+    }
+
+    // Walk outward from the innermost axis, merging where the layout allows
+    size_t n = 0;
+    for (size_t d = ndim; d-- > 0;) {
+        if (shape[d] == 1) continue;
+
+        bool merge = n > 0;
+        for (int k = 0; k < BROADCAST_OPERANDS && merge; k++) {
+            size_t inner = ARRAY_MAX_DIMS - n;
+            merge = strides[k][d] == plan->strides[k][inner] * (ptrdiff_t)plan->shape[inner];
+        }
+
+        if (merge) {
+            plan->shape[ARRAY_MAX_DIMS - n] *= shape[d];
+        } else {
+            n++;
+            plan->shape[ARRAY_MAX_DIMS - n] = shape[d];
+            for (int k = 0; k < BROADCAST_OPERANDS; k++) {
+                plan->strides[k][ARRAY_MAX_DIMS - n] = strides[k][d];
+            }
+        }
+    }
+
+    // Everything was length 1: a single element
+    if (n == 0) {
+        n = 1;
+        plan->shape[ARRAY_MAX_DIMS - 1] = 1;
+        for (int k = 0; k < BROADCAST_OPERANDS; k++) {
+            plan->strides[k][ARRAY_MAX_DIMS - 1] = 1;
+        }
+    }
+
+    // Axes were collected at the back of the arrays; move them to the front
+    plan->num_dimensions = n;
+    memmove(plan->shape, plan->shape + ARRAY_MAX_DIMS - n, n * sizeof(size_t));
+    for (int k = 0; k < BROADCAST_OPERANDS; k++) {
+        memmove(plan->strides[k], plan->strides[k] + ARRAY_MAX_DIMS - n, n * sizeof(ptrdiff_t));
+    }
+    return true;
+}
+
+/**
+ * A plan split into units of work for the thread pool: unit u is chunk
+ * u % chunks_per_row of row u / chunks_per_row
+ */
+typedef struct {
+    const BroadcastPlan* plan;
+    BroadcastRowFn fn;
+    void* ctx;
+    size_t chunk;
+    size_t chunks_per_row;
+} BroadcastTask;
+
+/**
+ * Run fn over units [begin, end)
+ */
+static void broadcast_range(size_t begin, size_t end, void* arg) {
+    const BroadcastTask* task = (const BroadcastTask*)arg;
+    const BroadcastPlan* plan = task->plan;
+    _Alignas(64) unsigned char staging[BROADCAST_OPERANDS][BROADCAST_CHUNK_BYTES];
+    const void* staged_scalar[2] = { NULL, NULL };  // element each input buffer is filled with
+    size_t staged_count[2] = { 0, 0 };
+
+    size_t ndim = plan->num_dimensions;
+    size_t inner = plan->shape[ndim - 1];
+    ptrdiff_t inner_stride[BROADCAST_OPERANDS];
+    for (int k = 0; k < BROADCAST_OPERANDS; k++) inner_stride[k] = plan->strides[k][ndim - 1];
+
+    // Position of the first row, then an odometer over the outer axes
+    size_t index[ARRAY_MAX_DIMS] = {0};
+    ptrdiff_t row[BROADCAST_OPERANDS] = {0};
+    size_t rest = begin / task->chunks_per_row;
+    for (size_t d = ndim - 1; d-- > 0;) {
+        index[d] = rest % plan->shape[d];
+        rest /= plan->shape[d];
+        for (int k = 0; k < BROADCAST_OPERANDS; k++) row[k] += (ptrdiff_t)index[d] * plan->strides[k][d];
+    }
+
+    for (size_t u = begin; u < end; u++) {
+        size_t start = (u % task->chunks_per_row) * task->chunk;
+        size_t m = inner - start < task->chunk ? inner - start : task->chunk;
+        const void* in[2];
+        void* out;
+
+        for (int k = 0; k < 2; k++) {
+            size_t size = plan->size[k];
+            const char* src = plan->data[k] + (row[k] + (ptrdiff_t)start * inner_stride[k]) * (ptrdiff_t)size;
+            if (inner_stride[k] == 1) {
+                in[k] = src;
+            } else if (inner_stride[k] == 0) {
+                // Broadcast along the row: fill once, reuse while the element is the same
+                if (staged_scalar[k] != src || staged_count[k] < m) {
+                    array_copy_elements(staging[k], 1, src, 0, m, size);
+                    staged_scalar[k] = src;
+                    staged_count[k] = m;
+                }
+                in[k] = staging[k];
+            } else {
+                array_copy_elements(staging[k], 1, src, inner_stride[k], m, size);
+                staged_scalar[k] = NULL;
+                in[k] = staging[k];
+            }
+        }
+
+        char* dst = plan->data[2] + (row[2] + (ptrdiff_t)start * inner_stride[2]) * (ptrdiff_t)plan->size[2];
+        out = inner_stride[2] == 1 ? (void*)dst : (void*)staging[2];
+        task->fn(in[0], in[1], out, m, task->ctx);
+        if (inner_stride[2] != 1) {
+            array_copy_elements(dst, inner_stride[2], staging[2], 1, m, plan->size[2]);
+        }
+
+        if ((u + 1) % task->chunks_per_row != 0) continue;
+
+        // Odometer over the outer axes
+        for (size_t d = ndim - 1; d-- > 0;) {
+            for (int k = 0; k < BROADCAST_OPERANDS; k++) row[k] += plan->strides[k][d];
+            if (++index[d] < plan->shape[d]) break;
+            for (int k = 0; k < BROADCAST_OPERANDS; k++) {
+                row[k] -= plan->strides[k][d] * (ptrdiff_t)plan->shape[d];
+            }
+            index[d] = 0;
+        }
+    }
+}
+
+/**
+ * Run fn over every inner row of the plan, split across the thread pool
+ */
+static void broadcast_execute(const BroadcastPlan* plan, BroadcastRowFn fn, void* ctx) {
+    size_t ndim = plan->num_dimensions;
+    size_t inner = plan->shape[ndim - 1];
+    bool unit = true;
+    size_t max_size = 1;
+    size_t item_bytes = 0;
+    for (int k = 0; k < BROADCAST_OPERANDS; k++) {
+        unit = unit && plan->strides[k][ndim - 1] == 1;
+        if (plan->size[k] > max_size) max_size = plan->size[k];
+        item_bytes += plan->size[k];
+    }
+
+    // Dense rows go to the kernel a grain at a time; anything else is staged
+    // in L1-sized chunks
+    size_t grain = parallel_grain(item_bytes);
+    size_t chunk = unit ? grain : BROADCAST_CHUNK_BYTES / max_size;
+    if (chunk > inner) chunk = inner;
+
+    size_t rows = 1;
+    for (size_t d = 0; d + 1 < ndim; d++) rows *= plan->shape[d];
+
+    BroadcastTask task = { plan, fn, ctx, chunk, (inner + chunk - 1) / chunk };
+    parallel_for(rows * task.chunks_per_row, grain / chunk + 1, broadcast_range, &task);
+}
+
+static void binary_row(const void* a, const void* b, void* out, size_t n, void* ctx) {
+    ((Kernel*)ctx)->binary(a, b, out, n);
+}
+
+/**
+ * Broadcast a binary kernel into an existing array
+ */
+bool array_binary_op_into(KernelOp op, const Array* a, const Array* b, Array* out) {
+    if (!a || !b || !out) {
+        fprintf(stderr, "Error: Operands cannot be NULL\n");
+        return false;
+    }
+    if (op != KERNEL_ADD && op != KERNEL_SUB && op != KERNEL_MUL && op != KERNEL_DIV &&
+        op != KERNEL_MIN && op != KERNEL_MAX) {
+        fprintf(stderr, "Error: Not a binary elementwise operation\n");
+        return false;
+    }
+    if (a->type != b->type || a->type != out->type) {
+        fprintf(stderr, "Error: Operand types must match\n");
+        return false;
+    }
+
+    Kernel kernel = get_kernel(op, a->type);
+    if (!kernel.binary) {
+        fprintf(stderr, "Error: Operation not supported for this type\n");
+        return false;
+    }
+
+    // out may share its buffer with a copy (which may be a or b)
+    if (!array_make_writable(out)) return false;
+
+    BroadcastPlan plan;
+    if (!broadcast_plan(a, b, out, &plan)) return false;
+    if (out->count == 0) return true;
+
+    // Inputs partially overlapping out are read from copies
+    Array* owned_a = NULL;
+    Array* owned_b = NULL;
+    const Array* src_a = array_unaliased(a, out, &owned_a);
+    const Array* src_b = src_a ? array_unaliased(b, out, &owned_b) : NULL;
+    bool ok = src_b != NULL;
+    if (ok && (owned_a || owned_b)) ok = broadcast_plan(src_a, src_b, out, &plan);
+    if (ok) broadcast_execute(&plan, binary_row, &kernel);
+    array_free(owned_b);
+    array_free(owned_a);
+    return ok;
+}
+
+/**
+ * Broadcast a binary kernel into a new array
+ */
+Array* array_binary_op(KernelOp op, const Array* a, const Array* b) {
+    if (!a || !b) {
+        fprintf(stderr, "Error: Operands cannot be NULL\n");
+        return NULL;
+    }
+
+    size_t shape[ARRAY_MAX_DIMS];
+    size_t ndim;
+    if (!array_broadcast_shape(a, b, shape, &ndim)) {
+        fprintf(stderr, "Error: Operands could not be broadcast together\n");
+        return NULL;
+    }
+
+    size_t count = 1;
+    for (size_t d = 0; d < ndim; d++) count *= shape[d];
+
+    Array* out = array_empty(count, a->type, false);
+    if (!out) return NULL;
+    if (!array_set_shape(out, shape, ndim) || !array_binary_op_into(op, a, b, out)) {
+        array_free(out);
+        return NULL;
+    }
+    return out;
+}
+
+typedef struct {
+    Kernel kernel;
+    CompareOp cmp;
+} CompareTask;
+
+static void compare_row(const void* a, const void* b, void* out, size_t n, void* ctx) {
+    CompareTask* task = (CompareTask*)ctx;
+    task->kernel.compare(a, b, (bool*)out, n, task->cmp);
+}
+
+/**
+ * Broadcast a comparison into an existing BOOL array
+ */
+bool array_compare_into(CompareOp cmp, const Array* a, const Array* b, Array* out) {
+    if (!a || !b || !out) {
+        fprintf(stderr, "Error: Operands cannot be NULL\n");
+        return false;
+    }
+    if (a->type != b->type) {
+        fprintf(stderr, "Error: Operand types must match\n");
+        return false;
+    }
+    if (out->type != BOOL) {
+        fprintf(stderr, "Error: Comparison output must be BOOL\n");
+        return false;
+    }
+    if (cmp < CMP_EQ || cmp > CMP_GE) {
+        fprintf(stderr, "Error: Unknown comparison\n");
+        return false;
+    }
+
+    CompareTask task = { get_kernel(KERNEL_COMPARE, a->type), cmp };
+    if (!task.kernel.compare) {
+        fprintf(stderr, "Error: Comparison not supported for this type\n");
+        return false;
+    }
+
+    if (!array_make_writable(out)) return false;
+
+    BroadcastPlan plan;
+    if (!broadcast_plan(a, b, out, &plan)) return false;
+    if (out->count == 0) return true;
+
+    // Inputs partially overlapping out are read from copies
+    Array* owned_a = NULL;
+    Array* owned_b = NULL;
+    const Array* src_a = array_unaliased(a, out, &owned_a);
+    const Array* src_b = src_a ? array_unaliased(b, out, &owned_b) : NULL;
+    bool ok = src_b != NULL;
+    if (ok && (owned_a || owned_b)) ok = broadcast_plan(src_a, src_b, out, &plan);
+    if (ok) broadcast_execute(&plan, compare_row, &task);
+    array_free(owned_b);
+    array_free(owned_a);
+    return ok;
+}
+
+/**
+ * Broadcast a comparison into a new BOOL mask
+ */
+Array* array_compare(CompareOp cmp, const Array* a, const Array* b) {
+    if (!a || !b) {
+        fprintf(stderr, "Error: Operands cannot be NULL\n");
+        return NULL;
+    }
+
+    size_t shape[ARRAY_MAX_DIMS];
+    size_t ndim;
+    if (!array_broadcast_shape(a, b, shape, &ndim)) {
+        fprintf(stderr, "Error: Operands could not be broadcast together\n");
+        return NULL;
+    }
+
+    size_t count = 1;
+    for (size_t d = 0; d < ndim; d++) count *= shape[d];
+
+    Array* out = array_empty(count, BOOL, false);
+    if (!out) return NULL;
+    if (!array_set_shape(out, shape, ndim) || !array_compare_into(cmp, a, b, out)) {
+        array_free(out);
+        return NULL;
+    }
+    return out;
+}
+
+/**
+ * Compare every element with one value of the array's type
+ */
+Array* array_compare_value(CompareOp cmp, const Array* a, const void* value) {
+    if (!a || !value) {
+        fprintf(stderr, "Error: Operands cannot be NULL\n");
+        return NULL;
+    }
+    Array* scalar = array_full(1, a->type, (void*)value, false);
+    if (!scalar) return NULL;
+    Array* out = array_compare(cmp, a, scalar);
+    array_free(scalar);
+    return out;
+}
+
+Array* array_add(const Array* a, const Array* b) { return array_binary_op(KERNEL_ADD, a, b); }
+Array* array_sub(const Array* a, const Array* b) { return array_binary_op(KERNEL_SUB, a, b); }
+Array* array_mul(const Array* a, const Array* b) { return array_binary_op(KERNEL_MUL, a, b); }
+Array* array_div(const Array* a, const Array* b) { return array_binary_op(KERNEL_DIV, a, b); }
+Array* array_minimum(const Array* a, const Array* b) { return array_binary_op(KERNEL_MIN, a, b); }
+Array* array_maximum(const Array* a, const Array* b) { return array_binary_op(KERNEL_MAX, a, b); }
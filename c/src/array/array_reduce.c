@@ -0,0 +1,624 @@
+/**
+ * array_reduce.c - Reductions over whole Arrays or along one axis
+ *
+ * Contiguous runs go straight to the dispatched reduction kernels (SIMD
+ * accumulators, pairwise sums). Strided runs are staged through an L1 buffer
+ * a chunk at a time. Whole-array reductions, contiguous or not, produce one
+ * partial per fixed block in parallel and combine the partials pairwise.
+ * Reductions over a non-innermost axis accumulate whole rows elementwise
+ * instead, so the input is still read in memory order; sums there fold each
+ * block of rows into the output with Neumaier compensation.
+ */
+
+#include "../../include/array/array_reduce.h"
+#include "../../include/array/array_view.h"
+#include "../../include/runtime/runtime_dispatch.h"
+#include "../../include/runtime/parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+// Elements per partial result of a whole-array reduction (fixed, so results
+// do not depend on how many threads ran)
+#define REDUCE_BLOCK ((size_t)1 << 16)
+
+// Staging for strided runs
+#define REDUCE_CHUNK_BYTES 8192
+
+// Output columns accumulated together when reducing a non-innermost axis
+#define REDUCE_TILE 2048
+
+// Rows summed plainly before each compensated fold into the axis sums
+#define REDUCE_ROW_BLOCK 128
+
+// Widest partial value: a double or one element
+#define REDUCE_VALUE_BYTES 8
+
+/**
+ * Kernels and sizes a reduction needs
+ */
+typedef struct {
+    ReduceOp op;
+    Type type;
+    size_t size;          // element size
+    size_t value_size;    // size of a partial value (double for SUM/PROD/MEAN unless integer_sum)
+    bool is_arg;
+    bool integer_sum;     // SUM/MEAN of INT64/UINT64: partials are wrapping element-type sums
+    Kernel kernel;        // reduces a contiguous run to one partial value
+    Kernel combine;       // reduces an array of partial values
+} ReducePlan;
+
+static bool reduce_plan(ReduceOp op, const Array* array, ReducePlan* plan) {
+    if (!array) {
+        fprintf(stderr, "Error: Array cannot be NULL\n");
+        return false;
+    }
+    if (array->type == STRING || array->type == ARRAY || array->type == FLOAT16 ||
+        array->type == BFLOAT16) {
+        fprintf(stderr, "Error: Type not supported for reductions\n");
+        return false;
+    }
+
+    plan->op = op;
+    plan->type = array->type;
+    plan->size = array->sizeof_type;
+    plan->is_arg = op == REDUCE_ARGMIN || op == REDUCE_ARGMAX;
+    plan->integer_sum = (op == REDUCE_SUM || op == REDUCE_MEAN) &&
+                        (array->type == INT64 || array->type == UINT64);
+
+    switch (op) {
+        case REDUCE_SUM:
+        case REDUCE_MEAN:
+            // A double cannot hold every 64-bit sum: those add up in their own type
+            plan->kernel = get_kernel(KERNEL_SUM, array->type);
+            plan->combine = plan->integer_sum ? plan->kernel : get_kernel(KERNEL_SUM, DOUBLE);
+            plan->value_size = plan->integer_sum ? plan->size : sizeof(double);
+            break;
+        case REDUCE_PROD:
+            plan->kernel = get_kernel(KERNEL_PROD, array->type);
+            plan->combine = get_kernel(KERNEL_PROD, DOUBLE);
+            plan->value_size = sizeof(double);
+            break;
+        case REDUCE_MIN:
+        case REDUCE_ARGMIN:
+            plan->kernel = get_kernel(KERNEL_REDUCE_MIN, array->type);
+            plan->combine = plan->kernel;
+            plan->value_size = plan->size;
+            break;
+        case REDUCE_MAX:
+        case REDUCE_ARGMAX:
+            plan->kernel = get_kernel(KERNEL_REDUCE_MAX, array->type);
+            plan->combine = plan->kernel;
+            plan->value_size = plan->size;
+            break;
+        default:
+            fprintf(stderr, "Error: Unknown reduction\n");
+            return false;
+    }
+    return plan->kernel.reduce != NULL;
+}
+
+/**
+ * Index of the first element bitwise equal to value (n if absent)
+ */
+static size_t find_first(const char* src, size_t n, size_t size, const void* value) {
+    switch (size) {
+        case 1: {
+            const void* hit = memchr(src, *(const unsigned char*)value, n);
+            return hit ? (size_t)((const char*)hit - src) : n;
+        }
+        case 4: {
+            uint32_t v;
+            memcpy(&v, value, 4);
+            for (size_t i = 0; i < n; i++) if (((const uint32_t*)src)[i] == v) return i;
+            return n;
+        }
+        case 8: {
+            uint64_t v;
+            memcpy(&v, value, 8);
+            for (size_t i = 0; i < n; i++) if (((const uint64_t*)src)[i] == v) return i;
+            return n;
+        }
+        default:
+            for (size_t i = 0; i < n; i++) if (memcmp(src + i * size, value, size) == 0) return i;
+            return n;
+    }
+}
+
+/**
+ * Index of the first element equal to a MIN/MAX result (n if absent). The
+ * kernels return whichever NaN they met, so a NaN result matches any NaN.
+ */
+static size_t find_result(const ReducePlan* plan, const char* src, size_t n, const void* value) {
+    if (plan->type == FLOAT && isnan(*(const float*)value)) {
+        for (size_t i = 0; i < n; i++) if (isnan(((const float*)src)[i])) return i;
+        return n;
+    }
+    if (plan->type == DOUBLE && isnan(*(const double*)value)) {
+        for (size_t i = 0; i < n; i++) if (isnan(((const double*)src)[i])) return i;
+        return n;
+    }
+    return find_first(src, n, plan->size, value);
+}
+
+/**
+ * Fold partial into acc; true if acc changed (for MIN/MAX, only on a strict improvement)
+ */
+static bool reduce_combine(const ReducePlan* plan, void* acc, const void* partial) {
+    if (plan->integer_sum) {
+        // Unsigned addition wraps the same way for INT64 and UINT64
+        uint64_t a, b;
+        memcpy(&a, acc, sizeof(a));
+        memcpy(&b, partial, sizeof(b));
+        a += b;
+        memcpy(acc, &a, sizeof(a));
+        return true;
+    }
+    if (plan->op == REDUCE_SUM || plan->op == REDUCE_MEAN) {
+        *(double*)acc += *(const double*)partial;
+        return true;
+    }
+    if (plan->op == REDUCE_PROD) {
+        *(double*)acc *= *(const double*)partial;
+        return true;
+    }
+
+    // MIN/MAX kernels keep the first of equal values, and a NaN acc over any partial
+    unsigned char pair[2 * REDUCE_VALUE_BYTES], best[REDUCE_VALUE_BYTES];
+    memcpy(pair, acc, plan->value_size);
+    memcpy(pair + plan->value_size, partial, plan->value_size);
+    plan->combine.reduce(pair, 2, best);
+    if (memcmp(best, acc, plan->value_size) == 0) return false;
+    memcpy(acc, best, plan->value_size);
+    return true;
+}
+
+/**
+ * Reduce n elements spaced `stride` elements apart (n >= 1); index is the
+ * arg position for ARGMIN/ARGMAX
+ */
+static void reduce_run(const ReducePlan* plan, const char* src, ptrdiff_t stride, size_t n,
+                       void* value, size_t* index) {
+    if (stride == 1) {
+        plan->kernel.reduce(src, n, value);
+        if (plan->is_arg) *index = find_result(plan, src, n, value);
+        return;
+    }
+
+    _Alignas(64) char staging[REDUCE_CHUNK_BYTES];
+    size_t chunk = REDUCE_CHUNK_BYTES / plan->size;
+    for (size_t start = 0; start < n; start += chunk) {
+        size_t m = n - start < chunk ? n - start : chunk;
+        array_copy_elements(staging, 1, src + (ptrdiff_t)start * stride * (ptrdiff_t)plan->size,
+                            stride, m, plan->size);
+
+        unsigned char partial[REDUCE_VALUE_BYTES];
+        plan->kernel.reduce(staging, m, partial);
+        bool improved = start == 0;
+        if (improved) {
+            memcpy(value, partial, plan->value_size);
+        } else {
+            improved = reduce_combine(plan, value, partial);
+        }
+        if (plan->is_arg && improved) {
+            *index = start + find_result(plan, staging, m, value);
+        }
+    }
+}
+
+//====================
+// Whole-array reductions
+//====================
+
+typedef struct {
+    const ReducePlan* plan;
+    const Array* array;      // NULL when data is contiguous
+    const char* data;
+    size_t count;
+    unsigned char* values;   // one partial per block
+    size_t* indices;         // arg position per block
+} BlockReduceTask;
+
+/**
+ * Element offset (from array_data) of row-major position flat
+ */
+static ptrdiff_t flat_offset(const Array* array, size_t flat) {
+    ptrdiff_t offset = 0;
+    for (size_t d = array->num_dimensions; d-- > 0;) {
+        offset += (ptrdiff_t)(flat % array->shape[d]) * array->strides[d];
+        flat /= array->shape[d];
+    }
+    return offset;
+}
+
+/**
+ * Reduce n elements from row-major position start: one run when contiguous,
+ * else one run per (piece of an) innermost row, folded in order
+ */
+static void reduce_block(const BlockReduceTask* task, size_t start, size_t n, void* value, size_t* index) {
+    const ReducePlan* plan = task->plan;
+    if (!task->array) {
+        size_t run_index = 0;
+        reduce_run(plan, task->data + start * plan->size, 1, n, value, &run_index);
+        *index = start + run_index;
+        return;
+    }
+
+    const Array* array = task->array;
+    size_t inner = array->shape[array->num_dimensions - 1];
+    ptrdiff_t inner_stride = array->strides[array->num_dimensions - 1];
+    for (size_t flat = start; flat < start + n;) {
+        size_t m = inner - flat % inner;
+        if (m > start + n - flat) m = start + n - flat;
+        unsigned char partial[REDUCE_VALUE_BYTES];
+        size_t run_index = 0;
+        reduce_run(plan, task->data + flat_offset(array, flat) * (ptrdiff_t)plan->size, inner_stride, m,
+                   partial, &run_index);
+
+        bool improved = flat == start;
+        if (improved) {
+            memcpy(value, partial, plan->value_size);
+        } else {
+            improved = reduce_combine(plan, value, partial);
+        }
+        if (plan->is_arg && improved) *index = flat + run_index;
+        flat += m;
+    }
+}
+
+static void reduce_blocks(size_t begin, size_t end, void* ctx) {
+    BlockReduceTask* task = (BlockReduceTask*)ctx;
+    const ReducePlan* plan = task->plan;
+    for (size_t b = begin; b < end; b++) {
+        size_t start = b * REDUCE_BLOCK;
+        size_t n = task->count - start < REDUCE_BLOCK ? task->count - start : REDUCE_BLOCK;
+        size_t index = 0;
+        reduce_block(task, start, n, task->values + b * plan->value_size, &index);
+        if (task->indices) task->indices[b] = index;
+    }
+}
+
+/**
+ * Per-block partials (in parallel), combined in block order. Strided arrays
+ * use the same blocks as contiguous ones, so results do not depend on the
+ * thread count either way.
+ */
+static bool reduce_all(const ReducePlan* plan, const Array* array, void* value, size_t* index) {
+    BlockReduceTask task = { plan, array_is_contiguous(array) ? NULL : array,
+                             (const char*)array_data(array), array->count, NULL, NULL };
+    if (task.count <= REDUCE_BLOCK) {
+        reduce_block(&task, 0, task.count, value, index);
+        return true;
+    }
+
+    size_t blocks = (task.count + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+    task.values = (unsigned char*)malloc(blocks * plan->value_size);
+    task.indices = plan->is_arg ? (size_t*)malloc(blocks * sizeof(size_t)) : NULL;
+    if (!task.values || (plan->is_arg && !task.indices)) {
+        fprintf(stderr, "Error: Failed to allocate memory for reduction\n");
+        free(task.values);
+        free(task.indices);
+        return false;
+    }
+
+    parallel_for(blocks, parallel_grain(plan->size * REDUCE_BLOCK), reduce_blocks, &task);
+
+    plan->combine.reduce(task.values, blocks, value);
+    if (plan->is_arg) {
+        // First block holding the winning value (or a NaN) holds its first occurrence
+        *index = task.indices[find_result(plan, (const char*)task.values, blocks, value)];
+    }
+
+    free(task.indices);
+    free(task.values);
+    return true;
+}
+
+/**
+ * Partial value as a double
+ */
+static double reduce_value_to_double(Type type, const void* value) {
+    switch (type) {
+        case INT:    return (double)*(const int*)value;
+        case FLOAT:  return (double)*(const float*)value;
+        case DOUBLE: return *(const double*)value;
+        case CHAR:   return (double)*(const char*)value;
+        case BOOL:   return *(const bool*)value ? 1.0 : 0.0;
+        case INT8:   return (double)*(const int8_t*)value;
+        case INT16:  return (double)*(const int16_t*)value;
+        case INT64:  return (double)*(const int64_t*)value;
+        case UINT8:  return (double)*(const uint8_t*)value;
+        case UINT16: return (double)*(const uint16_t*)value;
+        case UINT32: return (double)*(const uint32_t*)value;
+        case UINT64: return (double)*(const uint64_t*)value;
+        default:     return NAN;
+    }
+}
+
+/**
+ * Reduce every element
+ */
+bool array_reduce(ReduceOp op, const Array* array, double* result) {
+    if (!result) {
+        fprintf(stderr, "Error: Result pointer cannot be NULL\n");
+        return false;
+    }
+
+    ReducePlan plan;
+    if (!reduce_plan(op, array, &plan)) return false;
+
+    if (array->count == 0) {
+        if (op == REDUCE_SUM || op == REDUCE_PROD) {
+            *result = op == REDUCE_SUM ? 0.0 : 1.0;
+            return true;
+        }
+        fprintf(stderr, "Error: Reduction of an empty array has no identity\n");
+        return false;
+    }
+
+    unsigned char value[REDUCE_VALUE_BYTES];
+    size_t index = 0;
+    if (!reduce_all(&plan, array, value, &index)) return false;
+
+    if (plan.is_arg) {
+        *result = (double)index;
+    } else if (plan.integer_sum) {
+        *result = reduce_value_to_double(plan.type, value);
+        if (op == REDUCE_MEAN) *result /= (double)array->count;
+    } else if (op == REDUCE_SUM || op == REDUCE_PROD || op == REDUCE_MEAN) {
+        *result = *(double*)value;
+        if (op == REDUCE_MEAN) *result /= (double)array->count;
+    } else {
+        *result = reduce_value_to_double(plan.type, value);
+    }
+    return true;
+}
+
+//====================
+// Axis reductions
+//====================
+
+typedef struct {
+    const ReducePlan* plan;
+    const Array* array;
+    size_t axis;
+    size_t len;              // length of the reduced axis
+    size_t inner;            // elements after the axis
+    Array* out;
+    Kernel rows;             // SUM_ROWS/PROD_ROWS, or binary MIN/MAX/ADD
+} AxisReduceTask;
+
+/**
+ * Element offset (from array_data) of output position j with the axis index at 0
+ */
+static ptrdiff_t axis_base_offset(const Array* array, size_t axis, size_t j) {
+    ptrdiff_t offset = 0;
+    for (size_t d = array->num_dimensions; d-- > 0;) {
+        if (d == axis) continue;
+        offset += (ptrdiff_t)(j % array->shape[d]) * array->strides[d];
+        j /= array->shape[d];
+    }
+    return offset;
+}
+
+/**
+ * One output element per run along the axis (innermost axis, arg reductions,
+ * or layouts the row path cannot use)
+ */
+static void reduce_axis_runs(size_t begin, size_t end, void* ctx) {
+    AxisReduceTask* task = (AxisReduceTask*)ctx;
+    const ReducePlan* plan = task->plan;
+    const char* data = (const char*)array_data(task->array);
+    ptrdiff_t stride = task->array->strides[task->axis];
+    char* out = (char*)task->out->parray;
+
+    for (size_t j = begin; j < end; j++) {
+        const char* src = data + axis_base_offset(task->array, task->axis, j) * (ptrdiff_t)plan->size;
+        unsigned char value[REDUCE_VALUE_BYTES];
+        size_t index = 0;
+        reduce_run(plan, src, stride, task->len, value, &index);
+
+        if (plan->is_arg) {
+            ((int*)out)[j] = (int)index;
+        } else {
+            memcpy(out + j * task->out->sizeof_type, value, task->out->sizeof_type);
+        }
+    }
+}
+
+/**
+ * Add each block of REDUCE_ROW_BLOCK rows to the sums of a tile with Neumaier
+ * compensation, so long axes do not drift like a plain running sum
+ */
+static void sum_rows_compensated(const AxisReduceTask* task, const char* base, size_t t, size_t m,
+                                 double* sums) {
+    ptrdiff_t stride = task->array->strides[task->axis];
+    double block[REDUCE_TILE], comp[REDUCE_TILE];
+    for (size_t i = 0; i < m; i++) sums[i] = comp[i] = 0.0;
+
+    for (size_t l0 = 0; l0 < task->len; l0 += REDUCE_ROW_BLOCK) {
+        size_t l1 = task->len - l0 < REDUCE_ROW_BLOCK ? task->len : l0 + REDUCE_ROW_BLOCK;
+        for (size_t i = 0; i < m; i++) block[i] = 0.0;
+        for (size_t l = l0; l < l1; l++) {
+            const char* slice = base + ((ptrdiff_t)l * stride + (ptrdiff_t)t) * (ptrdiff_t)task->plan->size;
+            task->rows.accumulate(slice, block, m);
+        }
+        for (size_t i = 0; i < m; i++) {
+            double sum = sums[i] + block[i];
+            comp[i] += fabs(sums[i]) >= fabs(block[i]) ? (sums[i] - sum) + block[i] : (block[i] - sum) + sums[i];
+            sums[i] = sum;
+        }
+    }
+    // An infinite or NaN sum stays as is (its compensation is NaN)
+    for (size_t i = 0; i < m; i++) {
+        if (isfinite(sums[i])) sums[i] += comp[i];
+    }
+}
+
+/**
+ * Elementwise accumulation of whole rows into the output, a tile of output
+ * columns at a time (used when the axis is not innermost and the elements
+ * after it are contiguous)
+ */
+static void reduce_axis_rows(size_t begin, size_t end, void* ctx) {
+    AxisReduceTask* task = (AxisReduceTask*)ctx;
+    const ReducePlan* plan = task->plan;
+    const char* data = (const char*)array_data(task->array);
+    ptrdiff_t stride = task->array->strides[task->axis];
+    size_t out_size = task->out->sizeof_type;
+    // MIN/MAX and 64-bit integer sums combine rows in the element type
+    bool elementwise = plan->op == REDUCE_MIN || plan->op == REDUCE_MAX || plan->integer_sum;
+
+    for (size_t o = begin; o < end; o++) {
+        const char* base = data + axis_base_offset(task->array, task->axis, o * task->inner) *
+                                  (ptrdiff_t)plan->size;
+        char* acc = (char*)task->out->parray + o * task->inner * out_size;
+
+        for (size_t t = 0; t < task->inner; t += REDUCE_TILE) {
+            size_t m = task->inner - t < REDUCE_TILE ? task->inner - t : REDUCE_TILE;
+            char* acc_tile = acc + t * out_size;
+            size_t l = 0;
+
+            if (plan->op != REDUCE_PROD && !elementwise) {
+                sum_rows_compensated(task, base, t, m, (double*)acc_tile);
+                continue;
+            }
+            if (elementwise) {
+                memcpy(acc_tile, base + t * plan->size, m * plan->size);
+                l = 1;
+            } else {
+                double identity = plan->op == REDUCE_PROD ? 1.0 : 0.0;
+                for (size_t i = 0; i < m; i++) ((double*)acc_tile)[i] = identity;
+            }
+
+            for (; l < task->len; l++) {
+                const char* slice = base + ((ptrdiff_t)l * stride + (ptrdiff_t)t) * (ptrdiff_t)plan->size;
+                if (elementwise) {
+                    task->rows.binary(acc_tile, slice, acc_tile, m);
+                } else {
+                    task->rows.accumulate(slice, (double*)acc_tile, m);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Whether the elements after `axis` form one dense row-major block
+ */
+static bool trailing_contiguous(const Array* array, size_t axis) {
+    ptrdiff_t expected = 1;
+    for (size_t d = array->num_dimensions; d-- > axis + 1;) {
+        if (array->shape[d] != 1 && array->strides[d] != expected) return false;
+        expected *= (ptrdiff_t)array->shape[d];
+    }
+    return true;
+}
+
+/**
+ * Reduce along one axis
+ */
+Array* array_reduce_axis(ReduceOp op, const Array* array, size_t axis) {
+    ReducePlan plan;
+    if (!reduce_plan(op, array, &plan)) return NULL;
+    if (axis >= array->num_dimensions) {
+        fprintf(stderr, "Error: Axis out of range\n");
+        return NULL;
+    }
+
+    size_t len = array->shape[axis];
+    if (len == 0 && op != REDUCE_SUM && op != REDUCE_PROD) {
+        fprintf(stderr, "Error: Reduction of an empty axis has no identity\n");
+        return NULL;
+    }
+
+    // Output shape: the input shape without the axis
+    size_t shape[ARRAY_MAX_DIMS];
+    size_t ndim = 0, outputs = 1, inner = 1;
+    for (size_t d = 0; d < array->num_dimensions; d++) {
+        if (d == axis) continue;
+        shape[ndim++] = array->shape[d];
+        outputs *= array->shape[d];
+        if (d > axis) inner *= array->shape[d];
+    }
+    if (ndim == 0) shape[ndim++] = 1;
+
+    // MEAN of INT64/UINT64 holds the integer sums until they are divided below
+    bool keeps_type = op == REDUCE_MIN || op == REDUCE_MAX || (plan.integer_sum && op == REDUCE_SUM);
+    Type out_type = plan.is_arg ? INT : keeps_type ? array->type : DOUBLE;
+    Array* out = array_zeros(outputs, out_type, false);
+    if (!out) return NULL;
+    if (!array_set_shape(out, shape, ndim)) {
+        array_free(out);
+        return NULL;
+    }
+    if (outputs == 0) return out;
+    if (len == 0) {
+        // Empty sums are 0 (already zeroed); empty products are 1
+        if (op == REDUCE_PROD) {
+            double one = 1.0;
+            get_kernel(KERNEL_FILL, DOUBLE).fill(out->parray, &one, outputs);
+        }
+        return out;
+    }
+
+    AxisReduceTask task = { &plan, array, axis, len, inner, out, { 0 } };
+    size_t work = outputs * len;
+    bool use_rows = !plan.is_arg && inner > 1 && trailing_contiguous(array, axis);
+
+    if (use_rows) {
+        if (op == REDUCE_MIN || op == REDUCE_MAX) {
+            task.rows = get_kernel(op == REDUCE_MIN ? KERNEL_MIN : KERNEL_MAX, array->type);
+        } else if (plan.integer_sum) {
+            // Unsigned lanes: INT64 wraps without signed overflow
+            task.rows = get_kernel(KERNEL_ADD, UINT64);
+        } else {
+            task.rows = get_kernel(op == REDUCE_PROD ? KERNEL_PROD_ROWS : KERNEL_SUM_ROWS, array->type);
+        }
+        size_t outer = outputs / inner;
+        parallel_for(outer, parallel_grain(plan.size * (work / outer)), reduce_axis_rows, &task);
+    } else {
+        parallel_for(outputs, parallel_grain(plan.size * len), reduce_axis_runs, &task);
+    }
+
+    if (op == REDUCE_MEAN) {
+        for (size_t j = 0; j < outputs; j++) {
+            double* mean = (double*)out->parray + j;
+            double total = plan.integer_sum ? reduce_value_to_double(plan.type, mean) : *mean;
+            *mean = total / (double)len;
+        }
+    }
+    return out;
+}
+
+//====================
+// Convenience wrappers
+//====================
+
+static double reduce_or_nan(ReduceOp op, const Array* array) {
+    double result;
+    return array_reduce(op, array, &result) ? result : NAN;
+}
+
+static size_t reduce_index(ReduceOp op, const Array* array) {
+    double result;
+    return array_reduce(op, array, &result) ? (size_t)result : SIZE_MAX;
+}
+
+double array_sum(const Array* array) { return reduce_or_nan(REDUCE_SUM, array); }
+double array_prod(const Array* array) { return reduce_or_nan(REDUCE_PROD, array); }
+double array_mean(const Array* array) { return reduce_or_nan(REDUCE_MEAN, array); }
+double array_min(const Array* array) { return reduce_or_nan(REDUCE_MIN, array); }
+double array_max(const Array* array) { return reduce_or_nan(REDUCE_MAX, array); }
+size_t array_argmin(const Array* array) { return reduce_index(REDUCE_ARGMIN, array); }
+size_t array_argmax(const Array* array) { return reduce_index(REDUCE_ARGMAX, array); }
+
+Array* array_sum_axis(const Array* array, size_t axis) { return array_reduce_axis(REDUCE_SUM, array, axis); }
+Array* array_prod_axis(const Array* array, size_t axis) { return array_reduce_axis(REDUCE_PROD, array, axis); }
+Array* array_mean_axis(const Array* array, size_t axis) { return array_reduce_axis(REDUCE_MEAN, array, axis); }
+Array* array_min_axis(const Array* array, size_t axis) { return array_reduce_axis(REDUCE_MIN, array, axis); }
+Array* array_max_axis(const Array* array, size_t axis) { return array_reduce_axis(REDUCE_MAX, array, axis); }
+Array* array_argmin_axis(const Array* array, size_t axis) { return array_reduce_axis(REDUCE_ARGMIN, array, axis); }
+Array* array_argmax_axis(const Array* array, size_t axis) { return array_reduce_axis(REDUCE_ARGMAX, array, axis); }
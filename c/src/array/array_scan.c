@@ -0,0 +1,356 @@
+/**
+ * array_scan.c - Inclusive and exclusive prefix scans along an axis
+ *
+ * The (dense) array is seen as [outer, len, inner] around the scanned axis.
+ * With inner == 1 every row is one contiguous run for the dispatched scan
+ * kernel. Rows of up to SCAN_BLOCK elements are scanned whole on the thread
+ * pool; longer rows are cut into SCAN_BLOCK blocks and scanned in two
+ * parallel passes around a short serial one: every block reduces to its total
+ * (scanning through an L1 scratch buffer, so nothing is written), each row's
+ * totals are scanned into block offsets, and every block is scanned again
+ * from its offset into the output. With inner > 1 the running values are a
+ * whole row wide, and each output row is the previous one combined with the
+ * next input row by the elementwise binary kernels, a tile of columns at a
+ * time.
+ */
+
+#include "../../include/array/array_scan.h"
+#include "../../include/array/array_view.h"
+#include "../../include/runtime/runtime_dispatch.h"
+#include "../../include/runtime/parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <stdatomic.h>
+
+// Elements per block of a long row (fixed, so results do not depend on how
+// many threads ran)
+#define SCAN_BLOCK ((size_t)1 << 16)
+
+// Scratch for the totals pass (a multiple of every SIMD register width)
+#define SCAN_SCRATCH_BYTES 4096
+
+// Columns carried together when scanning a non-innermost axis
+#define SCAN_TILE 2048
+
+// Widest running value: a compensated sum
+#define SCAN_CARRY_BYTES (2 * sizeof(double))
+
+typedef struct {
+    const char* src;
+    char* dst;
+    size_t len;              // length of the scanned axis
+    size_t inner;            // elements after the axis
+    size_t size;             // element size
+    Type type;
+    bool exclusive;
+    bool compensated;
+    ScanKernelFn scan;       // contiguous runs (inner == 1)
+    BinaryKernelFn combine;  // whole rows (inner > 1)
+    FillKernelFn fill;
+    unsigned char identity[SCAN_CARRY_BYTES];
+    size_t carry_size;
+    size_t blocks;           // blocks per row of a long-row scan
+    unsigned char* carries;  // per block: its total, then its offset
+    size_t tiles;            // column tiles per outer index (inner > 1)
+    atomic_bool failed;
+} ScanTask;
+
+/**
+ * Identity of op for the type: the running value before the first element
+ */
+static void scan_identity(ScanOp op, Type type, void* out) {
+    switch (type) {
+        case INT: {
+            int v = op == SCAN_PROD ? 1 : op == SCAN_MIN ? INT_MAX : op == SCAN_MAX ? INT_MIN : 0;
+            memcpy(out, &v, sizeof(v));
+            break;
+        }
+        case FLOAT: {
+            float v = op == SCAN_PROD ? 1.0f : op == SCAN_MIN ? INFINITY : op == SCAN_MAX ? -INFINITY : 0.0f;
+            memcpy(out, &v, sizeof(v));
+            break;
+        }
+        default: {
+            double v = op == SCAN_PROD ? 1.0 : op == SCAN_MIN ? INFINITY : op == SCAN_MAX ? -INFINITY : 0.0;
+            memcpy(out, &v, sizeof(v));
+            break;
+        }
+    }
+}
+
+/**
+ * Add x to a compensated running sum (Neumaier)
+ */
+static void compensated_add(double* carry, double x) {
+    double t = carry[0] + x;
+    carry[1] += fabs(carry[0]) >= fabs(x) ? (carry[0] - t) + x : (x - t) + carry[0];
+    carry[0] = t;
+}
+
+//====================
+// Innermost axis
+//====================
+
+static void scan_rows(size_t begin, size_t end, void* ctx) {
+    ScanTask* task = (ScanTask*)ctx;
+    size_t row = task->len * task->size;
+    for (size_t r = begin; r < end; r++) {
+        unsigned char carry[SCAN_CARRY_BYTES];
+        memcpy(carry, task->identity, task->carry_size);
+        task->scan(task->src + r * row, task->dst + r * row, task->len, carry, task->exclusive);
+    }
+}
+
+/**
+ * Elements [first, first + n) of block u of a long-row scan
+ */
+static void block_range(const ScanTask* task, size_t u, size_t* first, size_t* n) {
+    size_t row = u / task->blocks;
+    size_t start = (u % task->blocks) * SCAN_BLOCK;
+    *first = row * task->len + start;
+    *n = task->len - start < SCAN_BLOCK ? task->len - start : SCAN_BLOCK;
+}
+
+static void scan_block_totals(size_t begin, size_t end, void* ctx) {
+    ScanTask* task = (ScanTask*)ctx;
+    _Alignas(64) unsigned char scratch[SCAN_SCRATCH_BYTES];
+    size_t piece = SCAN_SCRATCH_BYTES / task->size;
+    for (size_t u = begin; u < end; u++) {
+        size_t first, n;
+        block_range(task, u, &first, &n);
+        unsigned char* carry = task->carries + u * SCAN_CARRY_BYTES;
+        memcpy(carry, task->identity, task->carry_size);
+        for (size_t i = 0; i < n; i += piece) {
+            size_t m = n - i < piece ? n - i : piece;
+            task->scan(task->src + (first + i) * task->size, scratch, m, carry, false);
+        }
+    }
+}
+
+static void scan_blocks(size_t begin, size_t end, void* ctx) {
+    ScanTask* task = (ScanTask*)ctx;
+    for (size_t u = begin; u < end; u++) {
+        size_t first, n;
+        block_range(task, u, &first, &n);
+        task->scan(task->src + first * task->size, task->dst + first * task->size, n,
+                   task->carries + u * SCAN_CARRY_BYTES, task->exclusive);
+    }
+}
+
+/**
+ * Turn every row's block totals into block offsets (exclusive scan)
+ */
+static void scan_block_offsets(ScanTask* task, size_t rows) {
+    for (size_t r = 0; r < rows; r++) {
+        unsigned char* carries = task->carries + r * task->blocks * SCAN_CARRY_BYTES;
+        if (task->compensated) {
+            double running[2] = { 0.0, 0.0 };
+            for (size_t b = 0; b < task->blocks; b++) {
+                double* carry = (double*)(carries + b * SCAN_CARRY_BYTES);
+                double total = carry[0], correction = carry[1];
+                memcpy(carry, running, sizeof(running));
+                compensated_add(running, total);
+                compensated_add(running, correction);
+            }
+            continue;
+        }
+        // Gather the totals into one run and scan it with the kernel itself
+        unsigned char totals[SCAN_SCRATCH_BYTES];
+        unsigned char* run = task->blocks * task->size <= sizeof(totals)
+                                 ? totals : (unsigned char*)malloc(task->blocks * task->size);
+        if (!run) {
+            atomic_store(&task->failed, true);
+            return;
+        }
+        for (size_t b = 0; b < task->blocks; b++) {
+            memcpy(run + b * task->size, carries + b * SCAN_CARRY_BYTES, task->size);
+        }
+        unsigned char carry[SCAN_CARRY_BYTES];
+        memcpy(carry, task->identity, task->carry_size);
+        task->scan(run, run, task->blocks, carry, true);
+        for (size_t b = 0; b < task->blocks; b++) {
+            memcpy(carries + b * SCAN_CARRY_BYTES, run + b * task->size, task->size);
+        }
+        if (run != totals) free(run);
+    }
+}
+
+/**
+ * Scan rows of len contiguous elements: whole rows, or blocks of long ones
+ */
+static bool scan_innermost(ScanTask* task, size_t rows) {
+    task->blocks = (task->len + SCAN_BLOCK - 1) / SCAN_BLOCK;
+    if (task->blocks <= 1) {
+        parallel_for(rows, parallel_grain(2 * task->len * task->size), scan_rows, task);
+        return true;
+    }
+
+    size_t units = rows * task->blocks;
+    task->carries = (unsigned char*)malloc(units * SCAN_CARRY_BYTES);
+    if (!task->carries) return false;
+    parallel_for(units, 1, scan_block_totals, task);
+    scan_block_offsets(task, rows);
+    if (!atomic_load(&task->failed)) parallel_for(units, 1, scan_blocks, task);
+    free(task->carries);
+    return !atomic_load(&task->failed);
+}
+
+//====================
+// Other axes
+//====================
+
+/**
+ * Tiles of columns: output row j combines output row j - 1 with input row j
+ * (exclusive: input row j - 1, after a row of identities)
+ */
+static void scan_tiles(size_t begin, size_t end, void* ctx) {
+    ScanTask* task = (ScanTask*)ctx;
+    size_t size = task->size;
+    size_t row = task->inner * size;
+    for (size_t u = begin; u < end; u++) {
+        size_t o = u / task->tiles;
+        size_t t = (u % task->tiles) * SCAN_TILE;
+        size_t m = task->inner - t < SCAN_TILE ? task->inner - t : SCAN_TILE;
+        const char* src = task->src + o * task->len * row + t * size;
+        char* dst = task->dst + o * task->len * row + t * size;
+
+        if (task->exclusive) task->fill(dst, task->identity, m);
+        else memcpy(dst, src, m * size);
+        for (size_t j = 1; j < task->len; j++) {
+            const char* next = src + (task->exclusive ? j - 1 : j) * row;
+            task->combine(dst + (j - 1) * row, next, dst + j * row, m);
+        }
+    }
+}
+
+/**
+ * Compensated sums of tiles of columns, one running (sum, correction) pair per column
+ */
+static void scan_tiles_compensated(size_t begin, size_t end, void* ctx) {
+    ScanTask* task = (ScanTask*)ctx;
+    double* running = (double*)malloc(2 * SCAN_TILE * sizeof(double));
+    if (!running) {
+        atomic_store(&task->failed, true);
+        return;
+    }
+    size_t row = task->inner * task->size;
+    for (size_t u = begin; u < end; u++) {
+        size_t o = u / task->tiles;
+        size_t t = (u % task->tiles) * SCAN_TILE;
+        size_t m = task->inner - t < SCAN_TILE ? task->inner - t : SCAN_TILE;
+        memset(running, 0, 2 * m * sizeof(double));
+        for (size_t j = 0; j < task->len; j++) {
+            const char* src = task->src + (o * task->len + j) * row + t * task->size;
+            char* dst = task->dst + (o * task->len + j) * row + t * task->size;
+            for (size_t i = 0; i < m; i++) {
+                double* carry = running + 2 * i;
+                double before = carry[0] + carry[1];
+                double x = task->type == FLOAT ? (double)((const float*)src)[i] : ((const double*)src)[i];
+                compensated_add(carry, x);
+                double value = task->exclusive ? before : carry[0] + carry[1];
+                if (task->type == FLOAT) ((float*)dst)[i] = (float)value;
+                else ((double*)dst)[i] = value;
+            }
+        }
+    }
+    free(running);
+}
+
+//====================
+// Public API
+//====================
+
+/**
+ * Scan along one axis
+ */
+Array* array_scan(ScanOp op, const Array* array, size_t axis, bool exclusive) {
+    if (!array) {
+        fprintf(stderr, "Error: Array cannot be NULL\n");
+        return NULL;
+    }
+    if ((unsigned)op > SCAN_SUM_COMPENSATED) {
+        fprintf(stderr, "Error: Unknown scan\n");
+        return NULL;
+    }
+    if (array->type != INT && array->type != FLOAT && array->type != DOUBLE) {
+        fprintf(stderr, "Error: Scans support INT, FLOAT and DOUBLE arrays\n");
+        return NULL;
+    }
+    if (axis >= array->num_dimensions) {
+        fprintf(stderr, "Error: Axis out of range\n");
+        return NULL;
+    }
+    // Integer sums are exact already
+    if (op == SCAN_SUM_COMPENSATED && array->type == INT) op = SCAN_SUM;
+
+    Array* out = array_empty(array->count, array->type, false);
+    if (!out) return NULL;
+    if (!array_set_shape(out, array->shape, array->num_dimensions)) {
+        array_free(out);
+        return NULL;
+    }
+    if (array->count == 0) return out;
+
+    Array* owned;
+    const Array* src = array_contiguous(array, &owned);
+    if (!src) {
+        array_free(out);
+        return NULL;
+    }
+
+    static const KernelOp scan_ops[] = { KERNEL_CUMSUM, KERNEL_CUMPROD, KERNEL_CUMMIN, KERNEL_CUMMAX,
+                                         KERNEL_CUMSUM_COMPENSATED };
+    static const KernelOp row_ops[] = { KERNEL_ADD, KERNEL_MUL, KERNEL_MIN, KERNEL_MAX, KERNEL_ADD };
+
+    ScanTask task = { 0 };
+    task.src = (const char*)array_data(src);
+    task.dst = (char*)array_data(out);
+    task.len = array->shape[axis];
+    task.inner = 1;
+    for (size_t d = axis + 1; d < array->num_dimensions; d++) task.inner *= array->shape[d];
+    task.size = array->sizeof_type;
+    task.type = array->type;
+    task.exclusive = exclusive;
+    task.compensated = op == SCAN_SUM_COMPENSATED;
+    task.carry_size = task.compensated ? SCAN_CARRY_BYTES : task.size;
+    if (!task.compensated) scan_identity(op, array->type, task.identity);
+    atomic_init(&task.failed, false);
+
+    size_t outer = array->count / (task.len * task.inner);
+    bool ok = true;
+    if (task.inner == 1) {
+        task.scan = get_kernel(scan_ops[op], array->type).scan;
+        ok = scan_innermost(&task, outer);
+    } else {
+        task.tiles = (task.inner + SCAN_TILE - 1) / SCAN_TILE;
+        size_t grain = parallel_grain(2 * task.len * SCAN_TILE * task.size);
+        if (task.compensated) {
+            parallel_for(outer * task.tiles, grain, scan_tiles_compensated, &task);
+        } else {
+            task.combine = get_kernel(row_ops[op], array->type).binary;
+            task.fill = get_kernel(KERNEL_FILL, array->type).fill;
+            parallel_for(outer * task.tiles, grain, scan_tiles, &task);
+        }
+        ok = !atomic_load(&task.failed);
+    }
+    array_free(owned);
+
+    if (!ok) {
+        fprintf(stderr, "Error: Failed to allocate memory for scan\n");
+        array_free(out);
+        return NULL;
+    }
+    return out;
+}
+
+//====================
+// Convenience wrappers
+//====================
+
+Array* array_cumsum(const Array* array, size_t axis) { return array_scan(SCAN_SUM, array, axis, false); }
+Array* array_cumprod(const Array* array, size_t axis) { return array_scan(SCAN_PROD, array, axis, false); }
+Array* array_cummin(const Array* array, size_t axis) { return array_scan(SCAN_MIN, array, axis, false); }
+Array* array_cummax(const Array* array, size_t axis) { return array_scan(SCAN_MAX, array, axis, false); }
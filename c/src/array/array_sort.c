@@ -0,0 +1,943 @@
+/**
+ * array_sort.c - Sorting and selection on order-preserving unsigned keys
+ *
+ * The sort runs in three parallel sweeps over the dense data: encode every
+ * element as its key in place, sort each row of keys, decode. Radix passes
+ * split a row into chunks: every chunk counts its digits, the counts become
+ * per-(digit, chunk) output offsets, and every chunk scatters its keys to
+ * those offsets, which keeps the sort stable without any locking.
+ *
+ * Argsort runs the same passes over (key, index) pairs, or introsort when the
+ * order of ties does not matter. Partition and top-k use introselect:
+ * quickselect on a median of three that switches to heap selection once its
+ * partitions have been lopsided for 2 log2(n) rounds, which bounds the worst
+ * case at O(n log n).
+ */
+
+#include "../../include/array/array_sort.h"
+#include "../../include/array/array_view.h"
+#include "../../include/runtime/runtime_dispatch.h"
+#include "../../include/runtime/parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <limits.h>
+
+typedef struct {
+    char* data;              // dense rows: elements, then keys while sorting
+    size_t rows;
+    size_t len;              // elements per row
+    size_t width;            // bytes per element and key
+    Type type;
+    SortKernelFn block;
+    int* indices;            // argsort: output rows
+    bool stable;             // argsort: radix or merge passes instead of introsort
+    size_t kth;              // partition: position to select
+    atomic_bool failed;
+} SortTask;
+
+//====================
+// Keys
+//====================
+
+static void encode_keys(size_t begin, size_t end, void* ctx) {
+    SortTask* task = (SortTask*)ctx;
+    switch (task->type) {
+        case INT: {
+            uint32_t* k = (uint32_t*)task->data;
+            for (size_t i = begin; i < end; i++) k[i] ^= 0x80000000u;
+            break;
+        }
+        case FLOAT: {
+            uint32_t* k = (uint32_t*)task->data;
+            for (size_t i = begin; i < end; i++) {
+                uint32_t bits = k[i];
+                bool nan = (bits & 0x7FFFFFFFu) > 0x7F800000u;
+                k[i] = nan ? UINT32_MAX : bits ^ ((bits >> 31) ? UINT32_MAX : 0x80000000u);
+            }
+            break;
+        }
+        case DOUBLE: {
+            uint64_t* k = (uint64_t*)task->data;
+            for (size_t i = begin; i < end; i++) {
+                uint64_t bits = k[i];
+                bool nan = (bits & 0x7FFFFFFFFFFFFFFFull) > 0x7FF0000000000000ull;
+                k[i] = nan ? UINT64_MAX : bits ^ ((bits >> 63) ? UINT64_MAX : 0x8000000000000000ull);
+            }
+            break;
+        }
+        default: {
+            // CHAR follows the platform's signedness of char
+            uint8_t* k = (uint8_t*)task->data;
+            if (CHAR_MIN < 0) {
+                for (size_t i = begin; i < end; i++) k[i] ^= 0x80u;
+            }
+            break;
+        }
+    }
+}
+
+static void decode_keys(size_t begin, size_t end, void* ctx) {
+    SortTask* task = (SortTask*)ctx;
+    switch (task->type) {
+        case FLOAT: {
+            // NaN keys (all ones) decode to a quiet NaN
+            uint32_t* k = (uint32_t*)task->data;
+            for (size_t i = begin; i < end; i++) k[i] = (k[i] >> 31) ? k[i] ^ 0x80000000u : ~k[i];
+            break;
+        }
+        case DOUBLE: {
+            uint64_t* k = (uint64_t*)task->data;
+            for (size_t i = begin; i < end; i++) k[i] = (k[i] >> 63) ? k[i] ^ 0x8000000000000000ull : ~k[i];
+            break;
+        }
+        default:
+            // Integer keys are their own inverse
+            encode_keys(begin, end, ctx);
+            break;
+    }
+}
+
+//====================
+// Introsort and introselect (per element type)
+//====================
+
+// Pieces this short are finished with insertion sort
+#define SELECT_SMALL 16
+
+// Bare keys and (key, index) pairs; pairs order by key, then by index, so
+// every order over them is total and equal keys keep their input order
+typedef struct { uint8_t key; int32_t index; } Pair8;
+typedef struct { uint32_t key; int32_t index; } Pair32;
+typedef struct { uint64_t key; int32_t index; } Pair64;
+
+#define KEY_LESS(a, b) ((a) < (b))
+#define PAIR_LESS(a, b) ((a).key < (b).key || ((a).key == (b).key && (a).index < (b).index))
+#define KEY_OF(x) (x)
+#define PAIR_KEY_OF(x) ((x).key)
+
+/**
+ * Partitioning rounds allowed before falling back to heaps: 2 log2(n)
+ */
+static unsigned depth_limit(size_t n) {
+    unsigned depth = 0;
+    while (n >>= 1) depth++;
+    return 2 * depth;
+}
+
+#define DEFINE_SELECTION(E, NAME, LESS)                                              \
+    static void insertion_sort_##NAME(E* a, size_t n) {                              \
+        for (size_t i = 1; i < n; i++) {                                             \
+            E value = a[i];                                                          \
+            size_t j = i;                                                            \
+            for (; j > 0 && LESS(value, a[j - 1]); j--) a[j] = a[j - 1];             \
+            a[j] = value;                                                            \
+        }                                                                            \
+    }                                                                                \
+                                                                                     \
+    /* Max-heap on [0, n) */                                                         \
+    static void sift_down_##NAME(E* a, size_t root, size_t n) {                      \
+        E value = a[root];                                                           \
+        for (;;) {                                                                   \
+            size_t child = 2 * root + 1;                                             \
+            if (child >= n) break;                                                   \
+            if (child + 1 < n && LESS(a[child], a[child + 1])) child++;              \
+            if (!LESS(value, a[child])) break;                                       \
+            a[root] = a[child];                                                      \
+            root = child;                                                            \
+        }                                                                            \
+        a[root] = value;                                                             \
+    }                                                                                \
+                                                                                     \
+    static void make_heap_##NAME(E* a, size_t n) {                                   \
+        for (size_t i = n / 2; i-- > 0;) sift_down_##NAME(a, i, n);                  \
+    }                                                                                \
+                                                                                     \
+    /* Keep the kth + 1 smallest in a heap, then put its top at kth */               \
+    static void heap_select_##NAME(E* a, size_t n, size_t kth) {                     \
+        make_heap_##NAME(a, kth + 1);                                                \
+        for (size_t i = kth + 1; i < n; i++) {                                       \
+            if (LESS(a[i], a[0])) {                                                  \
+                E swap = a[i];                                                       \
+                a[i] = a[0];                                                         \
+                a[0] = swap;                                                         \
+                sift_down_##NAME(a, 0, kth + 1);                                     \
+            }                                                                        \
+        }                                                                            \
+        E top = a[0];                                                                \
+        a[0] = a[kth];                                                               \
+        a[kth] = top;                                                                \
+    }                                                                                \
+                                                                                     \
+    /* Hoare partition around the median of three; returns p in [1, n) with */       \
+    /* [0, p) <= pivot <= [p, n) */                                                  \
+    static size_t split_##NAME(E* a, size_t n) {                                     \
+        size_t mid = n / 2;                                                          \
+        E t;                                                                         \
+        if (LESS(a[mid], a[0])) { t = a[mid]; a[mid] = a[0]; a[0] = t; }             \
+        if (LESS(a[n - 1], a[mid])) { t = a[n - 1]; a[n - 1] = a[mid]; a[mid] = t; } \
+        if (LESS(a[mid], a[0])) { t = a[mid]; a[mid] = a[0]; a[0] = t; }             \
+        /* The median leads, the smallest and largest bound both scans */            \
+        t = a[mid]; a[mid] = a[0]; a[0] = t;                                         \
+        E pivot = a[0];                                                              \
+        size_t i = (size_t)-1, j = n;                                                \
+        for (;;) {                                                                   \
+            do i++; while (LESS(a[i], pivot));                                       \
+            do j--; while (LESS(pivot, a[j]));                                       \
+            if (i >= j) return j + 1;                                                \
+            t = a[i]; a[i] = a[j]; a[j] = t;                                         \
+        }                                                                            \
+    }                                                                                \
+                                                                                     \
+    /* Place the kth smallest at kth, smaller before and larger after */             \
+    static void intro_select_##NAME(E* a, size_t n, size_t kth) {                    \
+        unsigned depth = depth_limit(n);                                             \
+        while (n > SELECT_SMALL) {                                                   \
+            if (depth-- == 0) {                                                      \
+                heap_select_##NAME(a, n, kth);                                       \
+                return;                                                              \
+            }                                                                        \
+            size_t p = split_##NAME(a, n);                                           \
+            if (kth < p) {                                                           \
+                n = p;                                                               \
+            } else {                                                                 \
+                a += p;                                                              \
+                kth -= p;                                                            \
+                n -= p;                                                              \
+            }                                                                        \
+        }                                                                            \
+        insertion_sort_##NAME(a, n);                                                 \
+    }
+
+DEFINE_SELECTION(uint8_t, u8, KEY_LESS)
+DEFINE_SELECTION(uint32_t, u32, KEY_LESS)
+DEFINE_SELECTION(uint64_t, u64, KEY_LESS)
+DEFINE_SELECTION(Pair8, p8, PAIR_LESS)
+DEFINE_SELECTION(Pair32, p32, PAIR_LESS)
+DEFINE_SELECTION(Pair64, p64, PAIR_LESS)
+
+// Sorting proper is only needed for pairs
+#define DEFINE_INTRO_SORT(E, NAME, LESS)                                             \
+    static void heap_sort_##NAME(E* a, size_t n) {                                   \
+        make_heap_##NAME(a, n);                                                      \
+        for (size_t end = n; end > 1; end--) {                                       \
+            E top = a[0];                                                            \
+            a[0] = a[end - 1];                                                       \
+            a[end - 1] = top;                                                        \
+            sift_down_##NAME(a, 0, end - 1);                                         \
+        }                                                                            \
+    }                                                                                \
+                                                                                     \
+    static void intro_sort_##NAME(E* a, size_t n, unsigned depth) {                  \
+        while (n > SELECT_SMALL) {                                                   \
+            if (depth == 0) {                                                        \
+                heap_sort_##NAME(a, n);                                              \
+                return;                                                              \
+            }                                                                        \
+            depth--;                                                                 \
+            size_t p = split_##NAME(a, n);                                           \
+            /* Recurse into the smaller side: O(log n) stack */                      \
+            if (p < n - p) {                                                         \
+                intro_sort_##NAME(a, p, depth);                                      \
+                a += p;                                                              \
+                n -= p;                                                              \
+            } else {                                                                 \
+                intro_sort_##NAME(a + p, n - p, depth);                              \
+                n = p;                                                               \
+            }                                                                        \
+        }                                                                            \
+        insertion_sort_##NAME(a, n);                                                 \
+    }
+
+DEFINE_INTRO_SORT(Pair8, p8, PAIR_LESS)
+DEFINE_INTRO_SORT(Pair32, p32, PAIR_LESS)
+DEFINE_INTRO_SORT(Pair64, p64, PAIR_LESS)
+
+//====================
+// Radix and merge sorts (per element type)
+//====================
+
+typedef struct {
+    const void* src;
+    void* dst;
+    size_t n;
+    size_t chunk;            // elements per chunk
+    unsigned shift;          // digit being sorted on
+    size_t* counts;          // 256 per chunk: digit counts, then output offsets
+} RadixPass;
+
+#define DEFINE_SORTS(E, NAME, KEY, LESS)                                             \
+    static void radix_count_##NAME(size_t begin, size_t end, void* ctx) {            \
+        RadixPass* pass = (RadixPass*)ctx;                                           \
+        const E* src = (const E*)pass->src;                                          \
+        unsigned shift = pass->shift;                                                \
+        for (size_t c = begin; c < end; c++) {                                       \
+            size_t* counts = pass->counts + c * 256;                                 \
+            size_t stop = (c + 1) * pass->chunk < pass->n ? (c + 1) * pass->chunk : pass->n; \
+            memset(counts, 0, 256 * sizeof(size_t));                                 \
+            for (size_t i = c * pass->chunk; i < stop; i++) counts[(KEY(src[i]) >> shift) & 0xFF]++; \
+        }                                                                            \
+    }                                                                                \
+                                                                                     \
+    static void radix_scatter_##NAME(size_t begin, size_t end, void* ctx) {          \
+        RadixPass* pass = (RadixPass*)ctx;                                           \
+        const E* src = (const E*)pass->src;                                          \
+        E* dst = (E*)pass->dst;                                                      \
+        /* Locals: stores through dst may alias anything of type E */                \
+        unsigned shift = pass->shift;                                                \
+        size_t offsets[256];                                                         \
+        for (size_t c = begin; c < end; c++) {                                       \
+            memcpy(offsets, pass->counts + c * 256, sizeof(offsets));                \
+            size_t stop = (c + 1) * pass->chunk < pass->n ? (c + 1) * pass->chunk : pass->n; \
+            for (size_t i = c * pass->chunk; i < stop; i++) {                        \
+                E value = src[i];                                                    \
+                dst[offsets[(KEY(value) >> shift) & 0xFF]++] = value;                \
+            }                                                                        \
+        }                                                                            \
+    }                                                                                \
+                                                                                     \
+    static bool radix_sort_##NAME(E* keys, E* scratch, size_t n) {                   \
+        RadixPass pass = { 0 };                                                      \
+        pass.n = n;                                                                  \
+        pass.chunk = parallel_grain(2 * sizeof(E));                                  \
+        size_t chunks = (n + pass.chunk - 1) / pass.chunk;                           \
+        pass.counts = (size_t*)malloc(chunks * 256 * sizeof(size_t));                \
+        if (!pass.counts) return false;                                              \
+                                                                                     \
+        E* src = keys;                                                               \
+        E* dst = scratch;                                                            \
+        for (pass.shift = 0; pass.shift < 8 * sizeof(KEY(*keys)); pass.shift += 8) { \
+            pass.src = src;                                                          \
+            pass.dst = dst;                                                          \
+            parallel_for(chunks, 1, radix_count_##NAME, &pass);                      \
+                                                                                     \
+            /* Digit-major, chunk-minor offsets keep equal digits in input order */  \
+            size_t offset = 0;                                                       \
+            bool uniform = false;                                                    \
+            for (size_t d = 0; d < 256; d++) {                                       \
+                size_t first = offset;                                               \
+                for (size_t c = 0; c < chunks; c++) {                                \
+                    size_t count = pass.counts[c * 256 + d];                         \
+                    pass.counts[c * 256 + d] = offset;                               \
+                    offset += count;                                                 \
+                }                                                                    \
+                uniform = uniform || offset - first == n;                            \
+            }                                                                        \
+            if (uniform) continue;                                                   \
+                                                                                     \
+            parallel_for(chunks, 1, radix_scatter_##NAME, &pass);                    \
+            E* swap = src;                                                           \
+            src = dst;                                                               \
+            dst = swap;                                                              \
+        }                                                                            \
+        if (src != keys) memcpy(keys, src, n * sizeof(E));                           \
+        free(pass.counts);                                                           \
+        return true;                                                                 \
+    }                                                                                \
+                                                                                     \
+    /* Runs start as SORT_BLOCK_KEYS blocks ordered by block, or by insertion */     \
+    /* sort without one */                                                           \
+    static void merge_sort_##NAME(E* keys, E* scratch, size_t n, SortKernelFn block) { \
+        for (size_t i = 0; i < n; i += SORT_BLOCK_KEYS) {                            \
+            size_t len = n - i < SORT_BLOCK_KEYS ? n - i : SORT_BLOCK_KEYS;          \
+            if (block) block(keys + i, len);                                         \
+            else insertion_sort_##NAME(keys + i, len);                               \
+        }                                                                            \
+        E* src = keys;                                                               \
+        E* dst = scratch;                                                            \
+        for (size_t run = SORT_BLOCK_KEYS; run < n; run *= 2) {                      \
+            for (size_t lo = 0; lo < n; lo += 2 * run) {                             \
+                size_t mid = lo + run < n ? lo + run : n;                            \
+                size_t hi = lo + 2 * run < n ? lo + 2 * run : n;                     \
+                size_t i = lo, j = mid, k = lo;                                      \
+                while (i < mid && j < hi) dst[k++] = LESS(src[j], src[i]) ? src[j++] : src[i++]; \
+                while (i < mid) dst[k++] = src[i++];                                 \
+                while (j < hi) dst[k++] = src[j++];                                  \
+            }                                                                        \
+            E* swap = src;                                                           \
+            src = dst;                                                               \
+            dst = swap;                                                              \
+        }                                                                            \
+        if (src != keys) memcpy(keys, src, n * sizeof(E));                           \
+    }
+
+DEFINE_SORTS(uint8_t, u8, KEY_OF, KEY_LESS)
+DEFINE_SORTS(uint32_t, u32, KEY_OF, KEY_LESS)
+DEFINE_SORTS(uint64_t, u64, KEY_OF, KEY_LESS)
+DEFINE_SORTS(Pair8, p8, PAIR_KEY_OF, PAIR_LESS)
+DEFINE_SORTS(Pair32, p32, PAIR_KEY_OF, PAIR_LESS)
+DEFINE_SORTS(Pair64, p64, PAIR_KEY_OF, PAIR_LESS)
+
+/**
+ * Sort one row of keys (scratch holds at least as many keys)
+ */
+static bool sort_keys(const SortTask* task, void* keys, void* scratch) {
+    size_t n = task->len;
+    bool radix = n >= SORT_RADIX_MIN;
+    switch (task->width) {
+        case 1:
+            if (radix) return radix_sort_u8((uint8_t*)keys, (uint8_t*)scratch, n);
+            merge_sort_u8((uint8_t*)keys, (uint8_t*)scratch, n, task->block);
+            return true;
+        case 4:
+            if (radix) return radix_sort_u32((uint32_t*)keys, (uint32_t*)scratch, n);
+            merge_sort_u32((uint32_t*)keys, (uint32_t*)scratch, n, task->block);
+            return true;
+        default:
+            if (radix) return radix_sort_u64((uint64_t*)keys, (uint64_t*)scratch, n);
+            merge_sort_u64((uint64_t*)keys, (uint64_t*)scratch, n, task->block);
+            return true;
+    }
+}
+
+static void sort_rows(size_t begin, size_t end, void* ctx) {
+    SortTask* task = (SortTask*)ctx;
+    void* scratch = malloc(task->len * task->width);
+    if (!scratch) {
+        atomic_store(&task->failed, true);
+        return;
+    }
+    for (size_t r = begin; r < end; r++) {
+        if (!sort_keys(task, task->data + r * task->len * task->width, scratch)) {
+            atomic_store(&task->failed, true);
+        }
+    }
+    free(scratch);
+}
+
+/**
+ * Bytes per (key, index) pair for keys of the given width
+ */
+static size_t pair_size(size_t width) {
+    return width == 1 ? sizeof(Pair8) : width == 4 ? sizeof(Pair32) : sizeof(Pair64);
+}
+
+// Argsort one row of keys (pairs and scratch hold len pairs each)
+#define DEFINE_ARGSORT_ROW(T, NAME, PAIR, PNAME)                                     \
+    static bool argsort_row_##NAME(const SortTask* task, const void* pkeys, void* ppairs, \
+                                   void* scratch, int* out) {                        \
+        const T* keys = (const T*)pkeys;                                             \
+        PAIR* pairs = (PAIR*)ppairs;                                                 \
+        size_t n = task->len;                                                        \
+        for (size_t i = 0; i < n; i++) {                                             \
+            pairs[i].key = keys[i];                                                  \
+            pairs[i].index = (int32_t)i;                                             \
+        }                                                                            \
+        if (!task->stable) {                                                         \
+            intro_sort_##PNAME(pairs, n, depth_limit(n));                            \
+        } else if (n >= SORT_RADIX_MIN) {                                            \
+            if (!radix_sort_##PNAME(pairs, (PAIR*)scratch, n)) return false;         \
+        } else {                                                                     \
+            merge_sort_##PNAME(pairs, (PAIR*)scratch, n, NULL);                      \
+        }                                                                            \
+        for (size_t i = 0; i < n; i++) out[i] = pairs[i].index;                      \
+        return true;                                                                 \
+    }
+
+DEFINE_ARGSORT_ROW(uint8_t, u8, Pair8, p8)
+DEFINE_ARGSORT_ROW(uint32_t, u32, Pair32, p32)
+DEFINE_ARGSORT_ROW(uint64_t, u64, Pair64, p64)
+
+static void argsort_rows(size_t begin, size_t end, void* ctx) {
+    SortTask* task = (SortTask*)ctx;
+    size_t size = pair_size(task->width);
+    char* pairs = (char*)malloc(2 * task->len * size);
+    if (!pairs) {
+        atomic_store(&task->failed, true);
+        return;
+    }
+    char* scratch = pairs + task->len * size;
+    for (size_t r = begin; r < end; r++) {
+        const void* keys = task->data + r * task->len * task->width;
+        int* out = task->indices + r * task->len;
+        bool ok;
+        switch (task->width) {
+            case 1: ok = argsort_row_u8(task, keys, pairs, scratch, out); break;
+            case 4: ok = argsort_row_u32(task, keys, pairs, scratch, out); break;
+            default: ok = argsort_row_u64(task, keys, pairs, scratch, out); break;
+        }
+        if (!ok) atomic_store(&task->failed, true);
+    }
+    free(pairs);
+}
+
+static void partition_rows(size_t begin, size_t end, void* ctx) {
+    SortTask* task = (SortTask*)ctx;
+    for (size_t r = begin; r < end; r++) {
+        void* keys = task->data + r * task->len * task->width;
+        switch (task->width) {
+            case 1: intro_select_u8((uint8_t*)keys, task->len, task->kth); break;
+            case 4: intro_select_u32((uint32_t*)keys, task->len, task->kth); break;
+            default: intro_select_u64((uint64_t*)keys, task->len, task->kth); break;
+        }
+    }
+}
+
+//====================
+// Top-k
+//====================
+//
+// Top-k never copies the data: every chunk of it is streamed through the
+// dispatched key filter, and only the elements that pass get a key and index.
+// Small k keep a heap of the k best per chunk, and only elements that beat the
+// heap's worst (as of the start of their block) are tested against it. Large k
+// estimate the key of the k-th best from an even sample, collect everything at
+// least that good, and introselect among those candidates. Either way the k
+// survivors are sorted at the end. Keys of the largest elements are stored
+// inverted, so "best" is always "smallest pair".
+
+// Largest k served by per-chunk heaps
+#define TOPK_HEAP_MAX 1024
+// Elements per filter call
+#define TOPK_BLOCK 1024
+// Sample size for estimating the k-th best key, and extra sample ranks taken
+// on top of the expected one so the estimate rarely falls short
+#define TOPK_SAMPLE 8192
+#define TOPK_SAMPLE_SLACK 32
+
+typedef struct {
+    const char* src;         // dense elements
+    size_t n;
+    size_t k;
+    size_t width;
+    Type type;
+    bool largest;
+    KeyFilterKernelFn filter;
+    size_t chunk;            // elements per scheduling unit
+    void* pairs;             // heaps: k pairs per chunk; candidates: a pair array per chunk
+    size_t* counts;          // pairs found per chunk
+    uint64_t bound;          // candidates: stored keys below this one
+    atomic_bool failed;
+} TopkTask;
+
+/**
+ * Stored key of element i: its sort key, inverted when looking for the largest
+ */
+static uint64_t topk_key(const TopkTask* task, size_t i) {
+    const char* p = task->src + i * task->width;
+    uint64_t key;
+    switch (task->type) {
+        case INT: {
+            int32_t x;
+            memcpy(&x, p, sizeof(x));
+            key = (uint32_t)x ^ 0x80000000u;
+            break;
+        }
+        case FLOAT: {
+            uint32_t bits;
+            memcpy(&bits, p, sizeof(bits));
+            bool nan = (bits & 0x7FFFFFFFu) > 0x7F800000u;
+            key = nan ? UINT32_MAX : bits ^ ((bits >> 31) ? UINT32_MAX : 0x80000000u);
+            break;
+        }
+        case DOUBLE: {
+            uint64_t bits;
+            memcpy(&bits, p, sizeof(bits));
+            bool nan = (bits & 0x7FFFFFFFFFFFFFFFull) > 0x7FF0000000000000ull;
+            key = nan ? UINT64_MAX : bits ^ ((bits >> 63) ? UINT64_MAX : 0x8000000000000000ull);
+            break;
+        }
+        default:
+            key = CHAR_MIN < 0 ? (uint8_t)(*p ^ 0x80) : (uint8_t)*p;
+            break;
+    }
+    if (!task->largest) return key;
+    return task->width == 8 ? ~key : ~key & (((uint64_t)1 << (8 * task->width)) - 1);
+}
+
+/**
+ * Positions among elements [begin, begin + n) whose stored key is below bound
+ */
+static size_t topk_filter(const TopkTask* task, size_t begin, size_t n, uint64_t bound,
+                          uint32_t* positions) {
+    const char* src = task->src + begin * task->width;
+    if (!task->largest) return task->filter(src, n, bound, false, positions);
+    // Stored below bound: sort key above the inverted bound
+    uint64_t mask = task->width == 8 ? UINT64_MAX : ((uint64_t)1 << (8 * task->width)) - 1;
+    return task->filter(src, n, ~bound & mask, true, positions);
+}
+
+#define DEFINE_TOPK(T, NAME, PAIR, PNAME)                                            \
+    static void topk_heaps_##NAME(size_t begin, size_t end, void* ctx) {             \
+        TopkTask* task = (TopkTask*)ctx;                                             \
+        uint32_t positions[TOPK_BLOCK];                                              \
+        size_t k = task->k;                                                          \
+        for (size_t c = begin; c < end; c++) {                                       \
+            PAIR* heap = (PAIR*)task->pairs + c * k;                                 \
+            size_t lo = c * task->chunk;                                             \
+            size_t hi = task->n - lo < task->chunk ? task->n : lo + task->chunk;     \
+            size_t filled = hi - lo < k ? hi - lo : k;                               \
+            for (size_t j = 0; j < filled; j++) {                                    \
+                heap[j].key = (T)topk_key(task, lo + j);                             \
+                heap[j].index = (int32_t)(lo + j);                                   \
+            }                                                                        \
+            task->counts[c] = filled;                                                \
+            make_heap_##PNAME(heap, filled);                                         \
+            for (size_t i = lo + filled; i < hi; i += TOPK_BLOCK) {                  \
+                size_t m = hi - i < TOPK_BLOCK ? hi - i : TOPK_BLOCK;                \
+                size_t hits = topk_filter(task, i, m, heap[0].key, positions);       \
+                for (size_t h = 0; h < hits; h++) {                                  \
+                    PAIR pair;                                                       \
+                    pair.index = (int32_t)(i + positions[h]);                        \
+                    pair.key = (T)topk_key(task, (size_t)pair.index);                \
+                    if (PAIR_LESS(pair, heap[0])) {                                  \
+                        heap[0] = pair;                                              \
+                        sift_down_##PNAME(heap, 0, k);                               \
+                    }                                                                \
+                }                                                                    \
+            }                                                                        \
+        }                                                                            \
+    }                                                                                \
+                                                                                     \
+    static void topk_candidates_##NAME(size_t begin, size_t end, void* ctx) {        \
+        TopkTask* task = (TopkTask*)ctx;                                             \
+        uint32_t positions[TOPK_BLOCK];                                              \
+        for (size_t c = begin; c < end; c++) {                                       \
+            size_t lo = c * task->chunk;                                             \
+            size_t hi = task->n - lo < task->chunk ? task->n : lo + task->chunk;     \
+            PAIR* found = NULL;                                                      \
+            size_t count = 0, capacity = 0;                                          \
+            for (size_t i = lo; i < hi; i += TOPK_BLOCK) {                           \
+                size_t m = hi - i < TOPK_BLOCK ? hi - i : TOPK_BLOCK;                \
+                size_t hits = topk_filter(task, i, m, task->bound, positions);       \
+                if (count + hits > capacity) {                                       \
+                    capacity = 2 * (count + hits);                                   \
+                    PAIR* grown = (PAIR*)realloc(found, capacity * sizeof(PAIR));    \
+                    if (!grown) {                                                    \
+                        atomic_store(&task->failed, true);                           \
+                        break;                                                       \
+                    }                                                                \
+                    found = grown;                                                   \
+                }                                                                    \
+                for (size_t h = 0; h < hits; h++) {                                  \
+                    found[count].index = (int32_t)(i + positions[h]);                \
+                    found[count].key = (T)topk_key(task, (size_t)found[count].index); \
+                    count++;                                                         \
+                }                                                                    \
+            }                                                                        \
+            ((PAIR**)task->pairs)[c] = found;                                        \
+            task->counts[c] = count;                                                 \
+        }                                                                            \
+    }                                                                                \
+                                                                                     \
+    static void topk_all_##NAME(size_t begin, size_t end, void* ctx) {               \
+        TopkTask* task = (TopkTask*)ctx;                                             \
+        PAIR* pairs = (PAIR*)task->pairs;                                            \
+        for (size_t i = begin; i < end; i++) {                                       \
+            pairs[i].key = (T)topk_key(task, i);                                     \
+            pairs[i].index = (int32_t)i;                                             \
+        }                                                                            \
+    }                                                                                \
+                                                                                     \
+    /* Best k of every chunk's heap, gathered at the front of task->pairs */         \
+    static PAIR* topk_by_heaps_##NAME(TopkTask* task, size_t* count) {               \
+        size_t k = task->k;                                                          \
+        task->chunk = parallel_grain(task->width);                                   \
+        if (task->chunk < 16 * k) task->chunk = 16 * k;                              \
+        size_t chunks = (task->n + task->chunk - 1) / task->chunk;                   \
+        PAIR* heaps = (PAIR*)malloc(chunks * k * sizeof(PAIR));                      \
+        task->counts = (size_t*)malloc(chunks * sizeof(size_t));                     \
+        if (!heaps || !task->counts) {                                               \
+            free(heaps);                                                             \
+            return NULL;                                                             \
+        }                                                                            \
+        task->pairs = heaps;                                                         \
+        parallel_for(chunks, 1, topk_heaps_##NAME, task);                            \
+        *count = 0;                                                                  \
+        for (size_t c = 0; c < chunks; c++) {                                        \
+            memmove(heaps + *count, heaps + c * k, task->counts[c] * sizeof(PAIR));  \
+            *count += task->counts[c];                                               \
+        }                                                                            \
+        return heaps;                                                                \
+    }                                                                                \
+                                                                                     \
+    /* Elements at least as good as the sampled estimate of the k-th best; */        \
+    /* *fallback is set when the estimate cannot be used */                          \
+    static PAIR* topk_by_sample_##NAME(TopkTask* task, size_t* count, bool* fallback) { \
+        size_t n = task->n, k = task->k;                                             \
+        size_t s = n < TOPK_SAMPLE ? n : TOPK_SAMPLE;                                \
+        size_t expected = k * s / n;                                                 \
+        size_t rank = expected + expected / 4 + TOPK_SAMPLE_SLACK;                   \
+        *fallback = true;                                                            \
+        if (rank >= s) return NULL;                                                  \
+                                                                                     \
+        T sample[TOPK_SAMPLE];                                                       \
+        for (size_t i = 0; i < s; i++) sample[i] = (T)topk_key(task, i * (n / s));   \
+        intro_select_##NAME(sample, s, rank);                                        \
+        if (sample[rank] == (T)-1) return NULL;                                      \
+        task->bound = (uint64_t)sample[rank] + 1;                                    \
+                                                                                     \
+        task->chunk = parallel_grain(task->width);                                   \
+        size_t chunks = (n + task->chunk - 1) / task->chunk;                         \
+        PAIR** found = (PAIR**)calloc(chunks, sizeof(PAIR*));                        \
+        task->counts = (size_t*)malloc(chunks * sizeof(size_t));                     \
+        if (!found || !task->counts) {                                               \
+            free(found);                                                             \
+            *fallback = false;                                                       \
+            return NULL;                                                             \
+        }                                                                            \
+        task->pairs = found;                                                         \
+        parallel_for(chunks, 1, topk_candidates_##NAME, task);                       \
+                                                                                     \
+        size_t total = 0;                                                            \
+        for (size_t c = 0; c < chunks; c++) total += task->counts[c];                \
+        PAIR* candidates = NULL;                                                     \
+        bool failed = atomic_load(&task->failed);                                    \
+        if (!failed && total >= k) {                                                 \
+            candidates = (PAIR*)malloc(total * sizeof(PAIR));                        \
+            failed = !candidates;                                                    \
+        }                                                                            \
+        *count = 0;                                                                  \
+        for (size_t c = 0; c < chunks; c++) {                                        \
+            if (candidates) memcpy(candidates + *count, found[c], task->counts[c] * sizeof(PAIR)); \
+            *count += task->counts[c];                                               \
+            free(found[c]);                                                          \
+        }                                                                            \
+        free(found);                                                                 \
+        /* Too few candidates: the sample overestimated the k-th best */             \
+        *fallback = !failed && !candidates;                                          \
+        return candidates;                                                           \
+    }                                                                                \
+                                                                                     \
+    static bool topk_##NAME(TopkTask* task, int* out) {                              \
+        size_t k = task->k;                                                          \
+        size_t count = 0;                                                            \
+        bool fallback = false;                                                       \
+        PAIR* pairs = k <= TOPK_HEAP_MAX ? topk_by_heaps_##NAME(task, &count)        \
+                                         : topk_by_sample_##NAME(task, &count, &fallback); \
+        free(task->counts);                                                          \
+        task->counts = NULL;                                                         \
+        if (fallback) {                                                              \
+            pairs = (PAIR*)malloc(task->n * sizeof(PAIR));                           \
+            if (pairs) {                                                             \
+                task->pairs = pairs;                                                 \
+                parallel_for(task->n, parallel_grain(task->width + sizeof(PAIR)), topk_all_##NAME, task); \
+                count = task->n;                                                     \
+            }                                                                        \
+        }                                                                            \
+        if (!pairs) return false;                                                    \
+                                                                                     \
+        intro_select_##PNAME(pairs, count, k - 1);                                   \
+        intro_sort_##PNAME(pairs, k, depth_limit(k));                                \
+        for (size_t i = 0; i < k; i++) out[i] = pairs[i].index;                      \
+        free(pairs);                                                                 \
+        return true;                                                                 \
+    }
+
+DEFINE_TOPK(uint8_t, u8, Pair8, p8)
+DEFINE_TOPK(uint32_t, u32, Pair32, p32)
+DEFINE_TOPK(uint64_t, u64, Pair64, p64)
+
+//====================
+// Public API
+//====================
+
+/**
+ * Sort an array in place along its last axis
+ */
+bool array_sort(Array* array) {
+    if (!array) {
+        fprintf(stderr, "Error: Array cannot be NULL\n");
+        return false;
+    }
+    if (array->type != INT && array->type != FLOAT && array->type != DOUBLE && array->type != CHAR) {
+        fprintf(stderr, "Error: Sorting supports INT, FLOAT, DOUBLE and CHAR arrays\n");
+        return false;
+    }
+    size_t len = array->shape[array->num_dimensions - 1];
+    if (len < 2 || array->count == 0) return true;
+    if (!array_make_writable(array)) return false;
+
+    // Strided arrays are sorted in a dense copy and written back
+    Array* staged;
+    const Array* target = array_contiguous(array, &staged);
+    if (!target) return false;
+
+    SortTask task = { 0 };
+    task.data = (char*)array_data(target);
+    task.len = len;
+    task.rows = array->count / len;
+    task.width = array->sizeof_type;
+    task.type = array->type;
+    task.block = get_kernel(KERNEL_SORT_BLOCK, array->type).sort;
+    atomic_init(&task.failed, false);
+
+    size_t grain = parallel_grain(2 * task.width);
+    parallel_for(array->count, grain, encode_keys, &task);
+    // A single row keeps the pool for its radix passes
+    if (task.rows == 1) sort_rows(0, 1, &task);
+    else parallel_for(task.rows, parallel_grain(2 * len * task.width), sort_rows, &task);
+    parallel_for(array->count, grain, decode_keys, &task);
+
+    bool ok = !atomic_load(&task.failed);
+    if (!ok) fprintf(stderr, "Error: Failed to allocate memory for sorting\n");
+    if (staged) {
+        // A failed row is still a permutation of its elements, so the data stays intact
+        array_scatter(array, array_data(staged));
+        array_free(staged);
+    }
+    return ok;
+}
+
+/**
+ * Indices that sort an array along its last axis
+ */
+Array* array_argsort(const Array* array, bool stable) {
+    if (!array) {
+        fprintf(stderr, "Error: Array cannot be NULL\n");
+        return NULL;
+    }
+    if (array->type != INT && array->type != FLOAT && array->type != DOUBLE && array->type != CHAR) {
+        fprintf(stderr, "Error: Sorting supports INT, FLOAT, DOUBLE and CHAR arrays\n");
+        return NULL;
+    }
+    size_t len = array->shape[array->num_dimensions - 1];
+    if (len > INT_MAX) {
+        fprintf(stderr, "Error: Rows of %zu elements are too long for INT indices\n", len);
+        return NULL;
+    }
+
+    Array* out = array_empty(array->count, INT, false);
+    if (!out) return NULL;
+    if (!array_set_shape(out, array->shape, array->num_dimensions)) {
+        array_free(out);
+        return NULL;
+    }
+    if (array->count == 0) return out;
+
+    // Keys are encoded in a private dense copy
+    Array* keys = array_copy((Array*)array, false);
+    if (!keys || !array_make_writable(keys)) {
+        array_free(keys);
+        array_free(out);
+        return NULL;
+    }
+
+    SortTask task = { 0 };
+    task.data = (char*)array_data(keys);
+    task.len = len;
+    task.rows = array->count / len;
+    task.width = array->sizeof_type;
+    task.type = array->type;
+    task.indices = (int*)array_data(out);
+    task.stable = stable;
+    atomic_init(&task.failed, false);
+
+    parallel_for(array->count, parallel_grain(2 * task.width), encode_keys, &task);
+    // A single row keeps the pool for its radix passes
+    if (task.rows == 1) argsort_rows(0, 1, &task);
+    else parallel_for(task.rows, parallel_grain(3 * len * pair_size(task.width)), argsort_rows, &task);
+    array_free(keys);
+
+    if (atomic_load(&task.failed)) {
+        fprintf(stderr, "Error: Failed to allocate memory for sorting\n");
+        array_free(out);
+        return NULL;
+    }
+    return out;
+}
+
+/**
+ * Partially sort an array in place along its last axis around position kth
+ */
+bool array_partition(Array* array, size_t kth) {
+    if (!array) {
+        fprintf(stderr, "Error: Array cannot be NULL\n");
+        return false;
+    }
+    if (array->type != INT && array->type != FLOAT && array->type != DOUBLE && array->type != CHAR) {
+        fprintf(stderr, "Error: Partitioning supports INT, FLOAT, DOUBLE and CHAR arrays\n");
+        return false;
+    }
+    size_t len = array->shape[array->num_dimensions - 1];
+    if (array->count == 0) return true;
+    if (kth >= len) {
+        fprintf(stderr, "Error: kth %zu is out of range for rows of %zu\n", kth, len);
+        return false;
+    }
+    if (!array_make_writable(array)) return false;
+
+    Array* staged;
+    const Array* target = array_contiguous(array, &staged);
+    if (!target) return false;
+
+    SortTask task = { 0 };
+    task.data = (char*)array_data(target);
+    task.len = len;
+    task.rows = array->count / len;
+    task.width = array->sizeof_type;
+    task.type = array->type;
+    task.kth = kth;
+    atomic_init(&task.failed, false);
+
+    size_t grain = parallel_grain(2 * task.width);
+    parallel_for(array->count, grain, encode_keys, &task);
+    parallel_for(task.rows, parallel_grain(len * task.width), partition_rows, &task);
+    parallel_for(array->count, grain, decode_keys, &task);
+
+    if (staged) {
+        array_scatter(array, array_data(staged));
+        array_free(staged);
+    }
+    return true;
+}
+
+/**
+ * Flat indices of the k largest or smallest elements, best first
+ */
+Array* array_topk(const Array* array, size_t k, bool largest) {
+    if (!array) {
+        fprintf(stderr, "Error: Array cannot be NULL\n");
+        return NULL;
+    }
+    if (array->type != INT && array->type != FLOAT && array->type != DOUBLE && array->type != CHAR) {
+        fprintf(stderr, "Error: Top-k supports INT, FLOAT, DOUBLE and CHAR arrays\n");
+        return NULL;
+    }
+    if (k > array->count) {
+        fprintf(stderr, "Error: k = %zu exceeds the %zu elements\n", k, array->count);
+        return NULL;
+    }
+    if (array->count > INT_MAX) {
+        fprintf(stderr, "Error: Arrays of %zu elements are too long for INT indices\n", array->count);
+        return NULL;
+    }
+
+    Array* out = array_empty(k, INT, false);
+    if (!out || k == 0) return out;
+
+    Array* owned;
+    const Array* src = array_contiguous(array, &owned);
+    if (!src) {
+        array_free(out);
+        return NULL;
+    }
+
+    TopkTask task = { 0 };
+    task.src = (const char*)array_data(src);
+    task.n = array->count;
+    task.k = k;
+    task.width = array->sizeof_type;
+    task.type = array->type;
+    task.largest = largest;
+    task.filter = get_kernel(KERNEL_KEY_FILTER, array->type).key_filter;
+    atomic_init(&task.failed, false);
+
+    int* indices = (int*)array_data(out);
+    bool ok;
+    switch (task.width) {
+        case 1: ok = topk_u8(&task, indices); break;
+        case 4: ok = topk_u32(&task, indices); break;
+        default: ok = topk_u64(&task, indices); break;
+    }
+    array_free(owned);
+
+    if (!ok) {
+        fprintf(stderr, "Error: Failed to allocate memory for top-k\n");
+        array_free(out);
+        return NULL;
+    }
+    return out;
+}
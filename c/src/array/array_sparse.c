@@ -0,0 +1,602 @@
+/**
+ * array_sparse.c - COO, CSR and CSC sparse matrices and sparse-dense products
+ *
+ * Dense matrices are scanned in two passes over their rows, like selection:
+ * count the nonzeros of every row, turn the counts into row offsets, then
+ * compact each row straight to its offset with the compare and compress
+ * kernels. Conversions to CSR and CSC are two stable counting sorts (by the
+ * minor index, then the major one), which leaves every row or column sorted,
+ * followed by a pass that adds up repeated positions.
+ *
+ * Products work on CSR rows, which are independent and run on the thread
+ * pool. SpMV gathers, multiplies and sums runs of up to SPARSE_CHUNK entries
+ * at a time across row boundaries, so short rows do not pay a kernel call
+ * each for the gather and the multiply.
+ */
+
+#include "../../include/array/array_sparse.h"
+#include "../../include/array/array_view.h"
+#include "../../include/runtime/runtime_dispatch.h"
+#include "../../include/runtime/parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+// Entries (or columns) handled per kernel call, sized to stay in L1
+#define SPARSE_CHUNK 1024
+
+// Output columns kept in L1 while a row of SpMM accumulates
+#define SPMM_TILE 512
+
+typedef struct {
+    const SparseArray* sparse;
+    const char* src;         // dense rows (from_dense), x (SpMV) or B (SpMM)
+    char* dst;
+    size_t* offsets;         // per row: nonzero count, then offset (from_dense)
+    size_t n;                // columns of B and of the output (SpMM)
+    size_t size;             // element size
+    size_t prefetch;
+    Kernel compare;
+    Kernel reduce;           // SUM on BOOL counts nonzeros, SUM of the type adds products
+    Kernel compress;         // values of the type
+    Kernel compress_columns; // INT column indices
+    Kernel take;
+    Kernel mul;
+    Kernel fill;
+    Kernel fma;
+    Kernel iota;
+    Kernel put;
+} SparseTask;
+
+/**
+ * Prefetch distance for gathers from `bytes` of indexed data
+ */
+static size_t prefetch_distance(size_t bytes) {
+    // parallel_grain(1) is the L2 size: below it random accesses mostly hit
+    return bytes > parallel_grain(1) ? get_gather_prefetch_distance() : 0;
+}
+
+/**
+ * Sparse matrix with room for nnz entries in the given format
+ */
+static SparseArray* sparse_alloc(SparseFormat format, Type type, size_t rows, size_t cols, size_t nnz) {
+    SparseArray* sparse = (SparseArray*)calloc(1, sizeof(SparseArray));
+    if (!sparse) {
+        fprintf(stderr, "Error: Failed to allocate memory for sparse matrix\n");
+        return NULL;
+    }
+    sparse->format = format;
+    sparse->type = type;
+    sparse->rows = rows;
+    sparse->cols = cols;
+    sparse->nnz = nnz;
+
+    size_t entries = nnz > 0 ? nnz : 1;
+    sparse->values = malloc(entries * array_sizeof_type(type));
+    bool ok = sparse->values != NULL;
+    if (format != SPARSE_CSR) {
+        sparse->row_indices = (int*)malloc(entries * sizeof(int));
+        ok = ok && sparse->row_indices;
+    }
+    if (format != SPARSE_CSC) {
+        sparse->col_indices = (int*)malloc(entries * sizeof(int));
+        ok = ok && sparse->col_indices;
+    }
+    if (format != SPARSE_COO) {
+        sparse->offsets = (size_t*)malloc(((format == SPARSE_CSR ? rows : cols) + 1) * sizeof(size_t));
+        ok = ok && sparse->offsets;
+    }
+    if (!ok) {
+        fprintf(stderr, "Error: Failed to allocate memory for sparse matrix\n");
+        array_sparse_free(sparse);
+        return NULL;
+    }
+    return sparse;
+}
+
+/**
+ * Free a sparse matrix
+ */
+void array_sparse_free(SparseArray* sparse) {
+    if (!sparse) return;
+    free(sparse->values);
+    free(sparse->row_indices);
+    free(sparse->col_indices);
+    free(sparse->offsets);
+    free(sparse);
+}
+
+//====================
+// Conversions
+//====================
+
+/**
+ * Index of every entry's group, expanded from group offsets
+ */
+static int* expand_offsets(const size_t* offsets, size_t groups, size_t nnz) {
+    int* indices = (int*)malloc((nnz > 0 ? nnz : 1) * sizeof(int));
+    if (!indices) {
+        fprintf(stderr, "Error: Failed to allocate memory for sparse conversion\n");
+        return NULL;
+    }
+    for (size_t g = 0; g < groups; g++) {
+        for (size_t k = offsets[g]; k < offsets[g + 1]; k++) indices[k] = (int)g;
+    }
+    return indices;
+}
+
+/**
+ * Stable counting sort of order[0..nnz) by key, into sorted
+ */
+static bool counting_sort(const size_t* order, const int* key, size_t nnz, size_t key_count, size_t* sorted,
+                          size_t* starts) {
+    memset(starts, 0, (key_count + 1) * sizeof(size_t));
+    for (size_t k = 0; k < nnz; k++) starts[key[k] + 1]++;
+    for (size_t g = 0; g < key_count; g++) starts[g + 1] += starts[g];
+    size_t* next = (size_t*)malloc((key_count > 0 ? key_count : 1) * sizeof(size_t));
+    if (!next) return false;
+    memcpy(next, starts, key_count * sizeof(size_t));
+    for (size_t t = 0; t < nnz; t++) {
+        size_t k = order ? order[t] : t;
+        sorted[next[key[k]]++] = k;
+    }
+    free(next);
+    return true;
+}
+
+/**
+ * CSR (by_row) or CSC from entries in any order: entries are grouped by their
+ * major index and sorted by their minor one, and repeated positions are added
+ */
+static SparseArray* compress_entries(const SparseArray* src, const int* rows, const int* cols, bool by_row) {
+    const int* major = by_row ? rows : cols;
+    const int* minor = by_row ? cols : rows;
+    size_t major_count = by_row ? src->rows : src->cols;
+    size_t minor_count = by_row ? src->cols : src->rows;
+    size_t nnz = src->nnz;
+
+    SparseArray* out = sparse_alloc(by_row ? SPARSE_CSR : SPARSE_CSC, src->type, src->rows, src->cols, nnz);
+    size_t* by_minor = (size_t*)malloc((nnz > 0 ? nnz : 1) * sizeof(size_t));
+    size_t* order = (size_t*)malloc((nnz > 0 ? nnz : 1) * sizeof(size_t));
+    size_t* starts = (size_t*)malloc(((major_count > minor_count ? major_count : minor_count) + 1) * sizeof(size_t));
+    bool ok = out && by_minor && order && starts &&
+              counting_sort(NULL, minor, nnz, minor_count, by_minor, starts) &&
+              counting_sort(by_minor, major, nnz, major_count, order, starts);
+    if (!ok) {
+        if (out) fprintf(stderr, "Error: Failed to allocate memory for sparse conversion\n");
+        array_sparse_free(out);
+        out = NULL;
+    } else {
+        // starts now holds the group offsets before merging
+        int* out_minor = by_row ? out->col_indices : out->row_indices;
+        size_t written = 0;
+        for (size_t g = 0; g < major_count; g++) {
+            out->offsets[g] = written;
+            for (size_t t = starts[g]; t < starts[g + 1]; t++) {
+                size_t k = order[t];
+                if (written > out->offsets[g] && out_minor[written - 1] == minor[k]) {
+                    if (src->type == FLOAT) ((float*)out->values)[written - 1] += ((const float*)src->values)[k];
+                    else ((double*)out->values)[written - 1] += ((const double*)src->values)[k];
+                    continue;
+                }
+                out_minor[written] = minor[k];
+                if (src->type == FLOAT) ((float*)out->values)[written] = ((const float*)src->values)[k];
+                else ((double*)out->values)[written] = ((const double*)src->values)[k];
+                written++;
+            }
+        }
+        out->offsets[major_count] = written;
+        out->nnz = written;
+    }
+    free(by_minor);
+    free(order);
+    free(starts);
+    return out;
+}
+
+/**
+ * Deep copy in the same format
+ */
+static SparseArray* sparse_copy(const SparseArray* sparse) {
+    SparseArray* out = sparse_alloc(sparse->format, sparse->type, sparse->rows, sparse->cols, sparse->nnz);
+    if (!out) return NULL;
+    memcpy(out->values, sparse->values, sparse->nnz * array_sizeof_type(sparse->type));
+    if (sparse->row_indices) memcpy(out->row_indices, sparse->row_indices, sparse->nnz * sizeof(int));
+    if (sparse->col_indices) memcpy(out->col_indices, sparse->col_indices, sparse->nnz * sizeof(int));
+    if (sparse->offsets) {
+        size_t groups = sparse->format == SPARSE_CSR ? sparse->rows : sparse->cols;
+        memcpy(out->offsets, sparse->offsets, (groups + 1) * sizeof(size_t));
+    }
+    return out;
+}
+
+/**
+ * Copy a sparse matrix into another format
+ */
+SparseArray* array_sparse_convert(const SparseArray* sparse, SparseFormat format) {
+    if (!sparse) {
+        fprintf(stderr, "Error: Sparse matrix cannot be NULL\n");
+        return NULL;
+    }
+    if (sparse->format == format) return sparse_copy(sparse);
+
+    // Row and column of every entry
+    int* owned = NULL;
+    const int* rows = sparse->row_indices;
+    const int* cols = sparse->col_indices;
+    if (sparse->format == SPARSE_CSR) rows = owned = expand_offsets(sparse->offsets, sparse->rows, sparse->nnz);
+    if (sparse->format == SPARSE_CSC) cols = owned = expand_offsets(sparse->offsets, sparse->cols, sparse->nnz);
+    if (!rows || !cols) return NULL;
+
+    SparseArray* out;
+    if (format == SPARSE_COO) {
+        out = sparse_alloc(SPARSE_COO, sparse->type, sparse->rows, sparse->cols, sparse->nnz);
+        if (out) {
+            memcpy(out->values, sparse->values, sparse->nnz * array_sizeof_type(sparse->type));
+            memcpy(out->row_indices, rows, sparse->nnz * sizeof(int));
+            memcpy(out->col_indices, cols, sparse->nnz * sizeof(int));
+        }
+    } else {
+        out = compress_entries(sparse, rows, cols, format == SPARSE_CSR);
+    }
+    free(owned);
+    return out;
+}
+
+//====================
+// Construction
+//====================
+
+static void count_nonzeros(size_t begin, size_t end, void* ctx) {
+    SparseTask* task = (SparseTask*)ctx;
+    size_t cols = task->sparse->cols;
+    _Alignas(64) unsigned char zeros[SPARSE_CHUNK * sizeof(double)] = { 0 };
+    bool mask[SPARSE_CHUNK];
+    for (size_t r = begin; r < end; r++) {
+        size_t count = 0;
+        for (size_t c = 0; c < cols; c += SPARSE_CHUNK) {
+            size_t m = cols - c < SPARSE_CHUNK ? cols - c : SPARSE_CHUNK;
+            double nonzero;
+            task->compare.compare(task->src + (r * cols + c) * task->size, zeros, mask, m, CMP_NE);
+            task->reduce.reduce(mask, m, &nonzero);
+            count += (size_t)nonzero;
+        }
+        task->offsets[r] = count;
+    }
+}
+
+static void compress_rows(size_t begin, size_t end, void* ctx) {
+    SparseTask* task = (SparseTask*)ctx;
+    SparseArray* sparse = (SparseArray*)task->sparse;
+    size_t cols = sparse->cols;
+    _Alignas(64) unsigned char zeros[SPARSE_CHUNK * sizeof(double)] = { 0 };
+    bool mask[SPARSE_CHUNK];
+    int columns[SPARSE_CHUNK];
+    for (size_t r = begin; r < end; r++) {
+        size_t k = sparse->offsets[r];
+        for (size_t c = 0; c < cols; c += SPARSE_CHUNK) {
+            size_t m = cols - c < SPARSE_CHUNK ? cols - c : SPARSE_CHUNK;
+            const char* row = task->src + (r * cols + c) * task->size;
+            task->compare.compare(row, zeros, mask, m, CMP_NE);
+            task->compress.compress(row, mask, (char*)sparse->values + k * task->size, m);
+            task->iota.iota(columns, (double)c, 1.0, m);
+            k += task->compress_columns.compress(columns, mask, sparse->col_indices + k, m);
+        }
+    }
+}
+
+/**
+ * Sparse copy of the nonzero elements of a matrix
+ */
+SparseArray* array_sparse_from_dense(const Array* matrix, SparseFormat format) {
+    if (!matrix) {
+        fprintf(stderr, "Error: Array cannot be NULL\n");
+        return NULL;
+    }
+    if (matrix->type != FLOAT && matrix->type != DOUBLE) {
+        fprintf(stderr, "Error: Sparse matrices support FLOAT and DOUBLE arrays\n");
+        return NULL;
+    }
+    if (matrix->num_dimensions != 2 || matrix->shape[0] > INT_MAX || matrix->shape[1] > INT_MAX) {
+        fprintf(stderr, "Error: Sparse matrices need 2-D arrays of at most INT_MAX rows and columns\n");
+        return NULL;
+    }
+    Array* owned;
+    const Array* m = array_contiguous(matrix, &owned);
+    if (!m) return NULL;
+
+    size_t rows = m->shape[0];
+    SparseArray shape = { .format = SPARSE_CSR, .type = m->type, .rows = rows, .cols = m->shape[1] };
+    SparseTask task = { 0 };
+    task.sparse = &shape;
+    task.src = (const char*)array_data(m);
+    task.size = m->sizeof_type;
+    task.compare = get_kernel(KERNEL_COMPARE, m->type);
+    task.reduce = get_kernel(KERNEL_SUM, BOOL);
+    task.offsets = (size_t*)malloc((rows + 1) * sizeof(size_t));
+    if (!task.offsets) {
+        fprintf(stderr, "Error: Failed to allocate memory for sparse matrix\n");
+        array_free(owned);
+        return NULL;
+    }
+
+    // Counting first sizes the entries exactly
+    size_t grain = parallel_grain(shape.cols * task.size);
+    parallel_for(rows, grain, count_nonzeros, &task);
+    size_t nnz = 0;
+    for (size_t r = 0; r < rows; r++) {
+        size_t count = task.offsets[r];
+        task.offsets[r] = nnz;
+        nnz += count;
+    }
+    task.offsets[rows] = nnz;
+
+    SparseArray* csr = sparse_alloc(SPARSE_CSR, m->type, rows, shape.cols, nnz);
+    if (csr) {
+        memcpy(csr->offsets, task.offsets, (rows + 1) * sizeof(size_t));
+        task.sparse = csr;
+        task.compress = get_kernel(KERNEL_COMPRESS, m->type);
+        task.compress_columns = get_kernel(KERNEL_COMPRESS, INT);
+        task.iota = get_kernel(KERNEL_IOTA, INT);
+        parallel_for(rows, grain, compress_rows, &task);
+    }
+    free(task.offsets);
+    array_free(owned);
+
+    if (!csr || format == SPARSE_CSR) return csr;
+    SparseArray* out = array_sparse_convert(csr, format);
+    array_sparse_free(csr);
+    return out;
+}
+
+/**
+ * Sparse matrix from (row, column, value) triplets
+ */
+SparseArray* array_sparse_from_triplets(size_t rows, size_t cols, const Array* row_indices,
+                                        const Array* col_indices, const Array* values, SparseFormat format) {
+    if (!row_indices || !col_indices || !values) {
+        fprintf(stderr, "Error: Triplet arrays cannot be NULL\n");
+        return NULL;
+    }
+    if (row_indices->type != INT || col_indices->type != INT) {
+        fprintf(stderr, "Error: Indices must be an INT array\n");
+        return NULL;
+    }
+    if (values->type != FLOAT && values->type != DOUBLE) {
+        fprintf(stderr, "Error: Sparse matrices support FLOAT and DOUBLE arrays\n");
+        return NULL;
+    }
+    if (col_indices->count != row_indices->count || values->count != row_indices->count) {
+        fprintf(stderr, "Error: Triplet arrays must have the same length\n");
+        return NULL;
+    }
+    if (rows > INT_MAX || cols > INT_MAX) {
+        fprintf(stderr, "Error: Sparse matrices have at most INT_MAX rows and columns\n");
+        return NULL;
+    }
+
+    Array *owned_rows, *owned_cols, *owned_values;
+    const Array* r = array_contiguous(row_indices, &owned_rows);
+    const Array* c = array_contiguous(col_indices, &owned_cols);
+    const Array* v = array_contiguous(values, &owned_values);
+    size_t nnz = row_indices->count;
+    SparseArray* coo = r && c && v ? sparse_alloc(SPARSE_COO, values->type, rows, cols, nnz) : NULL;
+    if (coo) {
+        memcpy(coo->row_indices, array_data(r), nnz * sizeof(int));
+        memcpy(coo->col_indices, array_data(c), nnz * sizeof(int));
+        memcpy(coo->values, array_data(v), nnz * values->sizeof_type);
+        for (size_t k = 0; k < nnz; k++) {
+            int row = coo->row_indices[k], col = coo->col_indices[k];
+            if (row < 0 || (size_t)row >= rows || col < 0 || (size_t)col >= cols) {
+                fprintf(stderr, "Error: Entry (%d, %d) is out of bounds for shape (%zu, %zu)\n", row, col, rows, cols);
+                array_sparse_free(coo);
+                coo = NULL;
+                break;
+            }
+        }
+    }
+    array_free(owned_rows);
+    array_free(owned_cols);
+    array_free(owned_values);
+
+    if (!coo || format == SPARSE_COO) return coo;
+    SparseArray* out = array_sparse_convert(coo, format);
+    array_sparse_free(coo);
+    return out;
+}
+
+//====================
+// Dense results
+//====================
+
+/**
+ * CSR version of a sparse matrix (the matrix itself when already CSR)
+ */
+static const SparseArray* as_csr(const SparseArray* sparse, SparseArray** owned) {
+    *owned = NULL;
+    if (sparse->format == SPARSE_CSR) return sparse;
+    *owned = array_sparse_convert(sparse, SPARSE_CSR);
+    return *owned;
+}
+
+static void scatter_rows(size_t begin, size_t end, void* ctx) {
+    SparseTask* task = (SparseTask*)ctx;
+    const SparseArray* a = task->sparse;
+    for (size_t r = begin; r < end; r++) {
+        size_t k = a->offsets[r];
+        task->put.put(task->dst + r * a->cols * task->size, a->col_indices + k,
+                      (const char*)a->values + k * task->size, a->offsets[r + 1] - k, 0);
+    }
+}
+
+/**
+ * Dense copy of a sparse matrix
+ */
+Array* array_sparse_to_dense(const SparseArray* sparse) {
+    if (!sparse) {
+        fprintf(stderr, "Error: Sparse matrix cannot be NULL\n");
+        return NULL;
+    }
+    SparseArray* owned;
+    const SparseArray* a = as_csr(sparse, &owned);
+    if (!a) return NULL;
+
+    Array* out = array_zeros(a->rows * a->cols, a->type, false);
+    if (out && !array_set_shape(out, (size_t[]){ a->rows, a->cols }, 2)) {
+        array_free(out);
+        out = NULL;
+    }
+    if (out && a->nnz > 0) {
+        SparseTask task = { 0 };
+        task.sparse = a;
+        task.dst = (char*)out->parray;
+        task.size = out->sizeof_type;
+        task.put = get_kernel(KERNEL_PUT, a->type);
+        parallel_for(a->rows, parallel_grain(a->cols * task.size), scatter_rows, &task);
+    }
+    array_sparse_free(owned);
+    return out;
+}
+
+/**
+ * Store a double into element i of an array of the task's type
+ */
+static void store_result(SparseTask* task, size_t i, double value) {
+    if (task->sparse->type == FLOAT) ((float*)task->dst)[i] = (float)value;
+    else ((double*)task->dst)[i] = value;
+}
+
+static void spmv_rows(size_t begin, size_t end, void* ctx) {
+    SparseTask* task = (SparseTask*)ctx;
+    const SparseArray* a = task->sparse;
+    _Alignas(64) unsigned char products[SPARSE_CHUNK * sizeof(double)];
+    size_t row = begin;
+    double acc = 0.0;
+    size_t last = a->offsets[end];
+    for (size_t k = a->offsets[begin]; k < last; k += SPARSE_CHUNK) {
+        size_t m = last - k < SPARSE_CHUNK ? last - k : SPARSE_CHUNK;
+        task->take.take(task->src, a->col_indices + k, products, m, task->prefetch);
+        task->mul.binary((const char*)a->values + k * task->size, products, products, m);
+        // Sum the products row by row; a row may continue into the next run
+        size_t pos = k;
+        while (pos < k + m) {
+            size_t stop = a->offsets[row + 1] < k + m ? a->offsets[row + 1] : k + m;
+            if (stop > pos) {
+                double part;
+                task->reduce.reduce(products + (pos - k) * task->size, stop - pos, &part);
+                acc += part;
+                pos = stop;
+            }
+            if (pos == a->offsets[row + 1]) {
+                store_result(task, row++, acc);
+                acc = 0.0;
+            }
+        }
+    }
+    // Rows after the last entry of the range are empty
+    for (; row < end; row++) store_result(task, row, 0.0);
+}
+
+/**
+ * Sparse matrix times dense vector
+ */
+Array* array_sparse_matvec(const SparseArray* a, const Array* x) {
+    if (!a || !x) {
+        fprintf(stderr, "Error: Operands cannot be NULL\n");
+        return NULL;
+    }
+    if (x->type != a->type) {
+        fprintf(stderr, "Error: Operand types must match\n");
+        return NULL;
+    }
+    if (x->num_dimensions != 1 || x->count != a->cols) {
+        fprintf(stderr, "Error: Vector length must match the matrix columns\n");
+        return NULL;
+    }
+
+    SparseArray* owned_a;
+    Array* owned_x;
+    const SparseArray* csr = as_csr(a, &owned_a);
+    const Array* v = csr ? array_contiguous(x, &owned_x) : NULL;
+    Array* out = v ? array_empty(a->rows, a->type, false) : NULL;
+    if (out && a->rows > 0) {
+        SparseTask task = { 0 };
+        task.sparse = csr;
+        task.src = (const char*)array_data(v);
+        task.dst = (char*)out->parray;
+        task.size = out->sizeof_type;
+        task.prefetch = prefetch_distance(a->cols * task.size);
+        task.take = get_kernel(KERNEL_TAKE, a->type);
+        task.mul = get_kernel(KERNEL_MUL, a->type);
+        task.reduce = get_kernel(KERNEL_SUM, a->type);
+        size_t per_row = csr->nnz / a->rows + 1;
+        parallel_for(a->rows, parallel_grain(per_row * (task.size + sizeof(int))), spmv_rows, &task);
+    }
+    if (csr) array_free(owned_x);
+    array_sparse_free(owned_a);
+    return out;
+}
+
+static void spmm_rows(size_t begin, size_t end, void* ctx) {
+    SparseTask* task = (SparseTask*)ctx;
+    const SparseArray* a = task->sparse;
+    size_t size = task->size;
+    _Alignas(64) unsigned char scaled[SPMM_TILE * sizeof(double)];
+    for (size_t r = begin; r < end; r++) {
+        for (size_t t = 0; t < task->n; t += SPMM_TILE) {
+            size_t m = task->n - t < SPMM_TILE ? task->n - t : SPMM_TILE;
+            char* out = task->dst + (r * task->n + t) * size;
+            for (size_t k = a->offsets[r]; k < a->offsets[r + 1]; k++) {
+                // out += value * B[column, t:t + m]
+                const char* b = task->src + ((size_t)a->col_indices[k] * task->n + t) * size;
+                task->fill.fill(scaled, (const char*)a->values + k * size, m);
+                task->fma.fma(scaled, b, out, out, m);
+            }
+        }
+    }
+}
+
+/**
+ * Sparse matrix times dense matrix
+ */
+Array* array_sparse_matmul(const SparseArray* a, const Array* b) {
+    if (!a || !b) {
+        fprintf(stderr, "Error: Operands cannot be NULL\n");
+        return NULL;
+    }
+    if (b->type != a->type) {
+        fprintf(stderr, "Error: Operand types must match\n");
+        return NULL;
+    }
+    if (b->num_dimensions != 2 || b->shape[0] != a->cols) {
+        fprintf(stderr, "Error: Matrix shapes do not align\n");
+        return NULL;
+    }
+
+    SparseArray* owned_a;
+    Array* owned_b;
+    const SparseArray* csr = as_csr(a, &owned_a);
+    const Array* m = csr ? array_contiguous(b, &owned_b) : NULL;
+    size_t n = b->shape[1];
+    Array* out = m ? array_zeros(a->rows * n, a->type, false) : NULL;
+    if (out && !array_set_shape(out, (size_t[]){ a->rows, n }, 2)) {
+        array_free(out);
+        out = NULL;
+    }
+    if (out && csr->nnz > 0 && n > 0) {
+        SparseTask task = { 0 };
+        task.sparse = csr;
+        task.src = (const char*)array_data(m);
+        task.dst = (char*)out->parray;
+        task.n = n;
+        task.size = out->sizeof_type;
+        task.fill = get_kernel(KERNEL_FILL, a->type);
+        task.fma = get_kernel(KERNEL_FMA, a->type);
+        size_t per_row = csr->nnz / a->rows + 1;
+        parallel_for(a->rows, parallel_grain(per_row * n * task.size), spmm_rows, &task);
+    }
+    if (csr) array_free(owned_b);
+    array_sparse_free(owned_a);
+    return out;
+}
@@ -0,0 +1,308 @@
+/**
+ * array_string.c - STRING arrays stored as offsets plus one byte blob
+ *
+ * Element k of the buffer is the NUL-terminated string at
+ * strings + offsets[k]; offsets[k + 1] is where the next one starts. Arrays
+ * built here always have non-decreasing offsets, which lets substring search
+ * run memchr/memcmp over the whole blob and map each hit back to its element
+ * by walking the offsets forward.
+ */
+
+#include "../../include/array/array_string.h"
+#include "../../include/utils/memory.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+static int64_t* string_offsets(const Array* array) {
+    return (int64_t*)array_root(array)->parray;
+}
+
+static const char* string_blob(const Array* array) {
+    return array_root(array)->strings;
+}
+
+/**
+ * Buffer slot of flat element i (views may be strided)
+ */
+static size_t string_slot(const Array* array, size_t i) {
+    ptrdiff_t slot = (ptrdiff_t)array->offset;
+    for (size_t d = array->num_dimensions; d-- > 0;) {
+        slot += (ptrdiff_t)(i % array->shape[d]) * array->strides[d];
+        i /= array->shape[d];
+    }
+    return (size_t)slot;
+}
+
+/**
+ * Bytes of slot k including its NUL (0 for unset elements)
+ */
+static size_t string_bytes(const Array* array, size_t k) {
+    const int64_t* offsets = string_offsets(array);
+    return (size_t)(offsets[k + 1] - offsets[k]);
+}
+
+/**
+ * STRING array with zeroed offsets and an uninitialized blob
+ */
+static Array* string_alloc(size_t count, size_t blob_bytes, bool is_dynamic) {
+    Array* array = array_create(count, STRING, is_dynamic);
+    if (!array) return NULL;
+
+    if (blob_bytes > 0) {
+        array->strings = (char*)memory_buffer_alloc(blob_bytes, false);
+        if (!array->strings) {
+            fprintf(stderr, "Error: Failed to allocate memory for string data\n");
+            array_free(array);
+            return NULL;
+        }
+        array->strings_size = blob_bytes;
+        array->buffer->strings = array->strings;
+        array->buffer->strings_size = blob_bytes;
+    }
+    return array;
+}
+
+/**
+ * Create a STRING array from C strings
+ */
+Array* array_from_strings(const char* const* strings, size_t count, bool is_dynamic) {
+    if (!strings && count > 0) {
+        fprintf(stderr, "Error: Strings cannot be NULL\n");
+        return NULL;
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += (strings[i] ? strlen(strings[i]) : 0) + 1;
+    }
+
+    Array* array = string_alloc(count, total, is_dynamic);
+    if (!array) return NULL;
+
+    int64_t* offsets = string_offsets(array);
+    size_t pos = 0;
+    for (size_t i = 0; i < count; i++) {
+        const char* str = strings[i] ? strings[i] : "";
+        size_t len = strlen(str) + 1;
+        offsets[i] = (int64_t)pos;
+        memcpy(array->strings + pos, str, len);
+        pos += len;
+    }
+    offsets[count] = (int64_t)pos;
+    return array;
+}
+
+/**
+ * Create a STRING array repeating one value
+ */
+Array* array_string_full(size_t size, const char* value, bool is_dynamic) {
+    if (!value) {
+        fprintf(stderr, "Error: String value cannot be NULL\n");
+        return NULL;
+    }
+
+    size_t len = strlen(value) + 1;
+    if (size > 0 && len > SIZE_MAX / size) {
+        fprintf(stderr, "Error: String data size overflows size_t\n");
+        return NULL;
+    }
+
+    Array* array = string_alloc(size, size * len, is_dynamic);
+    if (!array) return NULL;
+
+    // Double the filled prefix until the blob is full
+    size_t total = size * len;
+    if (total > 0) {
+        memcpy(array->strings, value, len);
+        for (size_t filled = len; filled < total;) {
+            size_t n = filled < total - filled ? filled : total - filled;
+            memcpy(array->strings + filled, array->strings, n);
+            filled += n;
+        }
+    }
+
+    int64_t* offsets = string_offsets(array);
+    for (size_t i = 0; i <= size; i++) {
+        offsets[i] = (int64_t)(i * len);
+    }
+    return array;
+}
+
+/**
+ * Copy a STRING array into a compact blob
+ */
+Array* array_string_copy(const Array* source, bool is_dynamic) {
+    if (!source || source->type != STRING) {
+        fprintf(stderr, "Error: Source must be a STRING array\n");
+        return NULL;
+    }
+
+    size_t count = source->count;
+    const int64_t* src_offsets = string_offsets(source);
+    Array* array;
+
+    if (array_is_contiguous(source)) {
+        // One range of the blob: two memcpys, rebased if the view starts mid-blob
+        int64_t first = count > 0 ? src_offsets[source->offset] : 0;
+        int64_t last = count > 0 ? src_offsets[source->offset + count] : 0;
+        array = string_alloc(count, (size_t)(last - first), is_dynamic);
+        if (!array) return NULL;
+
+        if (last > first) memcpy(array->strings, string_blob(source) + first, (size_t)(last - first));
+        int64_t* offsets = string_offsets(array);
+        if (count > 0 && first == 0) {
+            memcpy(offsets, src_offsets + source->offset, (count + 1) * sizeof(int64_t));
+        } else if (count > 0) {
+            for (size_t i = 0; i <= count; i++) offsets[i] = src_offsets[source->offset + i] - first;
+        }
+    } else {
+        // Strided view: gather element by element
+        size_t total = 0;
+        for (size_t i = 0; i < count; i++) total += string_bytes(source, string_slot(source, i));
+
+        array = string_alloc(count, total, is_dynamic);
+        if (!array) return NULL;
+
+        int64_t* offsets = string_offsets(array);
+        size_t pos = 0;
+        for (size_t i = 0; i < count; i++) {
+            size_t k = string_slot(source, i);
+            size_t len = string_bytes(source, k);
+            offsets[i] = (int64_t)pos;
+            if (len > 0) memcpy(array->strings + pos, string_blob(source) + src_offsets[k], len);
+            pos += len;
+        }
+        offsets[count] = (int64_t)pos;
+    }
+
+    if (source->num_dimensions != 1 &&
+        !array_set_shape(array, source->shape, source->num_dimensions)) {
+        array_free(array);
+        return NULL;
+    }
+    return array;
+}
+
+/**
+ * String at a flat index
+ */
+const char* array_string_get(const Array* array, size_t index) {
+    if (!array || array->type != STRING || index >= array->count) return NULL;
+    size_t k = string_slot(array, index);
+    return string_bytes(array, k) > 0 ? string_blob(array) + string_offsets(array)[k] : "";
+}
+
+/**
+ * Length of the string at a flat index
+ */
+size_t array_string_length(const Array* array, size_t index) {
+    if (!array || array->type != STRING || index >= array->count) return 0;
+    size_t bytes = string_bytes(array, string_slot(array, index));
+    return bytes > 0 ? bytes - 1 : 0;
+}
+
+/**
+ * BOOL result array with the shape of a STRING array
+ */
+static Array* string_mask(const Array* array) {
+    if (!array || array->type != STRING) {
+        fprintf(stderr, "Error: Expected a STRING array\n");
+        return NULL;
+    }
+
+    Array* mask = array_zeros(array->count, BOOL, false);
+    if (mask && array->num_dimensions != 1 &&
+        !array_set_shape(mask, array->shape, array->num_dimensions)) {
+        array_free(mask);
+        return NULL;
+    }
+    return mask;
+}
+
+/**
+ * Elementwise equality
+ */
+Array* array_string_equal(const Array* array, const char* value) {
+    if (!value) {
+        fprintf(stderr, "Error: String value cannot be NULL\n");
+        return NULL;
+    }
+    Array* mask = string_mask(array);
+    if (!mask) return NULL;
+
+    // Lengths are checked first; only candidates of the right length are compared
+    size_t len = strlen(value);
+    bool contiguous = array_is_contiguous(array);
+    const int64_t* offsets = string_offsets(array);
+    bool* out = (bool*)mask->parray;
+
+    for (size_t i = 0; i < array->count; i++) {
+        size_t k = contiguous ? array->offset + i : string_slot(array, i);
+        size_t bytes = string_bytes(array, k);
+        size_t elem_len = bytes > 0 ? bytes - 1 : 0;
+        out[i] = elem_len == len && (len == 0 || memcmp(string_blob(array) + offsets[k], value, len) == 0);
+    }
+    return mask;
+}
+
+/**
+ * First occurrence of needle (m >= 1 bytes) in haystack, NULL if absent
+ */
+static const char* find_bytes(const char* haystack, size_t n, const char* needle, size_t m) {
+    if (m > n) return NULL;
+    const char* last = haystack + (n - m);
+    for (const char* p = haystack; p <= last; p++) {
+        p = (const char*)memchr(p, needle[0], (size_t)(last - p) + 1);
+        if (!p) return NULL;
+        if (memcmp(p, needle, m) == 0) return p;
+    }
+    return NULL;
+}
+
+/**
+ * Elementwise substring search
+ */
+Array* array_string_contains(const Array* array, const char* needle) {
+    if (!needle) {
+        fprintf(stderr, "Error: Needle cannot be NULL\n");
+        return NULL;
+    }
+    Array* mask = string_mask(array);
+    if (!mask) return NULL;
+
+    bool* out = (bool*)mask->parray;
+    size_t m = strlen(needle);
+    if (m == 0) {
+        memset(out, true, array->count);
+        return mask;
+    }
+
+    const int64_t* offsets = string_offsets(array);
+    const char* blob = string_blob(array);
+    if (array_is_contiguous(array)) {
+        // One pass over the blob; the needle has no NUL, so a hit never
+        // spans two strings
+        const int64_t* offs = offsets + array->offset;
+        size_t count = array->count;
+        size_t i = 0;
+        int64_t pos = count > 0 ? offs[0] : 0;
+        int64_t end = count > 0 ? offs[count] : 0;
+
+        while (pos < end) {
+            const char* hit = find_bytes(blob + pos, (size_t)(end - pos), needle, m);
+            if (!hit) break;
+            int64_t hit_pos = hit - blob;
+            while (offs[i + 1] <= hit_pos) i++;
+            out[i] = true;
+            pos = offs[++i];
+        }
+    } else {
+        for (size_t i = 0; i < array->count; i++) {
+            size_t k = string_slot(array, i);
+            size_t bytes = string_bytes(array, k);
+            out[i] = bytes > 0 && find_bytes(blob + offsets[k], bytes - 1, needle, m) != NULL;
+        }
+    }
+    return mask;
+}
@@ -0,0 +1,592 @@
+/**
+ * array_view.c - Zero-copy views over Array buffers
+ *
+ * Slicing, reshape, ravel, transpose and permute only build new shape/strides/
+ * offset metadata around the parent's parray. Data is copied only when a
+ * reshape or ravel is requested on a non-contiguous array, or when a view is
+ * gathered into (or scattered from) a dense buffer, which transposed layouts
+ * do in cache-sized tiles.
+ */
+
+#include "../../include/array/array_view.h"
+#include "../../include/runtime/runtime_dispatch.h"
+#include "../../include/runtime/parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+/**
+ * Allocate view metadata sharing the parent's buffer
+ */
+static Array* array_view_alloc(Array* parent, size_t num_dimensions) {
+    if (num_dimensions == 0 || num_dimensions > ARRAY_MAX_DIMS) {
+        fprintf(stderr, "Error: Invalid number of dimensions\n");
+        return NULL;
+    }
+
+    Array* view = (Array*)malloc(sizeof(Array));
+    if (!view) {
+        fprintf(stderr, "Error: Failed to allocate memory for view\n");
+        return NULL;
+    }
+
+    *view = *parent;
+    view->num_dimensions = num_dimensions;
+    view->is_dynamic = false;
+    view->owns_buffer = false;
+    view->base = parent->base ? parent->base : parent;
+    view->shape = (size_t*)malloc(sizeof(size_t) * num_dimensions);
+    view->strides = (ptrdiff_t*)malloc(sizeof(ptrdiff_t) * num_dimensions);
+    if (!view->shape || !view->strides) {
+        fprintf(stderr, "Error: Failed to allocate memory for view shape\n");
+        free(view->shape);
+        free(view->strides);
+        free(view);
+        return NULL;
+    }
+    return view;
+}
+
+/**
+ * Recompute count/capacity after the view's shape is filled in
+ */
+static void array_view_finish(Array* view) {
+    size_t count = 1;
+    for (size_t d = 0; d < view->num_dimensions; d++) {
+        count *= view->shape[d];
+    }
+    view->count = count;
+    view->capacity = count;
+}
+
+/**
+ * Create a view of the whole array
+ */
+Array* array_view(Array* array) {
+    if (!array) {
+        fprintf(stderr, "Error: Array cannot be NULL\n");
+        return NULL;
+    }
+
+    Array* view = array_view_alloc(array, array->num_dimensions);
+    if (!view) return NULL;
+
+    memcpy(view->shape, array->shape, sizeof(size_t) * array->num_dimensions);
+    memcpy(view->strides, array->strides, sizeof(ptrdiff_t) * array->num_dimensions);
+    array_view_finish(view);
+    return view;
+}
+
+/**
+ * Resolve Python slice bounds against an axis of length n (as CPython does)
+ */
+static bool slice_resolve(ptrdiff_t n, ptrdiff_t* start, ptrdiff_t* stop, ptrdiff_t* step,
+                          size_t* length) {
+    if (*step == SLICE_DEFAULT) *step = 1;
+    if (*step == 0) {
+        fprintf(stderr, "Error: Slice step cannot be zero\n");
+        return false;
+    }
+
+    if (*start == SLICE_DEFAULT) {
+        *start = *step < 0 ? n - 1 : 0;
+    } else {
+        if (*start < 0) *start += n;
+        if (*start < 0) *start = *step < 0 ? -1 : 0;
+        else if (*start >= n) *start = *step < 0 ? n - 1 : n;
+    }
+
+    if (*stop == SLICE_DEFAULT) {
+        *stop = *step < 0 ? -1 : n;
+    } else {
+        if (*stop < 0) *stop += n;
+        if (*stop < 0) *stop = *step < 0 ? -1 : 0;
+        else if (*stop >= n) *stop = *step < 0 ? n - 1 : n;
+    }
+
+    if (*step < 0) {
+        *length = *stop < *start ? (size_t)((*start - *stop - 1) / (-*step) + 1) : 0;
+    } else {
+        *length = *start < *stop ? (size_t)((*stop - *start - 1) / *step + 1) : 0;
+    }
+    return true;
+}
+
+/**
+ * Slice the leading axes
+ */
+Array* array_slices(Array* array, const ArraySlice* slices, size_t num_slices) {
+    if (!array || (num_slices > 0 && !slices)) {
+        fprintf(stderr, "Error: Array cannot be NULL\n");
+        return NULL;
+    }
+    if (num_slices > array->num_dimensions) {
+        fprintf(stderr, "Error: Too many slices for array dimensions\n");
+        return NULL;
+    }
+
+    Array* view = array_view(array);
+    if (!view) return NULL;
+
+    for (size_t axis = 0; axis < num_slices; axis++) {
+        ptrdiff_t start = slices[axis].start;
+        ptrdiff_t stop = slices[axis].stop;
+        ptrdiff_t step = slices[axis].step;
+        size_t length;
+        if (!slice_resolve((ptrdiff_t)array->shape[axis], &start, &stop, &step, &length)) {
+            array_free(view);
+            return NULL;
+        }
+
+        // Empty slices keep the offset; there is no first element to point at
+        if (length > 0) {
+            view->offset = (size_t)((ptrdiff_t)view->offset + start * view->strides[axis]);
+        }
+        view->shape[axis] = length;
+        view->strides[axis] *= step;
+    }
+
+    array_view_finish(view);
+    return view;
+}
+
+/**
+ * Slice one axis
+ */
+Array* array_slice(Array* array, size_t axis, ptrdiff_t start, ptrdiff_t stop, ptrdiff_t step) {
+    if (!array) {
+        fprintf(stderr, "Error: Array cannot be NULL\n");
+        return NULL;
+    }
+    if (axis >= array->num_dimensions) {
+        fprintf(stderr, "Error: Axis out of range\n");
+        return NULL;
+    }
+
+    // Leading axes before `axis` are taken whole
+    ArraySlice slices[ARRAY_MAX_DIMS];
+    for (size_t d = 0; d < axis; d++) {
+        slices[d].start = SLICE_DEFAULT;
+        slices[d].stop = SLICE_DEFAULT;
+        slices[d].step = SLICE_DEFAULT;
+    }
+    slices[axis].start = start;
+    slices[axis].stop = stop;
+    slices[axis].step = step;
+    return array_slices(array, slices, axis + 1);
+}
+
+/**
+ * New shape: a view for contiguous arrays, a copy otherwise
+ */
+Array* array_reshape(Array* array, const size_t* shape, size_t num_dimensions) {
+    if (!array || !shape) {
+        fprintf(stderr, "Error: Array and shape cannot be NULL\n");
+        return NULL;
+    }
+
+    size_t count = 1;
+    for (size_t d = 0; d < num_dimensions; d++) {
+        count *= shape[d];
+    }
+    if (count != array->count) {
+        fprintf(stderr, "Error: Cannot reshape array of size %zu into size %zu\n",
+                array->count, count);
+        return NULL;
+    }
+
+    if (!array_is_contiguous(array)) {
+        Array* copy = array_copy(array, false);
+        if (copy && !array_set_shape(copy, shape, num_dimensions)) {
+            array_free(copy);
+            return NULL;
+        }
+        return copy;
+    }
+
+    Array* view = array_view_alloc(array, num_dimensions);
+    if (!view) return NULL;
+
+    ptrdiff_t stride = 1;
+    for (size_t d = num_dimensions; d-- > 0;) {
+        view->shape[d] = shape[d];
+        view->strides[d] = stride;
+        stride *= (ptrdiff_t)shape[d];
+    }
+    array_view_finish(view);
+    return view;
+}
+
+/**
+ * Flatten to one dimension
+ */
+Array* array_ravel(Array* array) {
+    if (!array) {
+        fprintf(stderr, "Error: Array cannot be NULL\n");
+        return NULL;
+    }
+    size_t count = array->count;
+    return array_reshape(array, &count, 1);
+}
+
+/**
+ * Reverse the axes without copying
+ */
+Array* array_transpose(Array* array) {
+    if (!array) {
+        fprintf(stderr, "Error: Array cannot be NULL\n");
+        return NULL;
+    }
+
+    size_t ndim = array->num_dimensions;
+    Array* view = array_view_alloc(array, ndim);
+    if (!view) return NULL;
+
+    for (size_t d = 0; d < ndim; d++) {
+        view->shape[d] = array->shape[ndim - 1 - d];
+        view->strides[d] = array->strides[ndim - 1 - d];
+    }
+    array_view_finish(view);
+    return view;
+}
+
+/**
+ * Reorder the axes without copying
+ */
+Array* array_permute(Array* array, const size_t* axes) {
+    if (!array || !axes) {
+        fprintf(stderr, "Error: Array and axes cannot be NULL\n");
+        return NULL;
+    }
+
+    size_t ndim = array->num_dimensions;
+    bool seen[ARRAY_MAX_DIMS] = { false };
+    for (size_t d = 0; d < ndim; d++) {
+        if (axes[d] >= ndim || seen[axes[d]]) {
+            fprintf(stderr, "Error: Axes must be a permutation of 0..%zu\n", ndim - 1);
+            return NULL;
+        }
+        seen[axes[d]] = true;
+    }
+
+    Array* view = array_view_alloc(array, ndim);
+    if (!view) return NULL;
+
+    for (size_t d = 0; d < ndim; d++) {
+        view->shape[d] = array->shape[axes[d]];
+        view->strides[d] = array->strides[axes[d]];
+    }
+    array_view_finish(view);
+    return view;
+}
+
+/**
+ * Materialize a view as a new contiguous array
+ */
+static Array* array_materialize(Array* view) {
+    if (!view) return NULL;
+    Array* copy = array_copy(view, false);
+    array_free(view);
+    return copy;
+}
+
+/**
+ * Contiguous copy with the axes reversed
+ */
+Array* array_transpose_copy(Array* array) {
+    return array_materialize(array_transpose(array));
+}
+
+/**
+ * Contiguous copy with the axes reordered
+ */
+Array* array_permute_copy(Array* array, const size_t* axes) {
+    return array_materialize(array_permute(array, axes));
+}
+
+/**
+ * Address of the element at an N-D index
+ */
+void* array_get_ptr(const Array* array, const size_t* index) {
+    ptrdiff_t element = (ptrdiff_t)array->offset;
+    for (size_t d = 0; d < array->num_dimensions; d++) {
+        element += (ptrdiff_t)index[d] * array->strides[d];
+    }
+    return (char*)array_root(array)->parray + element * (ptrdiff_t)array->sizeof_type;
+}
+
+/**
+ * Contiguous version of an array (the array itself when already contiguous)
+ */
+const Array* array_contiguous(const Array* array, Array** owned) {
+    *owned = NULL;
+    if (array_is_contiguous(array)) return array;
+    *owned = array_copy((Array*)array, false);
+    return *owned;
+}
+
+/**
+ * Byte range [lo, hi) spanned by the elements of an array or view
+ */
+static void array_span(const Array* array, uintptr_t* lo, uintptr_t* hi) {
+    *lo = *hi = (uintptr_t)array_data(array);
+    for (size_t d = 0; d < array->num_dimensions; d++) {
+        ptrdiff_t extent = (ptrdiff_t)(array->shape[d] - 1) * array->strides[d] * (ptrdiff_t)array->sizeof_type;
+        if (extent < 0) *lo -= (uintptr_t)-extent;
+        else *hi += (uintptr_t)extent;
+    }
+    *hi += array->sizeof_type;
+}
+
+/**
+ * Input to read while out is written elementwise
+ */
+const Array* array_unaliased(const Array* in, const Array* out, Array** owned) {
+    *owned = NULL;
+    if (in->count == 0 || out->count == 0) return in;
+
+    // Same layout: every element is read before the same element is written
+    bool same = array_data(in) == array_data(out) && in->sizeof_type == out->sizeof_type &&
+                in->num_dimensions == out->num_dimensions;
+    for (size_t d = 0; same && d < in->num_dimensions; d++) {
+        same = in->shape[d] == out->shape[d] && in->strides[d] == out->strides[d];
+    }
+    uintptr_t in_lo, in_hi, out_lo, out_hi;
+    array_span(in, &in_lo, &in_hi);
+    array_span(out, &out_lo, &out_hi);
+    if (same || in_hi <= out_lo || out_hi <= in_lo) return in;
+
+    // A fresh buffer, not array_copy: a whole array's copy would share it
+    Array* copy = array_empty(in->count, in->type, false);
+    if (!copy || !array_set_shape(copy, in->shape, in->num_dimensions)) {
+        array_free(copy);
+        return NULL;
+    }
+    array_gather(in, copy->parray);
+    *owned = copy;
+    return copy;
+}
+
+/**
+ * Copy n elements between strided locations (strides in elements)
+ */
+void array_copy_elements(void* pdst, ptrdiff_t dst_stride, const void* psrc, ptrdiff_t src_stride,
+                         size_t n, size_t size) {
+    char* dst = (char*)pdst;
+    const char* src = (const char*)psrc;
+
+    if (dst_stride == 1 && src_stride == 1) {
+        memcpy(dst, src, n * size);
+        return;
+    }
+
+    // Fixed-width loops for the common element sizes
+    switch (size) {
+        case 1:
+            for (size_t i = 0; i < n; i++)
+                ((uint8_t*)dst)[(ptrdiff_t)i * dst_stride] = ((const uint8_t*)src)[(ptrdiff_t)i * src_stride];
+            break;
+        case 2:
+            for (size_t i = 0; i < n; i++)
+                ((uint16_t*)dst)[(ptrdiff_t)i * dst_stride] = ((const uint16_t*)src)[(ptrdiff_t)i * src_stride];
+            break;
+        case 4:
+            for (size_t i = 0; i < n; i++)
+                ((uint32_t*)dst)[(ptrdiff_t)i * dst_stride] = ((const uint32_t*)src)[(ptrdiff_t)i * src_stride];
+            break;
+        case 8:
+            for (size_t i = 0; i < n; i++)
+                ((uint64_t*)dst)[(ptrdiff_t)i * dst_stride] = ((const uint64_t*)src)[(ptrdiff_t)i * src_stride];
+            break;
+        default:
+            for (size_t i = 0; i < n; i++)
+                memcpy(dst + (ptrdiff_t)i * dst_stride * (ptrdiff_t)size,
+                       src + (ptrdiff_t)i * src_stride * (ptrdiff_t)size, size);
+            break;
+    }
+}
+
+//====================
+// Tiled transpose
+//====================
+//
+// When the innermost axis of a view is strided but another axis has unit
+// stride (a transposed or axis-permuted array), walking rows would touch a new
+// cache line and often a new page for every element. Those pairs of axes are
+// instead moved in square tiles that fit in L1 together with their
+// destination, each transposed by the dispatched TRANSPOSE kernel. The other
+// axes, if any, just select which 2-D slice a tile belongs to.
+
+// Both axes need at least this many elements for tiling to pay off
+#define TRANSPOSE_MIN_EXTENT 8
+
+typedef struct {
+    const Array* array;
+    char* data;                          // array_data(array)
+    char* dense;
+    bool to_dense;
+    size_t axis;                         // outer axis with unit stride
+    size_t dense_strides[ARRAY_MAX_DIMS];
+    size_t tile;
+    size_t tiles_inner;                  // tiles along the innermost axis
+    size_t tiles_axis;                   // tiles along axis
+    Kernel transpose;
+} TransposeTask;
+
+/**
+ * Edge of a square tile whose source and destination fill at most half of L1
+ */
+static size_t transpose_tile(size_t size) {
+    const CacheInfo* cache = &get_runtime_hardware_profile()->cache_info;
+    size_t l1 = cache->l1_data_cache_size_kb > 0 ? (size_t)cache->l1_data_cache_size_kb * 1024 : 32 * 1024;
+    size_t line = cache->cache_line_size_bytes > 0 ? (size_t)cache->cache_line_size_bytes : 64;
+    // Whole cache lines along both edges
+    size_t tile = line / size > 0 ? line / size : 1;
+    while (2 * (2 * tile) * (2 * tile) * size <= l1 / 2) tile *= 2;
+    return tile;
+}
+
+static void transpose_tiles(size_t begin, size_t end, void* ctx) {
+    TransposeTask* task = (TransposeTask*)ctx;
+    const Array* array = task->array;
+    size_t ndim = array->num_dimensions;
+    size_t size = array->sizeof_type;
+    size_t last = ndim - 1;
+    size_t per_slice = task->tiles_inner * task->tiles_axis;
+
+    for (size_t u = begin; u < end; u++) {
+        // Which 2-D slice: unravel over the axes other than axis and last
+        size_t slice = u / per_slice;
+        ptrdiff_t view_at = 0;
+        size_t dense_at = 0;
+        for (size_t d = last; d-- > 0;) {
+            if (d == task->axis) continue;
+            size_t i = slice % array->shape[d];
+            slice /= array->shape[d];
+            view_at += (ptrdiff_t)i * array->strides[d];
+            dense_at += i * task->dense_strides[d];
+        }
+
+        size_t t = u % per_slice;
+        size_t r0 = (t / task->tiles_axis) * task->tile;     // along the innermost axis
+        size_t c0 = (t % task->tiles_axis) * task->tile;     // along axis
+        size_t nr = array->shape[last] - r0 < task->tile ? array->shape[last] - r0 : task->tile;
+        size_t nc = array->shape[task->axis] - c0 < task->tile ? array->shape[task->axis] - c0 : task->tile;
+
+        ptrdiff_t stride = array->strides[last];
+        ptrdiff_t dense_stride = (ptrdiff_t)task->dense_strides[task->axis];
+        char* view = task->data + (view_at + (ptrdiff_t)r0 * stride + (ptrdiff_t)c0) * (ptrdiff_t)size;
+        char* dense = task->dense + (dense_at + c0 * (size_t)dense_stride + r0) * size;
+        // The view holds the block as rows along the innermost axis, the
+        // dense buffer as rows along axis
+        if (task->to_dense) {
+            task->transpose.transpose(view, stride, dense, dense_stride, nr, nc);
+        } else {
+            task->transpose.transpose(dense, dense_stride, view, stride, nc, nr);
+        }
+    }
+}
+
+/**
+ * Move the array in transposed tiles when its layout calls for it; false if
+ * the caller should walk rows instead
+ */
+static bool array_transfer_tiled(const Array* array, char* dense, bool to_dense) {
+    size_t ndim = array->num_dimensions;
+    size_t size = array->sizeof_type;
+    size_t last = ndim - 1;
+    if (ndim < 2 || array->strides[last] == 1 || array->shape[last] < TRANSPOSE_MIN_EXTENT) return false;
+
+    // Kernels move bits, so any type of a supported width will do
+    Type by_size = size == 1 ? CHAR : size == 2 ? UINT16 : size == 4 ? FLOAT : size == 8 ? DOUBLE : ARRAY;
+    Kernel transpose = by_size != ARRAY ? get_kernel(KERNEL_TRANSPOSE, by_size) : (Kernel){ 0 };
+    if (!transpose.transpose) return false;
+
+    TransposeTask task = { 0 };
+    task.axis = ndim;
+    for (size_t d = 0; d < last; d++) {
+        if (array->strides[d] == 1 && array->shape[d] >= TRANSPOSE_MIN_EXTENT) task.axis = d;
+    }
+    if (task.axis == ndim) return false;
+
+    task.array = array;
+    task.data = (char*)array_data(array);
+    task.dense = dense;
+    task.to_dense = to_dense;
+    task.transpose = transpose;
+    task.tile = transpose_tile(size);
+    size_t stride = 1;
+    for (size_t d = ndim; d-- > 0;) {
+        task.dense_strides[d] = stride;
+        stride *= array->shape[d];
+    }
+    task.tiles_inner = (array->shape[last] + task.tile - 1) / task.tile;
+    task.tiles_axis = (array->shape[task.axis] + task.tile - 1) / task.tile;
+    size_t slices = array->count / (array->shape[last] * array->shape[task.axis]);
+    size_t units = slices * task.tiles_inner * task.tiles_axis;
+
+    // Tiles write disjoint parts of the dense buffer; a view may alias itself,
+    // so writes into it stay on one thread
+    if (to_dense) {
+        parallel_for(units, parallel_grain(2 * task.tile * task.tile * size), transpose_tiles, &task);
+    } else {
+        transpose_tiles(0, units, &task);
+    }
+    return true;
+}
+
+/**
+ * Walk the array one innermost row at a time, moving data to or from a dense buffer
+ */
+static void array_transfer(const Array* array, char* dense, bool to_dense) {
+    if (array->count == 0) return;
+
+    size_t size = array->sizeof_type;
+    char* data = (char*)array_data(array);
+    if (array_is_contiguous(array)) {
+        if (to_dense) memcpy(dense, data, array->count * size);
+        else memcpy(data, dense, array->count * size);
+        return;
+    }
+    if (array_transfer_tiled(array, dense, to_dense)) return;
+
+    size_t ndim = array->num_dimensions;
+    size_t inner = array->shape[ndim - 1];
+    ptrdiff_t inner_stride = array->strides[ndim - 1];
+    size_t index[ARRAY_MAX_DIMS] = {0};
+    ptrdiff_t row = 0;  // element offset of the current row from array_data()
+
+    for (size_t done = 0; done < array->count; done += inner) {
+        char* row_ptr = data + row * (ptrdiff_t)size;
+        if (to_dense) {
+            array_copy_elements(dense + done * size, 1, row_ptr, inner_stride, inner, size);
+        } else {
+            array_copy_elements(row_ptr, inner_stride, dense + done * size, 1, inner, size);
+        }
+
+        // Odometer over the outer axes
+        for (size_t d = ndim - 1; d-- > 0;) {
+            row += array->strides[d];
+            if (++index[d] < array->shape[d]) break;
+            row -= array->strides[d] * (ptrdiff_t)array->shape[d];
+            index[d] = 0;
+        }
+    }
+}
+
+/**
+ * Copy the elements into a dense row-major buffer
+ */
+void array_gather(const Array* array, void* dst) {
+    if (!array || !dst) return;
+    array_transfer(array, (char*)dst, true);
+}
+
+/**
+ * Copy a dense row-major buffer into the array's elements
+ */
+void array_scatter(Array* array, const void* src) {
+    if (!array || !src || !array_make_writable(array)) return;
+    array_transfer(array, (char*)src, false);
+}
@@ -61,13 +61,21 @@
   * Detect and fill all fields of the hardware profile
   */
  HardwareProfile detect_hardware_profile(void) {
-     HardwareProfile hw = {0}; // Initialize to all zeros
+     HardwareProfile hw = detect_cpu_profile();
+     detect_gpu_info(&hw.gpu_info);
+     return hw;
+ }
+ 
+ /**
+  * Detect everything but the GPU (no external commands are run)
+  */
+ HardwareProfile detect_cpu_profile(void) {
+     HardwareProfile hw = {0}; // Initialize to all zeros; no GPU
      
      detect_cpu_features(&hw.cpu_features);
      detect_cpu_cores(&hw.cpu_cores);
      detect_cache_sizes(&hw.cache_info);
      detect_memory_info(&hw.memory_info);
-     detect_gpu_info(&hw.gpu_info);
      
      return hw;
  }
@@ -97,6 +105,7 @@
      cpu_features->sse4_1 = (cpu_info[2] & (1 << 19)) != 0;
      cpu_features->sse4_2 = (cpu_info[2] & (1 << 20)) != 0;
      cpu_features->fma = (cpu_info[2] & (1 << 12)) != 0;
+     cpu_features->f16c = (cpu_info[2] & (1 << 29)) != 0;
      
      // Function 7: EBX and ECX contain extended feature bits
      __cpuidex(cpu_info, 7, 0);
@@ -662,6 +671,7 @@
      printf("AVX2:     %s\n", hw->cpu_features.avx2 ? "Yes" : "No");
      printf("AVX-512F: %s\n", hw->cpu_features.avx512f ? "Yes" : "No");
      printf("FMA:      %s\n", hw->cpu_features.fma ? "Yes" : "No");
+     printf("F16C:     %s\n", hw->cpu_features.f16c ? "Yes" : "No");
      printf("NEON:     %s\n", hw->cpu_features.neon ? "Yes" : "No");
      printf("SVE:      %s\n", hw->cpu_features.sve ? "Yes" : "No");
      
@@ -0,0 +1,161 @@
+/**
+ * bitpack_kernels.c - Fixed-width bit packing of INT blocks for array_compress
+ *
+ * A block of BITPACK_BLOCK values is packed as four interleaved lanes: value
+ * i goes to lane i % 4, and each lane fills every fourth 32-bit word with its
+ * values, low bits first. Value v of every lane then starts at the same bit
+ * of the same word row, so one 128-bit vector of words yields four
+ * consecutive output values with one shift, a mask and an add, whatever the
+ * width. The SSE2 kernels shift by a count in a register, which covers all
+ * 33 widths without unrolling a loop per width; the AVX2 unpacker decodes two
+ * word rows per 256-bit vector with per-lane variable shifts.
+ */
+
+#include "../../include/runtime/runtime_dispatch.h"
+#include "../../include/runtime/simd_targets.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Values per lane of a block
+#define LANE_VALUES (BITPACK_BLOCK / 4)
+
+//====================
+// Scalar
+//====================
+
+static void kernel_bitpack_scalar(const int* values, int base, unsigned bits, uint32_t* packed) {
+    if (bits == 0) return;
+    for (size_t k = 0; k < 4; k++) {
+        uint32_t* out = packed + k;
+        uint32_t word = 0;
+        unsigned filled = 0;
+        for (size_t v = 0; v < LANE_VALUES; v++) {
+            uint32_t x = (uint32_t)values[4 * v + k] - (uint32_t)base;
+            word |= x << filled;
+            filled += bits;
+            if (filled >= 32) {
+                *out = word;
+                out += 4;
+                filled -= 32;
+                // Bits of x that did not fit start the next word
+                word = filled ? x >> (bits - filled) : 0;
+            }
+        }
+    }
+}
+
+static void kernel_bitunpack_scalar(const uint32_t* packed, unsigned bits, int base, int* values) {
+    if (bits == 0) {
+        for (size_t i = 0; i < BITPACK_BLOCK; i++) values[i] = base;
+        return;
+    }
+    uint32_t mask = bits == 32 ? UINT32_MAX : ((uint32_t)1 << bits) - 1;
+    for (size_t v = 0; v < LANE_VALUES; v++) {
+        unsigned bit = (unsigned)v * bits;
+        unsigned shift = bit % 32;
+        const uint32_t* row = packed + 4 * (bit / 32);
+        for (size_t k = 0; k < 4; k++) {
+            uint32_t x = row[k] >> shift;
+            if (shift + bits > 32) x |= row[k + 4] << (32 - shift);
+            values[4 * v + k] = (int)((x & mask) + (uint32_t)base);
+        }
+    }
+}
+
+//====================
+// SIMD
+//====================
+
+#if SIMD_X86
+TARGET_SSE2 static void kernel_bitpack_sse2(const int* values, int base, unsigned bits, uint32_t* packed) {
+    if (bits == 0) return;
+    const __m128i offset = _mm_set1_epi32(base);
+    __m128i word = _mm_setzero_si128();
+    unsigned filled = 0;
+    for (size_t v = 0; v < LANE_VALUES; v++) {
+        __m128i x = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(values + 4 * v)), offset);
+        word = _mm_or_si128(word, _mm_sll_epi32(x, _mm_cvtsi32_si128((int)filled)));
+        filled += bits;
+        if (filled >= 32) {
+            _mm_storeu_si128((__m128i*)packed, word);
+            packed += 4;
+            filled -= 32;
+            word = filled ? _mm_srl_epi32(x, _mm_cvtsi32_si128((int)(bits - filled))) : _mm_setzero_si128();
+        }
+    }
+}
+
+TARGET_SSE2 static void kernel_bitunpack_sse2(const uint32_t* packed, unsigned bits, int base, int* values) {
+    const __m128i offset = _mm_set1_epi32(base);
+    if (bits == 0) {
+        for (size_t i = 0; i < BITPACK_BLOCK; i += 4) _mm_storeu_si128((__m128i*)(values + i), offset);
+        return;
+    }
+    const __m128i mask = _mm_set1_epi32(bits == 32 ? -1 : (int)(((uint32_t)1 << bits) - 1));
+    for (size_t v = 0; v < LANE_VALUES; v++) {
+        unsigned bit = (unsigned)v * bits;
+        unsigned shift = bit % 32;
+        const uint32_t* row = packed + 4 * (bit / 32);
+        __m128i x = _mm_srl_epi32(_mm_loadu_si128((const __m128i*)row), _mm_cvtsi32_si128((int)shift));
+        if (shift + bits > 32) {
+            __m128i next = _mm_loadu_si128((const __m128i*)(row + 4));
+            x = _mm_or_si128(x, _mm_sll_epi32(next, _mm_cvtsi32_si128((int)(32 - shift))));
+        }
+        _mm_storeu_si128((__m128i*)(values + 4 * v), _mm_add_epi32(_mm_and_si128(x, mask), offset));
+    }
+}
+
+TARGET_AVX2 static void kernel_bitunpack_avx2(const uint32_t* packed, unsigned bits, int base, int* values) {
+    const __m256i offset = _mm256_set1_epi32(base);
+    if (bits == 0) {
+        for (size_t i = 0; i < BITPACK_BLOCK; i += 8) _mm256_storeu_si256((__m256i*)(values + i), offset);
+        return;
+    }
+    const __m256i mask = _mm256_set1_epi32(bits == 32 ? -1 : (int)(((uint32_t)1 << bits) - 1));
+    const __m128i none = _mm_setzero_si128();
+    // Values v and v + 1 of every lane: the low half decodes one word row, the high half the next
+    for (size_t v = 0; v < LANE_VALUES; v += 2) {
+        unsigned bit0 = (unsigned)v * bits, bit1 = bit0 + bits;
+        unsigned shift0 = bit0 % 32, shift1 = bit1 % 32;
+        const uint32_t* row0 = packed + 4 * (bit0 / 32);
+        const uint32_t* row1 = packed + 4 * (bit1 / 32);
+        __m256i words = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)row0)),
+                                                _mm_loadu_si128((const __m128i*)row1), 1);
+        __m256i x = _mm256_srlv_epi32(words, _mm256_setr_epi32((int)shift0, (int)shift0, (int)shift0, (int)shift0,
+                                                               (int)shift1, (int)shift1, (int)shift1, (int)shift1));
+        bool spill0 = shift0 + bits > 32, spill1 = shift1 + bits > 32;
+        if (spill0 || spill1) {
+            // A count of 32 shifts a half that does not spill to zero
+            __m128i next0 = spill0 ? _mm_loadu_si128((const __m128i*)(row0 + 4)) : none;
+            __m128i next1 = spill1 ? _mm_loadu_si128((const __m128i*)(row1 + 4)) : none;
+            int up0 = spill0 ? (int)(32 - shift0) : 32, up1 = spill1 ? (int)(32 - shift1) : 32;
+            __m256i next = _mm256_inserti128_si256(_mm256_castsi128_si256(next0), next1, 1);
+            x = _mm256_or_si256(x, _mm256_sllv_epi32(next, _mm256_setr_epi32(up0, up0, up0, up0,
+                                                                              up1, up1, up1, up1)));
+        }
+        _mm256_storeu_si256((__m256i*)(values + 4 * v), _mm256_add_epi32(_mm256_and_si256(x, mask), offset));
+    }
+}
+#endif
+
+//====================
+// Registration
+//====================
+
+/**
+ * Register the bit packing kernels with the dispatch registry
+ */
+void register_bitpack_kernels(void) {
+    Kernel k = { .bitpack = kernel_bitpack_scalar };
+    register_kernel(KERNEL_BITPACK, INT, ISA_SCALAR, k);
+    k.bitunpack = kernel_bitunpack_scalar;
+    register_kernel(KERNEL_BITUNPACK, INT, ISA_SCALAR, k);
+#if SIMD_X86
+    k.bitpack = kernel_bitpack_sse2;
+    register_kernel(KERNEL_BITPACK, INT, ISA_SSE2, k);
+    k.bitunpack = kernel_bitunpack_sse2;
+    register_kernel(KERNEL_BITUNPACK, INT, ISA_SSE2, k);
+    k.bitunpack = kernel_bitunpack_avx2;
+    register_kernel(KERNEL_BITUNPACK, INT, ISA_AVX2, k);
+#endif
+}
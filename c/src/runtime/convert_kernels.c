@@ -0,0 +1,188 @@
+/**
+ * convert_kernels.c - Element type conversion kernels for array_astype
+ *
+ * One kernel per (source, destination) pair of the fixed-width element types,
+ * generated per ISA level from a plain C loop like the kernels in kernels.c,
+ * so the auto-vectorizer emits the widening, narrowing and int <-> float
+ * instructions of each level. Each source type registers a KERNEL_ASTYPE
+ * table indexed by destination Type. The 16-bit float types have no entries:
+ * array_astype goes through FLOAT with the KERNEL_TO_FLOAT and
+ * KERNEL_FROM_FLOAT kernels for them.
+ *
+ * Conversions saturate instead of wrapping. Integers are clamped to the
+ * destination range, floats are truncated toward zero and clamped (NaN
+ * becomes 0), and anything converts to BOOL as value != 0.
+ */
+
+#include "../../include/runtime/runtime_dispatch.h"
+#include "../../include/runtime/simd_targets.h"
+#include "../../include/runtime/type_limits.h"
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+
+#define NO_TARGET
+
+//====================
+// Type traits
+//====================
+
+// Integer ranges (MIN_<name>, MAX_<name>) come from type_limits.h, keyed by
+// the name used in kernel names. BOOL is "boolean" there: a bool argument
+// would expand to _Bool before pasting.
+
+// Destination bounds that a source type can exceed, as source values
+#define CONVERT_LO(SN, DN) (MIN_##DN > MIN_##SN ? MIN_##DN : MIN_##SN)
+#define CONVERT_HI(SN, DN) (MAX_##DN < MAX_##SN ? MAX_##DN : MAX_##SN)
+
+// Bounds arrive as arguments, so always-true comparisons (an unsigned value
+// against 0) fold away after inlining instead of warning
+#define DEFINE_CLAMP(T, TNAME)                                                       \
+    static inline T clamp_##TNAME(T x, T lo, T hi) {                                 \
+        return x < lo ? lo : x > hi ? hi : x;                                        \
+    }
+
+DEFINE_CLAMP(int, int)
+DEFINE_CLAMP(char, char)
+DEFINE_CLAMP(int8_t, int8)
+DEFINE_CLAMP(int16_t, int16)
+DEFINE_CLAMP(int64_t, int64)
+DEFINE_CLAMP(uint8_t, uint8)
+DEFINE_CLAMP(uint16_t, uint16)
+DEFINE_CLAMP(uint32_t, uint32)
+DEFINE_CLAMP(uint64_t, uint64)
+
+//====================
+// Conversion rules (per class pair)
+//====================
+//
+// Classes: INTEGER (including CHAR), REAL (FLOAT, DOUBLE) and BOOL. Each rule
+// maps the source value x to an expression converted to D.
+
+#define CONVERT_INTEGER_INTEGER(x, S, SN, D, DN) clamp_##SN(x, (S)CONVERT_LO(SN, DN), (S)CONVERT_HI(SN, DN))
+#define CONVERT_INTEGER_REAL(x, S, SN, D, DN)    x
+#define CONVERT_INTEGER_BOOL(x, S, SN, D, DN)    x != 0
+#define CONVERT_REAL_INTEGER(x, S, SN, D, DN)    SATURATE_REAL(x, S, D, DN)
+#define CONVERT_REAL_REAL(x, S, SN, D, DN)       x
+#define CONVERT_REAL_BOOL(x, S, SN, D, DN)       x != 0
+#define CONVERT_BOOL_INTEGER(x, S, SN, D, DN)    x
+#define CONVERT_BOOL_REAL(x, S, SN, D, DN)       x
+#define CONVERT_BOOL_BOOL(x, S, SN, D, DN)       x
+
+//====================
+// Kernel templates
+//====================
+
+#define DEFINE_CONVERT_KERNEL(S, SN, SC, D, DN, DC, ISA, TARGET)                     \
+    TARGET static void kernel_astype_##SN##_##DN##_##ISA(const void* psrc,           \
+                                                         void* pdst, size_t n) {     \
+        const S* src = (const S*)psrc;                                               \
+        D* dst = (D*)pdst;                                                           \
+        for (size_t i = 0; i < n; i++) {                                             \
+            S x = src[i];                                                            \
+            dst[i] = (D)(CONVERT_##SC##_##DC(x, S, SN, D, DN));                      \
+        }                                                                            \
+    }
+
+// Every destination for one source type, and the table indexed by Type
+#define DEFINE_CONVERTS_FROM(S, SN, SC, ISA, TARGET)                                 \
+    DEFINE_CONVERT_KERNEL(S, SN, SC, int, int, INTEGER, ISA, TARGET)                 \
+    DEFINE_CONVERT_KERNEL(S, SN, SC, float, float, REAL, ISA, TARGET)                \
+    DEFINE_CONVERT_KERNEL(S, SN, SC, double, double, REAL, ISA, TARGET)              \
+    DEFINE_CONVERT_KERNEL(S, SN, SC, char, char, INTEGER, ISA, TARGET)               \
+    DEFINE_CONVERT_KERNEL(S, SN, SC, bool, boolean, BOOL, ISA, TARGET)               \
+    DEFINE_CONVERT_KERNEL(S, SN, SC, int8_t, int8, INTEGER, ISA, TARGET)             \
+    DEFINE_CONVERT_KERNEL(S, SN, SC, int16_t, int16, INTEGER, ISA, TARGET)           \
+    DEFINE_CONVERT_KERNEL(S, SN, SC, int64_t, int64, INTEGER, ISA, TARGET)           \
+    DEFINE_CONVERT_KERNEL(S, SN, SC, uint8_t, uint8, INTEGER, ISA, TARGET)           \
+    DEFINE_CONVERT_KERNEL(S, SN, SC, uint16_t, uint16, INTEGER, ISA, TARGET)         \
+    DEFINE_CONVERT_KERNEL(S, SN, SC, uint32_t, uint32, INTEGER, ISA, TARGET)         \
+    DEFINE_CONVERT_KERNEL(S, SN, SC, uint64_t, uint64, INTEGER, ISA, TARGET)         \
+    static const ConvertKernelFn astype_##SN##_##ISA[TYPE_COUNT] = {                 \
+        [INT] = kernel_astype_##SN##_int_##ISA,                                      \
+        [FLOAT] = kernel_astype_##SN##_float_##ISA,                                  \
+        [DOUBLE] = kernel_astype_##SN##_double_##ISA,                                \
+        [CHAR] = kernel_astype_##SN##_char_##ISA,                                    \
+        [BOOL] = kernel_astype_##SN##_boolean_##ISA,                                 \
+        [INT8] = kernel_astype_##SN##_int8_##ISA,                                    \
+        [INT16] = kernel_astype_##SN##_int16_##ISA,                                  \
+        [INT64] = kernel_astype_##SN##_int64_##ISA,                                  \
+        [UINT8] = kernel_astype_##SN##_uint8_##ISA,                                  \
+        [UINT16] = kernel_astype_##SN##_uint16_##ISA,                                \
+        [UINT32] = kernel_astype_##SN##_uint32_##ISA,                                \
+        [UINT64] = kernel_astype_##SN##_uint64_##ISA,                                \
+    };
+
+#define DEFINE_ISA_CONVERTS(ISA, TARGET)                                             \
+    DEFINE_CONVERTS_FROM(int, int, INTEGER, ISA, TARGET)                             \
+    DEFINE_CONVERTS_FROM(float, float, REAL, ISA, TARGET)                            \
+    DEFINE_CONVERTS_FROM(double, double, REAL, ISA, TARGET)                          \
+    DEFINE_CONVERTS_FROM(char, char, INTEGER, ISA, TARGET)                           \
+    DEFINE_CONVERTS_FROM(bool, boolean, BOOL, ISA, TARGET)                           \
+    DEFINE_CONVERTS_FROM(int8_t, int8, INTEGER, ISA, TARGET)                         \
+    DEFINE_CONVERTS_FROM(int16_t, int16, INTEGER, ISA, TARGET)                       \
+    DEFINE_CONVERTS_FROM(int64_t, int64, INTEGER, ISA, TARGET)                       \
+    DEFINE_CONVERTS_FROM(uint8_t, uint8, INTEGER, ISA, TARGET)                       \
+    DEFINE_CONVERTS_FROM(uint16_t, uint16, INTEGER, ISA, TARGET)                     \
+    DEFINE_CONVERTS_FROM(uint32_t, uint32, INTEGER, ISA, TARGET)                     \
+    DEFINE_CONVERTS_FROM(uint64_t, uint64, INTEGER, ISA, TARGET)
+
+//====================
+// Instantiation
+//====================
+//
+// AVX has no 256-bit integer instructions, so conversions skip that level
+// (AVX machines use the SSE2 tables).
+
+DEFINE_ISA_CONVERTS(scalar, NO_TARGET)
+#if SIMD_X86
+DEFINE_ISA_CONVERTS(sse2, TARGET_SSE2)
+DEFINE_ISA_CONVERTS(avx2, TARGET_AVX2)
+DEFINE_ISA_CONVERTS(avx512, TARGET_AVX512)
+#endif
+
+//====================
+// Registration
+//====================
+
+#define REGISTER_ASTYPE(ISA_LEVEL, ISA)                                              \
+    do {                                                                             \
+        Kernel k;                                                                    \
+        k.astype = astype_int_##ISA;                                                 \
+        register_kernel(KERNEL_ASTYPE, INT, ISA_LEVEL, k);                           \
+        k.astype = astype_float_##ISA;                                               \
+        register_kernel(KERNEL_ASTYPE, FLOAT, ISA_LEVEL, k);                         \
+        k.astype = astype_double_##ISA;                                              \
+        register_kernel(KERNEL_ASTYPE, DOUBLE, ISA_LEVEL, k);                        \
+        k.astype = astype_char_##ISA;                                                \
+        register_kernel(KERNEL_ASTYPE, CHAR, ISA_LEVEL, k);                          \
+        k.astype = astype_boolean_##ISA;                                             \
+        register_kernel(KERNEL_ASTYPE, BOOL, ISA_LEVEL, k);                          \
+        k.astype = astype_int8_##ISA;                                                \
+        register_kernel(KERNEL_ASTYPE, INT8, ISA_LEVEL, k);                          \
+        k.astype = astype_int16_##ISA;                                               \
+        register_kernel(KERNEL_ASTYPE, INT16, ISA_LEVEL, k);                         \
+        k.astype = astype_int64_##ISA;                                               \
+        register_kernel(KERNEL_ASTYPE, INT64, ISA_LEVEL, k);                         \
+        k.astype = astype_uint8_##ISA;                                               \
+        register_kernel(KERNEL_ASTYPE, UINT8, ISA_LEVEL, k);                         \
+        k.astype = astype_uint16_##ISA;                                              \
+        register_kernel(KERNEL_ASTYPE, UINT16, ISA_LEVEL, k);                        \
+        k.astype = astype_uint32_##ISA;                                              \
+        register_kernel(KERNEL_ASTYPE, UINT32, ISA_LEVEL, k);                        \
+        k.astype = astype_uint64_##ISA;                                              \
+        register_kernel(KERNEL_ASTYPE, UINT64, ISA_LEVEL, k);                        \
+    } while (0)
+
+/**
+ * Register the conversion tables with the dispatch registry
+ */
+void register_convert_kernels(void) {
+    REGISTER_ASTYPE(ISA_SCALAR, scalar);
+#if SIMD_X86
+    REGISTER_ASTYPE(ISA_SSE2, sse2);
+    REGISTER_ASTYPE(ISA_AVX2, avx2);
+    REGISTER_ASTYPE(ISA_AVX512, avx512);
+#endif
+}
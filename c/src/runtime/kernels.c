@@ -0,0 +1,2123 @@
+/**
+ * kernels.c - Built-in elementwise kernels for the runtime dispatch registry
+ *
+ * Every (operation, type) pair is generated once per ISA level from the same
+ * plain C loop. Each copy carries that level's target attribute, so the
+ * auto-vectorizer (src/runtime is built with -O3) emits SSE2/AVX/AVX2/AVX-512
+ * code in a portable binary. register_builtin_kernels() hands them all to the
+ * registry in runtime_dispatch.c, which picks one per (op, type) at startup.
+ * Fill and copy are written by hand per element size so they can switch to
+ * non-temporal stores for outputs larger than the last-level cache, and
+ * compaction, gathers, scatters, transposes, the GEMM micro-kernels, the
+ * FLOAT/DOUBLE multiply-adds, the sorting networks, the key filters, the
+ * prefix scans, the half precision conversions and the bit mask kernels are
+ * written with intrinsics because no loop vectorizes into them.
+ */
+
+#include "../../include/runtime/runtime_dispatch.h"
+#include "../../include/runtime/simd_targets.h"
+#include "../../include/runtime/type_limits.h"
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+#define NO_TARGET
+
+//====================
+// Kernel templates
+//====================
+
+#define DEFINE_BINARY_KERNEL(NAME, T, SUFFIX, TARGET, EXPR)                          \
+    TARGET static void kernel_##NAME##_##SUFFIX(const void* pa, const void* pb,      \
+                                                 void* pout, size_t n) {             \
+        const T* a = (const T*)pa;                                                   \
+        const T* b = (const T*)pb;                                                   \
+        T* out = (T*)pout;                                                           \
+        for (size_t i = 0; i < n; i++) {                                             \
+            T x = a[i], y = b[i];                                                    \
+            out[i] = (T)(EXPR);                                                      \
+        }                                                                            \
+    }
+
+// FMA_FN rounds a * b + c once: fmaf/fma for FLOAT/DOUBLE (src/runtime is
+// built with -ffp-contract=off, so a plain expression would round twice)
+#define DEFINE_FMA_KERNEL(T, SUFFIX, TARGET, FMA_FN)                                 \
+    TARGET static void kernel_fma_##SUFFIX(const void* pa, const void* pb,           \
+                                           const void* pc, void* pout, size_t n) {   \
+        const T* a = (const T*)pa;                                                   \
+        const T* b = (const T*)pb;                                                   \
+        const T* c = (const T*)pc;                                                   \
+        T* out = (T*)pout;                                                           \
+        for (size_t i = 0; i < n; i++) {                                             \
+            out[i] = (T)FMA_FN(a[i], b[i], c[i]);                                    \
+        }                                                                            \
+    }
+
+// One loop per predicate keeps the branch out of the vectorized body
+#define COMPARE_LOOP(OP)                                                             \
+    for (size_t i = 0; i < n; i++) out[i] = a[i] OP b[i];                            \
+    break;
+
+#define DEFINE_COMPARE_KERNEL(T, SUFFIX, TARGET)                                     \
+    TARGET static void kernel_compare_##SUFFIX(const void* pa, const void* pb,       \
+                                               bool* out, size_t n, CompareOp cmp) { \
+        const T* a = (const T*)pa;                                                   \
+        const T* b = (const T*)pb;                                                   \
+        switch (cmp) {                                                               \
+            case CMP_EQ: COMPARE_LOOP(==)                                            \
+            case CMP_NE: COMPARE_LOOP(!=)                                            \
+            case CMP_LT: COMPARE_LOOP(<)                                             \
+            case CMP_LE: COMPARE_LOOP(<=)                                            \
+            case CMP_GT: COMPARE_LOOP(>)                                             \
+            case CMP_GE: COMPARE_LOOP(>=)                                            \
+        }                                                                            \
+    }
+
+// dst[i] = start + i * step, computed in double like the scalar constructors
+// and stored through IOTA_STORE_<name>: integer types saturate like astype
+// does. Large outputs are generated in an L1 chunk and streamed out with
+// non-temporal stores so they do not evict the working set.
+#define IOTA_CHUNK_BYTES 4096
+
+#define IOTA_STORE_float(v)  (float)(v)
+#define IOTA_STORE_double(v) (v)
+#define IOTA_STORE_int(v)    SATURATE_REAL(v, double, int, int)
+#define IOTA_STORE_char(v)   SATURATE_REAL(v, double, char, char)
+#define IOTA_STORE_int8(v)   SATURATE_REAL(v, double, int8_t, int8)
+#define IOTA_STORE_int16(v)  SATURATE_REAL(v, double, int16_t, int16)
+#define IOTA_STORE_int64(v)  SATURATE_REAL(v, double, int64_t, int64)
+#define IOTA_STORE_uint8(v)  SATURATE_REAL(v, double, uint8_t, uint8)
+#define IOTA_STORE_uint16(v) SATURATE_REAL(v, double, uint16_t, uint16)
+#define IOTA_STORE_uint32(v) SATURATE_REAL(v, double, uint32_t, uint32)
+#define IOTA_STORE_uint64(v) SATURATE_REAL(v, double, uint64_t, uint64)
+
+#define DEFINE_IOTA_KERNEL(T, TNAME, ISA, TARGET)                                    \
+    TARGET static inline void iota_block_##TNAME##_##ISA(T* out, double start,       \
+                                                         double step, size_t base,   \
+                                                         size_t m) {                 \
+        double b = (double)base;                                                     \
+        for (int j = 0; j < (int)m; j++) {                                           \
+            double v = start + (b + (double)j) * step;                               \
+            out[j] = IOTA_STORE_##TNAME(v);                                          \
+        }                                                                            \
+    }                                                                                \
+    TARGET static void kernel_iota_##TNAME##_##ISA(void* pdst, double start,         \
+                                                   double step, size_t n) {          \
+        T* dst = (T*)pdst;                                                           \
+        bool stream = use_streaming_stores(n * sizeof(T));                           \
+        size_t block = stream ? IOTA_CHUNK_BYTES / sizeof(T) : ((size_t)1 << 30);    \
+        _Alignas(64) T chunk[IOTA_CHUNK_BYTES / sizeof(T)];                          \
+        for (size_t base = 0; base < n; base += block) {                             \
+            size_t m = n - base < block ? n - base : block;                          \
+            if (stream) {                                                            \
+                iota_block_##TNAME##_##ISA(chunk, start, step, base, m);             \
+                stream_copy_##ISA((char*)(dst + base), (const char*)chunk,           \
+                                  m * sizeof(T));                                    \
+            } else {                                                                 \
+                iota_block_##TNAME##_##ISA(dst + base, start, step, base, m);        \
+            }                                                                        \
+        }                                                                            \
+    }
+
+// Reductions keep REDUCE_LANES independent accumulators so the vectorizer can
+// map them onto SIMD registers without reassociating a single running sum.
+// Sums are pairwise: PAIRWISE_BLOCK elements per leaf, then halves combined,
+// which keeps float error at O(log n) instead of O(n). ACC is the accumulator
+// type (double for real types, long long for integer types) and SUM_T the type
+// KERNEL_SUM writes: double, except INT64 and UINT64, whose sums stay exact
+// (wrapping) 64-bit integers that a double could not hold.
+#define REDUCE_LANES 16
+#define PAIRWISE_BLOCK 128
+
+#define COMBINE_LANES(lanes, OP)                                                     \
+    for (int w = REDUCE_LANES / 2; w > 0; w /= 2)                                    \
+        for (int k = 0; k < w; k++) lanes[k] = OP(lanes[k], lanes[k + w]);
+
+#define REDUCE_ADD(x, y) ((x) + (y))
+#define REDUCE_MUL(x, y) ((x) * (y))
+
+// Minimum and maximum where a NaN operand wins (np.minimum, np.maximum), so
+// MIN and MAX reductions are NaN whenever any element is. Ties and two NaNs
+// keep x, the earlier element. Bitwise & and | leave no branch for the
+// vectorizer to trip over.
+#define NAN_MIN(x, y) (((x) == (x)) & (((y) < (x)) | ((y) != (y))) ? (y) : (x))
+#define NAN_MAX(x, y) (((x) == (x)) & (((y) > (x)) | ((y) != (y))) ? (y) : (x))
+
+#define DEFINE_REDUCE_KERNELS(T, ACC, SUM_T, SUFFIX, TARGET)                         \
+    TARGET static ACC sum_block_##SUFFIX(const T* a, size_t n) {                     \
+        ACC lanes[REDUCE_LANES] = {0};                                               \
+        size_t i = 0;                                                                \
+        for (; i + REDUCE_LANES <= n; i += REDUCE_LANES)                             \
+            for (int k = 0; k < REDUCE_LANES; k++) lanes[k] += (ACC)a[i + k];        \
+        for (; i < n; i++) lanes[0] += (ACC)a[i];                                    \
+        COMBINE_LANES(lanes, REDUCE_ADD)                                             \
+        return lanes[0];                                                             \
+    }                                                                                \
+    TARGET static ACC sum_pairwise_##SUFFIX(const T* a, size_t n) {                  \
+        if (n <= PAIRWISE_BLOCK) return sum_block_##SUFFIX(a, n);                    \
+        size_t half = (n / 2) & ~(size_t)(REDUCE_LANES - 1);                         \
+        return sum_pairwise_##SUFFIX(a, half) + sum_pairwise_##SUFFIX(a + half, n - half); \
+    }                                                                                \
+    TARGET static void kernel_sum_##SUFFIX(const void* src, size_t n, void* result) { \
+        *(SUM_T*)result = (SUM_T)sum_pairwise_##SUFFIX((const T*)src, n);            \
+    }                                                                                \
+    TARGET static void kernel_prod_##SUFFIX(const void* src, size_t n, void* result) { \
+        const T* a = (const T*)src;                                                  \
+        double lanes[REDUCE_LANES];                                                  \
+        for (int k = 0; k < REDUCE_LANES; k++) lanes[k] = 1.0;                       \
+        size_t i = 0;                                                                \
+        for (; i + REDUCE_LANES <= n; i += REDUCE_LANES)                             \
+            for (int k = 0; k < REDUCE_LANES; k++) lanes[k] *= (double)a[i + k];     \
+        for (; i < n; i++) lanes[0] *= (double)a[i];                                 \
+        COMBINE_LANES(lanes, REDUCE_MUL)                                             \
+        *(double*)result = lanes[0];                                                 \
+    }                                                                                \
+    DEFINE_MINMAX_KERNEL(reduce_min, T, SUFFIX, TARGET, NAN_MIN)                     \
+    DEFINE_MINMAX_KERNEL(reduce_max, T, SUFFIX, TARGET, NAN_MAX)                     \
+    TARGET static void kernel_sum_rows_##SUFFIX(const void* src, double* acc, size_t n) { \
+        const T* a = (const T*)src;                                                  \
+        for (size_t i = 0; i < n; i++) acc[i] += (double)a[i];                       \
+    }                                                                                \
+    TARGET static void kernel_prod_rows_##SUFFIX(const void* src, double* acc, size_t n) { \
+        const T* a = (const T*)src;                                                  \
+        for (size_t i = 0; i < n; i++) acc[i] *= (double)a[i];                       \
+    }
+
+// Result has the element type; n must be at least 1
+#define DEFINE_MINMAX_KERNEL(NAME, T, SUFFIX, TARGET, OP)                            \
+    TARGET static void kernel_##NAME##_##SUFFIX(const void* src, size_t n, void* result) { \
+        const T* a = (const T*)src;                                                  \
+        T lanes[REDUCE_LANES];                                                       \
+        for (int k = 0; k < REDUCE_LANES; k++) lanes[k] = a[0];                      \
+        size_t i = 0;                                                                \
+        for (; i + REDUCE_LANES <= n; i += REDUCE_LANES)                             \
+            for (int k = 0; k < REDUCE_LANES; k++) lanes[k] = OP(lanes[k], a[i + k]); \
+        for (; i < n; i++) lanes[0] = OP(lanes[0], a[i]);                            \
+        COMBINE_LANES(lanes, OP)                                                     \
+        *(T*)result = lanes[0];                                                      \
+    }
+
+// Integer division by zero yields 0 instead of trapping. Signed types also
+// divide by -1 as a negation through UT, their unsigned counterpart, so the
+// minimum value wraps to itself (as in NumPy) instead of trapping.
+#define INT_DIV_EXPR  (y != 0 ? x / y : 0)
+#define SINT_DIV_EXPR(UT) (y == -1 ? (UT)(0u - (UT)x) : y != 0 ? (UT)(x / y) : (UT)0)
+#define REAL_DIV_EXPR (x / y)
+
+// Integer multiply-adds are exact either way
+#define INT_FMA(x, y, z) ((x) * (y) + (z))
+
+// Arithmetic types: every operation. No kernel here is compiled with FMA
+// instructions available: the dispatcher only checks the FMA CPUID bit for the
+// hand-written FLOAT/DOUBLE FMA and GEMM kernels.
+#define DEFINE_NUMERIC_KERNELS(T, TNAME, ISA, TARGET, FMA_FN, DIV_EXPR, ACC, SUM_T)  \
+    DEFINE_BINARY_KERNEL(add, T, TNAME##_##ISA, TARGET, x + y)                       \
+    DEFINE_BINARY_KERNEL(sub, T, TNAME##_##ISA, TARGET, x - y)                       \
+    DEFINE_BINARY_KERNEL(mul, T, TNAME##_##ISA, TARGET, x * y)                       \
+    DEFINE_BINARY_KERNEL(div, T, TNAME##_##ISA, TARGET, DIV_EXPR)                    \
+    DEFINE_BINARY_KERNEL(min, T, TNAME##_##ISA, TARGET, NAN_MIN(x, y))               \
+    DEFINE_BINARY_KERNEL(max, T, TNAME##_##ISA, TARGET, NAN_MAX(x, y))               \
+    DEFINE_FMA_KERNEL(T, TNAME##_##ISA, TARGET, FMA_FN)                              \
+    DEFINE_COMPARE_KERNEL(T, TNAME##_##ISA, TARGET)                                  \
+    DEFINE_IOTA_KERNEL(T, TNAME, ISA, TARGET)                                        \
+    DEFINE_REDUCE_KERNELS(T, ACC, SUM_T, TNAME##_##ISA, TARGET)
+
+// BOOL: add is logical OR, mul is logical AND (NumPy semantics); no sub/div/fma
+#define DEFINE_BOOL_KERNELS(ISA, TARGET)                                             \
+    DEFINE_BINARY_KERNEL(add, bool, bool_##ISA, TARGET, x | y)                       \
+    DEFINE_BINARY_KERNEL(mul, bool, bool_##ISA, TARGET, x & y)                       \
+    DEFINE_BINARY_KERNEL(min, bool, bool_##ISA, TARGET, x & y)                       \
+    DEFINE_BINARY_KERNEL(max, bool, bool_##ISA, TARGET, x | y)                       \
+    DEFINE_COMPARE_KERNEL(bool, bool_##ISA, TARGET)                                  \
+    DEFINE_REDUCE_KERNELS(bool, long long, double, bool_##ISA, TARGET)
+
+#define DEFINE_ISA_KERNELS(ISA, TARGET)                                              \
+    DEFINE_NUMERIC_KERNELS(int, int, ISA, TARGET, INT_FMA, SINT_DIV_EXPR(unsigned int), long long, double) \
+    DEFINE_NUMERIC_KERNELS(float, float, ISA, TARGET, fmaf, REAL_DIV_EXPR, double, double) \
+    DEFINE_NUMERIC_KERNELS(double, double, ISA, TARGET, fma, REAL_DIV_EXPR, double, double) \
+    DEFINE_NUMERIC_KERNELS(char, char, ISA, TARGET, INT_FMA, SINT_DIV_EXPR(unsigned char), long long, double) \
+    DEFINE_NUMERIC_KERNELS(int8_t, int8, ISA, TARGET, INT_FMA, SINT_DIV_EXPR(uint8_t), long long, double) \
+    DEFINE_NUMERIC_KERNELS(int16_t, int16, ISA, TARGET, INT_FMA, SINT_DIV_EXPR(uint16_t), long long, double) \
+    DEFINE_NUMERIC_KERNELS(int64_t, int64, ISA, TARGET, INT_FMA, SINT_DIV_EXPR(uint64_t), unsigned long long, int64_t) \
+    DEFINE_NUMERIC_KERNELS(uint8_t, uint8, ISA, TARGET, INT_FMA, INT_DIV_EXPR, unsigned long long, double) \
+    DEFINE_NUMERIC_KERNELS(uint16_t, uint16, ISA, TARGET, INT_FMA, INT_DIV_EXPR, unsigned long long, double) \
+    DEFINE_NUMERIC_KERNELS(uint32_t, uint32, ISA, TARGET, INT_FMA, INT_DIV_EXPR, unsigned long long, double) \
+    DEFINE_NUMERIC_KERNELS(uint64_t, uint64, ISA, TARGET, INT_FMA, INT_DIV_EXPR, unsigned long long, uint64_t) \
+    DEFINE_BOOL_KERNELS(ISA, TARGET)
+
+//====================
+// Fill and copy (per element size)
+//====================
+//
+// Fill and copy only depend on the element width, so one broadcast-store and
+// one streaming-copy routine per ISA serves every type. Outputs of at least
+// get_streaming_store_threshold() bytes (the last-level cache size) use
+// non-temporal stores once the destination is vector aligned.
+
+static inline void fill_bytes_scalar(char* p, const void* value, size_t n, size_t size) {
+    switch (size) {
+        case 1: { uint8_t v; memcpy(&v, value, 1); memset(p, v, n); break; }
+        case 2: { uint16_t v; memcpy(&v, value, 2); for (size_t i = 0; i < n; i++) ((uint16_t*)p)[i] = v; break; }
+        case 4: { uint32_t v; memcpy(&v, value, 4); for (size_t i = 0; i < n; i++) ((uint32_t*)p)[i] = v; break; }
+        case 8: { uint64_t v; memcpy(&v, value, 8); for (size_t i = 0; i < n; i++) ((uint64_t*)p)[i] = v; break; }
+        default: for (size_t i = 0; i < n; i++) memcpy(p + i * size, value, size); break;
+    }
+}
+
+static inline void stream_copy_scalar(char* dst, const char* src, size_t bytes) {
+    memcpy(dst, src, bytes);
+}
+
+#if SIMD_X86
+#define DEFINE_STREAM_HELPERS(ISA, TARGET, VEC, WIDTH, LOADU, STOREU, STREAM)           \
+    TARGET static inline void fill_bytes_##ISA(char* p, const void* value, size_t n,   \
+                                               size_t size) {                          \
+        _Alignas(64) unsigned char pattern[WIDTH];                                     \
+        for (size_t k = 0; k < WIDTH; k += size) memcpy(pattern + k, value, size);     \
+        VEC v = LOADU((const VEC*)pattern);                                            \
+        size_t per_vec = WIDTH / size;                                                 \
+        bool stream = use_streaming_stores(n * size);                                  \
+                                                                                       \
+        /* Element stores until the destination is vector aligned */                  \
+        size_t i = 0;                                                                  \
+        while (i < n && i < per_vec && ((uintptr_t)(p + i * size) & (WIDTH - 1))) {   \
+            memcpy(p + i * size, value, size);                                         \
+            i++;                                                                       \
+        }                                                                              \
+        bool aligned = ((uintptr_t)(p + i * size) & (WIDTH - 1)) == 0;                 \
+        if (stream && aligned) {                                                       \
+            for (; i + per_vec <= n; i += per_vec) STREAM((VEC*)(p + i * size), v);    \
+            _mm_sfence();                                                              \
+        } else {                                                                       \
+            for (; i + per_vec <= n; i += per_vec) STOREU((VEC*)(p + i * size), v);    \
+        }                                                                              \
+        fill_bytes_scalar(p + i * size, value, n - i, size);                           \
+    }                                                                                  \
+    TARGET static inline void stream_copy_##ISA(char* dst, const char* src,            \
+                                                size_t bytes) {                        \
+        size_t head = (WIDTH - ((uintptr_t)dst & (WIDTH - 1))) & (WIDTH - 1);          \
+        if (head > bytes) head = bytes;                                                \
+        memcpy(dst, src, head);                                                        \
+        dst += head; src += head; bytes -= head;                                       \
+        for (; bytes >= WIDTH; bytes -= WIDTH, dst += WIDTH, src += WIDTH) {           \
+            STREAM((VEC*)dst, LOADU((const VEC*)src));                                 \
+        }                                                                              \
+        _mm_sfence();                                                                  \
+        memcpy(dst, src, bytes);                                                       \
+    }
+
+DEFINE_STREAM_HELPERS(sse2, TARGET_SSE2, __m128i, 16, _mm_loadu_si128, _mm_storeu_si128, _mm_stream_si128)
+DEFINE_STREAM_HELPERS(avx, TARGET_AVX, __m256i, 32, _mm256_loadu_si256, _mm256_storeu_si256, _mm256_stream_si256)
+DEFINE_STREAM_HELPERS(avx512, TARGET_AVX512, __m512i, 64, _mm512_loadu_si512, _mm512_storeu_si512, _mm512_stream_si512)
+
+// AVX2 adds nothing for byte moves; reuse the AVX routines
+#define fill_bytes_avx2 fill_bytes_avx
+#define stream_copy_avx2 stream_copy_avx
+#endif
+
+#define DEFINE_SIZED_KERNELS(SIZE, ISA, TARGET)                                        \
+    TARGET static void kernel_fill_##SIZE##_##ISA(void* dst, const void* value,        \
+                                                  size_t n) {                          \
+        fill_bytes_##ISA((char*)dst, value, n, SIZE);                                  \
+    }                                                                                  \
+    TARGET static void kernel_copy_##SIZE##_##ISA(void* dst, const void* src,          \
+                                                  size_t n) {                          \
+        if (use_streaming_stores(n * SIZE)) {                                          \
+            stream_copy_##ISA((char*)dst, (const char*)src, n * SIZE);                 \
+        } else {                                                                       \
+            memcpy(dst, src, n * SIZE);                                                \
+        }                                                                              \
+    }
+
+#define DEFINE_ISA_SIZED_KERNELS(ISA, TARGET)                                          \
+    DEFINE_SIZED_KERNELS(1, ISA, TARGET)                                               \
+    DEFINE_SIZED_KERNELS(2, ISA, TARGET)                                               \
+    DEFINE_SIZED_KERNELS(4, ISA, TARGET)                                               \
+    DEFINE_SIZED_KERNELS(8, ISA, TARGET)
+
+DEFINE_ISA_SIZED_KERNELS(scalar, NO_TARGET)
+#if SIMD_X86
+DEFINE_ISA_SIZED_KERNELS(sse2, TARGET_SSE2)
+DEFINE_ISA_SIZED_KERNELS(avx, TARGET_AVX)
+DEFINE_ISA_SIZED_KERNELS(avx2, TARGET_AVX2)
+DEFINE_ISA_SIZED_KERNELS(avx512, TARGET_AVX512)
+#endif
+
+//====================
+// Compaction (per element size)
+//====================
+//
+// dst receives the elements of src whose mask byte is nonzero, in order, and
+// the kernel returns how many. The SIMD variants turn a group of mask bytes
+// into a bit mask and left-pack the selected lanes: AVX-512 with its compress
+// instructions, AVX2 with a permutation looked up by the bit mask. Stores are
+// masked to the selected lanes, so nothing is written past the last one (a
+// caller may compact neighbouring blocks into one output concurrently).
+
+#define DEFINE_COMPRESS_SCALAR(SIZE, T)                                              \
+    static size_t kernel_compress_##SIZE##_scalar(const void* psrc, const bool* mask, \
+                                                  void* pdst, size_t n) {            \
+        const T* src = (const T*)psrc;                                               \
+        T* dst = (T*)pdst;                                                           \
+        size_t k = 0;                                                                \
+        for (size_t i = 0; i < n; i++) {                                             \
+            if (mask[i]) dst[k++] = src[i];                                          \
+        }                                                                            \
+        return k;                                                                    \
+    }
+
+DEFINE_COMPRESS_SCALAR(1, uint8_t)
+DEFINE_COMPRESS_SCALAR(2, uint16_t)
+DEFINE_COMPRESS_SCALAR(4, uint32_t)
+DEFINE_COMPRESS_SCALAR(8, uint64_t)
+
+#if SIMD_X86
+// Left-packing tables indexed by a bit mask of selected lanes
+static uint8_t compress_count[256];                 // popcount
+static _Alignas(32) int32_t compress_perm_4[256][8]; // 8 x 32-bit lanes
+static _Alignas(32) int32_t compress_perm_8[16][8];  // 4 x 64-bit lanes, as 32-bit pairs
+static _Alignas(16) uint8_t compress_shuffle_1[256][16]; // 8 bytes (0x80 clears a byte)
+
+static void init_compress_tables(void) {
+    for (int m = 0; m < 256; m++) {
+        int k = 0;
+        memset(compress_shuffle_1[m], 0x80, sizeof(compress_shuffle_1[m]));
+        for (int i = 0; i < 8; i++) {
+            if (!(m >> i & 1)) continue;
+            compress_perm_4[m][k] = i;
+            compress_shuffle_1[m][k] = (uint8_t)i;
+            if (m < 16) {
+                compress_perm_8[m][2 * k] = 2 * i;
+                compress_perm_8[m][2 * k + 1] = 2 * i + 1;
+            }
+            k++;
+        }
+        compress_count[m] = (uint8_t)k;
+    }
+}
+
+// Bit i set when mask[i] is nonzero, for 8 mask bytes
+TARGET_AVX2 static inline unsigned mask_bits_8(const bool* mask) {
+    __m128i v = _mm_loadl_epi64((const __m128i*)mask);
+    __m128i zero = _mm_cmpeq_epi8(v, _mm_setzero_si128());
+    return ~(unsigned)_mm_movemask_epi8(zero) & 0xFF;
+}
+
+TARGET_AVX2 static size_t kernel_compress_1_avx2(const void* psrc, const bool* mask,
+                                                 void* pdst, size_t n) {
+    const uint8_t* src = (const uint8_t*)psrc;
+    uint8_t* dst = (uint8_t*)pdst;
+    // Bytes are packed 8 at a time into a staging buffer, then copied out
+    _Alignas(16) uint8_t stage[256];
+    size_t staged = 0, k = 0, i = 0;
+    for (; i + 8 <= n; i += 8) {
+        unsigned bits = mask_bits_8(mask + i);
+        __m128i v = _mm_loadl_epi64((const __m128i*)(src + i));
+        __m128i shuffle = _mm_load_si128((const __m128i*)compress_shuffle_1[bits]);
+        _mm_storel_epi64((__m128i*)(stage + staged), _mm_shuffle_epi8(v, shuffle));
+        staged += compress_count[bits];
+        if (staged > sizeof(stage) - 8) {
+            memcpy(dst + k, stage, staged);
+            k += staged;
+            staged = 0;
+        }
+    }
+    memcpy(dst + k, stage, staged);
+    k += staged;
+    for (; i < n; i++) {
+        if (mask[i]) dst[k++] = src[i];
+    }
+    return k;
+}
+
+TARGET_AVX2 static size_t kernel_compress_4_avx2(const void* psrc, const bool* mask,
+                                                 void* pdst, size_t n) {
+    const int32_t* src = (const int32_t*)psrc;
+    int32_t* dst = (int32_t*)pdst;
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    size_t k = 0, i = 0;
+    for (; i + 8 <= n; i += 8) {
+        unsigned bits = mask_bits_8(mask + i);
+        if (bits == 0) continue;
+        __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i perm = _mm256_load_si256((const __m256i*)compress_perm_4[bits]);
+        __m256i keep = _mm256_cmpgt_epi32(_mm256_set1_epi32(compress_count[bits]), lanes);
+        _mm256_maskstore_epi32((int*)(dst + k), keep, _mm256_permutevar8x32_epi32(v, perm));
+        k += compress_count[bits];
+    }
+    for (; i < n; i++) {
+        if (mask[i]) dst[k++] = src[i];
+    }
+    return k;
+}
+
+TARGET_AVX2 static size_t kernel_compress_8_avx2(const void* psrc, const bool* mask,
+                                                 void* pdst, size_t n) {
+    const int64_t* src = (const int64_t*)psrc;
+    int64_t* dst = (int64_t*)pdst;
+    const __m256i lanes = _mm256_setr_epi64x(0, 1, 2, 3);
+    size_t k = 0, i = 0;
+    for (; i + 8 <= n; i += 8) {
+        unsigned bits = mask_bits_8(mask + i);
+        for (int half = 0; half < 2 && bits != 0; half++, bits >>= 4) {
+            unsigned b = bits & 0xF;
+            if (b == 0) continue;
+            __m256i v = _mm256_loadu_si256((const __m256i*)(src + i + 4 * half));
+            __m256i perm = _mm256_load_si256((const __m256i*)compress_perm_8[b]);
+            __m256i keep = _mm256_cmpgt_epi64(_mm256_set1_epi64x(compress_count[b]), lanes);
+            _mm256_maskstore_epi64((long long*)(dst + k), keep, _mm256_permutevar8x32_epi32(v, perm));
+            k += compress_count[b];
+        }
+    }
+    for (; i < n; i++) {
+        if (mask[i]) dst[k++] = src[i];
+    }
+    return k;
+}
+
+// Selected lanes of 16 mask bytes as an AVX-512 mask register
+TARGET_AVX512 static inline __mmask16 mask_bits_16(const bool* mask) {
+    __m512i m = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)mask));
+    return _mm512_test_epi32_mask(m, m);
+}
+
+TARGET_AVX512 static size_t kernel_compress_1_avx512(const void* psrc, const bool* mask,
+                                                     void* pdst, size_t n) {
+    const uint8_t* src = (const uint8_t*)psrc;
+    uint8_t* dst = (uint8_t*)pdst;
+    size_t k = 0, i = 0;
+    // Bytes are widened to 32-bit lanes, compressed, and narrowed on the store
+    for (; i + 16 <= n; i += 16) {
+        __mmask16 bits = mask_bits_16(mask + i);
+        if (bits == 0) continue;
+        __m512i v = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(src + i)));
+        unsigned count = compress_count[bits & 0xFF] + compress_count[bits >> 8];
+        _mm512_mask_cvtepi32_storeu_epi8(dst + k, (__mmask16)((1u << count) - 1),
+                                         _mm512_maskz_compress_epi32(bits, v));
+        k += count;
+    }
+    for (; i < n; i++) {
+        if (mask[i]) dst[k++] = src[i];
+    }
+    return k;
+}
+
+TARGET_AVX512 static size_t kernel_compress_4_avx512(const void* psrc, const bool* mask,
+                                                     void* pdst, size_t n) {
+    const int32_t* src = (const int32_t*)psrc;
+    int32_t* dst = (int32_t*)pdst;
+    size_t k = 0, i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __mmask16 bits = mask_bits_16(mask + i);
+        if (bits == 0) continue;
+        __m512i v = _mm512_loadu_si512((const void*)(src + i));
+        unsigned count = compress_count[bits & 0xFF] + compress_count[bits >> 8];
+        _mm512_mask_storeu_epi32(dst + k, (__mmask16)((1u << count) - 1),
+                                 _mm512_maskz_compress_epi32(bits, v));
+        k += count;
+    }
+    for (; i < n; i++) {
+        if (mask[i]) dst[k++] = src[i];
+    }
+    return k;
+}
+
+TARGET_AVX512 static size_t kernel_compress_8_avx512(const void* psrc, const bool* mask,
+                                                     void* pdst, size_t n) {
+    const int64_t* src = (const int64_t*)psrc;
+    int64_t* dst = (int64_t*)pdst;
+    size_t k = 0, i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512i m = _mm512_cvtepu8_epi64(_mm_loadl_epi64((const __m128i*)(mask + i)));
+        __mmask8 bits = _mm512_test_epi64_mask(m, m);
+        if (bits == 0) continue;
+        __m512i v = _mm512_loadu_si512((const void*)(src + i));
+        unsigned count = compress_count[bits];
+        _mm512_mask_storeu_epi64(dst + k, (__mmask8)((1u << count) - 1),
+                                 _mm512_maskz_compress_epi64(bits, v));
+        k += count;
+    }
+    for (; i < n; i++) {
+        if (mask[i]) dst[k++] = src[i];
+    }
+    return k;
+}
+#endif
+
+//====================
+// Gather and scatter (per element size)
+//====================
+//
+// TAKE reads src[indices[i]] and PUT writes dst[indices[i]] for indices the
+// caller has already bounds-checked. Random indices into an array larger than
+// the caches miss on almost every element, so with prefetch > 0 each kernel
+// touches the element `prefetch` positions ahead while it moves the current
+// one. AVX2 and AVX-512 gather 4- and 8-byte elements a vector at a time;
+// only AVX-512 can scatter, and its scatters write lanes in order, so the last
+// of several equal indices still wins.
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PREFETCH_READ(p) __builtin_prefetch((p), 0, 3)
+#define PREFETCH_WRITE(p) __builtin_prefetch((p), 1, 3)
+#elif SIMD_X86
+#define PREFETCH_READ(p) _mm_prefetch((const char*)(p), _MM_HINT_T0)
+#define PREFETCH_WRITE(p) _mm_prefetch((const char*)(p), _MM_HINT_T0)
+#else
+#define PREFETCH_READ(p) ((void)(p))
+#define PREFETCH_WRITE(p) ((void)(p))
+#endif
+
+// Prefetch the `lanes` elements a vector step will need `prefetch` elements from now
+#define PREFETCH_AHEAD(PREFETCH_OP, base, indices, i, lanes, n, prefetch)            \
+    if (prefetch > 0 && i + prefetch + lanes <= n) {                                 \
+        for (size_t j = 0; j < lanes; j++) PREFETCH_OP(base + indices[i + prefetch + j]); \
+    }
+
+#define DEFINE_GATHER_SCALAR(SIZE, T)                                                \
+    static void kernel_take_##SIZE##_scalar(const void* psrc, const int* indices,   \
+                                            void* pdst, size_t n, size_t prefetch) { \
+        const T* src = (const T*)psrc;                                               \
+        T* dst = (T*)pdst;                                                           \
+        size_t i = 0;                                                                \
+        if (prefetch > 0) {                                                          \
+            for (; i + prefetch < n; i++) {                                          \
+                PREFETCH_READ(src + indices[i + prefetch]);                          \
+                dst[i] = src[indices[i]];                                            \
+            }                                                                        \
+        }                                                                            \
+        for (; i < n; i++) dst[i] = src[indices[i]];                                 \
+    }                                                                                \
+    static void kernel_put_##SIZE##_scalar(void* pdst, const int* indices,          \
+                                           const void* pvalues, size_t n,            \
+                                           size_t prefetch) {                        \
+        const T* values = (const T*)pvalues;                                         \
+        T* dst = (T*)pdst;                                                           \
+        size_t i = 0;                                                                \
+        if (prefetch > 0) {                                                          \
+            for (; i + prefetch < n; i++) {                                          \
+                PREFETCH_WRITE(dst + indices[i + prefetch]);                         \
+                dst[indices[i]] = values[i];                                         \
+            }                                                                        \
+        }                                                                            \
+        for (; i < n; i++) dst[indices[i]] = values[i];                              \
+    }
+
+DEFINE_GATHER_SCALAR(1, uint8_t)
+DEFINE_GATHER_SCALAR(2, uint16_t)
+DEFINE_GATHER_SCALAR(4, uint32_t)
+DEFINE_GATHER_SCALAR(8, uint64_t)
+
+#if SIMD_X86
+TARGET_AVX2 static void kernel_take_4_avx2(const void* psrc, const int* indices,
+                                           void* pdst, size_t n, size_t prefetch) {
+    const int32_t* src = (const int32_t*)psrc;
+    int32_t* dst = (int32_t*)pdst;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        PREFETCH_AHEAD(PREFETCH_READ, src, indices, i, 8, n, prefetch)
+        __m256i idx = _mm256_loadu_si256((const __m256i*)(indices + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_i32gather_epi32((const int*)src, idx, 4));
+    }
+    for (; i < n; i++) dst[i] = src[indices[i]];
+}
+
+TARGET_AVX2 static void kernel_take_8_avx2(const void* psrc, const int* indices,
+                                           void* pdst, size_t n, size_t prefetch) {
+    const int64_t* src = (const int64_t*)psrc;
+    int64_t* dst = (int64_t*)pdst;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        PREFETCH_AHEAD(PREFETCH_READ, src, indices, i, 4, n, prefetch)
+        __m128i idx = _mm_loadu_si128((const __m128i*)(indices + i));
+        _mm256_storeu_si256((__m256i*)(dst + i),
+                            _mm256_i32gather_epi64((const long long*)src, idx, 8));
+    }
+    for (; i < n; i++) dst[i] = src[indices[i]];
+}
+
+TARGET_AVX512 static void kernel_take_4_avx512(const void* psrc, const int* indices,
+                                               void* pdst, size_t n, size_t prefetch) {
+    const int32_t* src = (const int32_t*)psrc;
+    int32_t* dst = (int32_t*)pdst;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        PREFETCH_AHEAD(PREFETCH_READ, src, indices, i, 16, n, prefetch)
+        __m512i idx = _mm512_loadu_si512((const void*)(indices + i));
+        _mm512_storeu_si512((void*)(dst + i), _mm512_i32gather_epi32(idx, (const void*)src, 4));
+    }
+    for (; i < n; i++) dst[i] = src[indices[i]];
+}
+
+TARGET_AVX512 static void kernel_take_8_avx512(const void* psrc, const int* indices,
+                                               void* pdst, size_t n, size_t prefetch) {
+    const int64_t* src = (const int64_t*)psrc;
+    int64_t* dst = (int64_t*)pdst;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        PREFETCH_AHEAD(PREFETCH_READ, src, indices, i, 8, n, prefetch)
+        __m256i idx = _mm256_loadu_si256((const __m256i*)(indices + i));
+        _mm512_storeu_si512((void*)(dst + i), _mm512_i32gather_epi64(idx, (const void*)src, 8));
+    }
+    for (; i < n; i++) dst[i] = src[indices[i]];
+}
+
+TARGET_AVX512 static void kernel_put_4_avx512(void* pdst, const int* indices,
+                                              const void* pvalues, size_t n, size_t prefetch) {
+    const int32_t* values = (const int32_t*)pvalues;
+    int32_t* dst = (int32_t*)pdst;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        PREFETCH_AHEAD(PREFETCH_WRITE, dst, indices, i, 16, n, prefetch)
+        __m512i idx = _mm512_loadu_si512((const void*)(indices + i));
+        _mm512_i32scatter_epi32((void*)dst, idx, _mm512_loadu_si512((const void*)(values + i)), 4);
+    }
+    for (; i < n; i++) dst[indices[i]] = values[i];
+}
+
+TARGET_AVX512 static void kernel_put_8_avx512(void* pdst, const int* indices,
+                                              const void* pvalues, size_t n, size_t prefetch) {
+    const int64_t* values = (const int64_t*)pvalues;
+    int64_t* dst = (int64_t*)pdst;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        PREFETCH_AHEAD(PREFETCH_WRITE, dst, indices, i, 8, n, prefetch)
+        __m256i idx = _mm256_loadu_si256((const __m256i*)(indices + i));
+        _mm512_i32scatter_epi64((void*)dst, idx, _mm512_loadu_si512((const void*)(values + i)), 8);
+    }
+    for (; i < n; i++) dst[indices[i]] = values[i];
+}
+#endif
+
+//====================
+// Transpose (per element size)
+//====================
+//
+// dst[c][r] = src[r][c] for a rows x cols block. Callers hand in blocks sized
+// to stay in L1; within a block the SIMD variants transpose square micro-tiles
+// in registers (4x4 floats with SSE2, 8x8 floats and 4x4 doubles with AVX) and
+// finish the ragged edges element by element. 4-byte kernels move INT bits
+// through float registers, which shuffles never alter.
+
+#define DEFINE_TRANSPOSE_KERNEL(SIZE, T, ISA, TARGET, B, MICRO)                      \
+    TARGET static void kernel_transpose_##SIZE##_##ISA(const void* psrc, ptrdiff_t ss, \
+                                                       void* pdst, ptrdiff_t ds,     \
+                                                       size_t rows, size_t cols) {   \
+        const T* src = (const T*)psrc;                                               \
+        T* dst = (T*)pdst;                                                           \
+        size_t r = 0;                                                                \
+        for (; B > 1 && r + B <= rows; r += B) {                                     \
+            size_t c = 0;                                                            \
+            for (; c + B <= cols; c += B) {                                          \
+                MICRO(src + (ptrdiff_t)r * ss + (ptrdiff_t)c, ss,                    \
+                      dst + (ptrdiff_t)c * ds + (ptrdiff_t)r, ds);                   \
+            }                                                                        \
+            for (; c < cols; c++) {                                                  \
+                for (size_t k = 0; k < B; k++)                                       \
+                    dst[(ptrdiff_t)c * ds + (ptrdiff_t)(r + k)] = src[(ptrdiff_t)(r + k) * ss + (ptrdiff_t)c]; \
+            }                                                                        \
+        }                                                                            \
+        for (; r < rows; r++) {                                                      \
+            for (size_t c = 0; c < cols; c++)                                        \
+                dst[(ptrdiff_t)c * ds + (ptrdiff_t)r] = src[(ptrdiff_t)r * ss + (ptrdiff_t)c]; \
+        }                                                                            \
+    }
+
+// The scalar variants have no micro-tile
+#define NO_MICRO(src, ss, dst, ds) ((void)0)
+
+DEFINE_TRANSPOSE_KERNEL(1, uint8_t, scalar, NO_TARGET, 1, NO_MICRO)
+DEFINE_TRANSPOSE_KERNEL(2, uint16_t, scalar, NO_TARGET, 1, NO_MICRO)
+DEFINE_TRANSPOSE_KERNEL(4, uint32_t, scalar, NO_TARGET, 1, NO_MICRO)
+DEFINE_TRANSPOSE_KERNEL(8, uint64_t, scalar, NO_TARGET, 1, NO_MICRO)
+
+#if SIMD_X86
+TARGET_SSE2 static inline void transpose_4x4_ps(const float* src, ptrdiff_t ss, float* dst, ptrdiff_t ds) {
+    __m128 r0 = _mm_loadu_ps(src);
+    __m128 r1 = _mm_loadu_ps(src + ss);
+    __m128 r2 = _mm_loadu_ps(src + 2 * ss);
+    __m128 r3 = _mm_loadu_ps(src + 3 * ss);
+    _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+    _mm_storeu_ps(dst, r0);
+    _mm_storeu_ps(dst + ds, r1);
+    _mm_storeu_ps(dst + 2 * ds, r2);
+    _mm_storeu_ps(dst + 3 * ds, r3);
+}
+
+TARGET_AVX static inline void transpose_8x8_ps(const float* src, ptrdiff_t ss, float* dst, ptrdiff_t ds) {
+    __m256 r[8], t[8];
+    for (int k = 0; k < 8; k++) r[k] = _mm256_loadu_ps(src + k * ss);
+    // Interleave row pairs, then gather 4-element column pieces per 128-bit lane
+    for (int k = 0; k < 8; k += 2) {
+        t[k] = _mm256_unpacklo_ps(r[k], r[k + 1]);
+        t[k + 1] = _mm256_unpackhi_ps(r[k], r[k + 1]);
+    }
+    for (int k = 0; k < 8; k += 4) {
+        r[k] = _mm256_shuffle_ps(t[k], t[k + 2], _MM_SHUFFLE(1, 0, 1, 0));
+        r[k + 1] = _mm256_shuffle_ps(t[k], t[k + 2], _MM_SHUFFLE(3, 2, 3, 2));
+        r[k + 2] = _mm256_shuffle_ps(t[k + 1], t[k + 3], _MM_SHUFFLE(1, 0, 1, 0));
+        r[k + 3] = _mm256_shuffle_ps(t[k + 1], t[k + 3], _MM_SHUFFLE(3, 2, 3, 2));
+    }
+    // Column k is the low lane of rows 0-3 next to the low lane of rows 4-7
+    for (int k = 0; k < 4; k++) {
+        _mm256_storeu_ps(dst + k * ds, _mm256_permute2f128_ps(r[k], r[k + 4], 0x20));
+        _mm256_storeu_ps(dst + (k + 4) * ds, _mm256_permute2f128_ps(r[k], r[k + 4], 0x31));
+    }
+}
+
+TARGET_AVX static inline void transpose_4x4_pd(const double* src, ptrdiff_t ss, double* dst, ptrdiff_t ds) {
+    __m256d r0 = _mm256_loadu_pd(src);
+    __m256d r1 = _mm256_loadu_pd(src + ss);
+    __m256d r2 = _mm256_loadu_pd(src + 2 * ss);
+    __m256d r3 = _mm256_loadu_pd(src + 3 * ss);
+    __m256d t0 = _mm256_unpacklo_pd(r0, r1);
+    __m256d t1 = _mm256_unpackhi_pd(r0, r1);
+    __m256d t2 = _mm256_unpacklo_pd(r2, r3);
+    __m256d t3 = _mm256_unpackhi_pd(r2, r3);
+    _mm256_storeu_pd(dst, _mm256_permute2f128_pd(t0, t2, 0x20));
+    _mm256_storeu_pd(dst + ds, _mm256_permute2f128_pd(t1, t3, 0x20));
+    _mm256_storeu_pd(dst + 2 * ds, _mm256_permute2f128_pd(t0, t2, 0x31));
+    _mm256_storeu_pd(dst + 3 * ds, _mm256_permute2f128_pd(t1, t3, 0x31));
+}
+
+DEFINE_TRANSPOSE_KERNEL(4, float, sse2, TARGET_SSE2, 4, transpose_4x4_ps)
+DEFINE_TRANSPOSE_KERNEL(4, float, avx, TARGET_AVX, 8, transpose_8x8_ps)
+DEFINE_TRANSPOSE_KERNEL(8, double, avx, TARGET_AVX, 4, transpose_4x4_pd)
+#endif
+
+//====================
+// Matrix multiply micro-kernels
+//====================
+//
+// Each call computes one GEMM_MR x NR tile of C from a packed A sliver (k
+// groups of GEMM_MR row values) and a packed B sliver (k groups of NR column
+// values), keeping the whole tile in registers for the length of k: every
+// step loads one B row, broadcasts each A value and issues 2 * GEMM_MR fused
+// multiply-adds. array_linalg.c does the packing and cache blocking around it.
+
+#define GEMM_MR 6
+
+#define DEFINE_GEMM_SCALAR(T, TNAME)                                                 \
+    static void kernel_gemm_##TNAME##_scalar(size_t k, const void* pa, const void* pb, \
+                                             void* pc, ptrdiff_t ldc, bool accumulate) { \
+        const T* a = (const T*)pa;                                                   \
+        const T* b = (const T*)pb;                                                   \
+        T* c = (T*)pc;                                                               \
+        T acc[4][4] = { { 0 } };                                                     \
+        for (size_t p = 0; p < k; p++, a += 4, b += 4) {                             \
+            for (int i = 0; i < 4; i++) {                                            \
+                for (int j = 0; j < 4; j++) acc[i][j] += a[i] * b[j];                \
+            }                                                                        \
+        }                                                                            \
+        for (int i = 0; i < 4; i++) {                                                \
+            T* row = c + (ptrdiff_t)i * ldc;                                         \
+            for (int j = 0; j < 4; j++) row[j] = accumulate ? row[j] + acc[i][j] : acc[i][j]; \
+        }                                                                            \
+    }                                                                                \
+    static const GemmKernel gemm_##TNAME##_scalar = { kernel_gemm_##TNAME##_scalar, 4, 4 };
+
+DEFINE_GEMM_SCALAR(float, float)
+DEFINE_GEMM_SCALAR(double, double)
+
+#if SIMD_X86
+#define DEFINE_GEMM_SIMD(T, TNAME, ISA, TARGET, VEC, LANES, SET1, ZERO, LOADU, STOREU, FMADD, ADD) \
+    TARGET static void kernel_gemm_##TNAME##_##ISA(size_t k, const void* pa, const void* pb, \
+                                                   void* pc, ptrdiff_t ldc, bool accumulate) { \
+        const T* a = (const T*)pa;                                                   \
+        const T* b = (const T*)pb;                                                   \
+        T* c = (T*)pc;                                                               \
+        VEC acc[GEMM_MR][2];                                                         \
+        for (int i = 0; i < GEMM_MR; i++) acc[i][0] = acc[i][1] = ZERO();            \
+        for (size_t p = 0; p < k; p++, a += GEMM_MR, b += 2 * LANES) {               \
+            VEC b0 = LOADU(b);                                                       \
+            VEC b1 = LOADU(b + LANES);                                               \
+            for (int i = 0; i < GEMM_MR; i++) {                                      \
+                VEC ai = SET1(a[i]);                                                 \
+                acc[i][0] = FMADD(ai, b0, acc[i][0]);                                \
+                acc[i][1] = FMADD(ai, b1, acc[i][1]);                                \
+            }                                                                        \
+        }                                                                            \
+        for (int i = 0; i < GEMM_MR; i++) {                                          \
+            T* row = c + (ptrdiff_t)i * ldc;                                         \
+            if (accumulate) {                                                        \
+                acc[i][0] = ADD(acc[i][0], LOADU(row));                              \
+                acc[i][1] = ADD(acc[i][1], LOADU(row + LANES));                      \
+            }                                                                        \
+            STOREU(row, acc[i][0]);                                                  \
+            STOREU(row + LANES, acc[i][1]);                                          \
+        }                                                                            \
+    }                                                                                \
+    static const GemmKernel gemm_##TNAME##_##ISA = { kernel_gemm_##TNAME##_##ISA, GEMM_MR, 2 * LANES };
+
+DEFINE_GEMM_SIMD(float, float, avx2, TARGET_AVX2_FMA, __m256, 8, _mm256_set1_ps, _mm256_setzero_ps,
+                 _mm256_loadu_ps, _mm256_storeu_ps, _mm256_fmadd_ps, _mm256_add_ps)
+DEFINE_GEMM_SIMD(double, double, avx2, TARGET_AVX2_FMA, __m256d, 4, _mm256_set1_pd, _mm256_setzero_pd,
+                 _mm256_loadu_pd, _mm256_storeu_pd, _mm256_fmadd_pd, _mm256_add_pd)
+DEFINE_GEMM_SIMD(float, float, avx512, TARGET_AVX512, __m512, 16, _mm512_set1_ps, _mm512_setzero_ps,
+                 _mm512_loadu_ps, _mm512_storeu_ps, _mm512_fmadd_ps, _mm512_add_ps)
+DEFINE_GEMM_SIMD(double, double, avx512, TARGET_AVX512, __m512d, 8, _mm512_set1_pd, _mm512_setzero_pd,
+                 _mm512_loadu_pd, _mm512_storeu_pd, _mm512_fmadd_pd, _mm512_add_pd)
+#endif
+
+//====================
+// Fused multiply-add (FLOAT, DOUBLE)
+//====================
+//
+// The generic FMA kernels call fmaf/fma, which only vectorize where the
+// target has FMA instructions, so the AVX2 and AVX-512 variants issue
+// vfmadd directly. Every variant rounds a * b + c once, so all of them give
+// the same bits.
+
+#if SIMD_X86
+#define DEFINE_FMA_SIMD(T, TNAME, ISA, TARGET, VEC, LANES, LOADU, STOREU, FMADD, FMA_FN) \
+    TARGET static void kernel_fmadd_##TNAME##_##ISA(const void* pa, const void* pb,  \
+                                                    const void* pc, void* pout,      \
+                                                    size_t n) {                      \
+        const T* a = (const T*)pa;                                                   \
+        const T* b = (const T*)pb;                                                   \
+        const T* c = (const T*)pc;                                                   \
+        T* out = (T*)pout;                                                           \
+        size_t i = 0;                                                                \
+        for (; i + LANES <= n; i += LANES) {                                         \
+            STOREU(out + i, FMADD(LOADU(a + i), LOADU(b + i), LOADU(c + i)));        \
+        }                                                                            \
+        for (; i < n; i++) out[i] = FMA_FN(a[i], b[i], c[i]);                        \
+    }
+
+DEFINE_FMA_SIMD(float, float, avx2, TARGET_AVX2_FMA, __m256, 8, _mm256_loadu_ps, _mm256_storeu_ps,
+                _mm256_fmadd_ps, fmaf)
+DEFINE_FMA_SIMD(double, double, avx2, TARGET_AVX2_FMA, __m256d, 4, _mm256_loadu_pd, _mm256_storeu_pd,
+                _mm256_fmadd_pd, fma)
+DEFINE_FMA_SIMD(float, float, avx512, TARGET_AVX512, __m512, 16, _mm512_loadu_ps, _mm512_storeu_ps,
+                _mm512_fmadd_ps, fmaf)
+DEFINE_FMA_SIMD(double, double, avx512, TARGET_AVX512, __m512d, 8, _mm512_loadu_pd, _mm512_storeu_pd,
+                _mm512_fmadd_pd, fma)
+#endif
+
+//====================
+// Sorting networks (per key width)
+//====================
+//
+// Sort up to SORT_BLOCK_KEYS unsigned keys: array_sort.c maps every element
+// type onto order-preserving unsigned keys first, so only unsigned compares
+// are needed here. The SIMD variants pad the block to 16 keys with the
+// largest key and run a 16-key bitonic network entirely in registers: each of
+// its 10 stages permutes the keys against their partners and blends the
+// minimum or maximum into each lane. Stages within a register use a lane
+// permutation; with 8-lane registers the one stage pairing keys 8 apart is a
+// plain min/max of the two registers.
+
+#define DEFINE_SORT_SCALAR(SIZE, T)                                                  \
+    static void kernel_sort_##SIZE##_scalar(void* pkeys, size_t n) {                 \
+        T* keys = (T*)pkeys;                                                         \
+        for (size_t i = 1; i < n; i++) {                                             \
+            T key = keys[i];                                                         \
+            size_t j = i;                                                            \
+            for (; j > 0 && keys[j - 1] > key; j--) keys[j] = keys[j - 1];           \
+            keys[j] = key;                                                           \
+        }                                                                            \
+    }
+
+DEFINE_SORT_SCALAR(1, uint8_t)
+DEFINE_SORT_SCALAR(4, uint32_t)
+DEFINE_SORT_SCALAR(8, uint64_t)
+
+#if SIMD_X86
+#define SORT_STAGES 10
+static uint8_t sort_stage_distance[SORT_STAGES];          // distance between partners
+static _Alignas(64) int32_t sort_perm_16[SORT_STAGES][16]; // partner lanes, 16-lane registers
+static __mmask16 sort_max_16[SORT_STAGES];                // lanes keeping the maximum
+static _Alignas(32) int32_t sort_perm_8[SORT_STAGES][8];   // partner lanes, 8-lane registers
+static _Alignas(64) int64_t sort_perm_8q[SORT_STAGES][8];
+static _Alignas(32) int32_t sort_max_8[SORT_STAGES][2][8]; // -1 where lane of register r keeps the max
+static __mmask8 sort_max_bits_8[SORT_STAGES][2];
+
+static void init_sort_tables(void) {
+    int s = 0;
+    for (int k = 2; k <= 16; k *= 2) {
+        for (int j = k / 2; j > 0; j /= 2, s++) {
+            sort_stage_distance[s] = (uint8_t)j;
+            for (int i = 0; i < 16; i++) {
+                // Ascending sequences where bit k of the key index is clear; the
+                // upper key of each pair keeps the max in an ascending sequence
+                bool ascending = (i & k) == 0;
+                bool upper = (i & j) != 0;
+                bool keep_max = upper == ascending;
+                int r = i / 8, lane = i % 8;
+                sort_perm_16[s][i] = i ^ j;
+                sort_perm_8[s][lane] = (lane ^ j) & 7;
+                sort_perm_8q[s][lane] = (lane ^ j) & 7;
+                sort_max_8[s][r][lane] = keep_max ? -1 : 0;
+                if (keep_max) {
+                    sort_max_16[s] |= (__mmask16)(1u << i);
+                    sort_max_bits_8[s][r] |= (__mmask8)(1u << lane);
+                }
+            }
+        }
+    }
+}
+
+TARGET_AVX2 static void kernel_sort_4_avx2(void* pkeys, size_t n) {
+    _Alignas(32) uint32_t buf[16];
+    memset(buf, 0xFF, sizeof(buf));
+    memcpy(buf, pkeys, n * sizeof(uint32_t));
+    __m256i v0 = _mm256_load_si256((const __m256i*)buf);
+    __m256i v1 = _mm256_load_si256((const __m256i*)(buf + 8));
+    for (int s = 0; s < SORT_STAGES; s++) {
+        if (sort_stage_distance[s] == 8) {
+            __m256i lo = _mm256_min_epu32(v0, v1);
+            v1 = _mm256_max_epu32(v0, v1);
+            v0 = lo;
+            continue;
+        }
+        __m256i perm = _mm256_load_si256((const __m256i*)sort_perm_8[s]);
+        __m256i p0 = _mm256_permutevar8x32_epi32(v0, perm);
+        __m256i p1 = _mm256_permutevar8x32_epi32(v1, perm);
+        v0 = _mm256_blendv_epi8(_mm256_min_epu32(v0, p0), _mm256_max_epu32(v0, p0),
+                                _mm256_load_si256((const __m256i*)sort_max_8[s][0]));
+        v1 = _mm256_blendv_epi8(_mm256_min_epu32(v1, p1), _mm256_max_epu32(v1, p1),
+                                _mm256_load_si256((const __m256i*)sort_max_8[s][1]));
+    }
+    _mm256_store_si256((__m256i*)buf, v0);
+    _mm256_store_si256((__m256i*)(buf + 8), v1);
+    memcpy(pkeys, buf, n * sizeof(uint32_t));
+}
+
+TARGET_AVX512 static void kernel_sort_4_avx512(void* pkeys, size_t n) {
+    __mmask16 valid = (__mmask16)((1u << n) - 1);
+    __m512i v = _mm512_mask_loadu_epi32(_mm512_set1_epi32(-1), valid, pkeys);
+    for (int s = 0; s < SORT_STAGES; s++) {
+        __m512i p = _mm512_permutexvar_epi32(_mm512_load_si512((const void*)sort_perm_16[s]), v);
+        v = _mm512_mask_blend_epi32(sort_max_16[s], _mm512_min_epu32(v, p), _mm512_max_epu32(v, p));
+    }
+    _mm512_mask_storeu_epi32(pkeys, valid, v);
+}
+
+TARGET_AVX512 static void kernel_sort_8_avx512(void* pkeys, size_t n) {
+    uint64_t* keys = (uint64_t*)pkeys;
+    __mmask8 valid0 = n >= 8 ? (__mmask8)0xFF : (__mmask8)((1u << n) - 1);
+    __mmask8 valid1 = n > 8 ? (__mmask8)((1u << (n - 8)) - 1) : 0;
+    __m512i v0 = _mm512_mask_loadu_epi64(_mm512_set1_epi64(-1), valid0, keys);
+    __m512i v1 = _mm512_mask_loadu_epi64(_mm512_set1_epi64(-1), valid1, keys + 8);
+    for (int s = 0; s < SORT_STAGES; s++) {
+        if (sort_stage_distance[s] == 8) {
+            __m512i lo = _mm512_min_epu64(v0, v1);
+            v1 = _mm512_max_epu64(v0, v1);
+            v0 = lo;
+            continue;
+        }
+        __m512i perm = _mm512_load_si512((const void*)sort_perm_8q[s]);
+        __m512i p0 = _mm512_permutexvar_epi64(perm, v0);
+        __m512i p1 = _mm512_permutexvar_epi64(perm, v1);
+        v0 = _mm512_mask_blend_epi64(sort_max_bits_8[s][0], _mm512_min_epu64(v0, p0), _mm512_max_epu64(v0, p0));
+        v1 = _mm512_mask_blend_epi64(sort_max_bits_8[s][1], _mm512_min_epu64(v1, p1), _mm512_max_epu64(v1, p1));
+    }
+    _mm512_mask_storeu_epi64(keys, valid0, v0);
+    _mm512_mask_storeu_epi64(keys + 8, valid1, v1);
+}
+#endif
+
+//====================
+// Key filters (per type)
+//====================
+//
+// KEY_FILTER lists the positions of elements whose sort key (the unsigned key
+// array_sort.c orders elements by: NaN largest) is below a threshold key, or
+// above it. It is the inner loop of top-k selection, where almost every
+// element fails the test. The SIMD variants compare keys in the signed domain
+// (key with its top bit flipped, which for floats is the bit pattern with the
+// magnitude bits of negatives inverted), so a register of raw elements needs
+// at most a shift, an xor and a NaN blend before the compare, and only the set
+// bits of the result are walked.
+
+static inline uint32_t sort_key_int(int32_t x) {
+    return (uint32_t)x ^ 0x80000000u;
+}
+
+static inline uint32_t sort_key_float(float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    if ((bits & 0x7FFFFFFFu) > 0x7F800000u) return UINT32_MAX;
+    return bits ^ ((bits >> 31) ? UINT32_MAX : 0x80000000u);
+}
+
+static inline uint64_t sort_key_double(double x) {
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    if ((bits & 0x7FFFFFFFFFFFFFFFull) > 0x7FF0000000000000ull) return UINT64_MAX;
+    return bits ^ ((bits >> 63) ? UINT64_MAX : 0x8000000000000000ull);
+}
+
+static inline uint8_t sort_key_char(char x) {
+    return CHAR_MIN < 0 ? (uint8_t)((uint8_t)x ^ 0x80u) : (uint8_t)x;
+}
+
+// Positions in [begin, n) of the elements passing the test, scalar
+#define FILTER_TAIL(T, KEY, src, begin, n, threshold, above, positions, count)       \
+    for (size_t i_ = (begin); i_ < (n); i_++) {                                      \
+        uint64_t key_ = KEY(((const T*)(src))[i_]);                                  \
+        if (above ? key_ > threshold : key_ < threshold) positions[count++] = (uint32_t)i_; \
+    }
+
+#define DEFINE_KEY_FILTER_SCALAR(NAME, T, KEY)                                       \
+    static size_t kernel_key_filter_##NAME##_scalar(const void* src, size_t n,       \
+                                                    uint64_t threshold, bool above,  \
+                                                    uint32_t* positions) {           \
+        size_t count = 0;                                                            \
+        FILTER_TAIL(T, KEY, src, 0, n, threshold, above, positions, count);          \
+        return count;                                                                \
+    }
+
+DEFINE_KEY_FILTER_SCALAR(int, int32_t, sort_key_int)
+DEFINE_KEY_FILTER_SCALAR(float, float, sort_key_float)
+DEFINE_KEY_FILTER_SCALAR(double, double, sort_key_double)
+DEFINE_KEY_FILTER_SCALAR(char, char, sort_key_char)
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LOWEST_BIT(bits) ((unsigned)__builtin_ctzll(bits))
+#else
+static inline unsigned lowest_bit(uint64_t bits) {
+    unsigned i = 0;
+    while (!(bits & 1)) {
+        bits >>= 1;
+        i++;
+    }
+    return i;
+}
+#define LOWEST_BIT(bits) lowest_bit(bits)
+#endif
+
+// Append base + i for every set bit i
+#define APPEND_BITS(positions, count, base, bits)                                    \
+    for (uint64_t b_ = (bits); b_; b_ &= b_ - 1) {                                   \
+        positions[count++] = (uint32_t)((base) + LOWEST_BIT(b_));                    \
+    }
+
+#if SIMD_X86
+
+// Signed-domain keys of a register of elements (INT elements already are)
+TARGET_AVX2 static inline __m256i signed_keys_int_avx2(__m256i v) {
+    return v;
+}
+
+TARGET_AVX2 static inline __m256i signed_keys_float_avx2(__m256i v) {
+    __m256i magnitude = _mm256_set1_epi32(0x7FFFFFFF);
+    __m256i keys = _mm256_xor_si256(v, _mm256_and_si256(_mm256_srai_epi32(v, 31), magnitude));
+    __m256i nan = _mm256_cmpgt_epi32(_mm256_and_si256(v, magnitude), _mm256_set1_epi32(0x7F800000));
+    return _mm256_blendv_epi8(keys, magnitude, nan);
+}
+
+TARGET_AVX2 static inline __m256i signed_keys_double_avx2(__m256i v) {
+    __m256i magnitude = _mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFll);
+    __m256i negative = _mm256_cmpgt_epi64(_mm256_setzero_si256(), v);
+    __m256i keys = _mm256_xor_si256(v, _mm256_and_si256(negative, magnitude));
+    __m256i nan = _mm256_cmpgt_epi64(_mm256_and_si256(v, magnitude), _mm256_set1_epi64x(0x7FF0000000000000ll));
+    return _mm256_blendv_epi8(keys, magnitude, nan);
+}
+
+#define MOVEMASK_PS(v) _mm256_movemask_ps(_mm256_castsi256_ps(v))
+#define MOVEMASK_PD(v) _mm256_movemask_pd(_mm256_castsi256_pd(v))
+
+#define DEFINE_KEY_FILTER_AVX2(NAME, T, S, LANES, SET1, CMPGT, MOVEMASK, KEY)        \
+    TARGET_AVX2 static size_t kernel_key_filter_##NAME##_avx2(const void* psrc,      \
+                                                              size_t n,             \
+                                                              uint64_t threshold,   \
+                                                              bool above,           \
+                                                              uint32_t* positions) { \
+        const T* src = (const T*)psrc;                                               \
+        /* The threshold key in the signed domain */                                 \
+        S bias = (S)1 << (8 * sizeof(S) - 1);                                        \
+        __m256i t = SET1((S)(threshold ^ (uint64_t)bias));                          \
+        size_t count = 0;                                                            \
+        size_t i = 0;                                                                \
+        for (; i + LANES <= n; i += LANES) {                                         \
+            __m256i keys = signed_keys_##NAME##_avx2(_mm256_loadu_si256((const __m256i*)(src + i))); \
+            __m256i hit = above ? CMPGT(keys, t) : CMPGT(t, keys);                   \
+            APPEND_BITS(positions, count, i, (uint32_t)MOVEMASK(hit));               \
+        }                                                                            \
+        FILTER_TAIL(T, KEY, src, i, n, threshold, above, positions, count);          \
+        return count;                                                                \
+    }
+
+DEFINE_KEY_FILTER_AVX2(int, int32_t, uint32_t, 8, _mm256_set1_epi32, _mm256_cmpgt_epi32, MOVEMASK_PS, sort_key_int)
+DEFINE_KEY_FILTER_AVX2(float, float, uint32_t, 8, _mm256_set1_epi32, _mm256_cmpgt_epi32, MOVEMASK_PS, sort_key_float)
+DEFINE_KEY_FILTER_AVX2(double, double, uint64_t, 4, _mm256_set1_epi64x, _mm256_cmpgt_epi64, MOVEMASK_PD, sort_key_double)
+
+TARGET_AVX512 static inline __m512i signed_keys_int_avx512(__m512i v) {
+    return v;
+}
+
+TARGET_AVX512 static inline __m512i signed_keys_float_avx512(__m512i v) {
+    __m512i magnitude = _mm512_set1_epi32(0x7FFFFFFF);
+    __m512i keys = _mm512_xor_si512(v, _mm512_and_si512(_mm512_srai_epi32(v, 31), magnitude));
+    __mmask16 nan = _mm512_cmpgt_epi32_mask(_mm512_and_si512(v, magnitude), _mm512_set1_epi32(0x7F800000));
+    return _mm512_mask_mov_epi32(keys, nan, magnitude);
+}
+
+TARGET_AVX512 static inline __m512i signed_keys_double_avx512(__m512i v) {
+    __m512i magnitude = _mm512_set1_epi64(0x7FFFFFFFFFFFFFFFll);
+    __m512i keys = _mm512_xor_si512(v, _mm512_and_si512(_mm512_srai_epi64(v, 63), magnitude));
+    __mmask8 nan = _mm512_cmpgt_epi64_mask(_mm512_and_si512(v, magnitude), _mm512_set1_epi64(0x7FF0000000000000ll));
+    return _mm512_mask_mov_epi64(keys, nan, magnitude);
+}
+
+// 4-byte elements left-pack their lane numbers with a compress instead of
+// walking the bits
+#define DEFINE_KEY_FILTER_AVX512_4(NAME, T, KEY)                                     \
+    TARGET_AVX512 static size_t kernel_key_filter_##NAME##_avx512(const void* psrc,  \
+                                                                  size_t n,         \
+                                                                  uint64_t threshold, \
+                                                                  bool above,       \
+                                                                  uint32_t* positions) { \
+        const T* src = (const T*)psrc;                                               \
+        __m512i t = _mm512_set1_epi32((int32_t)(uint32_t)(threshold ^ 0x80000000u));  \
+        __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15); \
+        size_t count = 0;                                                            \
+        size_t i = 0;                                                                \
+        for (; i + 16 <= n; i += 16) {                                               \
+            __m512i keys = signed_keys_##NAME##_avx512(_mm512_loadu_si512((const void*)(src + i))); \
+            __mmask16 hit = above ? _mm512_cmpgt_epi32_mask(keys, t)                 \
+                                  : _mm512_cmplt_epi32_mask(keys, t);                \
+            if (!hit) continue;                                                      \
+            unsigned hits = compress_count[hit & 0xFF] + compress_count[hit >> 8];   \
+            __m512i pos = _mm512_add_epi32(lanes, _mm512_set1_epi32((int32_t)i));    \
+            _mm512_mask_storeu_epi32(positions + count, (__mmask16)((1u << hits) - 1), \
+                                     _mm512_maskz_compress_epi32(hit, pos));         \
+            count += hits;                                                           \
+        }                                                                            \
+        FILTER_TAIL(T, KEY, src, i, n, threshold, above, positions, count);          \
+        return count;                                                                \
+    }
+
+DEFINE_KEY_FILTER_AVX512_4(int, int32_t, sort_key_int)
+DEFINE_KEY_FILTER_AVX512_4(float, float, sort_key_float)
+
+TARGET_AVX512 static size_t kernel_key_filter_double_avx512(const void* psrc, size_t n,
+                                                            uint64_t threshold, bool above,
+                                                            uint32_t* positions) {
+    const double* src = (const double*)psrc;
+    __m512i t = _mm512_set1_epi64((int64_t)(threshold ^ 0x8000000000000000ull));
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m512i keys = signed_keys_double_avx512(_mm512_loadu_si512((const void*)(src + i)));
+        __mmask8 hit = above ? _mm512_cmpgt_epi64_mask(keys, t) : _mm512_cmplt_epi64_mask(keys, t);
+        APPEND_BITS(positions, count, i, hit);
+    }
+    FILTER_TAIL(double, sort_key_double, src, i, n, threshold, above, positions, count);
+    return count;
+}
+#endif
+
+//====================
+// Prefix scans (per type)
+//====================
+//
+// Each output depends on the one before it, so the scalar loop cannot
+// vectorize. The SIMD variants scan a register in log2(lanes) steps, each
+// combining the register with itself shifted up by 1, 2, 4, ... lanes (the
+// vacated lanes hold the operation's identity), then combine it with the
+// broadcast carry and carry its last lane on. Float sums are reassociated
+// within a register; CUMSUM_COMPENSATED stays scalar and sequential and
+// carries a Neumaier compensation term in double. Cummin and cummax propagate
+// NaN: from the first NaN on, every output is NaN (np.minimum.accumulate).
+
+// Integer sums and products wrap (as the SIMD lanes do) instead of overflowing
+#define SCAN_ADD_INT(x, y) ((int)((unsigned)(x) + (unsigned)(y)))
+#define SCAN_MUL_INT(x, y) ((int)((unsigned)(x) * (unsigned)(y)))
+#define SCAN_ADD(x, y) ((x) + (y))
+#define SCAN_MUL(x, y) ((x) * (y))
+
+// Tail loop shared by every variant
+#define SCAN_LOOP(T, OP, src, dst, begin, n, carry, exclusive)                       \
+    if (exclusive) {                                                                 \
+        for (size_t i_ = (begin); i_ < (n); i_++) {                                  \
+            T x_ = src[i_];                                                          \
+            dst[i_] = carry;                                                         \
+            carry = OP(carry, x_);                                                   \
+        }                                                                            \
+    } else {                                                                         \
+        for (size_t i_ = (begin); i_ < (n); i_++) {                                  \
+            carry = OP(carry, src[i_]);                                              \
+            dst[i_] = carry;                                                         \
+        }                                                                            \
+    }
+
+#define DEFINE_SCAN_SCALAR(NAME, TNAME, T, OP)                                       \
+    static void kernel_##NAME##_##TNAME##_scalar(const void* psrc, void* pdst, size_t n, \
+                                                 void* pcarry, bool exclusive) {     \
+        const T* src = (const T*)psrc;                                               \
+        T* dst = (T*)pdst;                                                           \
+        T carry = *(T*)pcarry;                                                       \
+        SCAN_LOOP(T, OP, src, dst, 0, n, carry, exclusive)                           \
+        *(T*)pcarry = carry;                                                         \
+    }
+
+#define DEFINE_SCANS_SCALAR(TNAME, T, ADD, MUL)                                      \
+    DEFINE_SCAN_SCALAR(cumsum, TNAME, T, ADD)                                        \
+    DEFINE_SCAN_SCALAR(cumprod, TNAME, T, MUL)                                       \
+    DEFINE_SCAN_SCALAR(cummin, TNAME, T, NAN_MIN)                                    \
+    DEFINE_SCAN_SCALAR(cummax, TNAME, T, NAN_MAX)
+
+DEFINE_SCANS_SCALAR(int, int, SCAN_ADD_INT, SCAN_MUL_INT)
+DEFINE_SCANS_SCALAR(float, float, SCAN_ADD, SCAN_MUL)
+DEFINE_SCANS_SCALAR(double, double, SCAN_ADD, SCAN_MUL)
+
+#define DEFINE_SCAN_COMPENSATED(TNAME, T)                                            \
+    static void kernel_cumsum_compensated_##TNAME##_scalar(const void* psrc, void* pdst, \
+                                                           size_t n, void* pcarry,   \
+                                                           bool exclusive) {         \
+        const T* src = (const T*)psrc;                                               \
+        T* dst = (T*)pdst;                                                           \
+        double* carry = (double*)pcarry;                                             \
+        double sum = carry[0], compensation = carry[1];                              \
+        for (size_t i = 0; i < n; i++) {                                             \
+            double x = (double)src[i];                                               \
+            if (exclusive) dst[i] = (T)(sum + compensation);                         \
+            double t = sum + x;                                                      \
+            /* Recover the low-order bits of whichever operand was smaller */        \
+            double big = sum >= 0 ? sum : -sum, small = x >= 0 ? x : -x;             \
+            compensation += big >= small ? (sum - t) + x : (x - t) + sum;            \
+            sum = t;                                                                 \
+            if (!exclusive) dst[i] = (T)(sum + compensation);                        \
+        }                                                                            \
+        carry[0] = sum;                                                              \
+        carry[1] = compensation;                                                     \
+    }
+
+DEFINE_SCAN_COMPENSATED(float, float)
+DEFINE_SCAN_COMPENSATED(double, double)
+
+#if SIMD_X86
+// Lanes moved up by s, the lowest s lanes taken from id
+TARGET_AVX2 static inline __m256i scan_shift_epi32_avx2(__m256i v, int s, __m256i id) {
+    static const _Alignas(32) int32_t up[3][8] = {
+        { 0, 0, 1, 2, 3, 4, 5, 6 }, { 0, 0, 0, 1, 2, 3, 4, 5 }, { 0, 0, 0, 0, 0, 1, 2, 3 }
+    };
+    __m256i t = _mm256_permutevar8x32_epi32(v, _mm256_load_si256((const __m256i*)up[s == 1 ? 0 : s == 2 ? 1 : 2]));
+    return s == 1 ? _mm256_blend_epi32(t, id, 0x01) : s == 2 ? _mm256_blend_epi32(t, id, 0x03)
+                                                             : _mm256_blend_epi32(t, id, 0x0F);
+}
+
+TARGET_AVX2 static inline __m256i scan_shift_epi64_avx2(__m256i v, int s, __m256i id) {
+    return s == 1 ? _mm256_blend_epi32(_mm256_permute4x64_epi64(v, 0x90), id, 0x03)
+                  : _mm256_blend_epi32(_mm256_permute4x64_epi64(v, 0x40), id, 0x0F);
+}
+
+TARGET_AVX512 static inline __m512i scan_shift_epi32_avx512(__m512i v, int s, __m512i id) {
+    __m512i up = _mm512_sub_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+                                  _mm512_set1_epi32(s));
+    return _mm512_mask_mov_epi32(_mm512_permutexvar_epi32(up, v), (__mmask16)((1u << s) - 1), id);
+}
+
+TARGET_AVX512 static inline __m512i scan_shift_epi64_avx512(__m512i v, int s, __m512i id) {
+    __m512i up = _mm512_sub_epi64(_mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7), _mm512_set1_epi64(s));
+    return _mm512_mask_mov_epi64(_mm512_permutexvar_epi64(up, v), (__mmask8)((1u << s) - 1), id);
+}
+
+// Per (ISA, lane type): shift, broadcast of the last lane, load and store
+#define SHIFT_EPI32_AVX2(v, s, id) scan_shift_epi32_avx2(v, s, id)
+#define SHIFT_PS_AVX2(v, s, id) \
+    _mm256_castsi256_ps(scan_shift_epi32_avx2(_mm256_castps_si256(v), s, _mm256_castps_si256(id)))
+#define SHIFT_PD_AVX2(v, s, id) \
+    _mm256_castsi256_pd(scan_shift_epi64_avx2(_mm256_castpd_si256(v), s, _mm256_castpd_si256(id)))
+#define LAST_EPI32_AVX2(v) _mm256_permutevar8x32_epi32(v, _mm256_set1_epi32(7))
+#define LAST_PS_AVX2(v) _mm256_permutevar8x32_ps(v, _mm256_set1_epi32(7))
+#define LAST_PD_AVX2(v) _mm256_permute4x64_pd(v, 0xFF)
+#define LOAD_EPI32_AVX2(p) _mm256_loadu_si256((const __m256i*)(p))
+#define STORE_EPI32_AVX2(p, v) _mm256_storeu_si256((__m256i*)(p), v)
+
+#define SHIFT_EPI32_AVX512(v, s, id) scan_shift_epi32_avx512(v, s, id)
+#define SHIFT_PS_AVX512(v, s, id) \
+    _mm512_castsi512_ps(scan_shift_epi32_avx512(_mm512_castps_si512(v), s, _mm512_castps_si512(id)))
+#define SHIFT_PD_AVX512(v, s, id) \
+    _mm512_castsi512_pd(scan_shift_epi64_avx512(_mm512_castpd_si512(v), s, _mm512_castpd_si512(id)))
+#define LAST_EPI32_AVX512(v) _mm512_permutexvar_epi32(_mm512_set1_epi32(15), v)
+#define LAST_PS_AVX512(v) _mm512_permutexvar_ps(_mm512_set1_epi32(15), v)
+#define LAST_PD_AVX512(v) _mm512_permutexvar_pd(_mm512_set1_epi64(7), v)
+#define LOAD_EPI32_AVX512(p) _mm512_loadu_si512((const void*)(p))
+#define STORE_EPI32_AVX512(p, v) _mm512_storeu_si512((void*)(p), v)
+
+// NAN_MIN and NAN_MAX on registers. _mm*_min/max return their second operand
+// on ties and when either is NaN, so with the operands swapped only a NaN in b
+// needs blending back in.
+#define DEFINE_SCAN_MINMAX(NAME, ISA, TARGET, V, SUF, MINMAX, NAN_LANES, BLEND)      \
+    TARGET static inline V scan_##NAME##_##SUF##_##ISA(V a, V b) {                   \
+        return BLEND(MINMAX(b, a), b, NAN_LANES(b));                                 \
+    }
+
+#define NAN_PS_AVX2(a) _mm256_cmp_ps(a, a, _CMP_UNORD_Q)
+#define NAN_PD_AVX2(a) _mm256_cmp_pd(a, a, _CMP_UNORD_Q)
+#define NAN_PS_AVX512(a) _mm512_cmp_ps_mask(a, a, _CMP_UNORD_Q)
+#define NAN_PD_AVX512(a) _mm512_cmp_pd_mask(a, a, _CMP_UNORD_Q)
+#define BLEND_PS_AVX512(x, a, m) _mm512_mask_mov_ps(x, m, a)
+#define BLEND_PD_AVX512(x, a, m) _mm512_mask_mov_pd(x, m, a)
+
+DEFINE_SCAN_MINMAX(min, avx2, TARGET_AVX2, __m256, ps, _mm256_min_ps, NAN_PS_AVX2, _mm256_blendv_ps)
+DEFINE_SCAN_MINMAX(max, avx2, TARGET_AVX2, __m256, ps, _mm256_max_ps, NAN_PS_AVX2, _mm256_blendv_ps)
+DEFINE_SCAN_MINMAX(min, avx2, TARGET_AVX2, __m256d, pd, _mm256_min_pd, NAN_PD_AVX2, _mm256_blendv_pd)
+DEFINE_SCAN_MINMAX(max, avx2, TARGET_AVX2, __m256d, pd, _mm256_max_pd, NAN_PD_AVX2, _mm256_blendv_pd)
+DEFINE_SCAN_MINMAX(min, avx512, TARGET_AVX512, __m512, ps, _mm512_min_ps, NAN_PS_AVX512, BLEND_PS_AVX512)
+DEFINE_SCAN_MINMAX(max, avx512, TARGET_AVX512, __m512, ps, _mm512_max_ps, NAN_PS_AVX512, BLEND_PS_AVX512)
+DEFINE_SCAN_MINMAX(min, avx512, TARGET_AVX512, __m512d, pd, _mm512_min_pd, NAN_PD_AVX512, BLEND_PD_AVX512)
+DEFINE_SCAN_MINMAX(max, avx512, TARGET_AVX512, __m512d, pd, _mm512_max_pd, NAN_PD_AVX512, BLEND_PD_AVX512)
+
+#define DEFINE_SCAN_SIMD(NAME, TNAME, ISA, TARGET, T, V, LANES, LOAD, STORE, SET1,    \
+                         SHIFT, LAST, VOP, OP, IDENTITY)                             \
+    TARGET static void kernel_##NAME##_##TNAME##_##ISA(const void* psrc, void* pdst,  \
+                                                       size_t n, void* pcarry,       \
+                                                       bool exclusive) {             \
+        const T* src = (const T*)psrc;                                               \
+        T* dst = (T*)pdst;                                                           \
+        T carry = *(T*)pcarry;                                                       \
+        V id = SET1(IDENTITY);                                                       \
+        V c = SET1(carry);                                                           \
+        size_t i = 0;                                                                \
+        for (; i + LANES <= n; i += LANES) {                                         \
+            V v = LOAD(src + i);                                                     \
+            for (int s = 1; s < LANES; s *= 2) v = VOP(v, SHIFT(v, s, id));          \
+            STORE(dst + i, VOP(c, exclusive ? SHIFT(v, 1, id) : v));                 \
+            c = VOP(c, LAST(v));                                                     \
+        }                                                                            \
+        T lanes[LANES];                                                              \
+        STORE(lanes, c);                                                             \
+        carry = lanes[0];                                                            \
+        SCAN_LOOP(T, OP, src, dst, i, n, carry, exclusive)                           \
+        *(T*)pcarry = carry;                                                         \
+    }
+
+#define DEFINE_SCANS_SIMD(ISA, TAG, TARGET, W, LANES32, LANES64, PS, PD)            \
+    DEFINE_SCAN_SIMD(cumsum, int, ISA, TARGET, int, __m##W##i, LANES32, LOAD_EPI32_##TAG, STORE_EPI32_##TAG, \
+                     _mm##W##_set1_epi32, SHIFT_EPI32_##TAG, LAST_EPI32_##TAG, _mm##W##_add_epi32, SCAN_ADD_INT, 0) \
+    DEFINE_SCAN_SIMD(cumprod, int, ISA, TARGET, int, __m##W##i, LANES32, LOAD_EPI32_##TAG, STORE_EPI32_##TAG, \
+                     _mm##W##_set1_epi32, SHIFT_EPI32_##TAG, LAST_EPI32_##TAG, _mm##W##_mullo_epi32, SCAN_MUL_INT, 1) \
+    DEFINE_SCAN_SIMD(cummin, int, ISA, TARGET, int, __m##W##i, LANES32, LOAD_EPI32_##TAG, STORE_EPI32_##TAG, \
+                     _mm##W##_set1_epi32, SHIFT_EPI32_##TAG, LAST_EPI32_##TAG, _mm##W##_min_epi32, NAN_MIN, INT_MAX) \
+    DEFINE_SCAN_SIMD(cummax, int, ISA, TARGET, int, __m##W##i, LANES32, LOAD_EPI32_##TAG, STORE_EPI32_##TAG, \
+                     _mm##W##_set1_epi32, SHIFT_EPI32_##TAG, LAST_EPI32_##TAG, _mm##W##_max_epi32, NAN_MAX, INT_MIN) \
+    DEFINE_SCAN_SIMD(cumsum, float, ISA, TARGET, float, PS, LANES32, _mm##W##_loadu_ps, _mm##W##_storeu_ps, \
+                     _mm##W##_set1_ps, SHIFT_PS_##TAG, LAST_PS_##TAG, _mm##W##_add_ps, SCAN_ADD, 0.0f) \
+    DEFINE_SCAN_SIMD(cumprod, float, ISA, TARGET, float, PS, LANES32, _mm##W##_loadu_ps, _mm##W##_storeu_ps, \
+                     _mm##W##_set1_ps, SHIFT_PS_##TAG, LAST_PS_##TAG, _mm##W##_mul_ps, SCAN_MUL, 1.0f) \
+    DEFINE_SCAN_SIMD(cummin, float, ISA, TARGET, float, PS, LANES32, _mm##W##_loadu_ps, _mm##W##_storeu_ps, \
+                     _mm##W##_set1_ps, SHIFT_PS_##TAG, LAST_PS_##TAG, scan_min_ps_##ISA, NAN_MIN, INFINITY) \
+    DEFINE_SCAN_SIMD(cummax, float, ISA, TARGET, float, PS, LANES32, _mm##W##_loadu_ps, _mm##W##_storeu_ps, \
+                     _mm##W##_set1_ps, SHIFT_PS_##TAG, LAST_PS_##TAG, scan_max_ps_##ISA, NAN_MAX, -INFINITY) \
+    DEFINE_SCAN_SIMD(cumsum, double, ISA, TARGET, double, PD, LANES64, _mm##W##_loadu_pd, _mm##W##_storeu_pd, \
+                     _mm##W##_set1_pd, SHIFT_PD_##TAG, LAST_PD_##TAG, _mm##W##_add_pd, SCAN_ADD, 0.0) \
+    DEFINE_SCAN_SIMD(cumprod, double, ISA, TARGET, double, PD, LANES64, _mm##W##_loadu_pd, _mm##W##_storeu_pd, \
+                     _mm##W##_set1_pd, SHIFT_PD_##TAG, LAST_PD_##TAG, _mm##W##_mul_pd, SCAN_MUL, 1.0) \
+    DEFINE_SCAN_SIMD(cummin, double, ISA, TARGET, double, PD, LANES64, _mm##W##_loadu_pd, _mm##W##_storeu_pd, \
+                     _mm##W##_set1_pd, SHIFT_PD_##TAG, LAST_PD_##TAG, scan_min_pd_##ISA, NAN_MIN, INFINITY) \
+    DEFINE_SCAN_SIMD(cummax, double, ISA, TARGET, double, PD, LANES64, _mm##W##_loadu_pd, _mm##W##_storeu_pd, \
+                     _mm##W##_set1_pd, SHIFT_PD_##TAG, LAST_PD_##TAG, scan_max_pd_##ISA, NAN_MAX, -INFINITY)
+
+DEFINE_SCANS_SIMD(avx2, AVX2, TARGET_AVX2, 256, 8, 4, __m256, __m256d)
+DEFINE_SCANS_SIMD(avx512, AVX512, TARGET_AVX512, 512, 16, 8, __m512, __m512d)
+#endif
+
+//====================
+// Half precision conversions (FLOAT16, BFLOAT16)
+//====================
+//
+// FLOAT16 and BFLOAT16 are storage types: arrays hold the 16-bit patterns and
+// arithmetic happens in float. Widening is exact. Narrowing rounds to nearest
+// even, overflows FLOAT16 to infinity and keeps NaNs as quiet NaNs, matching
+// what F16C and AVX-512 do in hardware so every variant gives the same bits.
+// BFLOAT16 is the top half of a float, so plain integer shifts convert it.
+
+static inline float half_to_float(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000u) << 16;
+    uint32_t exponent = (h >> 10) & 0x1Fu;
+    uint32_t mantissa = h & 0x3FFu;
+    uint32_t bits;
+    if (exponent == 0x1Fu) {
+        bits = sign | 0x7F800000u | (mantissa << 13) | (mantissa ? 0x400000u : 0);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else {
+        // Zero or subnormal: mantissa units of 2^-24 are exact in float
+        float value = (float)mantissa * 0x1p-24f;
+        return sign ? -value : value;
+    }
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static inline uint16_t float_to_half(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    uint32_t magnitude = bits & 0x7FFFFFFFu;
+    if (magnitude > 0x7F800000u) return (uint16_t)(sign | 0x7E00u | ((magnitude >> 13) & 0x3FFu));
+    // At or above 65520 (halfway past the largest half) rounds to infinity
+    if (magnitude >= 0x477FF000u) return (uint16_t)(sign | 0x7C00u);
+    if (magnitude < 0x38800000u) {
+        // Below 2^-14 the result is subnormal; at or below 2^-25 it rounds to zero
+        if (magnitude <= 0x33000000u) return (uint16_t)sign;
+        uint32_t mantissa = (magnitude & 0x7FFFFFu) | 0x800000u;
+        uint32_t shift = 126 - (magnitude >> 23);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1))) half++;
+        return (uint16_t)(sign | half);
+    }
+    // Rebias the exponent (127 to 15) and round away the low 13 bits
+    uint32_t half = (magnitude - 0x38000000u) >> 13;
+    uint32_t rest = magnitude & 0x1FFFu;
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1))) half++;
+    return (uint16_t)(sign | half);
+}
+
+static inline float bfloat16_to_float(uint16_t h) {
+    uint32_t bits = (uint32_t)h << 16;
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static inline uint16_t float_to_bfloat16(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x7FFFFFFFu) > 0x7F800000u) return (uint16_t)((bits >> 16) | 0x40u);
+    bits += 0x7FFFu + ((bits >> 16) & 1);
+    return (uint16_t)(bits >> 16);
+}
+
+#define DEFINE_CONVERT_SCALAR(TNAME)                                                 \
+    static void kernel_to_float_##TNAME##_scalar(const void* psrc, void* pdst,       \
+                                                 size_t n) {                         \
+        const uint16_t* src = (const uint16_t*)psrc;                                 \
+        float* dst = (float*)pdst;                                                   \
+        for (size_t i = 0; i < n; i++) dst[i] = TNAME##_to_float(src[i]);            \
+    }                                                                                \
+    static void kernel_from_float_##TNAME##_scalar(const void* psrc, void* pdst,     \
+                                                   size_t n) {                       \
+        const float* src = (const float*)psrc;                                       \
+        uint16_t* dst = (uint16_t*)pdst;                                             \
+        for (size_t i = 0; i < n; i++) dst[i] = float_to_##TNAME(src[i]);            \
+    }                                                                                \
+    static void kernel_iota_##TNAME##_scalar(void* pdst, double start, double step,  \
+                                             size_t n) {                             \
+        uint16_t* dst = (uint16_t*)pdst;                                             \
+        for (size_t i = 0; i < n; i++) {                                             \
+            dst[i] = float_to_##TNAME((float)(start + (double)i * step));            \
+        }                                                                            \
+    }
+
+DEFINE_CONVERT_SCALAR(half)
+DEFINE_CONVERT_SCALAR(bfloat16)
+
+#if SIMD_X86
+// One register of float lanes from LANES 16-bit elements and back
+#define DEFINE_CONVERT_SIMD(TNAME, ISA, TARGET, LANES, WIDEN, NARROW)                \
+    TARGET static void kernel_to_float_##TNAME##_##ISA(const void* psrc, void* pdst, \
+                                                      size_t n) {                    \
+        const uint16_t* src = (const uint16_t*)psrc;                                 \
+        float* dst = (float*)pdst;                                                   \
+        size_t i = 0;                                                                \
+        for (; i + LANES <= n; i += LANES) WIDEN(src + i, dst + i);                  \
+        for (; i < n; i++) dst[i] = TNAME##_to_float(src[i]);                        \
+    }                                                                                \
+    TARGET static void kernel_from_float_##TNAME##_##ISA(const void* psrc,           \
+                                                        void* pdst, size_t n) {      \
+        const float* src = (const float*)psrc;                                       \
+        uint16_t* dst = (uint16_t*)pdst;                                             \
+        size_t i = 0;                                                                \
+        for (; i + LANES <= n; i += LANES) NARROW(src + i, dst + i);                 \
+        for (; i < n; i++) dst[i] = float_to_##TNAME(src[i]);                        \
+    }
+
+#define WIDEN_HALF_AVX2(s, d) _mm256_storeu_ps(d, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(s))))
+#define NARROW_HALF_AVX2(s, d)                                                       \
+    _mm_storeu_si128((__m128i*)(d), _mm256_cvtps_ph(_mm256_loadu_ps(s), _MM_FROUND_TO_NEAREST_INT))
+#define WIDEN_HALF_AVX512(s, d)                                                      \
+    _mm512_storeu_ps(d, _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(s))))
+#define NARROW_HALF_AVX512(s, d)                                                     \
+    _mm256_storeu_si256((__m256i*)(d), _mm512_cvtps_ph(_mm512_loadu_ps(s), _MM_FROUND_TO_NEAREST_INT))
+
+// BFLOAT16: zero-extend and shift up; round by adding 0x7FFF plus the lowest
+// kept bit, except for NaNs, which only get their quiet bit set
+TARGET_AVX2 static inline void widen_bfloat16_avx2(const uint16_t* src, float* dst) {
+    __m256i bits = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)src));
+    _mm256_storeu_si256((__m256i*)dst, _mm256_slli_epi32(bits, 16));
+}
+
+TARGET_AVX2 static inline void narrow_bfloat16_avx2(const float* src, uint16_t* dst) {
+    __m256 v = _mm256_loadu_ps(src);
+    __m256i bits = _mm256_castps_si256(v);
+    __m256i odd = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+    __m256i rounded = _mm256_add_epi32(bits, _mm256_add_epi32(odd, _mm256_set1_epi32(0x7FFF)));
+    __m256i quiet = _mm256_or_si256(bits, _mm256_set1_epi32(0x400000));
+    __m256 nan = _mm256_cmp_ps(v, v, _CMP_UNORD_Q);
+    __m256i out = _mm256_srli_epi32(_mm256_blendv_epi8(rounded, quiet, _mm256_castps_si256(nan)), 16);
+    // Pack within each 128-bit lane, then gather the two low halves
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(out, out), 0x08);
+    _mm_storeu_si128((__m128i*)dst, _mm256_castsi256_si128(packed));
+}
+
+TARGET_AVX512 static inline void widen_bfloat16_avx512(const uint16_t* src, float* dst) {
+    __m512i bits = _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)src));
+    _mm512_storeu_si512(dst, _mm512_slli_epi32(bits, 16));
+}
+
+TARGET_AVX512 static inline void narrow_bfloat16_avx512(const float* src, uint16_t* dst) {
+    __m512 v = _mm512_loadu_ps(src);
+    __m512i bits = _mm512_castps_si512(v);
+    __m512i odd = _mm512_and_si512(_mm512_srli_epi32(bits, 16), _mm512_set1_epi32(1));
+    __m512i rounded = _mm512_add_epi32(bits, _mm512_add_epi32(odd, _mm512_set1_epi32(0x7FFF)));
+    __m512i quiet = _mm512_or_si512(bits, _mm512_set1_epi32(0x400000));
+    __mmask16 nan = _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q);
+    __m512i out = _mm512_srli_epi32(_mm512_mask_blend_epi32(nan, rounded, quiet), 16);
+    _mm256_storeu_si256((__m256i*)dst, _mm512_cvtepi32_epi16(out));
+}
+
+DEFINE_CONVERT_SIMD(half, avx2, TARGET_AVX2_F16C, 8, WIDEN_HALF_AVX2, NARROW_HALF_AVX2)
+DEFINE_CONVERT_SIMD(half, avx512, TARGET_AVX512, 16, WIDEN_HALF_AVX512, NARROW_HALF_AVX512)
+DEFINE_CONVERT_SIMD(bfloat16, avx2, TARGET_AVX2, 8, widen_bfloat16_avx2, narrow_bfloat16_avx2)
+DEFINE_CONVERT_SIMD(bfloat16, avx512, TARGET_AVX512, 16, widen_bfloat16_avx512, narrow_bfloat16_avx512)
+#endif
+
+//====================
+// Bit masks (BOOL)
+//====================
+//
+// Packed masks hold bit i of an element range in word i / 64 (bit i % 64).
+// Word-wise logic is a plain loop the vectorizer widens per ISA. Counting
+// uses the nibble-lookup popcount (a byte shuffle per 4 bits) under AVX2,
+// packing turns 64 mask bytes into one word with two byte compares and
+// movemasks, unpacking spreads each byte of bits over 8 lanes and tests them
+// against 1 << lane, and AVX-512 lists set bits 16 at a time with a
+// compressing store of lane numbers.
+
+static inline unsigned popcount_word(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_popcountll(bits);
+#else
+    bits = bits - ((bits >> 1) & 0x5555555555555555ull);
+    bits = (bits & 0x3333333333333333ull) + ((bits >> 2) & 0x3333333333333333ull);
+    bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return (unsigned)((bits * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+// One loop per operation keeps the switch out of the vectorized body
+#define BITWISE_LOOP(EXPR)                                                           \
+    for (size_t i = 0; i < n; i++) out[i] = EXPR;                                    \
+    break;
+
+#define DEFINE_BITWISE_KERNEL(ISA, TARGET)                                           \
+    TARGET static void kernel_bitwise_##ISA(const uint64_t* a, const uint64_t* b,    \
+                                            uint64_t* out, size_t n, BitwiseOp op) { \
+        switch (op) {                                                                \
+            case BIT_AND:    BITWISE_LOOP(a[i] & b[i])                               \
+            case BIT_OR:     BITWISE_LOOP(a[i] | b[i])                               \
+            case BIT_XOR:    BITWISE_LOOP(a[i] ^ b[i])                               \
+            case BIT_ANDNOT: BITWISE_LOOP(a[i] & ~b[i])                              \
+            case BIT_NOT:    BITWISE_LOOP(~a[i])                                     \
+        }                                                                            \
+    }
+
+DEFINE_BITWISE_KERNEL(scalar, NO_TARGET)
+
+static size_t kernel_popcount_scalar(const uint64_t* words, size_t n) {
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) count += popcount_word(words[i]);
+    return count;
+}
+
+// Bits of up to 64 mask bytes, bit j set when bytes[j] is nonzero
+static inline uint64_t pack_word(const bool* bytes, size_t m) {
+    uint64_t word = 0;
+    for (size_t j = 0; j < m; j++) word |= (uint64_t)(bytes[j] != 0) << j;
+    return word;
+}
+
+static void kernel_pack_bits_scalar(const bool* bytes, uint64_t* words, size_t n) {
+    for (size_t i = 0; i < n; i += 64) words[i / 64] = pack_word(bytes + i, n - i < 64 ? n - i : 64);
+}
+
+static void kernel_unpack_bits_scalar(const uint64_t* words, bool* bytes, size_t n) {
+    for (size_t i = 0; i < n; i++) bytes[i] = (words[i / 64] >> (i % 64)) & 1;
+}
+
+static size_t kernel_bit_indices_scalar(const uint64_t* words, size_t n, int base, int* positions) {
+    uint32_t* out = (uint32_t*)positions;
+    size_t count = 0;
+    for (size_t w = 0; w < n; w++) {
+        APPEND_BITS(out, count, (uint32_t)base + (uint32_t)(w * 64), words[w]);
+    }
+    return count;
+}
+
+#if SIMD_X86
+DEFINE_BITWISE_KERNEL(sse2, TARGET_SSE2)
+DEFINE_BITWISE_KERNEL(avx2, TARGET_AVX2)
+DEFINE_BITWISE_KERNEL(avx512, TARGET_AVX512)
+
+// Per-byte counts reach at most 8 per step, so 31 steps fit in a byte
+#define POPCOUNT_STEPS 31
+
+TARGET_AVX2 static size_t kernel_popcount_avx2(const uint64_t* words, size_t n) {
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0F);
+    __m256i total = _mm256_setzero_si256();
+    size_t i = 0;
+    while (i + 4 <= n) {
+        __m256i bytes = _mm256_setzero_si256();
+        for (size_t step = 0; step < POPCOUNT_STEPS && i + 4 <= n; step++, i += 4) {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(words + i));
+            __m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(v, low));
+            __m256i hi = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+            bytes = _mm256_add_epi8(bytes, _mm256_add_epi8(lo, hi));
+        }
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+    }
+    _Alignas(32) uint64_t lanes[4];
+    _mm256_store_si256((__m256i*)lanes, total);
+    size_t count = (size_t)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+    for (; i < n; i++) count += popcount_word(words[i]);
+    return count;
+}
+
+TARGET_AVX2 static void kernel_pack_bits_avx2(const bool* bytes, uint64_t* words, size_t n) {
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m256i lo = _mm256_loadu_si256((const __m256i*)(bytes + i));
+        __m256i hi = _mm256_loadu_si256((const __m256i*)(bytes + i + 32));
+        uint32_t zero_lo = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, zero));
+        uint32_t zero_hi = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, zero));
+        words[i / 64] = ~((uint64_t)zero_hi << 32 | zero_lo);
+    }
+    if (i < n) words[i / 64] = pack_word(bytes + i, n - i);
+}
+
+TARGET_AVX2 static void kernel_unpack_bits_avx2(const uint64_t* words, bool* bytes, size_t n) {
+    // Byte k of the 32 bits goes to lanes 8k..8k+7; each lane keeps one bit
+    const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const __m256i select = _mm256_set1_epi64x((long long)0x8040201008040201ull);
+    const __m256i one = _mm256_set1_epi8(1);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        uint32_t bits = (uint32_t)(words[i / 64] >> (i % 64));
+        __m256i v = _mm256_shuffle_epi8(_mm256_set1_epi32((int)bits), spread);
+        v = _mm256_cmpeq_epi8(_mm256_and_si256(v, select), select);
+        _mm256_storeu_si256((__m256i*)(bytes + i), _mm256_and_si256(v, one));
+    }
+    for (; i < n; i++) bytes[i] = (words[i / 64] >> (i % 64)) & 1;
+}
+
+TARGET_AVX512 static size_t kernel_bit_indices_avx512(const uint64_t* words, size_t n, int base,
+                                                      int* positions) {
+    const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    size_t count = 0;
+    for (size_t w = 0; w < n; w++) {
+        uint64_t bits = words[w];
+        for (int k = 0; bits; k++, bits >>= 16) {
+            __mmask16 m = (__mmask16)(bits & 0xFFFF);
+            if (!m) continue;
+            __m512i at = _mm512_add_epi32(lanes, _mm512_set1_epi32(base + (int)(w * 64) + 16 * k));
+            _mm512_mask_compressstoreu_epi32(positions + count, m, at);
+            count += compress_count[m & 0xFF] + compress_count[m >> 8];
+        }
+    }
+    return count;
+}
+#endif
+
+//====================
+// Instantiation
+//====================
+
+DEFINE_ISA_KERNELS(scalar, NO_TARGET)
+#if SIMD_X86
+DEFINE_ISA_KERNELS(sse2, TARGET_SSE2)
+DEFINE_ISA_KERNELS(avx, TARGET_AVX)
+DEFINE_ISA_KERNELS(avx2, TARGET_AVX2)
+DEFINE_ISA_KERNELS(avx512, TARGET_AVX512)
+#endif
+
+//====================
+// Registration
+//====================
+
+static void register_binary(KernelOp op, Type type, IsaLevel isa, BinaryKernelFn fn) {
+    Kernel k = { .binary = fn };
+    register_kernel(op, type, isa, k);
+}
+
+#define REGISTER_COMMON(TYPE, TNAME, ISA_LEVEL, ISA)                                 \
+    do {                                                                             \
+        Kernel k;                                                                    \
+        register_binary(KERNEL_ADD, TYPE, ISA_LEVEL, kernel_add_##TNAME##_##ISA);    \
+        register_binary(KERNEL_MUL, TYPE, ISA_LEVEL, kernel_mul_##TNAME##_##ISA);    \
+        register_binary(KERNEL_MIN, TYPE, ISA_LEVEL, kernel_min_##TNAME##_##ISA);    \
+        register_binary(KERNEL_MAX, TYPE, ISA_LEVEL, kernel_max_##TNAME##_##ISA);    \
+        k.compare = kernel_compare_##TNAME##_##ISA;                                  \
+        register_kernel(KERNEL_COMPARE, TYPE, ISA_LEVEL, k);                         \
+        k.reduce = kernel_sum_##TNAME##_##ISA;                                       \
+        register_kernel(KERNEL_SUM, TYPE, ISA_LEVEL, k);                             \
+        k.reduce = kernel_prod_##TNAME##_##ISA;                                      \
+        register_kernel(KERNEL_PROD, TYPE, ISA_LEVEL, k);                            \
+        k.reduce = kernel_reduce_min_##TNAME##_##ISA;                                \
+        register_kernel(KERNEL_REDUCE_MIN, TYPE, ISA_LEVEL, k);                      \
+        k.reduce = kernel_reduce_max_##TNAME##_##ISA;                                \
+        register_kernel(KERNEL_REDUCE_MAX, TYPE, ISA_LEVEL, k);                      \
+        k.accumulate = kernel_sum_rows_##TNAME##_##ISA;                              \
+        register_kernel(KERNEL_SUM_ROWS, TYPE, ISA_LEVEL, k);                        \
+        k.accumulate = kernel_prod_rows_##TNAME##_##ISA;                             \
+        register_kernel(KERNEL_PROD_ROWS, TYPE, ISA_LEVEL, k);                       \
+    } while (0)
+
+#define REGISTER_SIZED(TYPE, SIZE, ISA_LEVEL, ISA)                                   \
+    do {                                                                             \
+        Kernel k;                                                                    \
+        k.fill = kernel_fill_##SIZE##_##ISA;                                         \
+        register_kernel(KERNEL_FILL, TYPE, ISA_LEVEL, k);                            \
+        k.copy = kernel_copy_##SIZE##_##ISA;                                         \
+        register_kernel(KERNEL_COPY, TYPE, ISA_LEVEL, k);                            \
+    } while (0)
+
+#define REGISTER_NUMERIC(TYPE, TNAME, ISA_LEVEL, ISA)                                \
+    do {                                                                             \
+        Kernel k;                                                                    \
+        REGISTER_COMMON(TYPE, TNAME, ISA_LEVEL, ISA);                                \
+        register_binary(KERNEL_SUB, TYPE, ISA_LEVEL, kernel_sub_##TNAME##_##ISA);    \
+        register_binary(KERNEL_DIV, TYPE, ISA_LEVEL, kernel_div_##TNAME##_##ISA);    \
+        k.fma = kernel_fma_##TNAME##_##ISA;                                          \
+        register_kernel(KERNEL_FMA, TYPE, ISA_LEVEL, k);                             \
+        k.iota = kernel_iota_##TNAME##_##ISA;                                        \
+        register_kernel(KERNEL_IOTA, TYPE, ISA_LEVEL, k);                            \
+    } while (0)
+
+#define REGISTER_ISA(ISA_LEVEL, ISA)                                                 \
+    do {                                                                             \
+        REGISTER_NUMERIC(INT, int, ISA_LEVEL, ISA);                                  \
+        REGISTER_NUMERIC(FLOAT, float, ISA_LEVEL, ISA);                              \
+        REGISTER_NUMERIC(DOUBLE, double, ISA_LEVEL, ISA);                            \
+        REGISTER_NUMERIC(CHAR, char, ISA_LEVEL, ISA);                                \
+        REGISTER_NUMERIC(INT8, int8, ISA_LEVEL, ISA);                                \
+        REGISTER_NUMERIC(INT16, int16, ISA_LEVEL, ISA);                              \
+        REGISTER_NUMERIC(INT64, int64, ISA_LEVEL, ISA);                              \
+        REGISTER_NUMERIC(UINT8, uint8, ISA_LEVEL, ISA);                              \
+        REGISTER_NUMERIC(UINT16, uint16, ISA_LEVEL, ISA);                            \
+        REGISTER_NUMERIC(UINT32, uint32, ISA_LEVEL, ISA);                            \
+        REGISTER_NUMERIC(UINT64, uint64, ISA_LEVEL, ISA);                            \
+        REGISTER_COMMON(BOOL, bool, ISA_LEVEL, ISA);                                 \
+        REGISTER_SIZED(INT, 4, ISA_LEVEL, ISA);                                      \
+        REGISTER_SIZED(FLOAT, 4, ISA_LEVEL, ISA);                                    \
+        REGISTER_SIZED(DOUBLE, 8, ISA_LEVEL, ISA);                                   \
+        REGISTER_SIZED(CHAR, 1, ISA_LEVEL, ISA);                                     \
+        REGISTER_SIZED(BOOL, 1, ISA_LEVEL, ISA);                                     \
+        REGISTER_SIZED(INT8, 1, ISA_LEVEL, ISA);                                     \
+        REGISTER_SIZED(INT16, 2, ISA_LEVEL, ISA);                                    \
+        REGISTER_SIZED(INT64, 8, ISA_LEVEL, ISA);                                    \
+        REGISTER_SIZED(UINT8, 1, ISA_LEVEL, ISA);                                    \
+        REGISTER_SIZED(UINT16, 2, ISA_LEVEL, ISA);                                   \
+        REGISTER_SIZED(UINT32, 4, ISA_LEVEL, ISA);                                   \
+        REGISTER_SIZED(UINT64, 8, ISA_LEVEL, ISA);                                   \
+        REGISTER_SIZED(FLOAT16, 2, ISA_LEVEL, ISA);                                  \
+        REGISTER_SIZED(BFLOAT16, 2, ISA_LEVEL, ISA);                                 \
+    } while (0)
+
+#define REGISTER_COMPRESS(ISA_LEVEL, ISA)                                            \
+    do {                                                                             \
+        Kernel k;                                                                    \
+        k.compress = kernel_compress_4_##ISA;                                        \
+        register_kernel(KERNEL_COMPRESS, INT, ISA_LEVEL, k);                         \
+        register_kernel(KERNEL_COMPRESS, FLOAT, ISA_LEVEL, k);                       \
+        register_kernel(KERNEL_COMPRESS, UINT32, ISA_LEVEL, k);                      \
+        k.compress = kernel_compress_8_##ISA;                                        \
+        register_kernel(KERNEL_COMPRESS, DOUBLE, ISA_LEVEL, k);                      \
+        register_kernel(KERNEL_COMPRESS, INT64, ISA_LEVEL, k);                       \
+        register_kernel(KERNEL_COMPRESS, UINT64, ISA_LEVEL, k);                      \
+        k.compress = kernel_compress_1_##ISA;                                        \
+        register_kernel(KERNEL_COMPRESS, CHAR, ISA_LEVEL, k);                        \
+        register_kernel(KERNEL_COMPRESS, BOOL, ISA_LEVEL, k);                        \
+        register_kernel(KERNEL_COMPRESS, INT8, ISA_LEVEL, k);                        \
+        register_kernel(KERNEL_COMPRESS, UINT8, ISA_LEVEL, k);                       \
+    } while (0)
+
+#define REGISTER_GATHER(TYPE, SIZE, ISA_LEVEL, ISA)                                  \
+    do {                                                                             \
+        Kernel k;                                                                    \
+        k.take = kernel_take_##SIZE##_##ISA;                                         \
+        register_kernel(KERNEL_TAKE, TYPE, ISA_LEVEL, k);                            \
+    } while (0)
+
+#define REGISTER_SCATTER(TYPE, SIZE, ISA_LEVEL, ISA)                                 \
+    do {                                                                             \
+        Kernel k;                                                                    \
+        k.put = kernel_put_##SIZE##_##ISA;                                           \
+        register_kernel(KERNEL_PUT, TYPE, ISA_LEVEL, k);                             \
+    } while (0)
+
+#define REGISTER_GATHER_ALL(ISA_LEVEL, ISA)                                          \
+    do {                                                                             \
+        REGISTER_GATHER(INT, 4, ISA_LEVEL, ISA);                                     \
+        REGISTER_GATHER(FLOAT, 4, ISA_LEVEL, ISA);                                   \
+        REGISTER_GATHER(DOUBLE, 8, ISA_LEVEL, ISA);                                  \
+        REGISTER_GATHER(UINT32, 4, ISA_LEVEL, ISA);                                  \
+        REGISTER_GATHER(INT64, 8, ISA_LEVEL, ISA);                                   \
+        REGISTER_GATHER(UINT64, 8, ISA_LEVEL, ISA);                                  \
+    } while (0)
+
+#define REGISTER_SCATTER_ALL(ISA_LEVEL, ISA)                                         \
+    do {                                                                             \
+        REGISTER_SCATTER(INT, 4, ISA_LEVEL, ISA);                                    \
+        REGISTER_SCATTER(FLOAT, 4, ISA_LEVEL, ISA);                                  \
+        REGISTER_SCATTER(DOUBLE, 8, ISA_LEVEL, ISA);                                 \
+        REGISTER_SCATTER(UINT32, 4, ISA_LEVEL, ISA);                                 \
+        REGISTER_SCATTER(INT64, 8, ISA_LEVEL, ISA);                                  \
+        REGISTER_SCATTER(UINT64, 8, ISA_LEVEL, ISA);                                 \
+    } while (0)
+
+#define REGISTER_TRANSPOSE(TYPE, SIZE, ISA_LEVEL, ISA)                               \
+    do {                                                                             \
+        Kernel k;                                                                    \
+        k.transpose = kernel_transpose_##SIZE##_##ISA;                               \
+        register_kernel(KERNEL_TRANSPOSE, TYPE, ISA_LEVEL, k);                       \
+    } while (0)
+
+#define REGISTER_GEMM(ISA_LEVEL, ISA)                                                \
+    do {                                                                             \
+        Kernel k;                                                                    \
+        k.gemm = &gemm_float_##ISA;                                                  \
+        register_kernel(KERNEL_GEMM, FLOAT, ISA_LEVEL, k);                           \
+        k.gemm = &gemm_double_##ISA;                                                 \
+        register_kernel(KERNEL_GEMM, DOUBLE, ISA_LEVEL, k);                          \
+    } while (0)
+
+#define REGISTER_FMA(ISA_LEVEL, ISA)                                                 \
+    do {                                                                             \
+        Kernel k;                                                                    \
+        k.fma = kernel_fmadd_float_##ISA;                                            \
+        register_kernel(KERNEL_FMA, FLOAT, ISA_LEVEL, k);                            \
+        k.fma = kernel_fmadd_double_##ISA;                                           \
+        register_kernel(KERNEL_FMA, DOUBLE, ISA_LEVEL, k);                           \
+    } while (0)
+
+#define REGISTER_SORT(TYPE, SIZE, ISA_LEVEL, ISA)                                    \
+    do {                                                                             \
+        Kernel k;                                                                    \
+        k.sort = kernel_sort_##SIZE##_##ISA;                                         \
+        register_kernel(KERNEL_SORT_BLOCK, TYPE, ISA_LEVEL, k);                      \
+    } while (0)
+
+#define REGISTER_KEY_FILTER(ISA_LEVEL, ISA)                                          \
+    do {                                                                             \
+        Kernel k;                                                                    \
+        k.key_filter = kernel_key_filter_int_##ISA;                                  \
+        register_kernel(KERNEL_KEY_FILTER, INT, ISA_LEVEL, k);                       \
+        k.key_filter = kernel_key_filter_float_##ISA;                                \
+        register_kernel(KERNEL_KEY_FILTER, FLOAT, ISA_LEVEL, k);                     \
+        k.key_filter = kernel_key_filter_double_##ISA;                               \
+        register_kernel(KERNEL_KEY_FILTER, DOUBLE, ISA_LEVEL, k);                    \
+    } while (0)
+
+#define REGISTER_SCAN(ISA_LEVEL, ISA)                                                \
+    do {                                                                             \
+        Kernel k;                                                                    \
+        k.scan = kernel_cumsum_int_##ISA;                                            \
+        register_kernel(KERNEL_CUMSUM, INT, ISA_LEVEL, k);                           \
+        k.scan = kernel_cumprod_int_##ISA;                                           \
+        register_kernel(KERNEL_CUMPROD, INT, ISA_LEVEL, k);                          \
+        k.scan = kernel_cummin_int_##ISA;                                            \
+        register_kernel(KERNEL_CUMMIN, INT, ISA_LEVEL, k);                           \
+        k.scan = kernel_cummax_int_##ISA;                                            \
+        register_kernel(KERNEL_CUMMAX, INT, ISA_LEVEL, k);                           \
+        k.scan = kernel_cumsum_float_##ISA;                                          \
+        register_kernel(KERNEL_CUMSUM, FLOAT, ISA_LEVEL, k);                         \
+        k.scan = kernel_cumprod_float_##ISA;                                         \
+        register_kernel(KERNEL_CUMPROD, FLOAT, ISA_LEVEL, k);                        \
+        k.scan = kernel_cummin_float_##ISA;                                          \
+        register_kernel(KERNEL_CUMMIN, FLOAT, ISA_LEVEL, k);                         \
+        k.scan = kernel_cummax_float_##ISA;                                          \
+        register_kernel(KERNEL_CUMMAX, FLOAT, ISA_LEVEL, k);                         \
+        k.scan = kernel_cumsum_double_##ISA;                                         \
+        register_kernel(KERNEL_CUMSUM, DOUBLE, ISA_LEVEL, k);                        \
+        k.scan = kernel_cumprod_double_##ISA;                                        \
+        register_kernel(KERNEL_CUMPROD, DOUBLE, ISA_LEVEL, k);                       \
+        k.scan = kernel_cummin_double_##ISA;                                         \
+        register_kernel(KERNEL_CUMMIN, DOUBLE, ISA_LEVEL, k);                        \
+        k.scan = kernel_cummax_double_##ISA;                                         \
+        register_kernel(KERNEL_CUMMAX, DOUBLE, ISA_LEVEL, k);                        \
+    } while (0)
+
+#define REGISTER_CONVERT(TYPE, TNAME, ISA_LEVEL, ISA)                                \
+    do {                                                                             \
+        Kernel k;                                                                    \
+        k.convert = kernel_to_float_##TNAME##_##ISA;                                 \
+        register_kernel(KERNEL_TO_FLOAT, TYPE, ISA_LEVEL, k);                        \
+        k.convert = kernel_from_float_##TNAME##_##ISA;                               \
+        register_kernel(KERNEL_FROM_FLOAT, TYPE, ISA_LEVEL, k);                      \
+    } while (0)
+
+#define REGISTER_BITWISE(ISA_LEVEL, ISA)                                             \
+    do {                                                                             \
+        Kernel k;                                                                    \
+        k.bitwise = kernel_bitwise_##ISA;                                            \
+        register_kernel(KERNEL_BITWISE, BOOL, ISA_LEVEL, k);                         \
+    } while (0)
+
+// Element moves for 2-byte types, which only have scalar variants
+#define REGISTER_MOVES_SCALAR(TYPE, SIZE)                                            \
+    do {                                                                             \
+        Kernel k;                                                                    \
+        k.compress = kernel_compress_##SIZE##_scalar;                                \
+        register_kernel(KERNEL_COMPRESS, TYPE, ISA_SCALAR, k);                       \
+        REGISTER_GATHER(TYPE, SIZE, ISA_SCALAR, scalar);                             \
+        REGISTER_SCATTER(TYPE, SIZE, ISA_SCALAR, scalar);                            \
+        REGISTER_TRANSPOSE(TYPE, SIZE, ISA_SCALAR, scalar);                          \
+    } while (0)
+
+/**
+ * Register every built-in kernel variant with the dispatch registry
+ */
+void register_builtin_kernels(void) {
+    REGISTER_ISA(ISA_SCALAR, scalar);
+    REGISTER_COMPRESS(ISA_SCALAR, scalar);
+    REGISTER_GATHER_ALL(ISA_SCALAR, scalar);
+    REGISTER_GATHER(CHAR, 1, ISA_SCALAR, scalar);
+    REGISTER_GATHER(BOOL, 1, ISA_SCALAR, scalar);
+    REGISTER_GATHER(INT8, 1, ISA_SCALAR, scalar);
+    REGISTER_GATHER(UINT8, 1, ISA_SCALAR, scalar);
+    REGISTER_SCATTER_ALL(ISA_SCALAR, scalar);
+    REGISTER_SCATTER(CHAR, 1, ISA_SCALAR, scalar);
+    REGISTER_SCATTER(BOOL, 1, ISA_SCALAR, scalar);
+    REGISTER_SCATTER(INT8, 1, ISA_SCALAR, scalar);
+    REGISTER_SCATTER(UINT8, 1, ISA_SCALAR, scalar);
+    REGISTER_TRANSPOSE(INT, 4, ISA_SCALAR, scalar);
+    REGISTER_TRANSPOSE(FLOAT, 4, ISA_SCALAR, scalar);
+    REGISTER_TRANSPOSE(DOUBLE, 8, ISA_SCALAR, scalar);
+    REGISTER_TRANSPOSE(CHAR, 1, ISA_SCALAR, scalar);
+    REGISTER_TRANSPOSE(BOOL, 1, ISA_SCALAR, scalar);
+    REGISTER_TRANSPOSE(INT8, 1, ISA_SCALAR, scalar);
+    REGISTER_TRANSPOSE(UINT8, 1, ISA_SCALAR, scalar);
+    REGISTER_TRANSPOSE(UINT32, 4, ISA_SCALAR, scalar);
+    REGISTER_TRANSPOSE(INT64, 8, ISA_SCALAR, scalar);
+    REGISTER_TRANSPOSE(UINT64, 8, ISA_SCALAR, scalar);
+    REGISTER_GEMM(ISA_SCALAR, scalar);
+    REGISTER_SORT(INT, 4, ISA_SCALAR, scalar);
+    REGISTER_SORT(FLOAT, 4, ISA_SCALAR, scalar);
+    REGISTER_SORT(DOUBLE, 8, ISA_SCALAR, scalar);
+    REGISTER_SORT(CHAR, 1, ISA_SCALAR, scalar);
+    REGISTER_KEY_FILTER(ISA_SCALAR, scalar);
+    {
+        Kernel k = { .key_filter = kernel_key_filter_char_scalar };
+        register_kernel(KERNEL_KEY_FILTER, CHAR, ISA_SCALAR, k);
+    }
+    REGISTER_SCAN(ISA_SCALAR, scalar);
+    {
+        Kernel k = { .scan = kernel_cumsum_compensated_float_scalar };
+        register_kernel(KERNEL_CUMSUM_COMPENSATED, FLOAT, ISA_SCALAR, k);
+        k.scan = kernel_cumsum_compensated_double_scalar;
+        register_kernel(KERNEL_CUMSUM_COMPENSATED, DOUBLE, ISA_SCALAR, k);
+    }
+    REGISTER_CONVERT(FLOAT16, half, ISA_SCALAR, scalar);
+    REGISTER_CONVERT(BFLOAT16, bfloat16, ISA_SCALAR, scalar);
+    register_convert_kernels();
+    register_bitpack_kernels();
+    REGISTER_BITWISE(ISA_SCALAR, scalar);
+    {
+        Kernel k = { .popcount = kernel_popcount_scalar };
+        register_kernel(KERNEL_POPCOUNT, BOOL, ISA_SCALAR, k);
+        k.pack_bits = kernel_pack_bits_scalar;
+        register_kernel(KERNEL_PACK_BITS, BOOL, ISA_SCALAR, k);
+        k.unpack_bits = kernel_unpack_bits_scalar;
+        register_kernel(KERNEL_UNPACK_BITS, BOOL, ISA_SCALAR, k);
+        k.bit_indices = kernel_bit_indices_scalar;
+        register_kernel(KERNEL_BIT_INDICES, BOOL, ISA_SCALAR, k);
+    }
+    {
+        Kernel k = { .iota = kernel_iota_half_scalar };
+        register_kernel(KERNEL_IOTA, FLOAT16, ISA_SCALAR, k);
+        k.iota = kernel_iota_bfloat16_scalar;
+        register_kernel(KERNEL_IOTA, BFLOAT16, ISA_SCALAR, k);
+    }
+    REGISTER_MOVES_SCALAR(INT16, 2);
+    REGISTER_MOVES_SCALAR(UINT16, 2);
+    REGISTER_MOVES_SCALAR(FLOAT16, 2);
+    REGISTER_MOVES_SCALAR(BFLOAT16, 2);
+#if SIMD_X86
+    REGISTER_ISA(ISA_SSE2, sse2);
+    REGISTER_ISA(ISA_AVX, avx);
+    REGISTER_ISA(ISA_AVX2, avx2);
+    REGISTER_ISA(ISA_AVX512, avx512);
+
+    // Compaction only has AVX2 and AVX-512 variants
+    init_compress_tables();
+    REGISTER_COMPRESS(ISA_AVX2, avx2);
+    REGISTER_COMPRESS(ISA_AVX512, avx512);
+
+    // Hardware gathers for 4- and 8-byte elements; scatters need AVX-512
+    REGISTER_GATHER_ALL(ISA_AVX2, avx2);
+    REGISTER_GATHER_ALL(ISA_AVX512, avx512);
+    REGISTER_SCATTER_ALL(ISA_AVX512, avx512);
+
+    // In-register micro-tile transposes for 4- and 8-byte elements
+    REGISTER_TRANSPOSE(INT, 4, ISA_SSE2, sse2);
+    REGISTER_TRANSPOSE(FLOAT, 4, ISA_SSE2, sse2);
+    REGISTER_TRANSPOSE(INT, 4, ISA_AVX, avx);
+    REGISTER_TRANSPOSE(FLOAT, 4, ISA_AVX, avx);
+    REGISTER_TRANSPOSE(DOUBLE, 8, ISA_AVX, avx);
+    REGISTER_TRANSPOSE(UINT32, 4, ISA_SSE2, sse2);
+    REGISTER_TRANSPOSE(UINT32, 4, ISA_AVX, avx);
+    REGISTER_TRANSPOSE(INT64, 8, ISA_AVX, avx);
+    REGISTER_TRANSPOSE(UINT64, 8, ISA_AVX, avx);
+
+    // GEMM micro-kernels need FMA (the AVX2 one is only selected with the FMA bit)
+    REGISTER_GEMM(ISA_AVX2, avx2);
+    REGISTER_GEMM(ISA_AVX512, avx512);
+
+    // FLOAT/DOUBLE multiply-adds on FMA units, replacing the generic variants
+    // (the AVX2 ones likewise need the FMA bit)
+    REGISTER_FMA(ISA_AVX2, avx2);
+    REGISTER_FMA(ISA_AVX512, avx512);
+
+    // Bitonic networks: AVX2 lacks unsigned 64-bit min/max, so 8-byte keys need AVX-512
+    init_sort_tables();
+    REGISTER_SORT(INT, 4, ISA_AVX2, avx2);
+    REGISTER_SORT(FLOAT, 4, ISA_AVX2, avx2);
+    REGISTER_SORT(INT, 4, ISA_AVX512, avx512);
+    REGISTER_SORT(FLOAT, 4, ISA_AVX512, avx512);
+    REGISTER_SORT(DOUBLE, 8, ISA_AVX512, avx512);
+
+    // Key filters for 4- and 8-byte elements
+    REGISTER_KEY_FILTER(ISA_AVX2, avx2);
+    REGISTER_KEY_FILTER(ISA_AVX512, avx512);
+
+    // In-register scans (the compensated scan stays scalar)
+    REGISTER_SCAN(ISA_AVX2, avx2);
+    REGISTER_SCAN(ISA_AVX512, avx512);
+
+    // 16-bit float conversions (the AVX2 FLOAT16 one is only selected with the F16C bit)
+    REGISTER_CONVERT(FLOAT16, half, ISA_AVX2, avx2);
+    REGISTER_CONVERT(FLOAT16, half, ISA_AVX512, avx512);
+    REGISTER_CONVERT(BFLOAT16, bfloat16, ISA_AVX2, avx2);
+    REGISTER_CONVERT(BFLOAT16, bfloat16, ISA_AVX512, avx512);
+
+    // Packed masks: word logic per ISA; byte shuffles and movemasks need AVX2
+    // (512-bit byte operations are AVX512BW), lists of set bits use AVX-512 compress
+    REGISTER_BITWISE(ISA_SSE2, sse2);
+    REGISTER_BITWISE(ISA_AVX2, avx2);
+    REGISTER_BITWISE(ISA_AVX512, avx512);
+    {
+        Kernel k = { .popcount = kernel_popcount_avx2 };
+        register_kernel(KERNEL_POPCOUNT, BOOL, ISA_AVX2, k);
+        k.pack_bits = kernel_pack_bits_avx2;
+        register_kernel(KERNEL_PACK_BITS, BOOL, ISA_AVX2, k);
+        k.unpack_bits = kernel_unpack_bits_avx2;
+        register_kernel(KERNEL_UNPACK_BITS, BOOL, ISA_AVX2, k);
+        k.bit_indices = kernel_bit_indices_avx512;
+        register_kernel(KERNEL_BIT_INDICES, BOOL, ISA_AVX512, k);
+    }
+#endif
+}
@@ -0,0 +1,232 @@
+/**
+ * parallel.c - Persistent work-stealing pool for data-parallel loops
+ *
+ * Workers are started lazily, up to the thread count a call asks for, and then
+ * sleep on a condition variable between loops. A loop is published as a job
+ * with one range slot per participant; participants take a grain at a time
+ * from the front of their own slot and steal from the back of other slots
+ * when theirs is empty. Slots are guarded by their own mutex, which is only
+ * taken once per grain.
+ */
+
+#include "../../include/runtime/parallel.h"
+#include "../../include/runtime/runtime_dispatch.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+// Upper bound on threads taking part in one loop
+#define PARALLEL_MAX_THREADS 256
+
+// L2 size assumed when detection did not report one
+#define PARALLEL_DEFAULT_L2_BYTES ((size_t)256 * 1024)
+
+static size_t thread_override = 0;
+
+// Set inside workers so nested parallel_for() calls run serially
+static _Thread_local bool in_parallel_region = false;
+
+/**
+ * Threads parallel_for() may use
+ */
+size_t parallel_thread_count(void) {
+    if (thread_override > 0) return thread_override;
+    // SMT siblings share the core's caches and load ports, which the
+    // bandwidth-bound kernels already saturate
+    const CPUCores* cores = &get_runtime_hardware_profile()->cpu_cores;
+    int count = cores->physical_cores > 0 ? cores->physical_cores : cores->logical_cores;
+    return count > 0 ? (size_t)count : 1;
+}
+
+/**
+ * Override the thread count (0 restores the hardware default)
+ */
+void parallel_set_thread_count(size_t threads) {
+    thread_override = threads;
+}
+
+/**
+ * Items per grain for loops touching item_bytes per item
+ */
+size_t parallel_grain(size_t item_bytes) {
+    int l2_kb = get_runtime_hardware_profile()->cache_info.l2_cache_size_kb;
+    size_t l2 = l2_kb > 0 ? (size_t)l2_kb * 1024 : PARALLEL_DEFAULT_L2_BYTES;
+    if (item_bytes == 0) item_bytes = 1;
+    return l2 / item_bytes > 0 ? l2 / item_bytes : 1;
+}
+
+#ifndef _WIN32
+
+/**
+ * Remaining items of one participant (padded to a cache line)
+ */
+typedef struct {
+    _Alignas(64) pthread_mutex_t lock;
+    size_t begin;
+    size_t end;
+    unsigned long started;    // worker only: pool_generation when it was started
+} ParallelSlot;
+
+typedef struct {
+    ParallelRangeFn fn;
+    void* ctx;
+    size_t grain;
+    size_t participants;      // caller is participant 0, worker k is participant k
+} ParallelJob;
+
+static ParallelSlot slots[PARALLEL_MAX_THREADS];
+static pthread_once_t slots_once = PTHREAD_ONCE_INIT;
+
+// One loop at a time owns the pool; others run serially rather than wait
+static pthread_mutex_t pool_submit = PTHREAD_MUTEX_INITIALIZER;
+
+// Guards every pool_* variable below
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER;   // a job was published
+static pthread_cond_t pool_done = PTHREAD_COND_INITIALIZER;   // last worker finished
+static size_t pool_workers = 0;                               // threads started
+static unsigned long pool_generation = 0;                     // jobs published so far
+static const ParallelJob* pool_job = NULL;
+static size_t pool_pending = 0;                               // workers still on pool_job
+
+static void init_slots(void) {
+    for (size_t t = 0; t < PARALLEL_MAX_THREADS; t++) pthread_mutex_init(&slots[t].lock, NULL);
+}
+
+/**
+ * Move the back half of another participant's range into self's slot
+ */
+static bool parallel_steal(const ParallelJob* job, size_t self) {
+    for (size_t k = 1; k < job->participants; k++) {
+        ParallelSlot* victim = &slots[(self + k) % job->participants];
+        pthread_mutex_lock(&victim->lock);
+        size_t left = victim->end - victim->begin;
+        if (left == 0) {
+            pthread_mutex_unlock(&victim->lock);
+            continue;
+        }
+        // Leave the victim its next grain when there is more than one
+        size_t take = left > job->grain ? left / 2 : left;
+        size_t end = victim->end;
+        victim->end -= take;
+        pthread_mutex_unlock(&victim->lock);
+
+        pthread_mutex_lock(&slots[self].lock);
+        slots[self].begin = end - take;
+        slots[self].end = end;
+        pthread_mutex_unlock(&slots[self].lock);
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Work through self's slot a grain at a time, then steal until nothing is left
+ */
+static void parallel_run(const ParallelJob* job, size_t self) {
+    ParallelSlot* own = &slots[self];
+    for (;;) {
+        pthread_mutex_lock(&own->lock);
+        size_t begin = own->begin;
+        size_t end = own->end - begin > job->grain ? begin + job->grain : own->end;
+        own->begin = end;
+        pthread_mutex_unlock(&own->lock);
+
+        if (begin < end) {
+            job->fn(begin, end, job->ctx);
+        } else if (!parallel_steal(job, self)) {
+            return;
+        }
+    }
+}
+
+static void* parallel_worker(void* arg) {
+    size_t self = (size_t)(uintptr_t)arg;
+    in_parallel_region = true;
+
+    // Jobs published after the worker was started are for it
+    unsigned long seen = slots[self].started;
+    pthread_mutex_lock(&pool_lock);
+    for (;;) {
+        while (pool_generation == seen) pthread_cond_wait(&pool_wake, &pool_lock);
+        seen = pool_generation;
+        const ParallelJob* job = pool_job;
+        if (!job || self >= job->participants) continue;
+
+        pthread_mutex_unlock(&pool_lock);
+        parallel_run(job, self);
+        pthread_mutex_lock(&pool_lock);
+        if (--pool_pending == 0) pthread_cond_signal(&pool_done);
+    }
+    return NULL;
+}
+
+/**
+ * Start workers until `threads` participants are available; returns how many are
+ */
+static size_t parallel_grow(size_t threads) {
+    while (pool_workers + 1 < threads) {
+        pthread_t handle;
+        void* self = (void*)(uintptr_t)(pool_workers + 1);
+        slots[pool_workers + 1].started = pool_generation;
+        if (pthread_create(&handle, NULL, parallel_worker, self) != 0) break;
+        pthread_detach(handle);
+        pool_workers++;
+    }
+    return pool_workers + 1 < threads ? pool_workers + 1 : threads;
+}
+
+#endif
+
+/**
+ * Run fn over [0, n) split across the pool
+ */
+void parallel_for(size_t n, size_t grain, ParallelRangeFn fn, void* ctx) {
+    if (n == 0) return;
+    if (grain == 0) grain = 1;
+
+    size_t threads = parallel_thread_count();
+    size_t max_ranges = (n + grain - 1) / grain;
+    if (threads > max_ranges) threads = max_ranges;
+    if (threads > PARALLEL_MAX_THREADS) threads = PARALLEL_MAX_THREADS;
+
+#ifdef _WIN32
+    threads = 1;
+#else
+    if (threads > 1 && !in_parallel_region && pthread_mutex_trylock(&pool_submit) == 0) {
+        pthread_once(&slots_once, init_slots);
+
+        pthread_mutex_lock(&pool_lock);
+        threads = parallel_grow(threads);
+        if (threads > 1) {
+            // No participant of the previous job is still touching the slots
+            for (size_t t = 0; t < threads; t++) {
+                slots[t].begin = n * t / threads;
+                slots[t].end = n * (t + 1) / threads;
+            }
+            ParallelJob job = { fn, ctx, grain, threads };
+            pool_job = &job;
+            pool_pending = threads - 1;
+            pool_generation++;
+            pthread_cond_broadcast(&pool_wake);
+            pthread_mutex_unlock(&pool_lock);
+
+            in_parallel_region = true;
+            parallel_run(&job, 0);
+            in_parallel_region = false;
+
+            pthread_mutex_lock(&pool_lock);
+            while (pool_pending > 0) pthread_cond_wait(&pool_done, &pool_lock);
+            pool_job = NULL;
+        }
+        pthread_mutex_unlock(&pool_lock);
+        pthread_mutex_unlock(&pool_submit);
+        if (threads > 1) return;
+    }
+#endif
+    fn(0, n, ctx);
+}
@@ -3,20 +3,158 @@
  * 
  * This file contains the implementation of runtime dispatch for selecting the optimal
  * function implementations based on the detected hardware features.
+ *
+ * Every SIMD variant is compiled with its own target attribute (see simd_targets.h),
+ * so a portable build without -march still contains real SSE2/AVX/AVX2/AVX-512 code
+ * and the variant picked from detect_hardware_profile() is the one that runs.
  */
 
  #include "../../include/runtime/runtime_dispatch.h"
+ #include "../../include/runtime/simd_targets.h"
  #include <stdio.h>
+ #include <stdbool.h>
+ #include <stdint.h>
  
  // Declarations of all implementation variants
- void array_add_scalar(const float* a, const float* b, float* c, int n);
- void array_add_sse2(const float* a, const float* b, float* c, int n);
- void array_add_avx(const float* a, const float* b, float* c, int n);
- void array_add_avx2(const float* a, const float* b, float* c, int n);
- void array_add_avx512(const float* a, const float* b, float* c, int n);
+ void array_add_scalar(const float* a, const float* b, float* c, size_t n);
+ void array_add_sse2(const float* a, const float* b, float* c, size_t n);
+ void array_add_avx(const float* a, const float* b, float* c, size_t n);
+ void array_add_avx2(const float* a, const float* b, float* c, size_t n);
+ void array_add_avx512(const float* a, const float* b, float* c, size_t n);
+ 
+ // Variant table indexed by IsaLevel
+ static const ArrayAddFn array_add_variants[ISA_COUNT] = {
+     array_add_scalar,
+     array_add_sse2,
+     array_add_avx,
+     array_add_avx2,
+     array_add_avx512
+ };
+ 
+ static const char* const isa_level_names[ISA_COUNT] = {
+     "Scalar",
+     "SSE2",
+     "AVX",
+     "AVX2",
+     "AVX-512"
+ };
  
  // Selected function pointers (default to scalar implementations)
  static ArrayAddFn array_add_fn = array_add_scalar;
+ static IsaLevel runtime_isa = ISA_SCALAR;
+ 
+ // Kernel registry: every registered variant, and the one selected per op x type
+ static Kernel kernel_variants[KERNEL_OP_COUNT][TYPE_COUNT][ISA_COUNT];
+ static Kernel kernel_table[KERNEL_OP_COUNT][TYPE_COUNT];
+ static IsaLevel kernel_table_isa[KERNEL_OP_COUNT][TYPE_COUNT];
+ 
+ static HardwareProfile runtime_hw;
+ static bool dispatch_ready = false;
+ 
+ // Outputs at least this large bypass the cache (last-level cache size)
+ #define DEFAULT_STREAMING_STORE_BYTES ((size_t)8 << 20)
+ static size_t streaming_store_threshold = DEFAULT_STREAMING_STORE_BYTES;
+ // Size of the whole output when this thread is writing one slice of it
+ static _Thread_local size_t streaming_store_extent = 0;
+ // Random gathers hide about this many elements of memory latency
+ #define DEFAULT_GATHER_PREFETCH_DISTANCE 32
+ static size_t gather_prefetch_distance = DEFAULT_GATHER_PREFETCH_DISTANCE;
+ static bool builtins_registered = false;
+ 
+ /**
+  * Whether a kernel variant at this ISA level may run for this op
+  */
+ static bool kernel_isa_usable(KernelOp op, Type type, IsaLevel isa) {
+     if (isa > runtime_isa) return false;
+     // The AVX2 FLOAT/DOUBLE FMA and GEMM kernels are built for "avx2,fma"; FMA is a separate CPUID bit
+     if ((op == KERNEL_FMA || op == KERNEL_GEMM) && (type == FLOAT || type == DOUBLE) && isa == ISA_AVX2 &&
+         !runtime_hw.cpu_features.fma) return false;
+     // Likewise the AVX2 FLOAT16 conversions need "avx2,f16c"
+     if ((op == KERNEL_TO_FLOAT || op == KERNEL_FROM_FLOAT) && type == FLOAT16 && isa == ISA_AVX2 &&
+         !runtime_hw.cpu_features.f16c) return false;
+     return true;
+ }
+ 
+ /**
+  * Select the best usable variant for one op x type slot
+  */
+ static void select_kernel(KernelOp op, Type type) {
+     Kernel none = { 0 };
+     kernel_table[op][type] = none;
+     kernel_table_isa[op][type] = ISA_SCALAR;
+     
+     for (int isa = ISA_COUNT - 1; isa >= ISA_SCALAR; isa--) {
+         if (!kernel_isa_usable(op, type, (IsaLevel)isa)) continue;
+         if (kernel_variants[op][type][isa].binary == NULL) continue;
+         kernel_table[op][type] = kernel_variants[op][type][isa];
+         kernel_table_isa[op][type] = (IsaLevel)isa;
+         return;
+     }
+ }
+ 
+ // Registry adapters so KERNEL_ADD on FLOAT uses the hand-written variants
+ static void float_add_scalar(const void* a, const void* b, void* c, size_t n) { array_add_scalar(a, b, c, n); }
+ static void float_add_sse2(const void* a, const void* b, void* c, size_t n) { array_add_sse2(a, b, c, n); }
+ static void float_add_avx(const void* a, const void* b, void* c, size_t n) { array_add_avx(a, b, c, n); }
+ static void float_add_avx2(const void* a, const void* b, void* c, size_t n) { array_add_avx2(a, b, c, n); }
+ static void float_add_avx512(const void* a, const void* b, void* c, size_t n) { array_add_avx512(a, b, c, n); }
+ 
+ static void register_float_add_kernels(void) {
+     const BinaryKernelFn adapters[ISA_COUNT] = {
+         float_add_scalar, float_add_sse2, float_add_avx, float_add_avx2, float_add_avx512
+     };
+     for (int isa = ISA_SCALAR; isa < ISA_COUNT; isa++) {
+         Kernel k = { .binary = adapters[isa] };
+         register_kernel(KERNEL_ADD, FLOAT, (IsaLevel)isa, k);
+     }
+ }
+ 
+ /**
+  * Fill the whole registry once from the hardware profile
+  */
+ static void configure_runtime_dispatch(const HardwareProfile* hw) {
+     runtime_hw = *hw;
+     runtime_isa = select_isa_level(hw);
+     array_add_fn = array_add_variants[runtime_isa];
+     
+     // Fall back to a multiple of L2 when the L3 size is unknown
+     if (hw->cache_info.l3_cache_size_kb > 0) {
+         streaming_store_threshold = (size_t)hw->cache_info.l3_cache_size_kb * 1024;
+     } else if (hw->cache_info.l2_cache_size_kb > 0) {
+         streaming_store_threshold = (size_t)hw->cache_info.l2_cache_size_kb * 1024 * 4;
+     } else {
+         streaming_store_threshold = DEFAULT_STREAMING_STORE_BYTES;
+     }
+     
+     if (!builtins_registered) {
+         builtins_registered = true;
+         register_builtin_kernels();
+         register_float_add_kernels();
+     }
+     for (int op = 0; op < KERNEL_OP_COUNT; op++) {
+         for (int type = 0; type < TYPE_COUNT; type++) {
+             select_kernel((KernelOp)op, (Type)type);
+         }
+     }
+     dispatch_ready = true;
+ }
+ 
+ /**
+  * Pick the highest ISA level usable on this machine
+  */
+ IsaLevel select_isa_level(const HardwareProfile* hw) {
+ #if SIMD_X86
+     // AVX levels also need OS support for the wider registers, which
+     // detect_hardware_profile() folds into the avx/avx512f flags
+     if (hw->cpu_features.avx512f && hw->cpu_features.avx) return ISA_AVX512;
+     if (hw->cpu_features.avx2 && hw->cpu_features.avx) return ISA_AVX2;
+     if (hw->cpu_features.avx) return ISA_AVX;
+     if (hw->cpu_features.sse2) return ISA_SSE2;
+ #else
+     (void)hw;
+ #endif
+     return ISA_SCALAR;
+ }
  
  /**
   * Initialize runtime dispatch based on detected hardware features
@@ -24,25 +162,31 @@
  void init_runtime_dispatch(const HardwareProfile* hw) {
      printf("Initializing runtime dispatch for optimal performance...\n");
      
-     // Select array addition implementation based on CPU features
-     if (hw->cpu_features.avx512f) {
-         printf("- Using AVX-512 instructions for array operations\n");
-         array_add_fn = array_add_avx512;
-     } else if (hw->cpu_features.avx2) {
-         printf("- Using AVX2 instructions for array operations\n");
-         array_add_fn = array_add_avx2;
-     } else if (hw->cpu_features.avx) {
-         printf("- Using AVX instructions for array operations\n");
-         array_add_fn = array_add_avx;
-     } else if (hw->cpu_features.sse2) {
-         printf("- Using SSE2 instructions for array operations\n");
-         array_add_fn = array_add_sse2;
-     } else {
+     // Select array addition and registry kernels based on CPU features
+     configure_runtime_dispatch(hw);
+     
+     if (runtime_isa == ISA_SCALAR) {
          printf("- Using scalar operations (no SIMD)\n");
-         array_add_fn = array_add_scalar;
+     } else {
+         printf("- Using %s instructions for array operations\n", isa_level_names[runtime_isa]);
      }
  }
  
+ /**
+  * ISA level chosen by init_runtime_dispatch()
+  */
+ IsaLevel get_runtime_isa_level(void) {
+     return runtime_isa;
+ }
+ 
+ /**
+  * Printable name of an ISA level
+  */
+ const char* isa_level_name(IsaLevel isa) {
+     if ((unsigned)isa >= ISA_COUNT) return "Unknown";
+     return isa_level_names[isa];
+ }
+ 
  /**
   * Get the optimal function for array addition
   */
@@ -50,109 +194,266 @@
      return array_add_fn;
  }
  
+ /**
+  * Get the array addition variant for a specific ISA level
+  */
+ ArrayAddFn get_array_add_variant(IsaLevel isa) {
+     if ((unsigned)isa >= ISA_COUNT) return NULL;
+     return array_add_variants[isa];
+ }
+ 
+ /**
+  * Register a kernel variant and refresh the selection for its slot
+  */
+ void register_kernel(KernelOp op, Type type, IsaLevel isa, Kernel kernel) {
+     if ((unsigned)op >= KERNEL_OP_COUNT || (unsigned)type >= TYPE_COUNT ||
+         (unsigned)isa >= ISA_COUNT) {
+         fprintf(stderr, "Error: Invalid kernel registration\n");
+         return;
+     }
+     kernel_variants[op][type][isa] = kernel;
+     if (dispatch_ready) {
+         select_kernel(op, type);
+     }
+ }
+ 
+ /**
+  * Fill the registry without printing (first kernel query). Only the CPU is
+  * probed: GPU detection shells out, which no array operation should do.
+  */
+ static void ensure_runtime_dispatch(void) {
+     HardwareProfile hw = detect_cpu_profile();
+     configure_runtime_dispatch(&hw);
+ }
+ 
+ /**
+  * Best kernel for op x type
+  */
+ Kernel get_kernel(KernelOp op, Type type) {
+     if (!dispatch_ready) ensure_runtime_dispatch();
+     return kernel_table[op][type];
+ }
+ 
+ /**
+  * Kernel registered for an exact ISA level
+  */
+ Kernel get_kernel_variant(KernelOp op, Type type, IsaLevel isa) {
+     if (!dispatch_ready) ensure_runtime_dispatch();
+     return kernel_variants[op][type][isa];
+ }
+ 
+ /**
+  * ISA level of the selected kernel for op x type
+  */
+ IsaLevel get_kernel_isa(KernelOp op, Type type) {
+     if (!dispatch_ready) ensure_runtime_dispatch();
+     return kernel_table_isa[op][type];
+ }
+ 
+ /**
+  * Hardware profile the dispatch tables were built from
+  */
+ const HardwareProfile* get_runtime_hardware_profile(void) {
+     if (!dispatch_ready) ensure_runtime_dispatch();
+     return &runtime_hw;
+ }
+ 
+ /**
+  * Output size (bytes) from which fill/copy kernels use non-temporal stores
+  */
+ size_t get_streaming_store_threshold(void) {
+     return streaming_store_threshold;
+ }
+ 
+ /**
+  * Override the streaming threshold (SIZE_MAX disables non-temporal stores)
+  */
+ void set_streaming_store_threshold(size_t bytes) {
+     streaming_store_threshold = bytes;
+ }
+ 
+ /**
+  * Declare the size of the whole output this thread writes a slice of (0 to clear)
+  */
+ void set_streaming_store_extent(size_t bytes) {
+     streaming_store_extent = bytes;
+ }
+ 
+ /**
+  * Whether a kernel writing `bytes` should use non-temporal stores
+  */
+ bool use_streaming_stores(size_t bytes) {
+     size_t total = bytes > streaming_store_extent ? bytes : streaming_store_extent;
+     return total >= streaming_store_threshold;
+ }
+ 
+ /**
+  * Elements ahead that take/put kernels prefetch for out-of-cache arrays
+  */
+ size_t get_gather_prefetch_distance(void) {
+     return gather_prefetch_distance;
+ }
+ 
+ /**
+  * Override the prefetch distance (0 disables software prefetching)
+  */
+ void set_gather_prefetch_distance(size_t elements) {
+     gather_prefetch_distance = elements;
+ }
+ 
  /**
   * Implementation of array addition functions for different instruction sets
-  * These are just example implementations - in a real library, these would be
-  * highly optimized for each instruction set.
+  *
+  * Inputs may have any alignment (Array slices start at arbitrary elements).
+  * Each SIMD variant peels a head until the output is vector aligned, runs the
+  * body with unaligned loads and aligned-width stores, then finishes the tail
+  * with a masked store (AVX/AVX-512) or a short scalar loop (SSE2).
   */
  
+ // Elements to process before ptr reaches a width-byte boundary (0 if it never can)
+ static inline size_t elements_to_alignment(const float* ptr, size_t width, size_t n) {
+     uintptr_t addr = (uintptr_t)ptr;
+     if (addr % sizeof(float) != 0) return 0;  // float-misaligned: stay unaligned
+     size_t peel = ((width - (addr & (width - 1))) & (width - 1)) / sizeof(float);
+     return peel < n ? peel : n;
+ }
+ 
  // Scalar implementation (fallback)
- void array_add_scalar(const float* a, const float* b, float* c, int n) {
-     for (int i = 0; i < n; i++) {
+ void array_add_scalar(const float* a, const float* b, float* c, size_t n) {
+     for (size_t i = 0; i < n; i++) {
          c[i] = a[i] + b[i];
      }
  }
  
  // SSE2 implementation
- #ifdef __SSE2__
- #include <emmintrin.h>
- #endif
- 
- void array_add_sse2(const float* a, const float* b, float* c, int n) {
- #ifdef __SSE2__
-     int i;
+ TARGET_SSE2
+ void array_add_sse2(const float* a, const float* b, float* c, size_t n) {
+ #if SIMD_X86
+     // Scalar head until c is 16-byte aligned
+     size_t i = elements_to_alignment(c, 16, n);
+     array_add_scalar(a, b, c, i);
+     
      // Process blocks of 4 floats (SSE2 works with 128-bit vectors = 4x32-bit floats)
-     for (i = 0; i <= n - 4; i += 4) {
-         __m128 va = _mm_load_ps(&a[i]);
-         __m128 vb = _mm_load_ps(&b[i]);
-         __m128 vc = _mm_add_ps(va, vb);
-         _mm_store_ps(&c[i], vc);
+     for (; i + 4 <= n; i += 4) {
+         __m128 va = _mm_loadu_ps(&a[i]);
+         __m128 vb = _mm_loadu_ps(&b[i]);
+         _mm_storeu_ps(&c[i], _mm_add_ps(va, vb));
      }
      
-     // Handle remaining elements
+     // Handle remaining elements (at most 3)
      for (; i < n; i++) {
          c[i] = a[i] + b[i];
      }
  #else
-     // Fallback to scalar if SSE2 not available at compile time
+     // No SSE2 on this architecture
      array_add_scalar(a, b, c, n);
  #endif
  }
  
- // AVX implementation
- #ifdef __AVX__
- #include <immintrin.h>
+ #if SIMD_X86
+ // Sliding window: loading 8 ints at (8 - k) yields a mask of k leading lanes
+ static const int32_t avx_lane_mask_table[16] = {
+     -1, -1, -1, -1, -1, -1, -1, -1,
+      0,  0,  0,  0,  0,  0,  0,  0
+ };
+ 
+ TARGET_AVX
+ static inline __m256i avx_lane_mask(size_t k) {
+     return _mm256_loadu_si256((const __m256i*)(avx_lane_mask_table + 8 - k));
+ }
+ 
+ // Masked add of k < 8 elements without touching memory past the end
+ TARGET_AVX
+ static inline void avx_add_partial(const float* a, const float* b, float* c, size_t k) {
+     __m256i mask = avx_lane_mask(k);
+     __m256 va = _mm256_maskload_ps(a, mask);
+     __m256 vb = _mm256_maskload_ps(b, mask);
+     _mm256_maskstore_ps(c, mask, _mm256_add_ps(va, vb));
+ }
  #endif
  
- void array_add_avx(const float* a, const float* b, float* c, int n) {
- #ifdef __AVX__
-     int i;
+ // AVX implementation
+ TARGET_AVX
+ void array_add_avx(const float* a, const float* b, float* c, size_t n) {
+ #if SIMD_X86
+     // Masked head until c is 32-byte aligned
+     size_t i = elements_to_alignment(c, 32, n);
+     if (i > 0) avx_add_partial(a, b, c, i);
+     
      // Process blocks of 8 floats (AVX works with 256-bit vectors = 8x32-bit floats)
-     for (i = 0; i <= n - 8; i += 8) {
-         __m256 va = _mm256_load_ps(&a[i]);
-         __m256 vb = _mm256_load_ps(&b[i]);
-         __m256 vc = _mm256_add_ps(va, vb);
-         _mm256_store_ps(&c[i], vc);
+     for (; i + 8 <= n; i += 8) {
+         __m256 va = _mm256_loadu_ps(&a[i]);
+         __m256 vb = _mm256_loadu_ps(&b[i]);
+         _mm256_storeu_ps(&c[i], _mm256_add_ps(va, vb));
      }
      
-     // Handle remaining elements
-     for (; i < n; i++) {
-         c[i] = a[i] + b[i];
-     }
+     // Masked tail
+     if (i < n) avx_add_partial(a + i, b + i, c + i, n - i);
  #else
-     // Fallback to SSE2 if AVX not available at compile time
-     array_add_sse2(a, b, c, n);
+     // No AVX on this architecture
+     array_add_scalar(a, b, c, n);
  #endif
  }
  
  // AVX2 implementation
- #ifdef __AVX2__
- #include <immintrin.h>
- #endif
- 
- void array_add_avx2(const float* a, const float* b, float* c, int n) {
- #ifdef __AVX2__
-     // For this simple operation, AVX2 and AVX are the same
-     // In more complex operations, AVX2 provides enhanced integer operations
-     array_add_avx(a, b, c, n);
+ TARGET_AVX2
+ void array_add_avx2(const float* a, const float* b, float* c, size_t n) {
+ #if SIMD_X86
+     // Masked head until c is 32-byte aligned
+     size_t i = elements_to_alignment(c, 32, n);
+     if (i > 0) avx_add_partial(a, b, c, i);
+     
+     // Same width as AVX, unrolled twice so two independent adds are in flight
+     for (; i + 16 <= n; i += 16) {
+         __m256 va0 = _mm256_loadu_ps(&a[i]);
+         __m256 va1 = _mm256_loadu_ps(&a[i + 8]);
+         __m256 vb0 = _mm256_loadu_ps(&b[i]);
+         __m256 vb1 = _mm256_loadu_ps(&b[i + 8]);
+         _mm256_storeu_ps(&c[i], _mm256_add_ps(va0, vb0));
+         _mm256_storeu_ps(&c[i + 8], _mm256_add_ps(va1, vb1));
+     }
+     if (i + 8 <= n) {
+         _mm256_storeu_ps(&c[i], _mm256_add_ps(_mm256_loadu_ps(&a[i]), _mm256_loadu_ps(&b[i])));
+         i += 8;
+     }
+     
+     // Masked tail
+     if (i < n) avx_add_partial(a + i, b + i, c + i, n - i);
  #else
-     // Fallback to AVX if AVX2 not available at compile time
-     array_add_avx(a, b, c, n);
+     // No AVX2 on this architecture
+     array_add_scalar(a, b, c, n);
  #endif
  }
  
  // AVX-512 implementation
- #ifdef __AVX512F__
- #include <immintrin.h>
- #endif
- 
- void array_add_avx512(const float* a, const float* b, float* c, int n) {
- #ifdef __AVX512F__
-     int i;
+ TARGET_AVX512
+ void array_add_avx512(const float* a, const float* b, float* c, size_t n) {
+ #if SIMD_X86
+     // Masked head until c is 64-byte aligned
+     size_t i = elements_to_alignment(c, 64, n);
+     if (i > 0) {
+         __mmask16 head = (__mmask16)((1u << i) - 1);
+         __m512 va = _mm512_maskz_loadu_ps(head, a);
+         __m512 vb = _mm512_maskz_loadu_ps(head, b);
+         _mm512_mask_storeu_ps(c, head, _mm512_add_ps(va, vb));
+     }
+     
      // Process blocks of 16 floats (AVX-512 works with 512-bit vectors = 16x32-bit floats)
-     for (i = 0; i <= n - 16; i += 16) {
-         __m512 va = _mm512_load_ps(&a[i]);
-         __m512 vb = _mm512_load_ps(&b[i]);
-         __m512 vc = _mm512_add_ps(va, vb);
-         _mm512_store_ps(&c[i], vc);
+     for (; i + 16 <= n; i += 16) {
+         __m512 va = _mm512_loadu_ps(&a[i]);
+         __m512 vb = _mm512_loadu_ps(&b[i]);
+         _mm512_storeu_ps(&c[i], _mm512_add_ps(va, vb));
      }
      
-     // Handle remaining elements
-     for (; i < n; i++) {
-         c[i] = a[i] + b[i];
+     // Masked tail
+     if (i < n) {
+         __mmask16 tail = (__mmask16)((1u << (n - i)) - 1);
+         __m512 va = _mm512_maskz_loadu_ps(tail, &a[i]);
+         __m512 vb = _mm512_maskz_loadu_ps(tail, &b[i]);
+         _mm512_mask_storeu_ps(&c[i], tail, _mm512_add_ps(va, vb));
      }
  #else
-     // Fallback to AVX2 if AVX-512 not available at compile time
-     array_add_avx2(a, b, c, n);
+     // No AVX-512 on this architecture
+     array_add_scalar(a, b, c, n);
  #endif
- }
\ No newline at end of file
+ }
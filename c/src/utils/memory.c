@@ -0,0 +1,151 @@
+/**
+ * memory.c - Allocation backend for array buffers
+ *
+ * Small buffers come from the aligned heap allocator. Large buffers are mapped
+ * straight from the OS so that:
+ * - they start on a huge-page boundary and are advised for transparent huge
+ *   pages (fewer TLB misses on multi-GB arrays)
+ * - their pages are zero-filled on first touch, so a zeroed allocation costs
+ *   nothing up front
+ */
+
+#include "../../include/utils/memory.h"
+#include <stdint.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #include <malloc.h>
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+static size_t buffer_alignment = 0;
+
+void* aligned_malloc(size_t size, size_t alignment) {
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    void* ptr = NULL;
+    if (posix_memalign(&ptr, alignment, size) != 0) {
+        return NULL;
+    }
+    return ptr;
+#endif
+}
+
+void aligned_free(void* ptr) {
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
+/**
+ * Alignment for array buffers: the L1 data cache line, never below 64 bytes
+ * (a full AVX-512 vector). Asks the OS for the line size alone, so allocating
+ * never runs the full hardware probe.
+ */
+size_t memory_buffer_alignment(void) {
+    if (buffer_alignment == 0) {
+        size_t line = 64;
+#if defined(_SC_LEVEL1_DCACHE_LINESIZE)
+        long detected = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+        if (detected > 0) line = (size_t)detected;
+#endif
+        
+        // Must be a power of two for posix_memalign
+        if (line < 64 || (line & (line - 1)) != 0) line = 64;
+        buffer_alignment = line;
+    }
+    return buffer_alignment;
+}
+
+/**
+ * Round value up to a multiple of `multiple` (0 on overflow)
+ */
+static size_t round_up(size_t value, size_t multiple) {
+    if (value > SIZE_MAX - (multiple - 1)) return 0;
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+/**
+ * Bytes actually reserved for a request; alloc and free must agree on it
+ */
+static size_t reserved_bytes(size_t bytes) {
+    size_t size = round_up(bytes > 0 ? bytes : 1, memory_buffer_alignment());
+    if (size >= MEMORY_LARGE_ALLOC_BYTES) {
+        size = round_up(size, MEMORY_HUGE_PAGE_BYTES);
+    }
+    return size;
+}
+
+/**
+ * Map a large, zero-filled region starting on a huge-page boundary
+ */
+static void* large_alloc(size_t size) {
+#ifdef _WIN32
+    // Committed pages are zero-filled and 64 KB aligned
+    return VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    // Over-map by one huge page so the start can be moved to a boundary
+    size_t span = size + MEMORY_HUGE_PAGE_BYTES;
+    char* raw = (char*)mmap(NULL, span, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return NULL;
+    
+    char* start = (char*)round_up((uintptr_t)raw, MEMORY_HUGE_PAGE_BYTES);
+    size_t head = (size_t)(start - raw);
+    size_t tail = span - head - size;
+    if (head > 0) munmap(raw, head);
+    if (tail > 0) munmap(start + size, tail);
+    
+    #ifdef MADV_HUGEPAGE
+    madvise(start, size, MADV_HUGEPAGE);
+    #endif
+    return start;
+#endif
+}
+
+static void large_free(void* ptr, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+    munmap(ptr, size);
+#endif
+}
+
+/**
+ * Allocate an aligned array buffer
+ */
+void* memory_buffer_alloc(size_t bytes, bool zeroed) {
+    size_t size = reserved_bytes(bytes);
+    if (size == 0) return NULL;  // size overflow
+    
+    if (size >= MEMORY_LARGE_ALLOC_BYTES) {
+        return large_alloc(size);  // already zero-filled
+    }
+    
+    void* ptr = aligned_malloc(size, memory_buffer_alignment());
+    if (ptr && zeroed) {
+        memset(ptr, 0, size);
+    }
+    return ptr;
+}
+
+/**
+ * Release an array buffer
+ */
+void memory_buffer_free(void* ptr, size_t bytes) {
+    if (!ptr) return;
+    
+    size_t size = reserved_bytes(bytes);
+    if (size >= MEMORY_LARGE_ALLOC_BYTES) {
+        large_free(ptr, size);
+    } else {
+        aligned_free(ptr);
+    }
+}
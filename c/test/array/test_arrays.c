@@ -86,8 +86,41 @@
 // }
 
  #include "../../include/array/array.h"
+ #include "../../include/array/array_view.h"
+ #include "../../include/array/array_math.h"
+ #include "../../include/array/array_reduce.h"
+ #include "../../include/array/array_string.h"
+ #include "../../include/array/array_io.h"
+ #include "../../include/array/array_expr.h"
+ #include "../../include/array/array_mask.h"
+ #include "../../include/array/array_index.h"
+ #include "../../include/array/array_linalg.h"
+ #include "../../include/array/array_sort.h"
+ #include "../../include/array/array_scan.h"
+ #include "../../include/array/array_convert.h"
+ #include "../../include/array/array_compress.h"
+ #include "../../include/array/array_sparse.h"
+ #include "../../include/runtime/parallel.h"
+ #include "../../include/utils/memory.h"
  #include <stdio.h>
+ #include <stdlib.h>
  #include <string.h>
+ #include <stdint.h>
+ #include <limits.h>
+ #include <stdatomic.h>
+ #include <math.h>
+ 
+ static int test_failures = 0;
+ 
+ #define ASSERT(cond, msg) \
+     do { \
+         if (cond) { \
+             printf("[PASS] %s\n", msg); \
+         } else { \
+             printf("[FAIL] %s\n", msg); \
+             test_failures++; \
+         } \
+     } while(0)
  
  /**
   * Helper function to print an integer array
@@ -176,9 +209,7 @@
      
      printf("String Array [");
      for (size_t i = 0; i < array->count; i++) {
-         char* value;
-         memcpy(&value, (char*)array->parray + i * array->sizeof_type, array->sizeof_type);
-         printf("\"%s\"", value);
+         printf("\"%s\"", array_string_get(array, i));
          if (i < array->count - 1) printf(", ");
      }
      printf("]\n");
@@ -264,6 +295,2496 @@
      printf("\n");
  }
  
+ /**
+  * Buffers are cache-line aligned; huge zeroed arrays come back zeroed untouched
+  */
+ void test_allocation(void) {
+     printf("\n--- Testing allocation backend ---\n");
+     
+     Array* small = array_empty(7, FLOAT, false);
+     ASSERT(small && (uintptr_t)small->parray % memory_buffer_alignment() == 0,
+            "Small buffer is cache-line aligned");
+     
+     Array* odd = array_zeros(3, CHAR, true);
+     ASSERT(odd && (uintptr_t)odd->parray % 64 == 0, "Dynamic buffer is 64-byte aligned");
+     
+     // 64 MB: takes the mapped, huge-page path
+     size_t big_count = 8u * 1024u * 1024u;
+     Array* big = array_zeros(big_count, DOUBLE, false);
+     bool zeroed = big != NULL;
+     for (size_t i = 0; zeroed && i < big_count; i += 4099) {
+         zeroed = ((double*)big->parray)[i] == 0.0;
+     }
+     ASSERT(zeroed && ((double*)big->parray)[big_count - 1] == 0.0, "Large array_zeros reads as zero");
+     ASSERT(big && (uintptr_t)big->parray % MEMORY_HUGE_PAGE_BYTES == 0,
+            "Large buffer starts on a huge-page boundary");
+     
+     array_free(small);
+     array_free(odd);
+     array_free(big);
+ }
+ 
+ /**
+  * Slices, reshape, ravel and transpose share the parent's buffer
+  */
+ void test_views(void) {
+     printf("\n--- Testing strided views ---\n");
+     
+     Array* a = array_arange(0, 12, 1, INT, false);
+     int* data = (int*)a->parray;
+     
+     // a[1:10:3] -> 1 4 7
+     Array* s = array_slice(a, 0, 1, 10, 3);
+     ASSERT(s && s->count == 3 && s->parray == a->parray && !s->owns_buffer, "Slice is a view");
+     ASSERT(*(int*)array_data(s) == 1 && s->strides[0] == 3, "Slice offset and stride");
+     
+     // a[::-1] -> 11 10 ... 0
+     Array* r = array_slice(a, 0, SLICE_DEFAULT, SLICE_DEFAULT, -1);
+     size_t last = 11;
+     ASSERT(r && r->count == 12 && *(int*)array_data(r) == 11 && *(int*)array_get_ptr(r, &last) == 0,
+            "Negative-step slice reverses");
+     
+     // 3x4 matrix, then its transpose
+     size_t shape[2] = { 3, 4 };
+     Array* m = array_reshape(a, shape, 2);
+     Array* t = array_transpose(m);
+     size_t idx[2] = { 3, 1 };
+     ASSERT(m && m->parray == a->parray && array_is_contiguous(m), "Reshape of contiguous array is a view");
+     ASSERT(t && t->shape[0] == 4 && t->shape[1] == 3 && *(int*)array_get_ptr(t, idx) == 7,
+            "Transpose swaps axes without copying");
+     ASSERT(!array_is_contiguous(t), "Transpose is not contiguous");
+     
+     // m[1:, ::2] -> [[4, 6], [8, 10]]
+     ArraySlice sl[2] = { { 1, SLICE_DEFAULT, SLICE_DEFAULT }, { SLICE_DEFAULT, SLICE_DEFAULT, 2 } };
+     Array* sub = array_slices(m, sl, 2);
+     int gathered[4];
+     array_gather(sub, gathered);
+     ASSERT(sub && sub->count == 4 && gathered[0] == 4 && gathered[1] == 6 && gathered[2] == 8 &&
+            gathered[3] == 10, "2-D slice gathers in row-major order");
+     
+     // Writes through a view land in the parent
+     int minus = -1;
+     array_scatter(sub, (int[]){ minus, minus, minus, minus });
+     ASSERT(data[4] == -1 && data[6] == -1 && data[5] == 5, "Scatter writes through the view");
+     
+     // Ravel of the transpose has to copy; ravel of m does not
+     Array* flat_t = array_ravel(t);
+     Array* flat_m = array_ravel(m);
+     ASSERT(flat_t && flat_t->owns_buffer && ((int*)flat_t->parray)[1] == -1 &&
+            ((int*)flat_t->parray)[3] == 1, "Ravel of a transposed view copies");
+     ASSERT(flat_m && !flat_m->owns_buffer && flat_m->parray == a->parray, "Ravel of contiguous array is a view");
+     
+     // array_copy materializes views and keeps the shape
+     Array* tc = array_copy(t, false);
+     ASSERT(tc && tc->num_dimensions == 2 && tc->shape[0] == 4 && array_is_contiguous(tc) &&
+            ((int*)tc->parray)[3] == 1, "Copy of a view is contiguous with the same shape");
+     
+     array_free(tc);
+     array_free(flat_m);
+     array_free(flat_t);
+     array_free(sub);
+     array_free(t);
+     array_free(m);
+     array_free(r);
+     array_free(s);
+     array_free(a);
+ }
+ 
+ /**
+  * Broadcasting elementwise math
+  */
+ void test_broadcasting(void) {
+     printf("\n--- Testing broadcasting ---\n");
+     
+     // (3,1) + (1,4) -> (3,4) with out[i][j] = 10*i + j
+     Array* col = array_arange(0, 30, 10, FLOAT, false);
+     Array* row = array_arange(0, 4, 1, FLOAT, false);
+     size_t col_shape[2] = { 3, 1 }, row_shape[2] = { 1, 4 };
+     array_set_shape(col, col_shape, 2);
+     array_set_shape(row, row_shape, 2);
+     
+     Array* sum = array_add(col, row);
+     bool ok = sum && sum->num_dimensions == 2 && sum->shape[0] == 3 && sum->shape[1] == 4;
+     for (size_t i = 0; ok && i < 12; i++) {
+         ok = ((float*)sum->parray)[i] == (float)(10 * (i / 4) + i % 4);
+     }
+     ASSERT(ok, "(3,1) + (1,4) broadcasts to (3,4)");
+     
+     // Same-shape operands collapse to one long kernel call; one operand transposed
+     Array* t = array_transpose(sum);
+     Array* tt = array_transpose(t);
+     Array* diff = array_sub(tt, sum);
+     ok = diff != NULL;
+     for (size_t i = 0; ok && i < 12; i++) ok = ((float*)diff->parray)[i] == 0.0f;
+     ASSERT(ok, "Strided operand matches contiguous operand");
+     
+     // 1-D operand broadcasts across rows; INT arithmetic
+     Array* m = array_arange(0, 6, 1, INT, false);
+     size_t m_shape[2] = { 2, 3 };
+     array_set_shape(m, m_shape, 2);
+     Array* v = array_arange(1, 4, 1, INT, false);
+     Array* prod = array_mul(m, v);
+     int expected[6] = { 0, 2, 6, 3, 8, 15 };
+     ASSERT(prod && memcmp(prod->parray, expected, sizeof(expected)) == 0, "(2,3) * (3,) broadcasts rows");
+     
+     // Output into a strided view: every other element of a zeroed buffer
+     Array* target = array_zeros(12, INT, false);
+     Array* evens = array_slice(target, 0, 0, SLICE_DEFAULT, 2);
+     Array* six = array_arange(0, 6, 1, INT, false);
+     ASSERT(array_binary_op_into(KERNEL_ADD, six, six, evens) &&
+            ((int*)target->parray)[10] == 10 && ((int*)target->parray)[11] == 0,
+            "Result written through a strided output view");
+     
+     Array* four = array_arange(0, 4, 1, INT, false);
+     Array* bad = array_add(m, four);
+     ASSERT(bad == NULL, "Incompatible shapes are rejected");
+     
+     // Output shifted by one element against an input on the same buffer
+     size_t shift_n = (size_t)1 << 22;
+     Array* line = array_arange(0, (double)shift_n, 1, INT, false);
+     Array* head = array_slice(line, 0, 0, -1, 1);
+     Array* tail = array_slice(line, 0, 1, SLICE_DEFAULT, 1);
+     Array* zeros = array_zeros(shift_n - 1, INT, false);
+     bool shifted = array_binary_op_into(KERNEL_ADD, head, zeros, tail);
+     for (size_t i = 0; shifted && i < shift_n; i++) shifted = ((int*)line->parray)[i] == (int)(i ? i - 1 : 0);
+     ASSERT(shifted, "Output view overlapping an input reads the input's old values");
+     // Same for a comparison: mask[1:] = mask[:-1] != false shifts the mask
+     Array* mask = array_zeros(shift_n, BOOL, false);
+     for (size_t i = 0; i < shift_n; i++) ((bool*)mask->parray)[i] = i % 3 == 0;
+     Array* mask_head = array_slice(mask, 0, 0, -1, 1);
+     Array* mask_tail = array_slice(mask, 0, 1, SLICE_DEFAULT, 1);
+     Array* none = array_zeros(shift_n - 1, BOOL, false);
+     bool compared = array_compare_into(CMP_NE, mask_head, none, mask_tail);
+     for (size_t i = 1; compared && i < shift_n; i++) compared = ((bool*)mask->parray)[i] == ((i - 1) % 3 == 0);
+     ASSERT(compared, "Comparison into a view overlapping an input");
+     array_free(none);
+     array_free(mask_tail);
+     array_free(mask_head);
+     array_free(mask);
+     array_free(zeros);
+     array_free(tail);
+     array_free(head);
+     array_free(line);
+     
+     // Integer division never traps: by zero gives 0, MIN / -1 wraps to MIN
+     Array* dividend = array_full(4, INT, &(int){ INT_MIN }, false);
+     Array* zero = array_full(4, INT, &(int){ 0 }, false);
+     Array* minus_one = array_full(4, INT, &(int){ -1 }, false);
+     Array* by_zero = array_div(dividend, zero);
+     Array* by_minus_one = array_div(dividend, minus_one);
+     Array* scalar_minus_one = array_full(1, INT, &(int){ -1 }, false);
+     Array* negated = array_div(m, scalar_minus_one);
+     ASSERT(by_zero && ((int*)by_zero->parray)[3] == 0, "INT division by zero yields 0");
+     ASSERT(by_minus_one && ((int*)by_minus_one->parray)[3] == INT_MIN &&
+            negated && ((int*)negated->parray)[5] == -5, "INT division by -1 negates and wraps");
+     Array* dividend64 = array_full(4, INT64, &(int64_t){ INT64_MIN }, false);
+     Array* minus_one64 = array_full(4, INT64, &(int64_t){ -1 }, false);
+     Array* by_minus_one64 = array_div(dividend64, minus_one64);
+     ASSERT(by_minus_one64 && ((int64_t*)by_minus_one64->parray)[3] == INT64_MIN, "INT64_MIN / -1 wraps");
+     
+     array_free(by_minus_one64);
+     array_free(minus_one64);
+     array_free(dividend64);
+     array_free(negated);
+     array_free(scalar_minus_one);
+     array_free(by_minus_one);
+     array_free(by_zero);
+     array_free(minus_one);
+     array_free(zero);
+     array_free(dividend);
+     array_free(four);
+     array_free(six);
+     array_free(evens);
+     array_free(target);
+     array_free(prod);
+     array_free(v);
+     array_free(m);
+     array_free(diff);
+     array_free(tt);
+     array_free(t);
+     array_free(sum);
+     array_free(row);
+     array_free(col);
+ }
+ 
+ /**
+  * Vectorized fill/iota constructors, with and without non-temporal stores
+  */
+ void test_fill(void) {
+     printf("\n--- Testing fill kernels ---\n");
+     
+     size_t saved = get_streaming_store_threshold();
+     for (int pass = 0; pass < 2; pass++) {
+         // Second pass streams every output regardless of size
+         set_streaming_store_threshold(pass == 0 ? SIZE_MAX : 0);
+         const char* mode = pass == 0 ? "cached" : "streaming";
+         char msg[96];
+         
+         Array* ones = array_ones(1003, DOUBLE, false);
+         bool ok = ones != NULL;
+         for (size_t i = 0; ok && i < 1003; i++) ok = ((double*)ones->parray)[i] == 1.0;
+         snprintf(msg, sizeof(msg), "array_ones(DOUBLE) fills every element (%s)", mode);
+         ASSERT(ok, msg);
+         
+         // Misaligned destination exercises the element-wise head and tail
+         char value = 'x';
+         char* bytes = (char*)ones->parray;
+         get_kernel(KERNEL_FILL, CHAR).fill(bytes + 3, &value, 200);
+         ok = bytes[2] != 'x' && bytes[3] == 'x' && bytes[202] == 'x' && bytes[203] != 'x';
+         snprintf(msg, sizeof(msg), "Unaligned CHAR fill stays in bounds (%s)", mode);
+         ASSERT(ok, msg);
+         
+         Array* range = array_arange(-5, 2000, 3, INT, false);
+         ok = range && range->count == 669;
+         for (size_t i = 0; ok && i < range->count; i++) ok = ((int*)range->parray)[i] == -5 + 3 * (int)i;
+         snprintf(msg, sizeof(msg), "array_arange(INT) matches start + i * step (%s)", mode);
+         ASSERT(ok, msg);
+         
+         Array* lin = array_linspace(0, 1, 1025, FLOAT, false);
+         ok = lin != NULL;
+         for (size_t i = 0; ok && i < 1025; i++) ok = ((float*)lin->parray)[i] == (float)(i / 1024.0);
+         snprintf(msg, sizeof(msg), "array_linspace(FLOAT) hits every point and the end (%s)", mode);
+         ASSERT(ok, msg);
+         
+         array_free(lin);
+         array_free(range);
+         array_free(ones);
+     }
+     set_streaming_store_threshold(saved);
+     
+     // Integer outputs clamp values outside the type's range instead of wrapping
+     Array* wide = array_linspace(-3e9, 3e9, 3, INT, false);
+     ASSERT(wide && ((int*)wide->parray)[0] == INT_MIN && ((int*)wide->parray)[1] == 0 &&
+            ((int*)wide->parray)[2] == INT_MAX, "array_linspace(INT) clamps to the INT range");
+     Array* chars = array_arange(100, 400, 100, CHAR, false);
+     ASSERT(chars && chars->count == 3 && ((char*)chars->parray)[0] == 100 &&
+            ((char*)chars->parray)[1] == CHAR_MAX && ((char*)chars->parray)[2] == CHAR_MAX,
+            "array_arange(CHAR) clamps to the CHAR range");
+     
+     // Narrow integer types: negative values, and values past either end
+     Array* bytes8 = array_arange(-200, 200, 50, INT8, false);
+     int8_t want8[8] = { -128, -128, -100, -50, 0, 50, 100, 127 };
+     ASSERT(bytes8 && bytes8->count == 8 && memcmp(bytes8->parray, want8, sizeof(want8)) == 0,
+            "array_arange(INT8) keeps negatives and clamps both ends");
+     Array* ubytes = array_arange(-5, 5, 1, UINT8, false);
+     bool clamped = ubytes && ubytes->count == 10;
+     for (size_t i = 0; clamped && i < 10; i++) clamped = ((uint8_t*)ubytes->parray)[i] == (i < 5 ? 0 : i - 5);
+     ASSERT(clamped, "array_arange(UINT8) clamps negatives to 0");
+     Array* lin8 = array_linspace(0, 1000, 5, INT8, false);
+     int8_t want_lin8[5] = { 0, 127, 127, 127, 127 };
+     ASSERT(lin8 && memcmp(lin8->parray, want_lin8, sizeof(want_lin8)) == 0,
+            "array_linspace(INT8) clamps to 127");
+     Array* lin16 = array_linspace(-40000, 40000, 5, INT16, false);
+     int16_t want_lin16[5] = { INT16_MIN, -20000, 0, 20000, INT16_MAX };
+     ASSERT(lin16 && memcmp(lin16->parray, want_lin16, sizeof(want_lin16)) == 0,
+            "array_linspace(INT16) clamps both ends");
+     Array* ones16 = array_ones(37, INT16, false);
+     ASSERT(ones16 && ((int16_t*)ones16->parray)[0] == 1 && ((int16_t*)ones16->parray)[36] == 1,
+            "array_ones(INT16)");
+     
+     array_free(ones16);
+     array_free(lin16);
+     array_free(lin8);
+     array_free(ubytes);
+     array_free(bytes8);
+     array_free(chars);
+     array_free(wide);
+     
+     // Every IOTA variant rounds and clamps like the scalar one (no contracted
+     // multiply-adds), over values every type holds and values none does
+     uint64_t want[1003], got[1003];
+     bool iota_ok = true;
+     for (int t = 0; t < TYPE_COUNT; t++) {
+         IotaKernelFn scalar = get_kernel_variant(KERNEL_IOTA, (Type)t, ISA_SCALAR).iota;
+         if (!scalar) continue;
+         for (int isa = ISA_SCALAR + 1; isa <= (int)get_runtime_isa_level(); isa++) {
+             IotaKernelFn iota = get_kernel_variant(KERNEL_IOTA, (Type)t, (IsaLevel)isa).iota;
+             if (!iota) continue;
+             scalar(want, 0.1, 1.0 / 9.0, 1003);
+             iota(got, 0.1, 1.0 / 9.0, 1003);
+             iota_ok = iota_ok && memcmp(want, got, 1003 * array_sizeof_type((Type)t)) == 0;
+             scalar(want, 3.7, 0.07, 1003);
+             iota(got, 3.7, 0.07, 1003);
+             iota_ok = iota_ok && memcmp(want, got, 1003 * array_sizeof_type((Type)t)) == 0;
+             scalar(want, -1e19, 3e16, 1003);
+             iota(got, -1e19, 3e16, 1003);
+             iota_ok = iota_ok && memcmp(want, got, 1003 * array_sizeof_type((Type)t)) == 0;
+         }
+     }
+     ASSERT(iota_ok, "Every IOTA kernel variant matches the scalar one bit for bit");
+ }
+ 
+ /**
+  * Whole-array and per-axis reductions
+  */
+ void test_reductions(void) {
+     printf("\n--- Testing reductions ---\n");
+     
+     // 0.1f two million times: a running float sum drifts by percents
+     size_t n = 2000000;
+     float tenth = 0.1f;
+     Array* big = array_full(n, FLOAT, &tenth, false);
+     double expected = (double)tenth * (double)n;
+     ASSERT(fabs(array_sum(big) - expected) < 1e-6 * expected, "FLOAT sum does not drift");
+     
+     // Block partials combine in a fixed order, whatever the thread count
+     parallel_set_thread_count(1);
+     double serial = array_sum(big);
+     parallel_set_thread_count(4);
+     double threaded = array_sum(big);
+     parallel_set_thread_count(0);
+     ASSERT(serial == threaded, "Threaded sum matches serial sum exactly");
+     
+     // Long axis 0 and a strided whole-array sum stay as close as the flat sum
+     Array* tall = array_full(2 * n, DOUBLE, &(double){ 0.1 }, false);
+     array_set_shape(tall, (size_t[]){n, 2}, 2);
+     Array* tall_sums = array_sum_axis(tall, 0);
+     Array* tall_t = array_transpose(tall);
+     double flat = array_sum(tall);
+     ASSERT(tall_sums && fabs(((double*)tall_sums->parray)[0] - flat / 2) < 1e-14 * flat &&
+            fabs(((double*)tall_sums->parray)[1] - flat / 2) < 1e-14 * flat,
+            "Axis-0 sum over a long axis does not drift");
+     ASSERT(fabs(array_sum(tall_t) - flat) < 1e-14 * flat, "Strided sum does not drift");
+     array_free(tall_t);
+     array_free(tall_sums);
+     array_free(tall);
+     
+     ((float*)big->parray)[1234567] = -3.0f;
+     ((float*)big->parray)[77] = 9.0f;
+     ((float*)big->parray)[1999999] = 9.0f;
+     ASSERT(array_min(big) == -3.0 && array_argmin(big) == 1234567, "min/argmin across blocks");
+     ASSERT(array_max(big) == 9.0 && array_argmax(big) == 77, "argmax returns the first occurrence");
+     
+     // NaN wins wherever it sits; the first NaN gives the index
+     Array* values = array_arange(1, 101, 1, DOUBLE, false);
+     bool nan_ok = true;
+     for (size_t pos = 0; pos < 100; pos += 3) {
+         ((double*)values->parray)[pos] = NAN;
+         nan_ok = nan_ok && isnan(array_min(values)) && isnan(array_max(values)) &&
+                  array_argmin(values) == pos && array_argmax(values) == pos;
+         ((double*)values->parray)[pos] = (double)(pos + 1);
+     }
+     ASSERT(nan_ok, "min, max, argmin and argmax propagate NaN at any position");
+     
+     ((float*)big->parray)[1800000] = NAN;
+     ((float*)big->parray)[1500000] = -NAN;
+     parallel_set_thread_count(4);
+     ASSERT(isnan(array_min(big)) && isnan(array_max(big)) &&
+            array_argmin(big) == 1500000 && array_argmax(big) == 1500000,
+            "NaN propagates across blocks");
+     parallel_set_thread_count(0);
+     
+     // Both axis paths: rows combined elementwise, runs through a strided view
+     array_set_shape(values, (size_t[]){25, 4}, 2);
+     ((double*)values->parray)[6] = NAN;
+     Array* col_min = array_min_axis(values, 0);
+     Array* col_arg = array_argmax_axis(values, 0);
+     Array* flipped = array_transpose(values);
+     Array* flipped_max = array_max_axis(flipped, 1);
+     ASSERT(col_min && isnan(((double*)col_min->parray)[2]) && ((double*)col_min->parray)[1] == 2.0 &&
+            col_arg && ((int*)col_arg->parray)[2] == 1 && ((int*)col_arg->parray)[3] == 24 &&
+            flipped_max && isnan(((double*)flipped_max->parray)[2]) && ((double*)flipped_max->parray)[0] == 97.0,
+            "Axis reductions propagate NaN");
+     
+     // (3,4) INT matrix 0..11
+     Array* m = array_arange(0, 12, 1, INT, false);
+     size_t shape[2] = { 3, 4 };
+     array_set_shape(m, shape, 2);
+     ASSERT(array_sum(m) == 66.0 && array_mean(m) == 5.5, "INT sum and mean");
+     
+     Array* cols = array_sum_axis(m, 0);
+     double col_sums[4] = { 12, 15, 18, 21 };
+     ASSERT(cols && cols->type == DOUBLE && cols->num_dimensions == 1 && cols->shape[0] == 4 &&
+            memcmp(cols->parray, col_sums, sizeof(col_sums)) == 0, "sum over axis 0");
+     
+     Array* rows = array_max_axis(m, 1);
+     int row_max[3] = { 3, 7, 11 };
+     ASSERT(rows && rows->type == INT && memcmp(rows->parray, row_max, sizeof(row_max)) == 0,
+            "max over axis 1 keeps the element type");
+     
+     // Same reductions through a transposed (strided) view
+     Array* t = array_transpose(m);
+     Array* t_rows = array_sum_axis(t, 1);
+     Array* t_arg = array_argmin_axis(t, 0);
+     int t_argmin[3] = { 0, 0, 0 };
+     ASSERT(t_rows && memcmp(t_rows->parray, col_sums, sizeof(col_sums)) == 0 &&
+            t_arg && memcmp(t_arg->parray, t_argmin, sizeof(t_argmin)) == 0 &&
+            array_sum(t) == 66.0 && array_argmax(t) == 11,
+            "Reductions over a transposed view");
+     
+     Array* prod = array_prod_axis(m, 1);
+     ASSERT(prod && ((double*)prod->parray)[1] == 4.0 * 5 * 6 * 7, "prod over axis 1");
+     
+     // 64-bit integer sums stay exact (and wrap) instead of going through double
+     Array* wide = array_empty(2, INT64, false);
+     ((int64_t*)wide->parray)[0] = (int64_t)1 << 60;
+     ((int64_t*)wide->parray)[1] = 1;
+     Array* wide_sum = array_sum_axis(wide, 0);
+     ASSERT(wide_sum && wide_sum->type == INT64 && ((int64_t*)wide_sum->parray)[0] == ((int64_t)1 << 60) + 1 &&
+            array_sum(wide) == (double)(((int64_t)1 << 60) + 1), "INT64 sum of [2^60, 1] is exact");
+     
+     size_t long_count = 300000;
+     Array* longs = array_empty(long_count, UINT64, false);
+     uint64_t long_total = 0;
+     for (size_t i = 0; i < long_count; i++) {
+         ((uint64_t*)longs->parray)[i] = ((uint64_t)i << 45) + i;
+         long_total += ((uint64_t)i << 45) + i;
+     }
+     parallel_set_thread_count(4);
+     Array* longs_sum = array_sum_axis(longs, 0);
+     parallel_set_thread_count(0);
+     ASSERT(longs_sum && ((uint64_t*)longs_sum->parray)[0] == long_total && array_sum(longs) == (double)long_total,
+            "UINT64 sum across blocks wraps exactly");
+     
+     // Rows path (axis 0) and runs path (axis 1) of a (2, 3) INT64 matrix
+     Array* pairs = array_empty(6, INT64, false);
+     int64_t big_one = ((int64_t)1 << 62) + 1;
+     memcpy(pairs->parray, (int64_t[]){ big_one, -3, 7, big_one, 4, -7 }, 6 * sizeof(int64_t));
+     array_set_shape(pairs, (size_t[]){2, 3}, 2);
+     Array* pairs_down = array_sum_axis(pairs, 0);
+     Array* pairs_across = array_sum_axis(pairs, 1);
+     Array* pairs_mean = array_mean_axis(pairs, 0);
+     ASSERT(pairs_down && pairs_down->type == INT64 &&
+            memcmp(pairs_down->parray, (int64_t[]){ (int64_t)((uint64_t)big_one * 2), 1, 0 }, 3 * sizeof(int64_t)) == 0 &&
+            pairs_across && memcmp(pairs_across->parray, (int64_t[]){ big_one + 4, big_one - 3 }, 2 * sizeof(int64_t)) == 0 &&
+            pairs_mean && pairs_mean->type == DOUBLE && ((double*)pairs_mean->parray)[1] == 0.5,
+            "INT64 axis sums keep the type along both paths");
+     
+     Array* empty = array_empty(0, DOUBLE, false);
+     double result;
+     ASSERT(array_sum(empty) == 0.0 && !array_reduce(REDUCE_MIN, empty, &result),
+            "Empty sum is 0, empty min is an error");
+     
+     array_free(empty);
+     array_free(pairs_mean);
+     array_free(pairs_across);
+     array_free(pairs_down);
+     array_free(pairs);
+     array_free(longs_sum);
+     array_free(longs);
+     array_free(wide_sum);
+     array_free(wide);
+     array_free(flipped_max);
+     array_free(flipped);
+     array_free(col_arg);
+     array_free(col_min);
+     array_free(values);
+     array_free(prod);
+     array_free(t_arg);
+     array_free(t_rows);
+     array_free(t);
+     array_free(rows);
+     array_free(cols);
+     array_free(m);
+     array_free(big);
+ }
+ 
+ /**
+  * STRING arrays: offsets plus one blob
+  */
+ void test_strings(void) {
+     printf("\n--- Testing string arrays ---\n");
+     
+     const char* words[] = { "apple", "", "banana", NULL, "grape", "pineapple" };
+     Array* fruit = array_from_strings(words, 6, false);
+     ASSERT(fruit && fruit->strings_size == 6 + 1 + 7 + 1 + 6 + 10, "Strings share one blob");
+     ASSERT(strcmp(array_string_get(fruit, 2), "banana") == 0 &&
+            strcmp(array_string_get(fruit, 3), "") == 0 && array_string_length(fruit, 5) == 9,
+            "Strings are read back by index");
+     
+     Array* has_apple = array_string_contains(fruit, "apple");
+     bool expected_apple[6] = { true, false, false, false, false, true };
+     ASSERT(has_apple && memcmp(has_apple->parray, expected_apple, sizeof(expected_apple)) == 0,
+            "contains scans the blob and maps hits to elements");
+     
+     // "an" appears twice in "banana"; the element is only marked once
+     Array* has_an = array_string_contains(fruit, "an");
+     bool expected_an[6] = { false, false, true, false, false, false };
+     ASSERT(has_an && memcmp(has_an->parray, expected_an, sizeof(expected_an)) == 0,
+            "contains with repeated hits inside one string");
+     
+     Array* empty_eq = array_string_equal(fruit, "");
+     bool expected_empty[6] = { false, true, false, true, false, false };
+     ASSERT(empty_eq && memcmp(empty_eq->parray, expected_empty, sizeof(expected_empty)) == 0,
+            "equal compares lengths before bytes");
+     
+     // Every other element: strided view, then a compacted copy
+     Array* odd = array_slice(fruit, 0, 1, SLICE_DEFAULT, 2);
+     Array* odd_copy = array_copy(odd, false);
+     ASSERT(odd_copy && odd_copy->count == 3 && strcmp(array_string_get(odd_copy, 2), "pineapple") == 0 &&
+            odd_copy->strings_size == 1 + 1 + 10, "Copy of a strided view compacts the blob");
+     
+     // Contiguous tail view: offsets are rebased in the copy
+     Array* tail = array_slice(fruit, 0, 4, SLICE_DEFAULT, 1);
+     Array* tail_copy = array_copy(tail, false);
+     Array* tail_grape = array_string_equal(tail_copy, "grape");
+     ASSERT(tail_grape && ((bool*)tail_grape->parray)[0] && !((bool*)tail_grape->parray)[1] &&
+            ((int64_t*)tail_copy->parray)[0] == 0, "Copy of a contiguous view rebases offsets");
+     
+     const char* hello = "hello";
+     Array* many = array_full(1000, STRING, &hello, false);
+     Array* many_copy = array_copy(many, false);
+     ASSERT(many_copy && many_copy->strings_size == 6000 &&
+            strcmp(array_string_get(many_copy, 999), "hello") == 0, "array_full repeats into one blob");
+     
+     array_free(many_copy);
+     array_free(many);
+     array_free(tail_grape);
+     array_free(tail_copy);
+     array_free(tail);
+     array_free(odd_copy);
+     array_free(odd);
+     array_free(empty_eq);
+     array_free(has_an);
+     array_free(has_apple);
+     array_free(fruit);
+ }
+ 
+ /**
+  * Copies share the buffer until one side writes
+  */
+ void test_copy_on_write(void) {
+     printf("\n--- Testing copy-on-write ---\n");
+     
+     Array* a = array_arange(0, 8, 1, INT, false);
+     Array* snapshot = array_copy(a, false);
+     ASSERT(snapshot && snapshot->parray == a->parray && atomic_load(&a->buffer->refcount) == 2,
+            "Copy of a whole array shares the buffer");
+     
+     // Writing through a view of the original detaches the original, not the copy
+     Array* tail = array_slice(a, 0, 4, SLICE_DEFAULT, 1);
+     Array* ones = array_ones(4, INT, false);
+     ASSERT(array_binary_op_into(KERNEL_ADD, tail, ones, tail), "Write through a view of a shared array");
+     ASSERT(((int*)array_data(tail))[0] == 5 && ((int*)a->parray)[4] == 5 &&
+            ((int*)snapshot->parray)[4] == 4 && a->parray != snapshot->parray,
+            "View and base see the write; the copy keeps the snapshot");
+     ASSERT(atomic_load(&snapshot->buffer->refcount) == 1, "Snapshot is left as sole owner");
+     
+     // Writer-side detach: the copy asks for a private buffer
+     Array* second = array_copy(snapshot, false);
+     ASSERT(array_make_writable(second) && second->parray != snapshot->parray, "make_writable detaches");
+     ((int*)second->parray)[0] = 100;
+     ASSERT(((int*)snapshot->parray)[0] == 0, "Detached copy writes privately");
+     
+     // Freeing the original first keeps the shared buffer alive for the copy
+     Array* b = array_full(3, DOUBLE, &(double){2.5}, false);
+     Array* b_copy = array_copy(b, false);
+     array_free(b);
+     ASSERT(((double*)b_copy->parray)[2] == 2.5, "Copy outlives the original");
+     
+     // Strided views and dynamic copies still copy eagerly
+     Array* evens = array_slice(a, 0, 0, SLICE_DEFAULT, 2);
+     Array* evens_copy = array_copy(evens, false);
+     Array* dynamic = array_copy(a, true);
+     ASSERT(evens_copy->parray != a->parray && dynamic->parray != a->parray,
+            "Partial and dynamic copies get their own buffer");
+     
+     array_free(dynamic);
+     array_free(evens_copy);
+     array_free(evens);
+     array_free(b_copy);
+     array_free(second);
+     array_free(ones);
+     array_free(tail);
+     array_free(snapshot);
+     array_free(a);
+ }
+ 
+ /**
+  * .npy round trips and mapped loads
+  */
+ void test_npy(void) {
+     printf("\n--- Testing .npy load/save ---\n");
+     const char* path = "bin/test_arrays.npy";
+     
+     Array* grid = array_arange(0, 12, 1, INT, false);
+     array_set_shape(grid, (size_t[]){3, 4}, 2);
+     ASSERT(array_save_npy(grid, path), "Save a 2-D INT array");
+     
+     FILE* file = fopen(path, "rb");
+     unsigned char preamble[10] = {0};
+     ASSERT(file && fread(preamble, 1, 10, file) == 10 && memcmp(preamble, "\x93NUMPY", 6) == 0 &&
+            (10 + (preamble[8] | preamble[9] << 8)) % 64 == 0, "Header pads data to 64 bytes");
+     if (file) fclose(file);
+     
+     Array* loaded = array_load_npy(path);
+     ASSERT(loaded && loaded->type == INT && loaded->num_dimensions == 2 &&
+            loaded->shape[0] == 3 && loaded->shape[1] == 4 && ((int*)loaded->parray)[11] == 11,
+            "Load restores type, shape and data");
+     
+     // Mapping is private: writes stay in memory
+     ((int*)loaded->parray)[0] = 42;
+     Array* reloaded = array_load_npy(path);
+     ASSERT(reloaded && ((int*)reloaded->parray)[0] == 0, "Writes to a loaded array do not reach the file");
+     
+     // Views are saved in logical order
+     Array* transposed = array_transpose(grid);
+     ASSERT(array_save_npy(transposed, path), "Save a transposed view");
+     Array* t_loaded = array_load_npy(path);
+     ASSERT(t_loaded && t_loaded->shape[0] == 4 && ((int*)t_loaded->parray)[1] == 4,
+            "Transposed view is written row-major");
+     
+     // Copies share the mapping and outlive the original
+     Array* values = array_linspace(0, 1, 5, DOUBLE, false);
+     ASSERT(array_save_npy(values, path), "Save a DOUBLE array");
+     Array* v_loaded = array_load_npy(path);
+     Array* v_copy = array_copy(v_loaded, false);
+     array_free(v_loaded);
+     ASSERT(v_copy && v_copy->num_dimensions == 1 && ((double*)v_copy->parray)[4] == 1.0,
+            "Copy of a mapped array outlives it");
+     
+     // Hand-written Fortran-order file loads as column-major
+     file = fopen(path, "wb");
+     char header[118];
+     int n = snprintf(header, sizeof(header), "{'descr': '<i4', 'fortran_order': True, 'shape': (2, 3), }");
+     memset(header + n, ' ', sizeof(header) - n - 1);
+     header[sizeof(header) - 1] = '\n';
+     int column_major[6] = {0, 3, 1, 4, 2, 5};
+     fwrite("\x93NUMPY\x01\x00\x76\x00", 1, 10, file);
+     fwrite(header, 1, sizeof(header), file);
+     fwrite(column_major, sizeof(int), 6, file);
+     fclose(file);
+     Array* fortran = array_load_npy(path);
+     ASSERT(fortran && *(int*)array_get_ptr(fortran, (size_t[]){1, 0}) == 3 &&
+            *(int*)array_get_ptr(fortran, (size_t[]){0, 2}) == 2, "Fortran-order file loads column-major");
+     
+     ASSERT(!array_load_npy("bin/missing.npy"), "Missing file fails");
+     remove(path);
+     
+     array_free(fortran);
+     array_free(v_copy);
+     array_free(values);
+     array_free(t_loaded);
+     array_free(transposed);
+     array_free(reloaded);
+     array_free(loaded);
+     array_free(grid);
+ }
+ 
+ /**
+  * Fused expressions match the eager elementwise ops
+  */
+ void test_expressions(void) {
+     printf("\n--- Testing fused expressions ---\n");
+     
+     // (a * b + c) / d with c broadcast along rows and b a transposed view
+     size_t rows = 400, cols = 700;  // large enough to split across threads
+     Array* a = array_linspace(1, 2, rows * cols, DOUBLE, false);
+     Array* bt = array_linspace(-1, 1, rows * cols, DOUBLE, false);
+     Array* c = array_arange(0, (double)cols, 1, DOUBLE, false);
+     Array* d = array_full(rows * cols, DOUBLE, &(double){4.0}, false);
+     array_set_shape(a, (size_t[]){rows, cols}, 2);
+     array_set_shape(bt, (size_t[]){cols, rows}, 2);
+     array_set_shape(c, (size_t[]){1, cols}, 2);
+     array_set_shape(d, (size_t[]){rows, cols}, 2);
+     Array* b = array_transpose(bt);
+     
+     ArrayExpr* e = array_expr_new();
+     int ab = array_expr_mul(e, array_expr_input(e, a), array_expr_input(e, b));
+     int root = array_expr_div(e, array_expr_add(e, ab, array_expr_input(e, c)), array_expr_input(e, d));
+     Array* fused = array_expr_eval(e, root);
+     
+     Array* t1 = array_mul(a, b);
+     Array* t2 = array_add(t1, c);
+     Array* eager = array_div(t2, d);
+     ASSERT(fused && fused->num_dimensions == 2 && fused->shape[0] == rows && fused->shape[1] == cols &&
+            memcmp(fused->parray, eager->parray, rows * cols * sizeof(double)) == 0,
+            "Fused (a*b + c)/d matches eager ops bit for bit");
+     
+     // Shared subexpressions and constants: x*x + x*2 over a strided view
+     Array* base = array_arange(0, 2000, 1, INT, false);
+     Array* odd = array_slice(base, 0, 1, SLICE_DEFAULT, 2);
+     ArrayExpr* g = array_expr_new();
+     int x = array_expr_input(g, odd);
+     int poly = array_expr_add(g, array_expr_mul(g, x, x), array_expr_mul(g, x, array_expr_scalar(g, 2)));
+     Array* p = array_expr_eval(g, poly);
+     bool poly_ok = p && p->count == 1000;
+     for (size_t i = 0; poly_ok && i < 1000; i++) {
+         int v = (int)(2 * i + 1);
+         poly_ok = ((int*)p->parray)[i] == v * v + 2 * v;
+     }
+     ASSERT(poly_ok, "Shared nodes and scalars evaluate correctly");
+     
+     // In place into one of the inputs, and into a strided view
+     int inc = array_expr_add(g, x, array_expr_scalar(g, 1));
+     ASSERT(array_expr_eval_into(g, inc, odd) && ((int*)base->parray)[1] == 2 &&
+            ((int*)base->parray)[0] == 0 && ((int*)base->parray)[1999] == 2000,
+            "Evaluate into an input view in place");
+     
+     // Output shifted by one element against its input on the same buffer
+     size_t shift_n = (size_t)1 << 20;
+     Array* line = array_arange(0, (double)shift_n, 1, INT, false);
+     Array* src = array_slice(line, 0, 0, -1, 1);
+     Array* dst = array_slice(line, 0, 1, SLICE_DEFAULT, 1);
+     ArrayExpr* s = array_expr_new();
+     int moved = array_expr_add(s, array_expr_input(s, src), array_expr_scalar(s, 0));
+     bool shifted = array_expr_eval_into(s, moved, dst);
+     for (size_t i = 0; shifted && i < shift_n; i++) shifted = ((int*)line->parray)[i] == (int)(i ? i - 1 : 0);
+     ASSERT(shifted, "Evaluate into a view overlapping an input");
+     array_expr_free(s);
+     array_free(dst);
+     array_free(src);
+     array_free(line);
+     
+     // Constants outside the element type's range clamp like astype
+     int capped = array_expr_minimum(g, x, array_expr_scalar(g, 1e12));
+     int floored = array_expr_maximum(g, x, array_expr_scalar(g, -1e12));
+     Array* capped_out = array_expr_eval(g, capped);
+     Array* floored_out = array_expr_eval(g, floored);
+     ASSERT(capped_out && ((int*)capped_out->parray)[0] == 2 &&
+            floored_out && ((int*)floored_out->parray)[999] == 2000,
+            "Out-of-range INT constants clamp to the type's range");
+     array_free(floored_out);
+     array_free(capped_out);
+     
+     // FMA node
+     ArrayExpr* f = array_expr_new();
+     int fma = array_expr_fma(f, array_expr_input(f, a), array_expr_scalar(f, 2), array_expr_scalar(f, 1));
+     Array* fma_out = array_expr_eval(f, fma);
+     ASSERT(fma_out && ((double*)fma_out->parray)[0] == 3.0 &&
+            ((double*)fma_out->parray)[rows * cols - 1] == 5.0, "FMA node");
+     
+     // (1 + e)^2 - (1 + 2e) is e^2 only when rounded once: every variant fuses
+     float fa[37], fc[37], fout[37];
+     double da[37], dc[37], dout[37];
+     for (int i = 0; i < 37; i++) {
+         fa[i] = 1.0f + ldexpf(1.0f, -12);
+         fc[i] = -(1.0f + ldexpf(1.0f, -11));
+         da[i] = 1.0 + ldexp(1.0, -27);
+         dc[i] = -(1.0 + ldexp(1.0, -26));
+     }
+     bool fused_ok = true;
+     for (int isa = ISA_SCALAR; isa <= (int)get_runtime_isa_level(); isa++) {
+         FmaKernelFn ffn = get_kernel_variant(KERNEL_FMA, FLOAT, (IsaLevel)isa).fma;
+         FmaKernelFn dfn = get_kernel_variant(KERNEL_FMA, DOUBLE, (IsaLevel)isa).fma;
+         if (!ffn || !dfn) continue;
+         ffn(fa, fa, fc, fout, 37);
+         dfn(da, da, dc, dout, 37);
+         for (int i = 0; i < 37; i++) {
+             fused_ok = fused_ok && fout[i] == ldexpf(1.0f, -24) && dout[i] == ldexp(1.0, -54);
+         }
+     }
+     ASSERT(fused_ok, "Every FLOAT/DOUBLE FMA variant rounds once");
+     
+     // Errors: mixed types, bad shapes, propagated failures
+     Array* ints = array_arange(0, 4, 1, INT, false);
+     Array* wrong = array_zeros(3, DOUBLE, false);
+     ArrayExpr* bad = array_expr_new();
+     int lhs = array_expr_input(bad, c);
+     ASSERT(array_expr_input(bad, ints) == -1, "Mixed types are rejected");
+     ASSERT(array_expr_add(bad, lhs, array_expr_input(bad, ints)) == -1, "Failures propagate");
+     ASSERT(!array_expr_eval(bad, array_expr_add(bad, lhs, array_expr_input(bad, wrong))),
+            "Incompatible shapes are rejected");
+     
+     array_expr_free(bad);
+     array_free(wrong);
+     array_free(ints);
+     array_free(fma_out);
+     array_expr_free(f);
+     array_free(p);
+     array_expr_free(g);
+     array_free(odd);
+     array_free(base);
+     array_free(eager);
+     array_free(t2);
+     array_free(t1);
+     array_free(fused);
+     array_expr_free(e);
+     array_free(b);
+     array_free(d);
+     array_free(c);
+     array_free(bt);
+     array_free(a);
+ }
+ 
+ /**
+  * Marks every index it is given; uneven work so ranges get stolen
+  */
+ typedef struct {
+     atomic_int* visits;
+     atomic_size_t nested;
+ } PoolProbe;
+ 
+ static void pool_visit(size_t begin, size_t end, void* ctx) {
+     PoolProbe* probe = (PoolProbe*)ctx;
+     for (size_t i = begin; i < end; i++) {
+         volatile double spin = 0;
+         for (size_t k = 0; k < (i < 1000 ? 2000 : 10); k++) spin += (double)k;
+         atomic_fetch_add(&probe->visits[i], 1);
+     }
+ }
+ 
+ static void pool_count(size_t begin, size_t end, void* ctx) {
+     atomic_fetch_add(&((PoolProbe*)ctx)->nested, end - begin);
+ }
+ 
+ static void pool_nested(size_t begin, size_t end, void* ctx) {
+     // Nested loops run serially on the calling worker
+     for (size_t i = begin; i < end; i++) parallel_for(100, 1, pool_count, ctx);
+ }
+ 
+ /**
+  * The persistent pool covers every index exactly once
+  */
+ void test_thread_pool(void) {
+     printf("\n--- Testing thread pool ---\n");
+     
+     size_t n = 20000;
+     atomic_int* visits = (atomic_int*)calloc(n, sizeof(atomic_int));
+     PoolProbe probe = { visits, 0 };
+     bool exact = true;
+     for (size_t threads = 1; threads <= 8; threads *= 2) {
+         parallel_set_thread_count(threads);
+         for (int round = 0; round < 3; round++) {
+             for (size_t i = 0; i < n; i++) atomic_store(&visits[i], 0);
+             parallel_for(n, 16, pool_visit, &probe);
+             for (size_t i = 0; i < n && exact; i++) exact = atomic_load(&visits[i]) == 1;
+         }
+     }
+     ASSERT(exact, "Every index runs exactly once, across thread counts and reuse");
+     
+     parallel_set_thread_count(4);
+     parallel_for(64, 1, pool_nested, &probe);
+     ASSERT(atomic_load(&probe.nested) == 6400, "Nested loops complete");
+     
+     // Large fills and copies split across the pool
+     size_t big = (size_t)3 << 20;
+     Array* filled = array_full(big, DOUBLE, &(double){1.5}, false);
+     Array* tail = array_slice(filled, 0, 1, SLICE_DEFAULT, 1);
+     Array* copied = array_copy(tail, false);
+     parallel_set_thread_count(0);
+     bool same = copied && copied->count == big - 1;
+     for (size_t i = 0; same && i < big - 1; i += 4099) same = ((double*)copied->parray)[i] == 1.5;
+     ASSERT(same && ((double*)copied->parray)[big - 2] == 1.5 && ((double*)filled->parray)[0] == 1.5,
+            "Threaded fill and copy cover the whole array");
+     
+     ASSERT(parallel_grain(8) >= 1 && parallel_grain(1) >= parallel_grain(8), "Grain shrinks with item size");
+     
+     array_free(copied);
+     array_free(tail);
+     array_free(filled);
+     free(visits);
+ }
+ 
+ /**
+  * Comparison masks and masked selection
+  */
+ void test_masks(void) {
+     printf("\n--- Testing masks and selection ---\n");
+     
+     Array* values = array_arange(0, 1000, 1, INT, false);
+     int pivot = 500;
+     Array* above = array_compare_value(CMP_GT, values, &pivot);
+     ASSERT(above && above->type == BOOL && array_count_true(above) == 499, "Compare to a value counts");
+     Array* picked = array_select(values, above);
+     ASSERT(picked && picked->count == 499 && ((int*)picked->parray)[0] == 501 &&
+            ((int*)picked->parray)[498] == 999, "Select keeps order");
+     
+     // Every compaction variant against a scalar reference, across blocks and tails
+     size_t n = 150001;
+     bool* pattern = (bool*)malloc(n);
+     for (size_t i = 0; i < n; i++) pattern[i] = (i * 2654435761u >> 7) % 3 == 0 || (i / 1000) % 7 == 3;
+     Type types[] = { INT, FLOAT, DOUBLE, CHAR };
+     bool kernels_ok = true;
+     for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+         size_t size = array_sizeof_type(types[t]);
+         unsigned char* src = (unsigned char*)malloc(n * size);
+         unsigned char* want = (unsigned char*)malloc(n * size);
+         unsigned char* got = (unsigned char*)malloc(n * size);
+         for (size_t i = 0; i < n * size; i++) src[i] = (unsigned char)(i * 31 + 7);
+         size_t expected = 0;
+         for (size_t i = 0; i < n; i++) {
+             if (pattern[i]) memcpy(want + size * expected++, src + i * size, size);
+         }
+         for (int isa = ISA_SCALAR; isa <= (int)get_runtime_isa_level(); isa++) {
+             Kernel k = get_kernel_variant(KERNEL_COMPRESS, types[t], (IsaLevel)isa);
+             if (!k.compress) continue;
+             // Odd offsets and lengths exercise unaligned heads and short tails
+             for (size_t skip = 0; skip < 3; skip++) {
+                 size_t ref = 0;
+                 for (size_t i = skip; i < n - skip; i++) ref += pattern[i];
+                 size_t count = k.compress(src + skip * size, pattern + skip, got, n - 2 * skip);
+                 size_t first = 0;
+                 for (size_t i = 0; i < skip; i++) first += pattern[i];
+                 kernels_ok = kernels_ok && count == ref &&
+                              memcmp(got, want + first * size, count * size) == 0;
+             }
+         }
+         free(got);
+         free(want);
+         free(src);
+     }
+     ASSERT(kernels_ok, "Every compaction variant matches the scalar reference");
+     
+     // Large selection through the blocked, threaded path
+     Array* big = array_arange(0, (double)n, 1, DOUBLE, false);
+     Array* big_mask = array_empty(n, BOOL, false);
+     memcpy(big_mask->parray, pattern, n);
+     parallel_set_thread_count(4);
+     Array* big_picked = array_select(big, big_mask);
+     parallel_set_thread_count(0);
+     bool big_ok = big_picked != NULL;
+     for (size_t i = 0, k = 0; big_ok && i < n; i++) {
+         if (pattern[i]) big_ok = ((double*)big_picked->parray)[k++] == (double)i;
+     }
+     ASSERT(big_ok && big_picked->count == array_count_true(big_mask), "Blocked selection matches");
+     
+     // Views: selection follows row-major order of the view
+     Array* grid = array_arange(0, 6, 1, INT, false);
+     array_set_shape(grid, (size_t[]){2, 3}, 2);
+     Array* gt = array_transpose(grid);            // [[0,3],[1,4],[2,5]]
+     int two = 2;
+     Array* small = array_compare_value(CMP_LE, gt, &two);
+     Array* from_view = array_select(gt, small);
+     ASSERT(from_view && from_view->count == 3 && ((int*)from_view->parray)[0] == 0 &&
+            ((int*)from_view->parray)[1] == 1 && ((int*)from_view->parray)[2] == 2, "Select from a transposed view");
+     
+     // Broadcast comparison between arrays, then AND of masks
+     Array* row = array_arange(0, 3, 1, INT, false);
+     Array* eq = array_compare(CMP_EQ, grid, row);
+     Array* both = eq ? array_mul(eq, eq) : NULL;
+     ASSERT(both && array_count_true(both) == 3, "Broadcast compare and mask AND");
+     
+     const char* names[] = { "ant", "bee", "cat", "dog" };
+     Array* words = array_from_strings(names, 4, false);
+     Array* keep = array_empty(4, BOOL, false);
+     memcpy(keep->parray, (bool[]){ false, true, false, true }, 4 * sizeof(bool));
+     Array* kept = array_select(words, keep);
+     ASSERT(kept && kept->count == 2 && strcmp(array_string_get(kept, 1), "dog") == 0, "Select strings");
+     
+     ASSERT(!array_select(values, small), "Mask shape must match");
+     
+     array_free(kept);
+     array_free(keep);
+     array_free(words);
+     array_free(both);
+     array_free(eq);
+     array_free(row);
+     array_free(from_view);
+     array_free(small);
+     array_free(gt);
+     array_free(grid);
+     array_free(big_picked);
+     array_free(big_mask);
+     array_free(big);
+     free(pattern);
+     array_free(picked);
+     array_free(above);
+     array_free(values);
+ }
+ 
+ /**
+  * take and put with INT index arrays
+  */
+ void test_take_put(void) {
+     printf("\n--- Testing take and put ---\n");
+     
+     Array* values = array_arange(0, 10, 1, INT, false);
+     Array* idx = array_empty(4, INT, false);
+     memcpy(idx->parray, (int[]){ 3, -1, 0, 3 }, 4 * sizeof(int));
+     array_set_shape(idx, (size_t[]){2, 2}, 2);
+     Array* taken = array_take(values, idx);
+     ASSERT(taken && taken->num_dimensions == 2 && taken->shape[0] == 2 &&
+            ((int*)taken->parray)[0] == 3 && ((int*)taken->parray)[1] == 9 &&
+            ((int*)taken->parray)[3] == 3, "Take with negative indices keeps the index shape");
+     
+     // Every gather and scatter variant against a scalar reference
+     size_t src_n = 5003, n = 20011;
+     int* random = (int*)malloc(n * sizeof(int));
+     for (size_t i = 0; i < n; i++) random[i] = (int)((i * 2654435761u >> 5) % src_n);
+     Type types[] = { INT, FLOAT, DOUBLE, CHAR };
+     bool kernels_ok = true;
+     for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+         size_t size = array_sizeof_type(types[t]);
+         unsigned char* src = (unsigned char*)malloc(src_n * size);
+         unsigned char* want = (unsigned char*)malloc(n * size);
+         unsigned char* got = (unsigned char*)malloc(n * size);
+         unsigned char* want_put = (unsigned char*)malloc(src_n * size);
+         unsigned char* got_put = (unsigned char*)malloc(src_n * size);
+         for (size_t i = 0; i < src_n * size; i++) src[i] = (unsigned char)(i * 31 + 7);
+         for (size_t i = 0; i < n; i++) memcpy(want + i * size, src + (size_t)random[i] * size, size);
+         // Repeated indices: the last write wins
+         memset(want_put, 0, src_n * size);
+         for (size_t i = 0; i < n; i++) memcpy(want_put + (size_t)random[i] * size, want + i * size, size);
+         for (int isa = ISA_SCALAR; isa <= (int)get_runtime_isa_level(); isa++) {
+             Kernel take = get_kernel_variant(KERNEL_TAKE, types[t], (IsaLevel)isa);
+             Kernel put = get_kernel_variant(KERNEL_PUT, types[t], (IsaLevel)isa);
+             for (size_t prefetch = 0; prefetch <= 16; prefetch += 16) {
+                 if (take.take) {
+                     take.take(src, random, got, n, prefetch);
+                     kernels_ok = kernels_ok && memcmp(got, want, n * size) == 0;
+                 }
+                 if (put.put) {
+                     memset(got_put, 0, src_n * size);
+                     put.put(got_put, random, want, n, prefetch);
+                     kernels_ok = kernels_ok && memcmp(got_put, want_put, src_n * size) == 0;
+                 }
+             }
+         }
+         free(got_put);
+         free(want_put);
+         free(got);
+         free(want);
+         free(src);
+     }
+     ASSERT(kernels_ok, "Every gather and scatter variant matches the scalar reference");
+     
+     // Random gather from an array larger than L2, on several threads
+     size_t big_n = (size_t)1 << 20;
+     Array* big = array_arange(0, (double)big_n, 1, DOUBLE, false);
+     Array* lookup = array_empty(n, INT, false);
+     for (size_t i = 0; i < n; i++) ((int*)lookup->parray)[i] = (int)((i * 2654435761u) % big_n);
+     parallel_set_thread_count(4);
+     Array* gathered = array_take(big, lookup);
+     parallel_set_thread_count(0);
+     bool big_ok = gathered && gathered->count == n;
+     for (size_t i = 0; big_ok && i < n; i++) {
+         big_ok = ((double*)gathered->parray)[i] == (double)((int*)lookup->parray)[i];
+     }
+     ASSERT(big_ok, "Threaded gather from a large array");
+     
+     // Along an axis, from an array and from a transposed view
+     Array* grid = array_arange(0, 12, 1, INT, false);
+     array_set_shape(grid, (size_t[]){3, 4}, 2);     // [[0..3],[4..7],[8..11]]
+     Array* pick = array_empty(2, INT, false);
+     memcpy(pick->parray, (int[]){ 2, 0 }, 2 * sizeof(int));
+     Array* rows = array_take_axis(grid, pick, 0);
+     Array* cols = array_take_axis(grid, pick, 1);
+     ASSERT(rows && rows->shape[0] == 2 && rows->shape[1] == 4 && ((int*)rows->parray)[0] == 8 &&
+            ((int*)rows->parray)[4] == 0, "Take rows");
+     ASSERT(cols && cols->shape[0] == 3 && cols->shape[1] == 2 && ((int*)cols->parray)[0] == 2 &&
+            ((int*)cols->parray)[1] == 0 && ((int*)cols->parray)[5] == 8, "Take columns");
+     Array* gt = array_transpose(grid);
+     Array* from_view = array_take_axis(gt, pick, 0);  // columns 2 and 0 of grid
+     ASSERT(from_view && ((int*)from_view->parray)[0] == 2 && ((int*)from_view->parray)[3] == 0 &&
+            ((int*)from_view->parray)[4] == 4, "Take along an axis of a view");
+     
+     // Put: flat, broadcast value, copy-on-write and strided targets
+     Array* shared = array_copy(values, false);
+     Array* put_idx = array_empty(3, INT, false);
+     memcpy(put_idx->parray, (int[]){ 1, -2, 1 }, 3 * sizeof(int));
+     Array* put_vals = array_empty(3, INT, false);
+     memcpy(put_vals->parray, (int[]){ 100, 200, 300 }, 3 * sizeof(int));
+     ASSERT(array_put(values, put_idx, put_vals) && ((int*)values->parray)[1] == 300 &&
+            ((int*)values->parray)[8] == 200, "Put in index order");
+     ASSERT(((int*)shared->parray)[1] == 1, "Put leaves a shared copy untouched");
+     int minus = -1;
+     Array* one = array_full(1, INT, &minus, false);
+     // Flat index 2 of the transpose is grid[2][0]
+     ASSERT(array_put(gt, pick, one) && ((int*)grid->parray)[8] == -1 && ((int*)grid->parray)[0] == -1 &&
+            ((int*)grid->parray)[2] == 2, "Put one value through a transposed view");
+     
+     Array* row_vals = array_zeros(8, INT, false);
+     array_set_shape(row_vals, (size_t[]){2, 4}, 2);
+     ASSERT(array_put_axis(grid, pick, row_vals, 0) && ((int*)grid->parray)[0] == 0 &&
+            ((int*)grid->parray)[11] == 0 && ((int*)grid->parray)[5] == 5, "Put rows");
+     
+     const char* names[] = { "ant", "bee", "cat" };
+     Array* words = array_from_strings(names, 3, false);
+     Array* word_picked = array_take(words, pick);
+     ASSERT(word_picked && strcmp(array_string_get(word_picked, 0), "cat") == 0 &&
+            strcmp(array_string_get(word_picked, 1), "ant") == 0, "Take strings");
+     
+     Array* bad = array_empty(1, INT, false);
+     ((int*)bad->parray)[0] = 10;
+     ASSERT(!array_take(values, bad), "Out-of-bounds index is rejected");
+     ASSERT(!array_put_axis(grid, pick, put_vals, 0), "Put values must match the resized shape");
+     Array* real_idx = array_ones(1, DOUBLE, false);
+     ASSERT(!array_take(values, real_idx), "Indices must be INT");
+     
+     array_free(real_idx);
+     array_free(bad);
+     array_free(word_picked);
+     array_free(words);
+     array_free(row_vals);
+     array_free(one);
+     array_free(put_vals);
+     array_free(put_idx);
+     array_free(shared);
+     array_free(from_view);
+     array_free(gt);
+     array_free(cols);
+     array_free(rows);
+     array_free(pick);
+     array_free(grid);
+     array_free(gathered);
+     array_free(lookup);
+     array_free(big);
+     free(random);
+     array_free(taken);
+     array_free(idx);
+     array_free(values);
+ }
+ 
+ /**
+  * Whether dense holds the elements of view in row-major order
+  */
+ static bool matches_view(const Array* view, const char* dense) {
+     size_t index[ARRAY_MAX_DIMS] = {0};
+     size_t size = view->sizeof_type;
+     for (size_t i = 0; i < view->count; i++) {
+         if (memcmp(array_get_ptr(view, index), dense + i * size, size) != 0) return false;
+         for (size_t d = view->num_dimensions; d-- > 0;) {
+             if (++index[d] < view->shape[d]) break;
+             index[d] = 0;
+         }
+     }
+     return true;
+ }
+ 
+ /**
+  * Cache-blocked transpose and axis permutation
+  */
+ void test_tiled_transpose(void) {
+     printf("\n--- Testing tiled transpose ---\n");
+     
+     // Every element size, with edges that are not a multiple of any tile
+     Type types[] = { INT, FLOAT, DOUBLE, CHAR };
+     bool copies_ok = true;
+     for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+         Array* m = array_arange(0, 67 * 131, 1, types[t], false);
+         array_set_shape(m, (size_t[]){67, 131}, 2);
+         Array* view = array_transpose(m);
+         Array* copy = array_transpose_copy(m);
+         copies_ok = copies_ok && copy && array_is_contiguous(copy) && copy->shape[0] == 131 &&
+                     matches_view(view, (const char*)copy->parray);
+         array_free(copy);
+         array_free(view);
+         array_free(m);
+     }
+     ASSERT(copies_ok, "Transposed copies match for every element size");
+     
+     // Every kernel variant against a scalar reference, on blocks with ragged edges
+     size_t rows = 45, cols = 37, ld = 50;
+     bool kernels_ok = true;
+     for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+         size_t size = array_sizeof_type(types[t]);
+         unsigned char* src = (unsigned char*)malloc(rows * ld * size);
+         unsigned char* want = (unsigned char*)calloc(cols * ld, size);
+         unsigned char* got = (unsigned char*)calloc(cols * ld, size);
+         for (size_t i = 0; i < rows * ld * size; i++) src[i] = (unsigned char)(i * 31 + 7);
+         for (size_t r = 0; r < rows; r++) {
+             for (size_t c = 0; c < cols; c++) memcpy(want + (c * ld + r) * size, src + (r * ld + c) * size, size);
+         }
+         for (int isa = ISA_SCALAR; isa <= (int)get_runtime_isa_level(); isa++) {
+             Kernel k = get_kernel_variant(KERNEL_TRANSPOSE, types[t], (IsaLevel)isa);
+             if (!k.transpose) continue;
+             memset(got, 0, cols * ld * size);
+             k.transpose(src, (ptrdiff_t)ld, got, (ptrdiff_t)ld, rows, cols);
+             kernels_ok = kernels_ok && memcmp(got, want, cols * ld * size) == 0;
+         }
+         free(got);
+         free(want);
+         free(src);
+     }
+     ASSERT(kernels_ok, "Every transpose variant matches the scalar reference");
+     
+     // N-D permutation, large enough to split tiles across threads
+     Array* cube = array_arange(0, 6 * 300 * 170, 1, DOUBLE, false);
+     array_set_shape(cube, (size_t[]){6, 300, 170}, 3);
+     size_t axes[] = { 2, 0, 1 };
+     Array* permuted = array_permute(cube, axes);
+     parallel_set_thread_count(4);
+     Array* permuted_copy = array_permute_copy(cube, axes);
+     parallel_set_thread_count(0);
+     ASSERT(permuted && permuted->shape[0] == 170 && permuted->shape[1] == 6 && permuted->shape[2] == 300,
+            "Permute reorders the shape");
+     ASSERT(permuted_copy && matches_view(permuted, (const char*)permuted_copy->parray),
+            "Threaded permuted copy matches");
+     
+     // Scatter back through a transposed view
+     Array* target = array_zeros(300 * 170, DOUBLE, false);
+     array_set_shape(target, (size_t[]){300, 170}, 2);
+     Array* target_t = array_transpose(target);
+     Array* cube_t = array_transpose_copy(cube);      // (170, 300, 6)
+     Array* column = array_empty(170 * 300, DOUBLE, false);
+     for (size_t i = 0; i < 170 * 300; i++) ((double*)column->parray)[i] = ((double*)cube_t->parray)[i * 6];
+     array_scatter(target_t, column->parray);
+     ASSERT(memcmp(target->parray, cube->parray, 300 * 170 * sizeof(double)) == 0,
+            "Scatter through a transposed view");
+     
+     ASSERT(!array_permute(cube, (size_t[]){ 0, 0, 1 }), "Axes must be a permutation");
+     
+     array_free(column);
+     array_free(cube_t);
+     array_free(target_t);
+     array_free(target);
+     array_free(permuted_copy);
+     array_free(permuted);
+     array_free(cube);
+ }
+ 
+ /**
+  * Largest difference between a matrix product and a naive double-precision reference
+  */
+ static double matmul_error(const Array* a, const Array* b, const Array* c) {
+     size_t m = a->shape[0], k = a->shape[1], n = b->shape[1];
+     double worst = 0;
+     for (size_t i = 0; i < m; i++) {
+         for (size_t j = 0; j < n; j++) {
+             double want = 0;
+             for (size_t p = 0; p < k; p++) {
+                 const void* x = array_get_ptr(a, (size_t[]){ i, p });
+                 const void* y = array_get_ptr(b, (size_t[]){ p, j });
+                 want += a->type == FLOAT ? (double)*(const float*)x * *(const float*)y
+                                          : *(const double*)x * *(const double*)y;
+             }
+             double got = c->type == FLOAT ? ((float*)c->parray)[i * n + j] : ((double*)c->parray)[i * n + j];
+             if (fabs(got - want) > worst) worst = fabs(got - want);
+         }
+     }
+     return worst;
+ }
+ 
+ /**
+  * Matrix with a deterministic pattern of small values
+  */
+ static Array* pattern_matrix(size_t rows, size_t cols, Type type, unsigned seed) {
+     Array* m = array_empty(rows * cols, type, false);
+     for (size_t i = 0; i < rows * cols; i++) {
+         double v = (double)((i * 2654435761u + seed) % 17) / 8.0 - 1.0;
+         if (type == FLOAT) ((float*)m->parray)[i] = (float)v;
+         else ((double*)m->parray)[i] = v;
+     }
+     array_set_shape(m, (size_t[]){ rows, cols }, 2);
+     return m;
+ }
+ 
+ /**
+  * Packed, cache-blocked matrix multiply
+  */
+ void test_matmul(void) {
+     printf("\n--- Testing matrix multiply ---\n");
+     
+     Array* a = array_arange(1, 7, 1, DOUBLE, false);      // [[1,2,3],[4,5,6]]
+     array_set_shape(a, (size_t[]){2, 3}, 2);
+     Array* at = array_transpose(a);
+     Array* small = array_matmul(a, at);                    // [[14,32],[32,77]]
+     ASSERT(small && small->shape[0] == 2 && small->shape[1] == 2 && ((double*)small->parray)[0] == 14 &&
+            ((double*)small->parray)[1] == 32 && ((double*)small->parray)[3] == 77, "Small product with a transposed view");
+     
+     // Every micro-kernel against a reference on packed slivers
+     bool kernels_ok = true;
+     Type types[] = { FLOAT, DOUBLE };
+     for (size_t t = 0; t < 2; t++) {
+         for (int isa = ISA_SCALAR; isa <= (int)get_runtime_isa_level(); isa++) {
+             const GemmKernel* g = get_kernel_variant(KERNEL_GEMM, types[t], (IsaLevel)isa).gemm;
+             if (!g) continue;
+             size_t k = 37, ldc = g->nr + 3;
+             Array* pa = pattern_matrix(k, g->mr, types[t], 1);
+             Array* pb = pattern_matrix(k, g->nr, types[t], 2);
+             Array* c = array_ones(g->mr * ldc, types[t], false);
+             g->fn(k, pa->parray, pb->parray, c->parray, (ptrdiff_t)ldc, true);
+             for (size_t i = 0; i < g->mr; i++) {
+                 for (size_t j = 0; j < ldc; j++) {
+                     double want = 1;
+                     for (size_t p = 0; j < g->nr && p < k; p++) {
+                         want += types[t] == FLOAT
+                             ? (double)((float*)pa->parray)[p * g->mr + i] * ((float*)pb->parray)[p * g->nr + j]
+                             : ((double*)pa->parray)[p * g->mr + i] * ((double*)pb->parray)[p * g->nr + j];
+                     }
+                     double got = types[t] == FLOAT ? ((float*)c->parray)[i * ldc + j] : ((double*)c->parray)[i * ldc + j];
+                     kernels_ok = kernels_ok && fabs(got - want) < 1e-4;
+                 }
+             }
+             array_free(c);
+             array_free(pb);
+             array_free(pa);
+         }
+     }
+     ASSERT(kernels_ok, "Every GEMM micro-kernel matches the reference");
+     
+     // Ragged edges in every dimension, for both types and a transposed operand
+     bool edges_ok = true;
+     for (size_t t = 0; t < 2; t++) {
+         Array* x = pattern_matrix(67, 93, types[t], 3);
+         Array* y_t = pattern_matrix(51, 93, types[t], 4);
+         Array* y = array_transpose(y_t);
+         Array* z = array_matmul(x, y);
+         edges_ok = edges_ok && z && z->shape[0] == 67 && z->shape[1] == 51 &&
+                    matmul_error(x, y, z) < (types[t] == FLOAT ? 1e-3 : 1e-9);
+         array_free(z);
+         array_free(y);
+         array_free(y_t);
+         array_free(x);
+     }
+     ASSERT(edges_ok, "Products with ragged edges match the reference");
+     
+     // Several K blocks and threads
+     Array* big_a = pattern_matrix(211, 1300, DOUBLE, 5);
+     Array* big_b = pattern_matrix(1300, 97, DOUBLE, 6);
+     parallel_set_thread_count(4);
+     Array* big_c = array_matmul(big_a, big_b);
+     parallel_set_thread_count(0);
+     ASSERT(big_c && matmul_error(big_a, big_b, big_c) < 1e-9, "Threaded product over several K blocks");
+     
+     // Into one of the operands: square products, then into b through a transposed view
+     Array* sq = pattern_matrix(300, 300, DOUBLE, 7);
+     Array* sq_other = pattern_matrix(300, 300, DOUBLE, 8);
+     Array* sq_want = array_matmul(sq, sq);
+     bool into_ok = sq_want && array_matmul_into(sq, sq, sq) &&
+                    memcmp(sq->parray, sq_want->parray, 300 * 300 * sizeof(double)) == 0;
+     Array* sq_view = array_transpose(sq);
+     Array* sq_want_b = array_matmul(sq_other, sq_view);
+     into_ok = into_ok && sq_want_b && array_matmul_into(sq_other, sq_view, sq) &&
+               memcmp(sq->parray, sq_want_b->parray, 300 * 300 * sizeof(double)) == 0;
+     ASSERT(into_ok, "Product into an operand's own buffer");
+     
+     Array* ints = array_ones(4, INT, false);
+     array_set_shape(ints, (size_t[]){2, 2}, 2);
+     ASSERT(!array_matmul(a, a), "Inner dimensions must match");
+     ASSERT(!array_matmul(ints, ints), "Integer matrices are rejected");
+     
+     array_free(ints);
+     array_free(sq_want_b);
+     array_free(sq_view);
+     array_free(sq_want);
+     array_free(sq_other);
+     array_free(sq);
+     array_free(big_c);
+     array_free(big_b);
+     array_free(big_a);
+     array_free(small);
+     array_free(at);
+     array_free(a);
+ }
+ 
+ static int compare_ints(const void* x, const void* y) {
+     int a = *(const int*)x, b = *(const int*)y;
+     return (a > b) - (a < b);
+ }
+ 
+ static int compare_doubles(const void* x, const void* y) {
+     double a = *(const double*)x, b = *(const double*)y;
+     return (a > b) - (a < b);
+ }
+ 
+ /**
+  * Radix, merge and network sorts
+  */
+ void test_sort(void) {
+     printf("\n--- Testing sort ---\n");
+     
+     // Large INT column: radix passes on several threads
+     size_t n = 300007;
+     Array* ints = array_empty(n, INT, false);
+     int* want = (int*)malloc(n * sizeof(int));
+     for (size_t i = 0; i < n; i++) {
+         want[i] = ((int*)ints->parray)[i] = (int)(i * 2654435761u) - (int)(i % 7) * 1000;
+     }
+     qsort(want, n, sizeof(int), compare_ints);
+     parallel_set_thread_count(4);
+     bool sorted = array_sort(ints);
+     parallel_set_thread_count(0);
+     ASSERT(sorted && memcmp(ints->parray, want, n * sizeof(int)) == 0, "Radix sort of a large INT array");
+     
+     // Every length around the network block and merge sizes, DOUBLE
+     bool small_ok = true;
+     for (size_t len = 0; len <= 70 && small_ok; len++) {
+         Array* d = array_empty(len, DOUBLE, false);
+         double* ref = (double*)malloc((len + 1) * sizeof(double));
+         for (size_t i = 0; i < len; i++) ref[i] = ((double*)d->parray)[i] = (double)((i * 37 + len) % 23) - 11.5;
+         qsort(ref, len, sizeof(double), compare_doubles);
+         small_ok = array_sort(d) && memcmp(d->parray, ref, len * sizeof(double)) == 0;
+         free(ref);
+         array_free(d);
+     }
+     ASSERT(small_ok, "Merge sort of short DOUBLE arrays");
+     
+     // Every network variant against insertion order on random blocks
+     bool networks_ok = true;
+     Type key_types[] = { INT, DOUBLE, CHAR };
+     for (size_t t = 0; t < 3; t++) {
+         size_t width = array_sizeof_type(key_types[t]);
+         for (int isa = ISA_SCALAR; isa <= (int)get_runtime_isa_level(); isa++) {
+             Kernel k = get_kernel_variant(KERNEL_SORT_BLOCK, key_types[t], (IsaLevel)isa);
+             if (!k.sort) continue;
+             for (size_t len = 0; len <= SORT_BLOCK_KEYS; len++) {
+                 uint64_t keys[SORT_BLOCK_KEYS + 1];
+                 unsigned char* bytes = (unsigned char*)keys;
+                 for (size_t i = 0; i < sizeof(keys); i++) bytes[i] = (unsigned char)((i * 131 + len * 7) >> 1);
+                 uint64_t sentinel = keys[SORT_BLOCK_KEYS];
+                 k.sort(keys, len);
+                 for (size_t i = 1; i < len; i++) {
+                     uint64_t prev = 0, cur = 0;
+                     memcpy(&prev, bytes + (i - 1) * width, width);
+                     memcpy(&cur, bytes + i * width, width);
+                     networks_ok = networks_ok && prev <= cur;
+                 }
+                 networks_ok = networks_ok && keys[SORT_BLOCK_KEYS] == sentinel;
+             }
+         }
+     }
+     ASSERT(networks_ok, "Every sorting network variant orders its block");
+     
+     // Floats: signed zeros, infinities and NaNs (last)
+     float specials[] = { 3.5f, -0.0f, NAN, -INFINITY, 0.0f, -2.0f, INFINITY, 1e-30f, -NAN };
+     size_t fcount = sizeof(specials) / sizeof(specials[0]);
+     Array* floats = array_empty(fcount, FLOAT, false);
+     memcpy(floats->parray, specials, sizeof(specials));
+     ASSERT(array_sort(floats), "Sort FLOAT specials");
+     float* f = (float*)floats->parray;
+     ASSERT(f[0] == -INFINITY && f[1] == -2.0f && signbit(f[2]) && f[3] == 0.0f && !signbit(f[3]) &&
+            f[4] == 1e-30f && f[6] == INFINITY && isnan(f[7]) && isnan(f[8]), "Float order with NaNs last");
+     
+     Array* chars = array_empty(5, CHAR, false);
+     memcpy(chars->parray, (char[]){ 'd', -5, 'a', 0, 'z' }, 5);
+     ASSERT(array_sort(chars) && memcmp(chars->parray, (char[]){ -5, 0, 'a', 'd', 'z' }, 5) == 0,
+            "Sort CHAR with the platform's signedness");
+     
+     // Rows sort independently; a transposed view sorts the base's columns
+     Array* grid = array_empty(6, INT, false);
+     memcpy(grid->parray, (int[]){ 3, 1, 2, 0, 5, -4 }, 6 * sizeof(int));
+     array_set_shape(grid, (size_t[]){2, 3}, 2);
+     ASSERT(array_sort(grid) && memcmp(grid->parray, (int[]){ 1, 2, 3, -4, 0, 5 }, 6 * sizeof(int)) == 0,
+            "Sort each row");
+     Array* columns = array_transpose(grid);
+     ASSERT(array_sort(columns) && memcmp(grid->parray, (int[]){ -4, 0, 3, 1, 2, 5 }, 6 * sizeof(int)) == 0,
+            "Sort the columns through a transposed view");
+     
+     const char* names[] = { "b", "a" };
+     Array* words = array_from_strings(names, 2, false);
+     ASSERT(!array_sort(words), "STRING arrays are rejected");
+     
+     array_free(words);
+     array_free(columns);
+     array_free(grid);
+     array_free(chars);
+     array_free(floats);
+     free(want);
+     array_free(ints);
+ }
+ 
+ 
+ /**
+  * Sorted order check for argsort: a permutation, ascending, ties by index
+  */
+ static bool argsort_matches(const int* values, const int* order, size_t n) {
+     bool* seen = (bool*)calloc(n + 1, sizeof(bool));
+     bool ok = true;
+     for (size_t i = 0; i < n && ok; i++) {
+         ok = order[i] >= 0 && (size_t)order[i] < n && !seen[order[i]];
+         if (ok) seen[order[i]] = true;
+         if (ok && i > 0) {
+             int a = values[order[i - 1]], b = values[order[i]];
+             ok = a < b || (a == b && order[i - 1] < order[i]);
+         }
+     }
+     free(seen);
+     return ok;
+ }
+ 
+ typedef struct {
+     double value;
+     int index;
+ } Ranked;
+ 
+ static int compare_ranked_descending(const void* x, const void* y) {
+     const Ranked* a = (const Ranked*)x;
+     const Ranked* b = (const Ranked*)y;
+     if (a->value != b->value) return a->value < b->value ? 1 : -1;
+     return a->index - b->index;
+ }
+ 
+ /**
+  * Argsort, partition and top-k selection
+  */
+ void test_selection(void) {
+     printf("\n--- Testing selection ---\n");
+     
+     // Argsort, both ways, long rows (radix) and short ones (merge), with ties
+     bool argsort_ok = true;
+     size_t lengths[] = { 0, 1, 17, 1000, 100003 };
+     parallel_set_thread_count(4);
+     for (size_t l = 0; l < 5; l++) {
+         size_t n = lengths[l];
+         Array* a = array_empty(n, INT, false);
+         int* v = (int*)array_data(a);
+         for (size_t i = 0; i < n; i++) v[i] = (int)((i * 2654435761u) % 1000) - 500;
+         for (int stable = 0; stable <= 1; stable++) {
+             Array* order = array_argsort(a, stable);
+             argsort_ok = argsort_ok && order && order->count == n &&
+                          argsort_matches(v, (const int*)array_data(order), n);
+             array_free(order);
+         }
+         array_free(a);
+     }
+     parallel_set_thread_count(0);
+     ASSERT(argsort_ok, "Argsort (stable and introsort) orders rows with ties by index");
+     
+     Array* grid = array_empty(6, DOUBLE, false);
+     memcpy(grid->parray, (double[]){ 2.5, -1.0, 0.5, 7.0, 7.0, -3.0 }, 6 * sizeof(double));
+     array_set_shape(grid, (size_t[]){2, 3}, 2);
+     Array* grid_order = array_argsort(grid, true);
+     ASSERT(grid_order && grid_order->num_dimensions == 2 &&
+            memcmp(grid_order->parray, (int[]){ 1, 2, 0, 2, 0, 1 }, 6 * sizeof(int)) == 0,
+            "Argsort each row of a 2-D array");
+     
+     // Partition: every kth of short rows, and adversarial long ones
+     bool partition_ok = true;
+     for (size_t len = 1; len <= 40 && partition_ok; len++) {
+         for (size_t kth = 0; kth < len && partition_ok; kth++) {
+             Array* a = array_empty(len, INT, false);
+             int* v = (int*)array_data(a);
+             int ref[40];
+             for (size_t i = 0; i < len; i++) ref[i] = v[i] = (int)((i * 37 + len) % 11) - 5;
+             qsort(ref, len, sizeof(int), compare_ints);
+             partition_ok = array_partition(a, kth) && v[kth] == ref[kth];
+             for (size_t i = 0; i < len && partition_ok; i++) {
+                 partition_ok = i < kth ? v[i] <= v[kth] : v[i] >= v[kth];
+             }
+             array_free(a);
+         }
+     }
+     ASSERT(partition_ok, "Partition puts every kth in place");
+     
+     size_t big = 200000;
+     bool patterns_ok = true;
+     for (int pattern = 0; pattern < 3; pattern++) {
+         Array* a = array_empty(big, DOUBLE, false);
+         double* v = (double*)array_data(a);
+         for (size_t i = 0; i < big; i++) {
+             // Ascending, all equal, and organ pipe
+             v[i] = pattern == 0 ? (double)i : pattern == 1 ? 1.0 : (double)(i < big / 2 ? i : big - i);
+         }
+         size_t kth = big / 3;
+         double* ref = (double*)malloc(big * sizeof(double));
+         memcpy(ref, v, big * sizeof(double));
+         qsort(ref, big, sizeof(double), compare_doubles);
+         patterns_ok = patterns_ok && array_partition(a, kth) && v[kth] == ref[kth];
+         for (size_t i = 0; i < big && patterns_ok; i++) {
+             patterns_ok = i < kth ? v[i] <= v[kth] : v[i] >= v[kth];
+         }
+         free(ref);
+         array_free(a);
+     }
+     ASSERT(patterns_ok, "Partition of sorted, constant and organ-pipe data");
+     
+     // Top-k against a full sort: heaps (small k), sampling (large k), everything
+     size_t n = 300007;
+     Array* scores = array_empty(n, FLOAT, false);
+     float* sv = (float*)array_data(scores);
+     Ranked* ranked = (Ranked*)malloc(n * sizeof(Ranked));
+     for (size_t i = 0; i < n; i++) {
+         sv[i] = (float)((i * 2654435761u) % 100003) / 7.0f - 5000.0f;
+         ranked[i].value = sv[i];
+         ranked[i].index = (int)i;
+     }
+     qsort(ranked, n, sizeof(Ranked), compare_ranked_descending);
+     bool topk_ok = true;
+     size_t ks[] = { 1, 100, 1024, 5000, n / 2, n };
+     parallel_set_thread_count(4);
+     for (size_t t = 0; t < 6; t++) {
+         Array* top = array_topk(scores, ks[t], true);
+         Array* bottom = array_topk(scores, ks[t], false);
+         topk_ok = topk_ok && top && bottom && top->count == ks[t];
+         for (size_t i = 0; topk_ok && i < ks[t]; i++) {
+             // The smallest come in ascending order, ties still by index
+             topk_ok = ((int*)top->parray)[i] == ranked[i].index &&
+                       sv[((int*)bottom->parray)[i]] == (float)ranked[n - 1 - i].value;
+         }
+         array_free(top);
+         array_free(bottom);
+     }
+     parallel_set_thread_count(0);
+     ASSERT(topk_ok, "Top-k largest and smallest match a full sort");
+     
+     Array* none = array_topk(scores, 0, true);
+     ASSERT(none && none->count == 0, "Top-0 is empty");
+     ASSERT(!array_topk(scores, n + 1, true), "k beyond the element count is rejected");
+     
+     // Every key filter variant against the scalar one, NaNs counted largest
+     bool filters_ok = true;
+     double keyed[67];
+     for (size_t i = 0; i < 67; i++) keyed[i] = i % 13 == 0 ? NAN : (double)((i * 29) % 31) - 15.0;
+     float keyed_f[67];
+     int keyed_i[67];
+     for (size_t i = 0; i < 67; i++) {
+         keyed_f[i] = (float)keyed[i];
+         keyed_i[i] = isnan(keyed[i]) ? 1000 : (int)keyed[i];
+     }
+     Type filter_types[] = { INT, FLOAT, DOUBLE };
+     const void* filter_data[] = { keyed_i, keyed_f, keyed };
+     uint64_t thresholds[] = { 0x80000000u, 0xC0E00000u, 0xC02E000000000000ull };
+     for (size_t t = 0; t < 3; t++) {
+         KeyFilterKernelFn scalar = get_kernel_variant(KERNEL_KEY_FILTER, filter_types[t], ISA_SCALAR).key_filter;
+         for (int isa = ISA_SCALAR; isa <= (int)get_runtime_isa_level(); isa++) {
+             KeyFilterKernelFn fn = get_kernel_variant(KERNEL_KEY_FILTER, filter_types[t], (IsaLevel)isa).key_filter;
+             if (!fn) continue;
+             for (int above = 0; above <= 1; above++) {
+                 uint32_t want_pos[67], got_pos[67];
+                 size_t want_count = scalar(filter_data[t], 67, thresholds[t], above, want_pos);
+                 size_t got_count = fn(filter_data[t], 67, thresholds[t], above, got_pos);
+                 filters_ok = filters_ok && want_count == got_count && want_count > 0 &&
+                              memcmp(want_pos, got_pos, got_count * sizeof(uint32_t)) == 0;
+             }
+         }
+     }
+     ASSERT(filters_ok, "Every key filter variant agrees with the scalar one");
+     
+     free(ranked);
+     array_free(none);
+     array_free(scores);
+     array_free(grid_order);
+     array_free(grid);
+ }
+ 
+ /**
+  * Prefix scans: kernels, long blocked rows and other axes
+  */
+ void test_scan(void) {
+     printf("\n--- Testing scans ---\n");
+     
+     // Every scan variant against the scalar one, inclusive and exclusive
+     bool kernels_ok = true;
+     KernelOp scan_ops[] = { KERNEL_CUMSUM, KERNEL_CUMPROD, KERNEL_CUMMIN, KERNEL_CUMMAX };
+     Type scan_types[] = { INT, FLOAT, DOUBLE };
+     for (size_t t = 0; t < 3; t++) {
+         size_t width = array_sizeof_type(scan_types[t]);
+         for (size_t o = 0; o < 4; o++) {
+             ScanKernelFn scalar = get_kernel_variant(scan_ops[o], scan_types[t], ISA_SCALAR).scan;
+             for (int isa = ISA_SCALAR + 1; isa <= (int)get_runtime_isa_level(); isa++) {
+                 ScanKernelFn fn = get_kernel_variant(scan_ops[o], scan_types[t], (IsaLevel)isa).scan;
+                 if (!fn || fn == scalar) continue;
+                 for (size_t len = 0; len <= 41; len++) {
+                     // Small integers (and +-1 for products) keep float results exact
+                     double src[41], want[41], got[41];
+                     for (size_t i = 0; i < len; i++) {
+                         int v = o == 1 ? ((i * 7) % 5 == 0 ? -1 : 1) : (int)((i * 37 + len) % 19) - 9;
+                         if (scan_types[t] == INT) ((int*)src)[i] = v;
+                         else if (scan_types[t] == FLOAT) ((float*)src)[i] = (float)v;
+                         else src[i] = v;
+                     }
+                     // A NaN for the running minima and maxima to carry along
+                     if (o >= 2 && scan_types[t] != INT && len % 3 == 1) {
+                         if (scan_types[t] == FLOAT) ((float*)src)[len / 2] = NAN;
+                         else src[len / 2] = NAN;
+                     }
+                     for (int exclusive = 0; exclusive <= 1; exclusive++) {
+                         uint64_t carry_want = 0, carry_got = 0;
+                         if (scan_types[t] == INT) *(int*)&carry_want = o == 1 ? -1 : 3;
+                         else if (scan_types[t] == FLOAT) *(float*)&carry_want = o == 1 ? -1.0f : 3.0f;
+                         else *(double*)&carry_want = o == 1 ? -1.0 : 3.0;
+                         carry_got = carry_want;
+                         scalar(src, want, len, &carry_want, exclusive);
+                         fn(src, got, len, &carry_got, exclusive);
+                         kernels_ok = kernels_ok && memcmp(want, got, len * width) == 0 && carry_want == carry_got;
+                     }
+                 }
+             }
+         }
+     }
+     ASSERT(kernels_ok, "Every scan kernel variant matches the scalar one");
+     
+     // Cummin and cummax are NaN from the first NaN on
+     Array* ramp = array_arange(0, 64, 1, FLOAT, false);
+     ((float*)ramp->parray)[10] = NAN;
+     Array* ramp_max = array_cummax(ramp, 0);
+     Array* countdown = array_arange(40, 0, -1, DOUBLE, false);
+     ((double*)countdown->parray)[3] = NAN;
+     Array* countdown_min = array_cummin(countdown, 0);
+     bool nan_ok = ramp_max && countdown_min;
+     for (size_t i = 0; i < 64 && nan_ok; i++) {
+         float v = ((float*)ramp_max->parray)[i];
+         nan_ok = i < 10 ? v == (float)i : isnan(v);
+     }
+     for (size_t i = 0; i < 40 && nan_ok; i++) {
+         double v = ((double*)countdown_min->parray)[i];
+         nan_ok = i < 3 ? v == 40.0 - (double)i : isnan(v);
+     }
+     // Down the columns too: (20, 2) holds the NaN in column 1 of row 1
+     array_set_shape(countdown, (size_t[]){20, 2}, 2);
+     Array* columns_min = array_cummin(countdown, 0);
+     for (size_t i = 0; i < 40 && nan_ok && columns_min; i++) {
+         double v = ((double*)columns_min->parray)[i];
+         nan_ok = i % 2 == 0 ? v == 40.0 - (double)i : i < 3 ? v == 39.0 : isnan(v);
+     }
+     ASSERT(nan_ok && columns_min, "Cummin and cummax propagate NaN");
+     
+     // Long INT row: blocked passes, exclusive sums give offsets
+     size_t n = 300007;
+     Array* lengths = array_empty(n, INT, false);
+     int* lv = (int*)array_data(lengths);
+     for (size_t i = 0; i < n; i++) lv[i] = (int)(i % 13);
+     parallel_set_thread_count(4);
+     Array* offsets = array_scan(SCAN_SUM, lengths, 0, true);
+     Array* running_max = array_cummax(lengths, 0);
+     parallel_set_thread_count(0);
+     bool offsets_ok = offsets && running_max;
+     int expect = 0;
+     for (size_t i = 0; i < n && offsets_ok; i++) {
+         offsets_ok = ((int*)offsets->parray)[i] == expect &&
+                      ((int*)running_max->parray)[i] == (i < 12 ? (int)i : 12);
+         expect += lv[i];
+     }
+     ASSERT(offsets_ok, "Exclusive sum of a long INT row gives offsets");
+     
+     // Float sums: the same bits for any thread count; compensation stays accurate
+     size_t fn_count = 1000003;
+     Array* steps = array_empty(fn_count, FLOAT, false);
+     for (size_t i = 0; i < fn_count; i++) ((float*)steps->parray)[i] = 0.1f;
+     parallel_set_thread_count(1);
+     Array* serial = array_cumsum(steps, 0);
+     parallel_set_thread_count(4);
+     Array* threaded = array_cumsum(steps, 0);
+     Array* compensated = array_scan(SCAN_SUM_COMPENSATED, steps, 0, false);
+     parallel_set_thread_count(0);
+     ASSERT(serial && threaded && memcmp(serial->parray, threaded->parray, fn_count * sizeof(float)) == 0,
+            "Float cumsum does not depend on the thread count");
+     double exact = (double)0.1f * (double)fn_count;
+     float last = ((float*)compensated->parray)[fn_count - 1];
+     float plain = ((float*)serial->parray)[fn_count - 1];
+     ASSERT(fabs(last - exact) <= exact * 1e-7 && fabs(last - exact) <= fabs(plain - exact),
+            "Compensated float cumsum stays within rounding of the exact sum");
+     
+     // Other axes: running rows, a transposed view, exclusive identities
+     Array* grid = array_empty(6, DOUBLE, false);
+     memcpy(grid->parray, (double[]){ 1, 5, -2, 4, 0, 3 }, 6 * sizeof(double));
+     array_set_shape(grid, (size_t[]){2, 3}, 2);
+     Array* down = array_cumsum(grid, 0);
+     ASSERT(down && memcmp(down->parray, (double[]){ 1, 5, -2, 5, 5, 1 }, 6 * sizeof(double)) == 0,
+            "Cumsum down the columns");
+     Array* across = array_scan(SCAN_MAX, grid, 1, true);
+     ASSERT(across && ((double*)across->parray)[0] == -INFINITY &&
+            memcmp((double*)across->parray + 1, (double[]){ 1, 5, -INFINITY, 4, 4 }, 5 * sizeof(double)) == 0,
+            "Exclusive cummax along rows starts from -inf");
+     Array* columns = array_transpose(grid);
+     Array* along_view = array_cumprod(columns, 0);
+     ASSERT(along_view && memcmp(along_view->parray, (double[]){ 1, 4, 5, 0, -10, 0 }, 6 * sizeof(double)) == 0,
+            "Cumprod of a transposed view");
+     Array* down_compensated = array_scan(SCAN_SUM_COMPENSATED, grid, 0, true);
+     ASSERT(down_compensated &&
+            memcmp(down_compensated->parray, (double[]){ 0, 0, 0, 1, 5, -2 }, 6 * sizeof(double)) == 0,
+            "Exclusive compensated sum down the columns");
+     
+     Array* chars = array_empty(3, CHAR, false);
+     ASSERT(!array_cumsum(chars, 0) && !array_cumsum(grid, 2) &&
+            !array_scan((ScanOp)(SCAN_SUM_COMPENSATED + 1), grid, 0, false),
+            "Bad types, axes and ops are rejected");
+     
+     array_free(chars);
+     array_free(columns_min);
+     array_free(countdown_min);
+     array_free(countdown);
+     array_free(ramp_max);
+     array_free(ramp);
+     array_free(down_compensated);
+     array_free(along_view);
+     array_free(columns);
+     array_free(across);
+     array_free(down);
+     array_free(grid);
+     array_free(compensated);
+     array_free(threaded);
+     array_free(serial);
+     array_free(steps);
+     array_free(running_max);
+     array_free(offsets);
+     array_free(lengths);
+ }
+ 
+ /**
+  * Narrow integer and 16-bit float element types
+  */
+ void test_dtypes(void) {
+     printf("\n--- Testing narrow and 16-bit float types ---\n");
+     
+     ASSERT(array_sizeof_type(INT8) == 1 && array_sizeof_type(UINT16) == 2 && array_sizeof_type(FLOAT16) == 2 &&
+            array_sizeof_type(BFLOAT16) == 2 && array_sizeof_type(UINT32) == 4 && array_sizeof_type(INT64) == 8,
+            "Element sizes");
+     
+     // Constructors
+     Array* ones64 = array_ones(1000, INT64, false);
+     Array* ones8 = array_ones(1000, UINT8, false);
+     Array* ones_half = array_ones(1000, FLOAT16, false);
+     Array* ones_bf16 = array_ones(1000, BFLOAT16, false);
+     ASSERT(ones64 && ((int64_t*)ones64->parray)[999] == 1 && ones8 && ((uint8_t*)ones8->parray)[999] == 1 &&
+            ones_half && ((uint16_t*)ones_half->parray)[999] == 0x3C00 &&
+            ones_bf16 && ((uint16_t*)ones_bf16->parray)[999] == 0x3F80, "ones() in every encoding");
+     Array* steps = array_arange(-5, 5, 1, INT16, false);
+     Array* points = array_linspace(0, 1, 5, FLOAT16, false);
+     ASSERT(steps && steps->count == 10 && ((int16_t*)steps->parray)[0] == -5 && ((int16_t*)steps->parray)[9] == 4,
+            "arange over INT16");
+     ASSERT(points && array_float16_to_float(((uint16_t*)points->parray)[1]) == 0.25f &&
+            array_float16_to_float(((uint16_t*)points->parray)[4]) == 1.0f, "linspace over FLOAT16");
+     
+     // Copies, strided copies and arithmetic
+     Array* grid = array_arange(0, 60000, 1, UINT16, false);
+     array_set_shape(grid, (size_t[]){200, 300}, 2);
+     Array* t = array_transpose(grid);
+     Array* t_copy = array_copy(t, false);
+     Array* dyn = array_copy(grid, true);
+     ASSERT(t_copy && ((uint16_t*)t_copy->parray)[1] == 300 && ((uint16_t*)t_copy->parray)[299 * 200 + 199] == 59999 &&
+            dyn && ((uint16_t*)dyn->parray)[59999] == 59999, "Copies of UINT16 arrays and transposed views");
+     Array* wrapped = array_add(ones8, ones8);
+     ASSERT(wrapped && wrapped->type == UINT8 && ((uint8_t*)wrapped->parray)[0] == 2, "Arithmetic on UINT8");
+     ASSERT(array_sum(ones64) == 1000.0 && array_max(grid) == 59999.0, "Reductions over INT64 and UINT16");
+     
+     // Scalar rounding: ties to even, overflow to infinity, subnormals
+     ASSERT(array_float_to_float16(65504.0f) == 0x7BFF && array_float_to_float16(65520.0f) == 0x7C00 &&
+            array_float_to_float16(1.0f / 3.0f) == 0x3555 && array_float_to_float16(0x1p-24f) == 0x0001 &&
+            array_float_to_float16(0x1p-25f) == 0x0000 && array_float_to_float16(-0x1.8p-25f) == 0x8001 &&
+            array_float_to_float16(1.0f + 0x1p-11f) == 0x3C00 && array_float_to_float16(1.0f + 0x3p-11f) == 0x3C02,
+            "FLOAT16 rounding");
+     ASSERT(array_float_to_bfloat16(1.0f / 3.0f) == 0x3EAB && array_float_to_bfloat16(1.0f + 0x1p-8f) == 0x3F80 &&
+            array_float_to_bfloat16(1.0f + 0x3p-8f) == 0x3F82 && array_float_to_bfloat16(INFINITY) == 0x7F80 &&
+            array_float_to_bfloat16(NAN) >= 0x7FC0, "BFLOAT16 rounding");
+     ASSERT(array_float16_to_float(0x0001) == 0x1p-24f && array_float16_to_float(0xFBFF) == -65504.0f &&
+            array_bfloat16_to_float(0x3EAB) == 0.333984375f, "Widening is exact");
+     
+     // Every conversion variant against the scalar one: all 16-bit patterns
+     // widened, and a spread of float patterns (with the specials) narrowed
+     size_t count = 1 << 16;
+     uint16_t* halves = (uint16_t*)malloc(count * sizeof(uint16_t));
+     float* floats = (float*)malloc(count * sizeof(float));
+     float* want = (float*)malloc(count * sizeof(float));
+     float* got = (float*)malloc(count * sizeof(float));
+     uint16_t* want16 = (uint16_t*)malloc(count * sizeof(uint16_t));
+     uint16_t* got16 = (uint16_t*)malloc(count * sizeof(uint16_t));
+     uint32_t state = 12345;
+     for (size_t i = 0; i < count; i++) {
+         halves[i] = (uint16_t)i;
+         state = state * 1664525u + 1013904223u;
+         // Mostly the exponents near the FLOAT16 range, every tenth one anywhere
+         uint32_t bits = i % 10 == 0 ? state : (state & 0x807FFFFFu) | ((100 + (state >> 8) % 48) << 23);
+         memcpy(&floats[i], &bits, sizeof(float));
+     }
+     const float specials[] = { 0.0f, -0.0f, INFINITY, -INFINITY, NAN, 65504.0f, 65520.0f, 0x1p-25f, 0x1p-14f };
+     memcpy(floats, specials, sizeof(specials));
+     bool convert_ok = true;
+     Type half_types[] = { FLOAT16, BFLOAT16 };
+     for (size_t h = 0; h < 2; h++) {
+         ConvertKernelFn widen = get_kernel_variant(KERNEL_TO_FLOAT, half_types[h], ISA_SCALAR).convert;
+         ConvertKernelFn narrow = get_kernel_variant(KERNEL_FROM_FLOAT, half_types[h], ISA_SCALAR).convert;
+         widen(halves, want, count);
+         narrow(floats, want16, count);
+         for (int isa = ISA_SCALAR + 1; isa <= (int)get_runtime_isa_level(); isa++) {
+             ConvertKernelFn fn = get_kernel_variant(KERNEL_TO_FLOAT, half_types[h], (IsaLevel)isa).convert;
+             if (fn) {
+                 fn(halves, got, count - 3);
+                 convert_ok = convert_ok && memcmp(want, got, (count - 3) * sizeof(float)) == 0;
+             }
+             fn = get_kernel_variant(KERNEL_FROM_FLOAT, half_types[h], (IsaLevel)isa).convert;
+             if (fn) {
+                 fn(floats, got16, count - 3);
+                 convert_ok = convert_ok && memcmp(want16, got16, (count - 3) * sizeof(uint16_t)) == 0;
+             }
+         }
+     }
+     ASSERT(convert_ok, "Every conversion kernel variant matches the scalar one");
+     free(halves); free(floats); free(want); free(got); free(want16); free(got16);
+     
+     // .npy dtypes: FLOAT16 and UINT64 round trip, BFLOAT16 has no equivalent
+     const char* path = "bin/test_arrays.npy";
+     Array* big = array_full(3, UINT64, &(uint64_t){ UINT64_MAX }, false);
+     ASSERT(array_save_npy(points, path), "Save a FLOAT16 array");
+     Array* p_loaded = array_load_npy(path);
+     ASSERT(p_loaded && p_loaded->type == FLOAT16 && ((uint16_t*)p_loaded->parray)[4] == 0x3C00, "Load a FLOAT16 array");
+     ASSERT(array_save_npy(big, path), "Save a UINT64 array");
+     Array* b_loaded = array_load_npy(path);
+     ASSERT(b_loaded && b_loaded->type == UINT64 && ((uint64_t*)b_loaded->parray)[2] == UINT64_MAX, "Load a UINT64 array");
+     ASSERT(!array_save_npy(ones_bf16, path), "BFLOAT16 cannot be saved as .npy");
+     
+     array_free(ones64);
+     array_free(ones8);
+     array_free(ones_half);
+     array_free(ones_bf16);
+     array_free(steps);
+     array_free(points);
+     array_free(t);
+     array_free(grid);
+     array_free(t_copy);
+     array_free(dyn);
+     array_free(wrapped);
+     array_free(big);
+     array_free(p_loaded);
+     array_free(b_loaded);
+ }
+ 
+ /**
+  * Element type conversion
+  */
+ void test_astype(void) {
+     printf("\n--- Testing astype ---\n");
+     
+     // Every pair kernel variant against the scalar one, over edge values
+     const Type types[] = { INT, FLOAT, DOUBLE, CHAR, BOOL, INT8, INT16, INT64, UINT8, UINT16, UINT32, UINT64 };
+     const size_t num_types = sizeof(types) / sizeof(types[0]);
+     const double reals[] = { 0.0, -0.0, 0.5, -0.5, -1.5, 127.9, 128.0, -129.0, 255.5, 256.0, 32768.0, -32769.0,
+                              65535.9, 2147483648.0, -2147483649.0, 4294967296.0, 9.3e18, -9.3e18, 1.9e19,
+                              1e30, -1e30, INFINITY, -INFINITY, NAN };
+     const size_t num_reals = sizeof(reals) / sizeof(reals[0]);
+     size_t n = 67;  // odd, so the tails run too
+     uint64_t src[67], want[67], got[67];
+     bool kernels_ok = true;
+     for (size_t s = 0; s < num_types; s++) {
+         uint64_t state = 88172645463325252ull;
+         for (size_t i = 0; i < n; i++) {
+             state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+             double r = reals[i % num_reals] * (i < num_reals ? 1.0 : (double)(state % 1000) / 500.0);
+             if (types[s] == FLOAT) ((float*)src)[i] = (float)r;
+             else if (types[s] == DOUBLE) ((double*)src)[i] = r;
+             else if (types[s] == BOOL) ((bool*)src)[i] = state & 1;
+             else memcpy((char*)src + i * array_sizeof_type(types[s]), &state, array_sizeof_type(types[s]));
+         }
+         const ConvertKernelFn* scalar = get_kernel_variant(KERNEL_ASTYPE, types[s], ISA_SCALAR).astype;
+         for (int isa = ISA_SCALAR + 1; isa <= (int)get_runtime_isa_level(); isa++) {
+             const ConvertKernelFn* table = get_kernel_variant(KERNEL_ASTYPE, types[s], (IsaLevel)isa).astype;
+             if (!table) continue;
+             for (size_t d = 0; d < num_types; d++) {
+                 scalar[types[d]](src, want, n);
+                 table[types[d]](src, got, n);
+                 kernels_ok = kernels_ok && memcmp(want, got, n * array_sizeof_type(types[d])) == 0;
+             }
+         }
+     }
+     ASSERT(kernels_ok, "Every astype kernel variant matches the scalar one");
+     
+     // Saturating narrowings
+     Array* values = array_empty(5, DOUBLE, false);
+     memcpy(values->parray, (double[]){ -1.5, 300.7, NAN, 1e20, -1e20 }, 5 * sizeof(double));
+     Array* as_u8 = array_astype(values, UINT8);
+     Array* as_int = array_astype(values, INT);
+     Array* as_bool = array_astype(values, BOOL);
+     uint8_t* u8 = (uint8_t*)as_u8->parray;
+     int* iv = (int*)as_int->parray;
+     bool* bv = (bool*)as_bool->parray;
+     ASSERT(as_u8->type == UINT8 && u8[0] == 0 && u8[1] == 255 && u8[2] == 0 && u8[3] == 255 && u8[4] == 0,
+            "DOUBLE to UINT8 clamps and maps NaN to 0");
+     ASSERT(iv[0] == -1 && iv[1] == 300 && iv[2] == 0 && iv[3] == INT_MAX && iv[4] == INT_MIN,
+            "DOUBLE to INT truncates toward zero and clamps");
+     ASSERT(bv[0] && bv[2] && bv[4], "Nonzero values and NaN are true");
+     
+     Array* wide = array_full(3, UINT64, &(uint64_t){ UINT64_MAX }, false);
+     Array* as_i64 = array_astype(wide, INT64);
+     Array* ints = array_arange(-70000, 70000, 35000, INT, false);
+     Array* as_i16 = array_astype(ints, INT16);
+     Array* as_u16 = array_astype(ints, UINT16);
+     int16_t* i16 = (int16_t*)as_i16->parray;
+     ASSERT(((int64_t*)as_i64->parray)[2] == INT64_MAX, "UINT64 to INT64 clamps");
+     ASSERT(i16[0] == INT16_MIN && i16[2] == 0 && i16[3] == 32767 && ((uint16_t*)as_u16->parray)[0] == 0 &&
+            ((uint16_t*)as_u16->parray)[3] == 35000, "INT to INT16 and UINT16 clamp");
+     
+     // 16-bit floats go through FLOAT
+     Array* halves = array_linspace(-2, 2, 9, FLOAT16, false);
+     Array* h_int = array_astype(halves, INT64);
+     Array* h_bf16 = array_astype(halves, BFLOAT16);
+     Array* h_back = array_astype(h_bf16, DOUBLE);
+     Array* d_half = array_astype(h_back, FLOAT16);
+     ASSERT(h_int && ((int64_t*)h_int->parray)[1] == -1 && ((int64_t*)h_int->parray)[8] == 2,
+            "FLOAT16 to INT64");
+     ASSERT(h_back && ((double*)h_back->parray)[1] == -1.5 && d_half &&
+            memcmp(d_half->parray, halves->parray, 9 * sizeof(uint16_t)) == 0,
+            "FLOAT16 to BFLOAT16 to DOUBLE and back is exact for short values");
+     
+     // Large arrays run in parallel chunks; views convert in logical order
+     parallel_set_thread_count(4);
+     Array* big = array_arange(0, 1000003, 1, INT, false);
+     Array* big_f = array_astype(big, FLOAT);
+     bool big_ok = big_f && big_f->count == 1000003;
+     for (size_t i = 0; big_ok && i < big_f->count; i++) big_ok = ((float*)big_f->parray)[i] == (float)i;
+     ASSERT(big_ok, "Parallel INT to FLOAT");
+     parallel_set_thread_count(0);
+     
+     Array* grid = array_arange(0, 12, 1, INT, false);
+     array_set_shape(grid, (size_t[]){ 3, 4 }, 2);
+     Array* t = array_transpose(grid);
+     Array* t_u8 = array_astype(t, UINT8);
+     ASSERT(t_u8 && t_u8->num_dimensions == 2 && t_u8->shape[0] == 4 && ((uint8_t*)t_u8->parray)[1] == 4,
+            "Transposed view converts in logical order");
+     Array* same = array_astype(grid, INT);
+     ASSERT(same && same->type == INT && ((int*)same->parray)[11] == 11, "Same type is a copy");
+     Array* strings = array_string_full(2, "x", false);
+     ASSERT(!array_astype(strings, INT) && !array_astype(grid, STRING), "STRING is rejected");
+     
+     array_free(values);
+     array_free(as_u8);
+     array_free(as_int);
+     array_free(as_bool);
+     array_free(wide);
+     array_free(as_i64);
+     array_free(ints);
+     array_free(as_i16);
+     array_free(as_u16);
+     array_free(halves);
+     array_free(h_int);
+     array_free(h_bf16);
+     array_free(h_back);
+     array_free(d_half);
+     array_free(big);
+     array_free(big_f);
+     array_free(t);
+     array_free(t_u8);
+     array_free(grid);
+     array_free(same);
+     array_free(strings);
+ }
+ 
+ /**
+  * Test bit-packed masks
+  */
+ void test_bitmask(void) {
+     printf("\n--- Testing bit masks ---\n");
+     
+     // Every kernel variant against the scalar one, at odd lengths
+     uint64_t a[37], b[37], want[37], got[37];
+     bool bytes[37 * 64], back[37 * 64];
+     int want_pos[37 * 64], got_pos[37 * 64];
+     uint64_t state = 88172645463325252ull;
+     for (size_t i = 0; i < 37; i++) {
+         state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+         a[i] = state;
+         b[i] = i % 5 == 0 ? 0 : state * 0x9E3779B97F4A7C15ull;
+     }
+     for (size_t i = 0; i < 37 * 64; i++) bytes[i] = (bool)((a[i / 64] >> (i % 64)) & (i % 3 != 0));
+     bool kernels_ok = true;
+     for (int isa = ISA_SCALAR + 1; isa <= (int)get_runtime_isa_level(); isa++) {
+         BitwiseKernelFn bitwise = get_kernel_variant(KERNEL_BITWISE, BOOL, (IsaLevel)isa).bitwise;
+         for (int op = BIT_AND; bitwise && op <= BIT_NOT; op++) {
+             get_kernel_variant(KERNEL_BITWISE, BOOL, ISA_SCALAR).bitwise(a, b, want, 37, (BitwiseOp)op);
+             bitwise(a, b, got, 37, (BitwiseOp)op);
+             kernels_ok = kernels_ok && memcmp(want, got, sizeof(want)) == 0;
+         }
+         PopcountKernelFn popcount = get_kernel_variant(KERNEL_POPCOUNT, BOOL, (IsaLevel)isa).popcount;
+         for (size_t n = 0; popcount && n <= 37; n += 3) {
+             kernels_ok = kernels_ok && popcount(a, n) == get_kernel_variant(KERNEL_POPCOUNT, BOOL, ISA_SCALAR).popcount(a, n);
+         }
+         PackBitsKernelFn pack = get_kernel_variant(KERNEL_PACK_BITS, BOOL, (IsaLevel)isa).pack_bits;
+         UnpackBitsKernelFn unpack = get_kernel_variant(KERNEL_UNPACK_BITS, BOOL, (IsaLevel)isa).unpack_bits;
+         for (size_t n = 1; (pack || unpack) && n <= 37 * 64; n += 131) {
+             size_t words = (n + 63) / 64;
+             get_kernel_variant(KERNEL_PACK_BITS, BOOL, ISA_SCALAR).pack_bits(bytes, want, n);
+             if (pack) {
+                 memset(got, 0xFF, sizeof(got));
+                 pack(bytes, got, n);
+                 kernels_ok = kernels_ok && memcmp(want, got, words * sizeof(uint64_t)) == 0;
+             }
+             if (unpack) {
+                 unpack(want, back, n);
+                 kernels_ok = kernels_ok && memcmp(bytes, back, n) == 0;
+             }
+         }
+         BitIndicesKernelFn indices = get_kernel_variant(KERNEL_BIT_INDICES, BOOL, (IsaLevel)isa).bit_indices;
+         if (indices) {
+             size_t n_want = get_kernel_variant(KERNEL_BIT_INDICES, BOOL, ISA_SCALAR).bit_indices(a, 37, 5, want_pos);
+             size_t n_got = indices(a, 37, 5, got_pos);
+             kernels_ok = kernels_ok && n_want == n_got && memcmp(want_pos, got_pos, n_want * sizeof(int)) == 0;
+         }
+     }
+     ASSERT(kernels_ok, "Every bit mask kernel variant matches the scalar one");
+     
+     // Pack and unpack round trip; views pack in logical order
+     Array* grid = array_empty(200, BOOL, false);
+     for (size_t i = 0; i < 200; i++) ((bool*)grid->parray)[i] = i % 3 == 0 || i % 7 == 1;
+     array_set_shape(grid, (size_t[]){ 10, 20 }, 2);
+     Array* mask = array_transpose(grid);
+     BitMask* packed = array_bitmask_pack(mask);
+     Array* unpacked = array_bitmask_unpack(packed);
+     Array* dense_mask = array_copy(mask, false);
+     ASSERT(packed && packed->count == 200 && packed->num_words == 4 && unpacked && unpacked->count == 200 &&
+            memcmp(unpacked->parray, dense_mask->parray, 200) == 0, "BOOL view packs and unpacks in logical order");
+     ASSERT(array_bitmask_count(packed) == array_count_true(mask) && array_bitmask_get(packed, 3) &&
+            !array_bitmask_get(packed, 1), "Packed count and get match the BOOL mask");
+     
+     // Algebra, including NOT keeping the bits past count clear
+     BitMask* evens = array_bitmask_new(200, false);
+     for (size_t i = 0; i < 200; i += 2) array_bitmask_set(evens, i, true);
+     BitMask* both = array_bitmask_and(packed, evens);
+     BitMask* either = array_bitmask_or(packed, evens);
+     BitMask* one = array_bitmask_xor(packed, evens);
+     BitMask* only = array_bitmask_andnot(packed, evens);
+     BitMask* odds = array_bitmask_not(evens);
+     bool algebra_ok = both && either && one && only && odds;
+     for (size_t i = 0; algebra_ok && i < 200; i++) {
+         bool p = array_bitmask_get(packed, i), e = i % 2 == 0;
+         algebra_ok = array_bitmask_get(both, i) == (p && e) && array_bitmask_get(either, i) == (p || e) &&
+                      array_bitmask_get(one, i) == (p != e) && array_bitmask_get(only, i) == (p && !e) &&
+                      array_bitmask_get(odds, i) == !e;
+     }
+     ASSERT(algebra_ok, "AND, OR, XOR, ANDNOT and NOT");
+     ASSERT(array_bitmask_count(odds) == 100 && (odds->words[3] >> 8) == 0, "NOT clears the bits past count");
+     ASSERT(array_bitmask_op(BIT_OR, evens, odds, evens) && array_bitmask_all(evens), "In-place OR");
+     
+     BitMask* full = array_bitmask_new(130, true);
+     BitMask* empty = array_bitmask_new(130, false);
+     BitMask* none = array_bitmask_new(0, false);
+     ASSERT(array_bitmask_all(full) && array_bitmask_count(full) == 130 && !array_bitmask_any(empty) &&
+            !array_bitmask_all(empty) && array_bitmask_all(none) && !array_bitmask_any(none), "any and all");
+     array_bitmask_set(full, 129, false);
+     array_bitmask_set(empty, 129, true);
+     ASSERT(!array_bitmask_all(full) && array_bitmask_any(empty), "any and all see the last element");
+     
+     // Index lists both ways
+     Array* positions = array_bitmask_to_indices(packed);
+     bool positions_ok = positions && positions->type == INT && positions->count == array_bitmask_count(packed);
+     for (size_t i = 0; positions_ok && i < positions->count; i++) {
+         positions_ok = array_bitmask_get(packed, (size_t)((int*)positions->parray)[i]) &&
+                        (i == 0 || ((int*)positions->parray)[i] > ((int*)positions->parray)[i - 1]);
+     }
+     ASSERT(positions_ok, "Indices of the set elements, ascending");
+     BitMask* rebuilt = array_bitmask_from_indices(positions, 200);
+     ASSERT(rebuilt && memcmp(rebuilt->words, packed->words, 4 * sizeof(uint64_t)) == 0, "Indices rebuild the mask");
+     Array* wrapped_idx = array_empty(2, INT, false);
+     memcpy(wrapped_idx->parray, (int[]){ -1, 3 }, 2 * sizeof(int));
+     BitMask* wrapped = array_bitmask_from_indices(wrapped_idx, 10);
+     ASSERT(wrapped && array_bitmask_count(wrapped) == 2 && array_bitmask_get(wrapped, 9), "Negative indices wrap");
+     ((int*)wrapped_idx->parray)[1] = 10;
+     ASSERT(!array_bitmask_from_indices(wrapped_idx, 10), "Out of range indices are rejected");
+     
+     // Large masks run on the thread pool
+     parallel_set_thread_count(4);
+     BitMask* big = array_bitmask_new(1000003, false);
+     for (size_t i = 0; i < 1000003; i += 7) array_bitmask_set(big, i, true);
+     Array* big_pos = array_bitmask_to_indices(big);
+     BitMask* big_not = array_bitmask_not(big);
+     bool big_ok = big_pos && big_pos->count == 142858 && array_bitmask_count(big) == 142858 &&
+                   array_bitmask_count(big_not) == 1000003 - 142858;
+     for (size_t i = 0; big_ok && i < big_pos->count; i++) big_ok = ((int*)big_pos->parray)[i] == (int)(7 * i);
+     ASSERT(big_ok, "Parallel count, NOT and indices");
+     parallel_set_thread_count(0);
+     
+     ASSERT(!array_bitmask_and(packed, full) && !array_bitmask_op(BIT_NOT, packed, NULL, full),
+            "Masks of different lengths are rejected");
+     ASSERT(!array_bitmask_pack(positions), "Only BOOL arrays pack");
+     
+     array_free(grid);
+     array_free(mask);
+     array_free(unpacked);
+     array_free(dense_mask);
+     array_free(positions);
+     array_free(wrapped_idx);
+     array_free(big_pos);
+     array_bitmask_free(packed);
+     array_bitmask_free(evens);
+     array_bitmask_free(both);
+     array_bitmask_free(either);
+     array_bitmask_free(one);
+     array_bitmask_free(only);
+     array_bitmask_free(odds);
+     array_bitmask_free(full);
+     array_bitmask_free(empty);
+     array_bitmask_free(none);
+     array_bitmask_free(rebuilt);
+     array_bitmask_free(wrapped);
+     array_bitmask_free(big);
+     array_bitmask_free(big_not);
+ }
+ 
+ /**
+  * Test compressed INT arrays
+  */
+ void test_compress(void) {
+     printf("\n--- Testing compression ---\n");
+     
+     // Every kernel variant against the scalar one, at every width
+     int block[BITPACK_BLOCK], got[BITPACK_BLOCK];
+     uint32_t want_packed[4 * 32], got_packed[4 * 32];
+     bool kernels_ok = true;
+     uint64_t state = 88172645463325252ull;
+     for (unsigned bits = 0; bits <= 32; bits++) {
+         for (size_t i = 0; i < BITPACK_BLOCK; i++) {
+             state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+             uint32_t mask = bits == 32 ? UINT32_MAX : ((uint32_t)1 << bits) - 1;
+             block[i] = (int)((uint32_t)(state & mask) + (uint32_t)-1000);
+         }
+         get_kernel_variant(KERNEL_BITPACK, INT, ISA_SCALAR).bitpack(block, -1000, bits, want_packed);
+         get_kernel_variant(KERNEL_BITUNPACK, INT, ISA_SCALAR).bitunpack(want_packed, bits, -1000, got);
+         kernels_ok = kernels_ok && memcmp(block, got, sizeof(block)) == 0;
+         for (int isa = ISA_SCALAR + 1; isa <= (int)get_runtime_isa_level(); isa++) {
+             BitPackKernelFn pack = get_kernel_variant(KERNEL_BITPACK, INT, (IsaLevel)isa).bitpack;
+             BitUnpackKernelFn unpack = get_kernel_variant(KERNEL_BITUNPACK, INT, (IsaLevel)isa).bitunpack;
+             if (pack) {
+                 pack(block, -1000, bits, got_packed);
+                 kernels_ok = kernels_ok && memcmp(want_packed, got_packed, 4 * bits * sizeof(uint32_t)) == 0;
+             }
+             if (unpack) {
+                 memset(got, 0, sizeof(got));
+                 unpack(want_packed, bits, -1000, got);
+                 kernels_ok = kernels_ok && memcmp(block, got, sizeof(block)) == 0;
+             }
+         }
+     }
+     ASSERT(kernels_ok, "Every bit packing kernel variant round-trips and matches the scalar one");
+     
+     // Sorted data packs its steps, narrow data its range
+     size_t n = 100003;  // partial last block
+     Array* sorted = array_empty(n, INT, false);
+     Array* narrow = array_empty(n, INT, false);
+     for (size_t i = 0; i < n; i++) {
+         state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+         ((int*)sorted->parray)[i] = 1000000000 + 3 * (int)i + (int)(state % 3);
+         ((int*)narrow->parray)[i] = -500 + (int)(state % 1000);
+     }
+     parallel_set_thread_count(4);
+     CompressedArray* c_sorted = array_compress(sorted);
+     CompressedArray* c_narrow = array_compress(narrow);
+     Array* d_sorted = array_decompress(c_sorted);
+     Array* d_narrow = array_decompress(c_narrow);
+     parallel_set_thread_count(0);
+     ASSERT(d_sorted && d_sorted->count == n && memcmp(d_sorted->parray, sorted->parray, n * sizeof(int)) == 0 &&
+            d_narrow && memcmp(d_narrow->parray, narrow->parray, n * sizeof(int)) == 0, "Parallel round trips");
+     ASSERT(c_sorted->blocks[1].encoding == COMPRESS_DELTA && c_sorted->blocks[1].bits <= 3 &&
+            array_compressed_bytes(c_sorted) * 5 < n * sizeof(int), "Sorted data is delta encoded");
+     ASSERT(c_narrow->blocks[1].encoding == COMPRESS_FOR && c_narrow->blocks[1].bits == 10 &&
+            array_compressed_bytes(c_narrow) * 2 < n * sizeof(int), "Narrow data is frame-of-reference encoded");
+     bool get_ok = true;
+     for (size_t i = 0; i < n; i += 997) {
+         get_ok = get_ok && array_compressed_get(c_sorted, i) == ((int*)sorted->parray)[i] &&
+                  array_compressed_get(c_narrow, i) == ((int*)narrow->parray)[i];
+     }
+     get_ok = get_ok && array_compressed_get(c_sorted, n - 1) == ((int*)sorted->parray)[n - 1];
+     ASSERT(get_ok, "Random access into FOR and delta blocks");
+     
+     // A constant step takes no bits, partial last block included; near the
+     // end of the INT range the padding past that block must not overflow
+     Array* stepped = array_arange(-50000, 9950000, 1000, INT, false);   // 10000 values
+     CompressedArray* c_stepped = array_compress(stepped);
+     bool no_bits = c_stepped != NULL;
+     for (size_t b = 0; no_bits && b < c_stepped->num_blocks; b++) {
+         no_bits = c_stepped->blocks[b].encoding == COMPRESS_DELTA && c_stepped->blocks[b].bits == 0;
+     }
+     Array* d_stepped = array_decompress(c_stepped);
+     ASSERT(no_bits && d_stepped && memcmp(d_stepped->parray, stepped->parray, 10000 * sizeof(int)) == 0,
+            "Constant-step blocks pack to 0 bits");
+     Array* top = array_arange(INT_MAX - 10 * 20000000.0, INT_MAX, 20000000, INT, false);
+     CompressedArray* c_top = array_compress(top);
+     Array* d_top = array_decompress(c_top);
+     ASSERT(d_top && memcmp(d_top->parray, top->parray, top->count * sizeof(int)) == 0 &&
+            array_compressed_get(c_top, 9) == ((int*)top->parray)[9], "Delta padding near INT_MAX round-trips");
+     array_free(d_top);
+     array_compressed_free(c_top);
+     array_free(top);
+     array_free(d_stepped);
+     array_compressed_free(c_stepped);
+     array_free(stepped);
+     
+     // Extremes, constants and views
+     Array* extremes = array_empty(300, INT, false);
+     for (size_t i = 0; i < 300; i++) ((int*)extremes->parray)[i] = i % 2 ? INT_MAX : INT_MIN + (int)i;
+     Array* constant = array_full(200, INT, &(int){ 7 }, false);
+     Array* grid = array_arange(0, 600, 1, INT, false);
+     array_set_shape(grid, (size_t[]){ 20, 30 }, 2);
+     Array* t = array_transpose(grid);
+     Array* t_dense = array_copy(t, false);
+     CompressedArray* c_extremes = array_compress(extremes);
+     CompressedArray* c_constant = array_compress(constant);
+     CompressedArray* c_view = array_compress(t);
+     Array* d_extremes = array_decompress(c_extremes);
+     Array* d_constant = array_decompress(c_constant);
+     Array* d_view = array_decompress(c_view);
+     ASSERT(d_extremes && memcmp(d_extremes->parray, extremes->parray, 300 * sizeof(int)) == 0 &&
+            c_extremes->blocks[0].bits == 32, "Full-range values use 32 bits");
+     ASSERT(d_constant && ((int*)d_constant->parray)[199] == 7 && c_constant->packed_words == 0,
+            "Constant blocks take no packed words");
+     ASSERT(d_view && memcmp(d_view->parray, t_dense->parray, 600 * sizeof(int)) == 0,
+            "Views compress in logical order");
+     
+     // Reductions match the uncompressed ones
+     bool reduce_ok = true;
+     const ReduceOp ops[] = { REDUCE_SUM, REDUCE_MEAN, REDUCE_MIN, REDUCE_MAX };
+     for (size_t o = 0; o < 4; o++) {
+         double want, got_value;
+         reduce_ok = reduce_ok && array_reduce(ops[o], sorted, &want) &&
+                     array_compressed_reduce(ops[o], c_sorted, &got_value) && want == got_value;
+         reduce_ok = reduce_ok && array_reduce(ops[o], extremes, &want) &&
+                     array_compressed_reduce(ops[o], c_extremes, &got_value) && want == got_value;
+     }
+     ASSERT(reduce_ok, "SUM, MEAN, MIN and MAX on compressed blocks");
+     
+     // Comparisons match the uncompressed ones, with whole blocks decided from their ranges
+     bool compare_ok = true;
+     const int thresholds[] = { -501, -500, 0, 499, 500, 7, 1000150000 };
+     for (int cmp = CMP_EQ; cmp <= CMP_GE; cmp++) {
+         for (size_t k = 0; k < sizeof(thresholds) / sizeof(thresholds[0]); k++) {
+             const Array* sources[] = { narrow, sorted, constant };
+             const CompressedArray* compressed[] = { c_narrow, c_sorted, c_constant };
+             for (size_t s = 0; s < 3; s++) {
+                 Array* want = array_compare_value((CompareOp)cmp, sources[s], &thresholds[k]);
+                 BitMask* want_bits = array_bitmask_pack(want);
+                 BitMask* got_bits = array_compressed_compare((CompareOp)cmp, compressed[s], thresholds[k]);
+                 compare_ok = compare_ok && got_bits && got_bits->count == want_bits->count &&
+                              memcmp(got_bits->words, want_bits->words, want_bits->num_words * sizeof(uint64_t)) == 0;
+                 array_free(want);
+                 array_bitmask_free(want_bits);
+                 array_bitmask_free(got_bits);
+             }
+         }
+     }
+     ASSERT(compare_ok, "Comparisons on compressed blocks");
+     
+     Array* empty = array_empty(0, INT, false);
+     CompressedArray* c_empty = array_compress(empty);
+     Array* d_empty = array_decompress(c_empty);
+     double sum = -1.0, min;
+     ASSERT(c_empty && d_empty && d_empty->count == 0 && array_compressed_reduce(REDUCE_SUM, c_empty, &sum) &&
+            sum == 0.0 && !array_compressed_reduce(REDUCE_MIN, c_empty, &min), "Empty arrays");
+     Array* floats = array_empty(4, FLOAT, true);
+     ASSERT(!array_compress(floats), "Only INT arrays compress");
+     ASSERT(!array_compressed_reduce(REDUCE_PROD, c_sorted, &sum), "Unsupported reductions are rejected");
+     
+     array_free(sorted);
+     array_free(narrow);
+     array_free(d_sorted);
+     array_free(d_narrow);
+     array_free(extremes);
+     array_free(constant);
+     array_free(grid);
+     array_free(t);
+     array_free(t_dense);
+     array_free(d_extremes);
+     array_free(d_constant);
+     array_free(d_view);
+     array_free(empty);
+     array_free(d_empty);
+     array_free(floats);
+     array_compressed_free(c_sorted);
+     array_compressed_free(c_narrow);
+     array_compressed_free(c_extremes);
+     array_compressed_free(c_constant);
+     array_compressed_free(c_view);
+     array_compressed_free(c_empty);
+ }
+ 
+ /**
+  * Sparse matrix of rows x cols with about one nonzero in `every`, some empty
+  * rows and, when long_row, a row with more entries than one SpMV run
+  */
+ static Array* sparse_pattern(size_t rows, size_t cols, size_t every, bool long_row, Type type) {
+     Array* m = array_zeros(rows * cols, type, false);
+     uint64_t state = 88172645463325252ull;
+     for (size_t i = 0; i < rows * cols; i++) {
+         state ^= state << 13; state ^= state >> 7; state ^= state << 17;
+         size_t r = i / cols;
+         bool set = (r % 7 != 3 && state % every == 0) || (long_row && r == 1);
+         double v = set ? (double)(state % 19) - 9.0 + 0.5 : 0.0;
+         if (type == FLOAT) ((float*)m->parray)[i] = (float)v;
+         else ((double*)m->parray)[i] = v;
+     }
+     array_set_shape(m, (size_t[]){ rows, cols }, 2);
+     return m;
+ }
+ 
+ /**
+  * Test sparse matrices
+  */
+ void test_sparse(void) {
+     printf("\n--- Testing sparse matrices ---\n");
+     
+     // Dense round trips in every format
+     Array* m = sparse_pattern(50, 70, 20, false, FLOAT);
+     size_t nonzeros = 0;
+     for (size_t i = 0; i < m->count; i++) nonzeros += ((float*)m->parray)[i] != 0.0f;
+     bool round_ok = true;
+     for (int f = SPARSE_COO; f <= SPARSE_CSC; f++) {
+         SparseArray* s = array_sparse_from_dense(m, (SparseFormat)f);
+         Array* back = s ? array_sparse_to_dense(s) : NULL;
+         round_ok = round_ok && s && s->format == (SparseFormat)f && s->nnz == nonzeros && back &&
+                    back->num_dimensions == 2 && back->shape[0] == 50 && back->shape[1] == 70 &&
+                    memcmp(back->parray, m->parray, m->count * sizeof(float)) == 0;
+         array_sparse_free(s);
+         array_free(back);
+     }
+     ASSERT(nonzeros > 0 && round_ok, "Dense to COO, CSR and CSC and back");
+     
+     SparseArray* csr = array_sparse_from_dense(m, SPARSE_CSR);
+     bool sorted_ok = csr->offsets[0] == 0 && csr->offsets[50] == csr->nnz;
+     for (size_t r = 0; r < 50; r++) {
+         for (size_t k = csr->offsets[r]; k + 1 < csr->offsets[r + 1]; k++) {
+             sorted_ok = sorted_ok && csr->col_indices[k] < csr->col_indices[k + 1];
+         }
+         sorted_ok = sorted_ok && (r % 7 != 3 || csr->offsets[r] == csr->offsets[r + 1]);
+     }
+     ASSERT(sorted_ok, "CSR rows are sorted by column, empty rows have no entries");
+     
+     // Conversions between formats
+     SparseArray* csc = array_sparse_convert(csr, SPARSE_CSC);
+     SparseArray* coo = array_sparse_convert(csc, SPARSE_COO);
+     SparseArray* csr_again = array_sparse_convert(coo, SPARSE_CSR);
+     ASSERT(csr_again && csr_again->nnz == csr->nnz &&
+            memcmp(csr_again->offsets, csr->offsets, 51 * sizeof(size_t)) == 0 &&
+            memcmp(csr_again->col_indices, csr->col_indices, csr->nnz * sizeof(int)) == 0 &&
+            memcmp(csr_again->values, csr->values, csr->nnz * sizeof(float)) == 0, "CSR to CSC to COO to CSR");
+     
+     // Triplets: unsorted, with a repeated position
+     Array* tr = array_empty(5, INT, false);
+     Array* tc = array_empty(5, INT, false);
+     Array* tv = array_empty(5, DOUBLE, false);
+     memcpy(tr->parray, (int[]){ 2, 0, 2, 1, 2 }, 5 * sizeof(int));
+     memcpy(tc->parray, (int[]){ 3, 1, 0, 2, 3 }, 5 * sizeof(int));
+     memcpy(tv->parray, (double[]){ 1.5, 2.0, -1.0, 4.0, 2.5 }, 5 * sizeof(double));
+     SparseArray* t_coo = array_sparse_from_triplets(3, 4, tr, tc, tv, SPARSE_COO);
+     SparseArray* t_csr = array_sparse_from_triplets(3, 4, tr, tc, tv, SPARSE_CSR);
+     Array* t_dense = array_sparse_to_dense(t_coo);
+     double* td = (double*)t_dense->parray;
+     ASSERT(t_coo->nnz == 5 && t_csr->nnz == 4 && t_csr->offsets[3] == 4 && t_csr->col_indices[2] == 0 &&
+            ((double*)t_csr->values)[3] == 4.0, "CSR from triplets sorts and adds repeats");
+     ASSERT(td[1] == 2.0 && td[6] == 4.0 && td[8] == -1.0 && td[11] == 4.0 && td[0] == 0.0,
+            "COO to dense adds repeats");
+     ((int*)tc->parray)[4] = 4;
+     ASSERT(!array_sparse_from_triplets(3, 4, tr, tc, tv, SPARSE_CSR), "Out of bounds triplets are rejected");
+     
+     // SpMV against a dense product, on the thread pool, with a row longer than one run
+     parallel_set_thread_count(4);
+     Array* big = sparse_pattern(3000, 1500, 50, true, DOUBLE);
+     SparseArray* big_csr = array_sparse_from_dense(big, SPARSE_CSR);
+     SparseArray* big_csc = array_sparse_convert(big_csr, SPARSE_CSC);
+     Array* x = array_linspace(-1.0, 2.0, 1500, DOUBLE, false);
+     Array* y = array_sparse_matvec(big_csr, x);
+     Array* y_csc = array_sparse_matvec(big_csc, x);
+     bool spmv_ok = y && y->count == 3000 && y_csc && memcmp(y->parray, y_csc->parray, 3000 * sizeof(double)) == 0;
+     for (size_t r = 0; spmv_ok && r < 3000; r++) {
+         double want = 0.0;
+         for (size_t c = 0; c < 1500; c++) want += ((double*)big->parray)[r * 1500 + c] * ((double*)x->parray)[c];
+         spmv_ok = fabs(((double*)y->parray)[r] - want) <= 1e-9 * (1.0 + fabs(want));
+     }
+     ASSERT(spmv_ok, "Parallel SpMV matches the dense product");
+     
+     // SpMM against the dense matrix multiply, with a transposed operand
+     Array* b_src = pattern_matrix(40, 1500, DOUBLE, 5);
+     Array* b = array_transpose(b_src);
+     Array* spmm = array_sparse_matmul(big_csr, b);
+     Array* want = array_matmul(big, b);
+     double spmm_err = 0.0;
+     for (size_t i = 0; spmm && i < spmm->count; i++) {
+         double d = fabs(((double*)spmm->parray)[i] - ((double*)want->parray)[i]);
+         if (d > spmm_err) spmm_err = d;
+     }
+     ASSERT(spmm && spmm->shape[0] == 3000 && spmm->shape[1] == 40 && spmm_err < 1e-9,
+            "Parallel SpMM matches the dense matrix multiply");
+     parallel_set_thread_count(0);
+     
+     Array* floats = array_linspace(0.0, 1.0, 70, FLOAT, false);
+     Array* float_y = array_sparse_matvec(csr, floats);
+     ASSERT(float_y && float_y->type == FLOAT, "FLOAT SpMV");
+     ASSERT(!array_sparse_matvec(big_csr, floats) && !array_sparse_matvec(csr, x), "Mismatched SpMV operands are rejected");
+     ASSERT(!array_sparse_matmul(csr, b), "Misaligned SpMM shapes are rejected");
+     ASSERT(!array_sparse_from_dense(tr, SPARSE_CSR), "Only FLOAT and DOUBLE matrices");
+     
+     array_free(m);
+     array_free(tr);
+     array_free(tc);
+     array_free(tv);
+     array_free(t_dense);
+     array_free(big);
+     array_free(x);
+     array_free(y);
+     array_free(y_csc);
+     array_free(b_src);
+     array_free(b);
+     array_free(spmm);
+     array_free(want);
+     array_free(floats);
+     array_free(float_y);
+     array_sparse_free(csr);
+     array_sparse_free(csc);
+     array_sparse_free(coo);
+     array_sparse_free(csr_again);
+     array_sparse_free(t_coo);
+     array_sparse_free(t_csr);
+     array_sparse_free(big_csr);
+     array_sparse_free(big_csc);
+ }
+ 
  int main() {
      printf("===== Array Library Test =====\n\n");
      
@@ -389,7 +2910,34 @@
      array_free(copied_array);
      array_free(dynamic_copy);
      
-     printf("\nAll tests completed successfully!\n");
+     test_allocation();
+     test_views();
+     test_broadcasting();
+     test_fill();
+     test_reductions();
+     test_strings();
+     test_copy_on_write();
+     test_npy();
+     test_expressions();
+     test_thread_pool();
+     test_masks();
+     test_take_put();
+     test_tiled_transpose();
+     test_matmul();
+     test_sort();
+     test_selection();
+     test_scan();
+     test_dtypes();
+     test_astype();
+     test_bitmask();
+     test_compress();
+     test_sparse();
+     
+     if (test_failures == 0) {
+         printf("\nAll tests completed successfully!\n");
+     } else {
+         printf("\n%d test(s) FAILED\n", test_failures);
+     }
      
-     return 0;
+     return test_failures == 0 ? 0 : 1;
  }
\ No newline at end of file
@@ -98,6 +98,128 @@
  #endif
  }
  
+ // Self-test: the dispatched variant must match the best ISA the hardware reports,
+ // and every variant the CPU can execute must produce correct results
+ bool verify_runtime_dispatch(const HardwareProfile* hw) {
+     printf("\n=== RUNTIME DISPATCH SELF-TEST ===\n");
+     bool ok = true;
+     
+     IsaLevel expected = select_isa_level(hw);
+     IsaLevel selected = get_runtime_isa_level();
+     ArrayAddFn add_fn = get_array_add_function();
+     
+     if (selected != expected || add_fn != get_array_add_variant(expected)) {
+         printf("[FAIL] Dispatch picked %s, hardware supports %s\n",
+                isa_level_name(selected), isa_level_name(expected));
+         ok = false;
+     } else {
+         printf("[PASS] Dispatch runs the %s variant\n", isa_level_name(selected));
+     }
+     
+     // Odd length so every variant also exercises its scalar tail
+     const int n = 1000 + 13;
+     float *a, *b, *c;
+     if (posix_memalign((void**)&a, 64, n * sizeof(float)) != 0 ||
+         posix_memalign((void**)&b, 64, n * sizeof(float)) != 0 ||
+         posix_memalign((void**)&c, 64, n * sizeof(float)) != 0) {
+         printf("Memory allocation failed\n");
+         return false;
+     }
+     for (int i = 0; i < n; i++) {
+         a[i] = (float)i * 0.5f;
+         b[i] = (float)(n - i);
+     }
+     
+     for (int isa = ISA_SCALAR; isa <= (int)expected; isa++) {
+         bool correct = true;
+         
+         // Misaligned starts and short lengths exercise the peeled head and masked tail
+         for (int shift = 0; shift < 16 && correct; shift += 5) {
+             for (int len = 0; len < 40 && correct; len += 3) {
+                 int count = (len == 39) ? n - 2 * shift : len;
+                 memset(c, 0, n * sizeof(float));
+                 get_array_add_variant((IsaLevel)isa)(a + shift, b + 2 * shift, c + shift, (size_t)count);
+                 
+                 for (int i = 0; i < n; i++) {
+                     bool inside = i >= shift && i < shift + count;
+                     float want = inside ? a[i] + b[i + shift] : 0.0f;
+                     if (c[i] != want) {
+                         correct = false;
+                         break;
+                     }
+                 }
+             }
+         }
+         printf("[%s] %s variant\n", correct ? "PASS" : "FAIL", isa_level_name((IsaLevel)isa));
+         ok = ok && correct;
+     }
+     
+     free(a);
+     free(b);
+     free(c);
+     return ok;
+ }
+ 
+ // Self-test: every selected registry kernel must agree with its scalar variant
+ bool verify_kernel_registry(void) {
+     printf("\n=== KERNEL REGISTRY SELF-TEST ===\n");
+     const Type types[] = { INT, FLOAT, DOUBLE, CHAR, BOOL };
+     const char* type_names[] = { "INT", "FLOAT", "DOUBLE", "CHAR", "BOOL" };
+     const KernelOp binary_ops[] = { KERNEL_ADD, KERNEL_SUB, KERNEL_MUL, KERNEL_DIV,
+                                     KERNEL_MIN, KERNEL_MAX };
+     const size_t n = 257;
+     bool ok = true;
+     
+     // Byte patterns stay small so every type sees valid, non-zero values
+     unsigned char a[257 * sizeof(double)], b[257 * sizeof(double)];
+     unsigned char expected[257 * sizeof(double)], actual[257 * sizeof(double)];
+     
+     for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++) {
+         Type type = types[t];
+         size_t width = array_sizeof_type(type);
+         for (size_t i = 0; i < n; i++) {
+             switch (type) {
+                 case INT:    ((int*)a)[i] = (int)i - 100; ((int*)b)[i] = (int)(i % 7) + 1; break;
+                 case FLOAT:  ((float*)a)[i] = (float)i * 0.25f; ((float*)b)[i] = (float)(i % 5) + 1.0f; break;
+                 case DOUBLE: ((double*)a)[i] = (double)i * 0.5; ((double*)b)[i] = (double)(i % 3) + 1.0; break;
+                 case CHAR:   ((char*)a)[i] = (char)(i % 50); ((char*)b)[i] = (char)(i % 9 + 1); break;
+                 case BOOL:   ((bool*)a)[i] = (i % 2) != 0; ((bool*)b)[i] = (i % 3) != 0; break;
+                 default: break;
+             }
+         }
+         
+         bool type_ok = true;
+         for (size_t o = 0; o < sizeof(binary_ops) / sizeof(binary_ops[0]); o++) {
+             Kernel best = get_kernel(binary_ops[o], type);
+             Kernel scalar = get_kernel_variant(binary_ops[o], type, ISA_SCALAR);
+             if (!best.binary || !scalar.binary) continue;  // op not defined for type
+             scalar.binary(a, b, expected, n);
+             best.binary(a, b, actual, n);
+             type_ok = type_ok && memcmp(expected, actual, n * width) == 0;
+         }
+         
+         Kernel cmp = get_kernel(KERNEL_COMPARE, type);
+         bool mask[257];
+         cmp.compare(a, b, mask, n, CMP_LT);
+         for (size_t i = 0; i < n && type_ok; i++) {
+             get_kernel_variant(KERNEL_COMPARE, type, ISA_SCALAR).compare(a + i * width, b + i * width,
+                                                                          (bool*)expected, 1, CMP_LT);
+             type_ok = mask[i] == ((bool*)expected)[0];
+         }
+         
+         get_kernel(KERNEL_FILL, type).fill(actual, a + 3 * width, n);
+         get_kernel(KERNEL_COPY, type).copy(expected, actual, n);
+         for (size_t i = 0; i < n && type_ok; i++) {
+             type_ok = memcmp(expected + i * width, a + 3 * width, width) == 0;
+         }
+         
+         printf("[%s] %s kernels (%s)\n", type_ok ? "PASS" : "FAIL", type_names[t],
+                isa_level_name(get_kernel_isa(KERNEL_ADD, type)));
+         ok = ok && type_ok;
+     }
+     return ok;
+ }
+ 
  // Suggest optimal block sizes for matrix operations
  void suggest_matrix_blocking(const HardwareProfile* hw) {
      printf("\n=== MATRIX OPERATION RECOMMENDATIONS ===\n");
@@ -164,24 +286,12 @@
      // Initialize runtime dispatch based on detected features
      init_runtime_dispatch(&hw);
      
-     // Get the selected function name for information
-    //  ArrayAddFn selected_fn = get_array_add_function();
+     // Verify the dispatched variant is the one the hardware profile calls for
      printf("\n=== SELECTED IMPLEMENTATIONS ===\n");
-     printf("Array addition: ");
-     
-     // This requires some way to identify which function was selected
-     // We'll just make an educated guess based on CPU features
-     if (hw.cpu_features.avx512f) {
-         printf("AVX-512 implementation\n");
-     } else if (hw.cpu_features.avx2) {
-         printf("AVX2 implementation\n");
-     } else if (hw.cpu_features.avx) {
-         printf("AVX implementation\n");
-     } else if (hw.cpu_features.sse2) {
-         printf("SSE2 implementation\n");
-     } else {
-         printf("Scalar implementation\n");
-     }
+     IsaLevel isa = get_runtime_isa_level();
+     printf("Array addition: %s implementation\n", isa_level_name(isa));
+     bool dispatch_ok = verify_runtime_dispatch(&hw);
+     dispatch_ok = verify_kernel_registry() && dispatch_ok;
      
      // Run benchmark
      benchmark_array_operations(&hw);
@@ -190,8 +300,12 @@
      suggest_matrix_blocking(&hw);
      
      printf("\n===================================================\n");
-     printf("Hardware detection completed successfully!\n");
+     if (dispatch_ok) {
+         printf("Hardware detection completed successfully!\n");
+     } else {
+         printf("Hardware detection finished with dispatch failures!\n");
+     }
      printf("===================================================\n");
      
-     return 0;
+     return dispatch_ok ? 0 : 1;
  }
\ No newline at end of file
@@ -1,49 +1,3 @@
-// Instead of repeating POSIX vs Windows logic everywhere, create in a new file:
-#ifndef MEMORY_UTILS_H
-#define MEMORY_UTILS_H
-
-#include <stdlib.h>
-#include <stddef.h>
-
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-void* aligned_malloc(size_t size, size_t alignment);
-void aligned_free(void* ptr);
-
-#ifdef __cplusplus
-}
-#endif
-
-#endif // MEMORY_UTILS_H
-
-#include "../../include/utils/memory.h"
-
-#ifdef _WIN32
-#include <malloc.h>
-#endif
-
-void* aligned_malloc(size_t size, size_t alignment) {
-#ifdef _WIN32
-    return _aligned_malloc(size, alignment);
-#else
-    void* ptr = NULL;
-    if (posix_memalign(&ptr, alignment, size) != 0) {
-        return NULL;
-    }
-    return ptr;
-#endif
-}
-
-void aligned_free(void* ptr) {
-#ifdef _WIN32
-    _aligned_free(ptr);
-#else
-    free(ptr);
-#endif
-}
-
 // add benchmark
 #include "../../include/hardware/hardware_detection.h"
 #include "../../include/runtime/runtime_dispatch.h"